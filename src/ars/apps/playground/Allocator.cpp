@@ -0,0 +1,147 @@
+#include <ars/runtime/core/Log.h>
+#include <ars/runtime/core/misc/OffsetAllocator.h>
+#include <chrono>
+#include <map>
+#include <random>
+#include <vector>
+
+using namespace ars;
+
+// Checks OffsetAllocator against a reference map of live ranges, then
+// measures alloc/free speed and fragmentation under random churn.
+namespace {
+struct LiveRange {
+    OffsetAllocator::Allocation allocation;
+    uint32_t size;
+};
+
+bool check_no_overlap(const std::map<uint32_t, uint32_t> &ranges,
+                      uint32_t capacity) {
+    uint32_t end = 0;
+    for (auto &[offset, size] : ranges) {
+        if (offset < end || offset + size > capacity) {
+            return false;
+        }
+        end = offset + size;
+    }
+    return true;
+}
+
+bool verify(uint32_t seed) {
+    constexpr uint32_t capacity = 1 << 20;
+    OffsetAllocator allocator(capacity);
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<uint32_t> size_dist(1, 4096);
+
+    std::vector<LiveRange> live{};
+    std::map<uint32_t, uint32_t> ranges{};
+    uint32_t used = 0;
+
+    for (int step = 0; step < 200000; step++) {
+        if (step == 100000) {
+            // Growing keeps existing allocations valid
+            allocator.grow(capacity * 2);
+        }
+
+        if (live.empty() || rng() % 100 < 55) {
+            auto size = size_dist(rng);
+            auto allocation = allocator.allocate(size);
+            if (!allocation.valid()) {
+                continue;
+            }
+            if (allocator.allocation_size(allocation) != size ||
+                ranges.count(allocation.offset) != 0) {
+                ARS_LOG_ERROR("Invalid allocation at step {}", step);
+                return false;
+            }
+            ranges[allocation.offset] = size;
+            live.push_back({allocation, size});
+            used += size;
+        } else {
+            auto i = rng() % live.size();
+            allocator.free(live[i].allocation);
+            ranges.erase(live[i].allocation.offset);
+            used -= live[i].size;
+            live[i] = live.back();
+            live.pop_back();
+        }
+
+        if (step % 1000 == 0) {
+            auto stats = allocator.stats();
+            if (!check_no_overlap(ranges, allocator.size()) ||
+                stats.total_free != allocator.size() - used ||
+                stats.allocation_count != live.size()) {
+                ARS_LOG_ERROR("Allocator state mismatch at step {}", step);
+                return false;
+            }
+        }
+    }
+
+    // All free regions merge back into one
+    for (auto &r : live) {
+        allocator.free(r.allocation);
+    }
+    auto stats = allocator.stats();
+    if (stats.free_region_count != 1 ||
+        stats.largest_free_region != allocator.size() ||
+        allocator.allocate(allocator.size()).offset != 0) {
+        ARS_LOG_ERROR("Free regions are not merged");
+        return false;
+    }
+    return true;
+}
+
+void bench(uint32_t live_count, uint32_t max_size) {
+    constexpr uint32_t capacity = 1u << 30;
+    OffsetAllocator allocator(capacity);
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<uint32_t> size_dist(16, max_size);
+
+    std::vector<OffsetAllocator::Allocation> live{};
+    for (uint32_t i = 0; i < live_count; i++) {
+        live.push_back(allocator.allocate(size_dist(rng)));
+    }
+
+    constexpr int churn = 1000000;
+    int failed = 0;
+    auto beg = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < churn; i++) {
+        auto &slot = live[rng() % live.size()];
+        allocator.free(slot);
+        slot = allocator.allocate(size_dist(rng));
+        if (!slot.valid()) {
+            failed++;
+        }
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    auto ns = std::chrono::duration<double, std::nano>(end - beg).count();
+
+    auto stats = allocator.stats();
+    auto fragmentation =
+        stats.total_free == 0
+            ? 0.0
+            : 1.0 - double(stats.largest_free_region) / stats.total_free;
+    ARS_LOG_INFO("{} live, size <= {}: {:.1f} ns per free + alloc, {} "
+                 "failed, {} free regions, fragmentation {:.3f}",
+                 live_count,
+                 max_size,
+                 ns / churn,
+                 failed,
+                 stats.free_region_count,
+                 fragmentation);
+}
+} // namespace
+
+int main() {
+    for (uint32_t seed = 0; seed < 4; seed++) {
+        if (!verify(seed)) {
+            return 1;
+        }
+    }
+    ARS_LOG_INFO("OffsetAllocator verification passed");
+
+    bench(1000, 1 << 16);
+    bench(10000, 1 << 16);
+    bench(100000, 1 << 12);
+    return 0;
+}
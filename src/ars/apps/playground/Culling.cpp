@@ -0,0 +1,245 @@
+#include <ars/runtime/core/Log.h>
+#include <ars/runtime/core/math/AABBTree.h>
+#include <ars/runtime/core/math/FrustumCulling.h>
+#include <ars/runtime/render/IScene.h>
+#include <chrono>
+#include <numeric>
+#include <random>
+
+using namespace ars;
+
+// Compares culling strategies used by vk::Scene. Objects are unit cubes
+// scattered in a cube whose size grows with the object count, so density keeps
+// roughly the same.
+namespace {
+template <typename Func> double measure_ms(Func &&func, int repeat) {
+    auto beg = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < repeat; i++) {
+        func();
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<double, std::milli>(end - beg).count() /
+           repeat;
+}
+
+struct Objects {
+    std::vector<glm::mat4> matrices{};
+    std::vector<glm::vec3> aabb_min{};
+    std::vector<glm::vec3> aabb_max{};
+    std::vector<uint32_t> indices{};
+
+    [[nodiscard]] math::AABB<float> aabb(uint32_t index) const {
+        return {aabb_min[index], aabb_max[index]};
+    }
+};
+
+Objects create_objects(size_t count, float half_size, std::mt19937 &rng) {
+    std::uniform_real_distribution<float> pos_dist(-half_size, half_size);
+    std::uniform_real_distribution<float> angle_dist(0.0f, glm::pi<float>());
+
+    Objects objs{};
+    math::AABB<float> aabb_os({-0.5f, -0.5f, -0.5f}, {0.5f, 0.5f, 0.5f});
+    for (size_t i = 0; i < count; i++) {
+        math::XformTRS<float> xform{};
+        xform.set_translation({pos_dist(rng), pos_dist(rng), pos_dist(rng)});
+        xform.set_rotation(glm::angleAxis(angle_dist(rng), glm::vec3(0, 1, 0)));
+        auto matrix = xform.matrix();
+        auto aabb_ws = math::transform_aabb(matrix, aabb_os);
+        objs.matrices.push_back(matrix);
+        objs.aabb_min.push_back(aabb_ws.min);
+        objs.aabb_max.push_back(aabb_ws.max);
+    }
+    objs.indices.resize(count);
+    std::iota(objs.indices.begin(), objs.indices.end(), 0);
+    return objs;
+}
+
+render::Frustum random_frustum(float half_size, std::mt19937 &rng) {
+    std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+    render::Perspective persp{};
+    persp.z_far = half_size;
+    auto frustum = persp.frustum(16.0f / 9.0f);
+    math::XformTRS<float> xform{};
+    xform.set_translation(glm::vec3(dist(rng), dist(rng), dist(rng)) *
+                          half_size * 0.5f);
+    xform.set_rotation(glm::angleAxis(
+        dist(rng) * glm::pi<float>(),
+        glm::normalize(glm::vec3(dist(rng), dist(rng), dist(rng)) + 1e-3f)));
+    return render::transform_frustum(xform.matrix(), frustum);
+}
+
+// SIMD and scalar kernels should give exactly the same result, which should
+// also agree with Frustum::culled
+bool check_equivalence(size_t count, int frustum_count) {
+    std::mt19937 rng(7);
+    auto half_size = 10.0f * std::cbrt(static_cast<float>(count));
+    auto objs = create_objects(count, half_size, rng);
+
+    std::vector<uint32_t> simd(count);
+    std::vector<uint32_t> scalar(count);
+    for (int f = 0; f < frustum_count; f++) {
+        auto frustum = random_frustum(half_size, rng);
+        // Shuffled indices test the gather path
+        auto indices = objs.indices;
+        std::shuffle(indices.begin(), indices.end(), rng);
+
+        auto simd_count = math::cull_aabbs(frustum.planes,
+                                           frustum.plane_count,
+                                           objs.aabb_min.data(),
+                                           objs.aabb_max.data(),
+                                           indices.data(),
+                                           count,
+                                           simd.data());
+        auto scalar_count = math::cull_aabbs_scalar(frustum.planes,
+                                                    frustum.plane_count,
+                                                    objs.aabb_min.data(),
+                                                    objs.aabb_max.data(),
+                                                    indices.data(),
+                                                    count,
+                                                    scalar.data());
+        if (simd_count != scalar_count ||
+            !std::equal(simd.begin(),
+                        simd.begin() + simd_count,
+                        scalar.begin())) {
+            ARS_LOG_ERROR("SIMD culling differs from scalar culling");
+            return false;
+        }
+
+        size_t ref_count = 0;
+        for (auto index : indices) {
+            if (frustum.culled(objs.aabb(index))) {
+                continue;
+            }
+            if (ref_count >= scalar_count || scalar[ref_count] != index) {
+                ARS_LOG_ERROR("Scalar culling differs from Frustum::culled");
+                return false;
+            }
+            ref_count++;
+        }
+        if (ref_count != scalar_count) {
+            ARS_LOG_ERROR("Scalar culling differs from Frustum::culled");
+            return false;
+        }
+    }
+    return true;
+}
+
+void bench(size_t count) {
+    std::mt19937 rng(42);
+    auto half_size = 10.0f * std::cbrt(static_cast<float>(count));
+    auto objs = create_objects(count, half_size, rng);
+    math::AABB<float> aabb_os({-0.5f, -0.5f, -0.5f}, {0.5f, 0.5f, 0.5f});
+
+    math::AABBTree<float, uint32_t> tree{};
+    for (uint32_t i = 0; i < count; i++) {
+        tree.insert(objs.aabb(i), i);
+    }
+
+    render::Perspective persp{};
+    persp.z_far = half_size;
+    auto frustum = persp.frustum(16.0f / 9.0f);
+
+    // The loop Scene::cull used to run, AABBs are transformed on every call
+    size_t transform_visible = 0;
+    auto transform_linear = [&]() {
+        transform_visible = 0;
+        for (auto &matrix : objs.matrices) {
+            auto aabb_ws = math::transform_aabb(matrix, aabb_os);
+            if (!frustum.culled(aabb_ws)) {
+                transform_visible++;
+            }
+        }
+    };
+
+    std::vector<uint32_t> visible(count);
+    size_t scalar_visible = 0;
+    auto scalar_linear = [&]() {
+        scalar_visible = math::cull_aabbs_scalar(frustum.planes,
+                                                 frustum.plane_count,
+                                                 objs.aabb_min.data(),
+                                                 objs.aabb_max.data(),
+                                                 objs.indices.data(),
+                                                 count,
+                                                 visible.data());
+    };
+
+    size_t simd_visible = 0;
+    auto simd_linear = [&]() {
+        simd_visible = math::cull_aabbs(frustum.planes,
+                                        frustum.plane_count,
+                                        objs.aabb_min.data(),
+                                        objs.aabb_max.data(),
+                                        objs.indices.data(),
+                                        count,
+                                        visible.data());
+    };
+
+    // Same as Scene::cull
+    size_t tree_visible = 0;
+    std::vector<uint32_t> candidates{};
+    auto hierarchical = [&]() {
+        tree_visible = 0;
+        candidates.clear();
+        auto test = [&](const math::AABB<float> &aabb) {
+            if (frustum.culled(aabb)) {
+                return math::Containment::Disjoint;
+            }
+            if (frustum.contains(aabb)) {
+                return math::Containment::Contain;
+            }
+            return math::Containment::Intersect;
+        };
+        auto visit = [&](uint32_t index, bool contained) {
+            if (contained) {
+                tree_visible++;
+            } else {
+                candidates.push_back(index);
+            }
+        };
+        tree.query(test, visit);
+        tree_visible += math::cull_aabbs(frustum.planes,
+                                         frustum.plane_count,
+                                         objs.aabb_min.data(),
+                                         objs.aabb_max.data(),
+                                         candidates.data(),
+                                         candidates.size(),
+                                         visible.data());
+    };
+
+    auto repeat = static_cast<int>(std::max<size_t>(1, 1000000 / count));
+    auto transform_ms = measure_ms(transform_linear, repeat);
+    auto scalar_ms = measure_ms(scalar_linear, repeat);
+    auto simd_ms = measure_ms(simd_linear, repeat);
+    auto tree_ms = measure_ms(hierarchical, repeat);
+
+    ARS_LOG_INFO("{:>8} objects, {} visible", count, simd_visible);
+    ARS_LOG_INFO("    transform + linear {:.3f} ms", transform_ms);
+    ARS_LOG_INFO("    scalar kernel      {:.3f} ms", scalar_ms);
+    ARS_LOG_INFO("    SIMD kernel        {:.3f} ms", simd_ms);
+    ARS_LOG_INFO("    tree + SIMD kernel {:.3f} ms (height {})",
+                 tree_ms,
+                 tree.height());
+    if (transform_visible != scalar_visible ||
+        scalar_visible != simd_visible || simd_visible != tree_visible) {
+        ARS_LOG_ERROR("Visible count mismatch: {} {} {} {}",
+                      transform_visible,
+                      scalar_visible,
+                      simd_visible,
+                      tree_visible);
+    }
+}
+} // namespace
+
+int main() {
+    for (size_t count : {3, 1000, 10001}) {
+        if (!check_equivalence(count, 64)) {
+            return 1;
+        }
+    }
+    ARS_LOG_INFO("SIMD culling is bit exact with scalar culling");
+
+    for (size_t count : {1000, 10000, 100000, 1000000}) {
+        bench(count);
+    }
+    return 0;
+}
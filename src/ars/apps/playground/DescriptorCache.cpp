@@ -0,0 +1,150 @@
+#include "Headless.h"
+#include "Scenes.h"
+#include <ars/runtime/core/Core.h>
+#include <ars/runtime/core/Log.h>
+#include <ars/runtime/render/IContext.h>
+#include <ars/runtime/render/IScene.h>
+#include <ars/runtime/render/vk/Capture.h>
+#include <ars/runtime/render/vk/Context.h>
+#include <ars/runtime/render/vk/Pipeline.h>
+#include <chrono>
+#include <vector>
+
+using namespace ars;
+
+// Measures descriptor sets written per frame and CPU time of
+// DescriptorEncoder::commit with the descriptor set cache enabled and
+// disabled. Commands are captured instead of executed, so a software vulkan
+// driver is enough.
+namespace {
+struct Result {
+    double cpu_ms = 0.0;
+    double allocated_sets = 0.0;
+    double written_sets = 0.0;
+    double hit_rate = 0.0;
+};
+
+void log_result(const char *name, bool cached, const Result &r) {
+    ARS_LOG_INFO("{} ({}): {:.3f} ms CPU, {:.1f} sets allocated, {:.1f} sets "
+                 "written per frame, {:.1f}% cache hits",
+                 name,
+                 cached ? "cached" : "not cached",
+                 r.cpu_ms,
+                 r.allocated_sets,
+                 r.written_sets,
+                 r.hit_rate * 100.0);
+}
+
+// Run frames and average what they do, func returns the CPU time to count
+template <typename Func>
+Result bench(render::vk::Context *ctx, bool cached, Func &&func) {
+    constexpr int warm_up_count = 3;
+    constexpr int frame_count = 30;
+    auto cache = ctx->descriptor_set_cache();
+    cache->set_enabled(cached);
+
+    render::vk::CommandCapture capture(ctx);
+    Result result{};
+    uint64_t allocated = 0, written = 0, hits = 0, lookups = 0;
+    for (int i = 0; i < warm_up_count + frame_count; i++) {
+        capture.clear();
+        auto cache_beg = cache->stats();
+        if (!ctx->begin_frame()) {
+            continue;
+        }
+        auto cpu_ms = func();
+        ctx->end_frame();
+        if (i < warm_up_count) {
+            continue;
+        }
+        auto stats = capture.stats();
+        auto cache_end = cache->stats();
+        result.cpu_ms += cpu_ms;
+        allocated += stats.allocated_descriptor_set_count;
+        written += stats.written_descriptor_set_count;
+        hits += cache_end.hit_count - cache_beg.hit_count;
+        lookups += cache_end.hit_count - cache_beg.hit_count +
+                   cache_end.miss_count - cache_beg.miss_count;
+    }
+    result.cpu_ms /= frame_count;
+    result.allocated_sets = static_cast<double>(allocated) / frame_count;
+    result.written_sets = static_cast<double>(written) / frame_count;
+    result.hit_rate =
+        lookups == 0 ? 0.0 : static_cast<double>(hits) / lookups;
+    cache->set_enabled(true);
+    return result;
+}
+
+// Commit the same few descriptor sets many times, which is what passes
+// drawing or dispatching with unchanged resources do every frame
+void bench_commits(render::vk::Context *ctx) {
+    using namespace render::vk;
+    constexpr int commit_count = 2000;
+    constexpr int texture_count = 16;
+
+    auto pipeline = ComputePipeline::create(ctx, "AddInplace.comp");
+    auto target_info = TextureCreateInfo::sampled_2d(
+        VK_FORMAT_B10G11R11_UFLOAT_PACK32, 64, 64, 1);
+    target_info.usage |= VK_IMAGE_USAGE_STORAGE_BIT;
+    auto target = ctx->create_texture(target_info);
+    std::vector<Handle<Texture>> textures{};
+    for (int i = 0; i < texture_count; i++) {
+        textures.push_back(ctx->create_texture(TextureCreateInfo::sampled_2d(
+            VK_FORMAT_R8G8B8A8_UNORM, 64, 64, 1)));
+    }
+
+    auto record = [&]() {
+        double cpu_ms = 0.0;
+        ctx->queue()->submit_once([&](CommandBuffer *cmd) {
+            pipeline->bind(cmd);
+            auto beg = std::chrono::high_resolution_clock::now();
+            for (int i = 0; i < commit_count; i++) {
+                DescriptorEncoder desc{};
+                desc.set_texture(0, 0, target.get());
+                desc.set_texture(0, 1, textures[i % texture_count].get());
+                desc.commit(cmd, pipeline.get());
+            }
+            auto end = std::chrono::high_resolution_clock::now();
+            cpu_ms =
+                std::chrono::duration<double, std::milli>(end - beg).count();
+        });
+        return cpu_ms;
+    };
+
+    for (bool cached : {false, true}) {
+        auto r = bench(ctx, cached, record);
+        log_result("2000 commits", cached, r);
+    }
+}
+
+// Render whole frames of a static scene, every pass commits descriptors
+void bench_frames(render::vk::Context *ctx) {
+    playground::GridSceneInfo scene_info{};
+    scene_info.object_count = 1024;
+    scene_info.material_count = 16;
+    auto s = playground::create_grid_scene(ctx, scene_info);
+
+    auto render = [&]() {
+        auto beg = std::chrono::high_resolution_clock::now();
+        s.view->render();
+        auto end = std::chrono::high_resolution_clock::now();
+        return std::chrono::duration<double, std::milli>(end - beg).count();
+    };
+
+    for (bool cached : {false, true}) {
+        auto r = bench(ctx, cached, render);
+        log_result("View render", cached, r);
+    }
+}
+} // namespace
+
+int main() {
+    init_core();
+    {
+        playground::HeadlessContext ctx("Descriptor Cache Benchmark");
+        bench_commits(ctx.get());
+        bench_frames(ctx.get());
+    }
+    destroy_core();
+    return 0;
+}
@@ -0,0 +1,102 @@
+#include "Headless.h"
+#include "Meshes.h"
+#include "Scenes.h"
+#include <ars/runtime/core/Core.h>
+#include <ars/runtime/core/Log.h>
+#include <ars/runtime/render/IContext.h>
+#include <ars/runtime/render/IMaterial.h>
+#include <ars/runtime/render/IScene.h>
+#include <ars/runtime/render/vk/Context.h>
+#include <ars/runtime/render/vk/View.h>
+#include <chrono>
+
+using namespace ars;
+
+// Measures frame time with frames kept in flight, against waiting for the GPU
+// after every frame, which is what one frame in flight does. The camera moves
+// every frame, so per-frame uniform buffers are written while the previous
+// frame may still read its own. Runs headless, so a software vulkan driver
+// like lavapipe is enough, and CPU and GPU work of the driver still overlap.
+namespace {
+struct Result {
+    double frame_ms = 0.0;
+    // Set if consecutive frames were given the same view transform buffer
+    bool shared_transform_buffer = false;
+};
+
+Result bench(render::vk::Context *ctx,
+             render::IView *view,
+             bool wait_each_frame) {
+    auto vk_view = dynamic_cast<render::vk::View *>(view);
+    constexpr int warm_up_count = 5;
+    constexpr int frame_count = 100;
+    Result result{};
+    render::vk::Buffer *last_transform_buffer = nullptr;
+    std::chrono::high_resolution_clock::time_point beg{};
+    for (int i = 0; i < warm_up_count + frame_count; i++) {
+        if (i == warm_up_count) {
+            beg = std::chrono::high_resolution_clock::now();
+        }
+        if (!ctx->begin_frame()) {
+            continue;
+        }
+
+        math::XformTRS<float> xform{};
+        xform.set_translation(
+            {static_cast<float>(i % 20) - 10.0f, 20.0f, 40.0f});
+        xform.set_rotation(glm::angleAxis(-0.5f, glm::vec3(1, 0, 0)));
+        view->set_xform(xform);
+        view->render();
+
+        auto transform_buffer = vk_view->transform_buffer().get();
+        if (transform_buffer == last_transform_buffer &&
+            render::vk::MAX_FRAMES_IN_FLIGHT > 1) {
+            result.shared_transform_buffer = true;
+        }
+        last_transform_buffer = transform_buffer;
+
+        ctx->end_frame();
+        if (wait_each_frame) {
+            ctx->queue()->flush();
+        }
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    result.frame_ms =
+        std::chrono::duration<double, std::milli>(end - beg).count() /
+        frame_count;
+    return result;
+}
+
+bool run(render::vk::Context *ctx) {
+    playground::GridSceneInfo scene_info{};
+    scene_info.object_count = 1024;
+    scene_info.columns = 32;
+    scene_info.spacing = 2.0f;
+    scene_info.meshes = {playground::create_cube(ctx)};
+    auto s = playground::create_grid_scene(ctx, scene_info);
+
+    auto waited = bench(ctx, s.view.get(), true);
+    auto in_flight = bench(ctx, s.view.get(), false);
+    ARS_LOG_INFO("Waiting for the GPU every frame {:.3f} ms/frame, {} frames "
+                 "in flight {:.3f} ms/frame",
+                 waited.frame_ms,
+                 render::vk::MAX_FRAMES_IN_FLIGHT,
+                 in_flight.frame_ms);
+    if (in_flight.shared_transform_buffer) {
+        ARS_LOG_ERROR("Frames in flight share the view transform buffer");
+        return false;
+    }
+    return true;
+}
+} // namespace
+
+int main() {
+    init_core();
+    bool passed = false;
+    {
+        playground::HeadlessContext ctx("Frames In Flight Benchmark");
+        passed = run(ctx.get());
+    }
+    destroy_core();
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,29 @@
+#include "Headless.h"
+#include <ars/runtime/render/IWindow.h>
+
+namespace ars::playground {
+HeadlessContext::HeadlessContext(const std::string &app_name,
+                                 const std::string &cache_dir) {
+    render::ApplicationInfo info{};
+    info.app_name = app_name;
+    info.enable_presentation = false;
+    info.cache_dir = cache_dir;
+    render::init_render_backend(info);
+
+    _context = render::IContext::create(nullptr).first;
+    _vk_context = dynamic_cast<render::vk::Context *>(_context.get());
+}
+
+HeadlessContext::~HeadlessContext() {
+    _context.reset();
+    render::destroy_render_backend();
+}
+
+render::vk::Context *HeadlessContext::get() const {
+    return _vk_context;
+}
+
+render::vk::Context *HeadlessContext::operator->() const {
+    return _vk_context;
+}
+} // namespace ars::playground
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <ars/runtime/core/misc/Macro.h>
+#include <ars/runtime/render/vk/Context.h>
+#include <memory>
+#include <string>
+
+// Context fixture shared by playground executables
+namespace ars::playground {
+// Initializes the render backend without presentation and creates a context,
+// both are destroyed when going out of scope. Runs headless, so a software
+// vulkan driver like lavapipe is enough. The core must be initialized before.
+class HeadlessContext {
+  public:
+    // If cache_dir is empty, the default cache directory of the app is used
+    explicit HeadlessContext(const std::string &app_name,
+                             const std::string &cache_dir = {});
+
+    ARS_NO_COPY_MOVE(HeadlessContext);
+
+    ~HeadlessContext();
+
+    [[nodiscard]] render::vk::Context *get() const;
+    render::vk::Context *operator->() const;
+
+  private:
+    std::unique_ptr<render::IContext> _context{};
+    render::vk::Context *_vk_context = nullptr;
+};
+} // namespace ars::playground
@@ -0,0 +1,140 @@
+#include <ars/runtime/core/Jobs.h>
+#include <ars/runtime/core/Log.h>
+#include <chrono>
+#include <cmath>
+#include <numeric>
+
+using namespace ars;
+
+// Throughput and latency benchmarks for the job system
+namespace {
+using Clock = std::chrono::high_resolution_clock;
+
+double elapsed_ms(Clock::time_point beg) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - beg)
+        .count();
+}
+
+void bench_throughput(size_t job_count) {
+    std::atomic<size_t> finished = 0;
+    jobs::Counter counter{};
+    auto beg = Clock::now();
+    for (size_t i = 0; i < job_count; i++) {
+        jobs::run([&]() { finished++; }, &counter);
+    }
+    jobs::wait(&counter);
+    auto ms = elapsed_ms(beg);
+    ARS_LOG_INFO("Throughput: {} empty jobs in {:.3f} ms, {:.1f} jobs/ms",
+                 finished.load(),
+                 ms,
+                 static_cast<double>(job_count) / ms);
+}
+
+void bench_nested_throughput(size_t outer_count, size_t inner_count) {
+    std::atomic<size_t> finished = 0;
+    jobs::Counter counter{};
+    auto beg = Clock::now();
+    for (size_t i = 0; i < outer_count; i++) {
+        jobs::run(
+            [&]() {
+                // Spawned from workers, these jobs are stolen by others
+                jobs::Counter inner{};
+                for (size_t j = 0; j < inner_count; j++) {
+                    jobs::run([&]() { finished++; }, &inner);
+                }
+                jobs::wait(&inner);
+            },
+            &counter);
+    }
+    jobs::wait(&counter);
+    auto ms = elapsed_ms(beg);
+    ARS_LOG_INFO("Nested throughput: {} jobs in {:.3f} ms, {:.1f} jobs/ms",
+                 finished.load(),
+                 ms,
+                 static_cast<double>(finished.load()) / ms);
+}
+
+void bench_latency(int repeat) {
+    double total_ms = 0.0;
+    double max_ms = 0.0;
+    for (int i = 0; i < repeat; i++) {
+        jobs::Counter counter{};
+        Clock::time_point start{};
+        auto submit = Clock::now();
+        jobs::run([&]() { start = Clock::now(); }, &counter);
+        jobs::wait(&counter);
+        auto ms =
+            std::chrono::duration<double, std::milli>(start - submit).count();
+        total_ms += ms;
+        max_ms = std::max(max_ms, ms);
+    }
+    ARS_LOG_INFO("Latency: average {:.4f} ms, max {:.4f} ms",
+                 total_ms / repeat,
+                 max_ms);
+}
+
+void bench_dependency_chain(size_t length) {
+    std::vector<std::unique_ptr<jobs::Counter>> counters{};
+    std::vector<size_t> order{};
+    auto beg = Clock::now();
+    for (size_t i = 0; i < length; i++) {
+        auto counter = std::make_unique<jobs::Counter>();
+        jobs::Counter *dep = counters.empty() ? nullptr : counters.back().get();
+        jobs::run_after(
+            dep, [&order, i]() { order.push_back(i); }, counter.get());
+        counters.emplace_back(std::move(counter));
+    }
+    jobs::wait(counters.back().get());
+    for (auto &c : counters) {
+        jobs::wait(c.get());
+    }
+    auto ms = elapsed_ms(beg);
+
+    bool in_order = order.size() == length;
+    for (size_t i = 0; in_order && i < length; i++) {
+        in_order = order[i] == i;
+    }
+    ARS_LOG_INFO("Dependency chain: {} jobs in {:.3f} ms, {}",
+                 length,
+                 ms,
+                 in_order ? "in order" : "OUT OF ORDER");
+}
+
+void bench_parallel_for(size_t count) {
+    std::vector<float> data(count);
+    std::iota(data.begin(), data.end(), 0.0f);
+    auto work = [&](size_t beg, size_t end) {
+        for (size_t i = beg; i < end; i++) {
+            data[i] = std::sqrt(data[i]) * std::sin(data[i]);
+        }
+    };
+
+    auto beg = Clock::now();
+    work(0, count);
+    auto serial_ms = elapsed_ms(beg);
+
+    beg = Clock::now();
+    jobs::parallel_for(0, count, 4096, work);
+    auto parallel_ms = elapsed_ms(beg);
+
+    ARS_LOG_INFO("parallel_for: {} elements, serial {:.3f} ms, parallel "
+                 "{:.3f} ms",
+                 count,
+                 serial_ms,
+                 parallel_ms);
+}
+} // namespace
+
+int main() {
+    jobs::init_jobs();
+    ARS_LOG_INFO("{} workers", jobs::worker_count());
+
+    bench_throughput(100000);
+    bench_nested_throughput(64, 1000);
+    bench_latency(1000);
+    bench_dependency_chain(10000);
+    bench_parallel_for(1 << 22);
+
+    jobs::destroy_jobs();
+    return 0;
+}
@@ -0,0 +1,185 @@
+#include <ars/runtime/core/Log.h>
+#include <ars/runtime/render/vk/Scene.h>
+#include <ars/runtime/render/vk/features/LightCulling.h>
+#include <algorithm>
+#include <random>
+#include <vector>
+
+using namespace ars;
+using render::vk::LightClusterGrid;
+using render::vk::LightClusterList;
+using render::vk::PointLightData;
+
+// Checks the CPU light binning used as the reference of ClusterLights.comp.
+// Clusters are compared with a brute force sphere vs cluster AABB test, and
+// points sampled inside each light must land in clusters listing the light.
+// The computed range of point lights is checked against the falloff of
+// Light.glsl too. Runs on the CPU only.
+namespace {
+std::vector<PointLightData> create_lights(size_t count, std::mt19937 &rng) {
+    std::uniform_real_distribution<float> x_dist(-30.0f, 30.0f);
+    std::uniform_real_distribution<float> y_dist(-20.0f, 20.0f);
+    std::uniform_real_distribution<float> z_dist(-60.0f, 5.0f);
+    std::uniform_real_distribution<float> color_dist(0.0f, 1.0f);
+    std::uniform_real_distribution<float> intensity_dist(0.5f, 50.0f);
+
+    std::vector<PointLightData> lights{};
+    for (size_t i = 0; i < count; i++) {
+        render::vk::Light light{};
+        light.color = {color_dist(rng), color_dist(rng), color_dist(rng)};
+        light.intensity = intensity_dist(rng);
+
+        PointLightData data{};
+        data.position = {x_dist(rng), y_dist(rng), z_dist(rng)};
+        data.range = render::vk::point_light_range(light);
+        data.color = light.color;
+        data.intensity = light.intensity;
+        lights.push_back(data);
+    }
+    return lights;
+}
+
+// Radiance of radiance_to_point() in Light.glsl without the range window
+bool check_range(const std::vector<PointLightData> &lights) {
+    for (auto &light : lights) {
+        auto &c = light.color;
+        auto radiance = light.intensity * std::max({c.r, c.g, c.b}) /
+                        (4.0f * glm::pi<float>() * light.range * light.range);
+        auto cutoff = render::vk::POINT_LIGHT_RADIANCE_CUTOFF;
+        if (std::abs(radiance - cutoff) > cutoff * 1e-3f) {
+            ARS_LOG_ERROR("Radiance at the range of a light is {}, expected {}",
+                          radiance,
+                          cutoff);
+            return false;
+        }
+    }
+    return true;
+}
+
+bool intersect_brute_force(const PointLightData &light,
+                           const math::AABB<float> &aabb) {
+    float dist_sqr = 0.0f;
+    for (int axis = 0; axis < 3; axis++) {
+        auto p = light.position[axis];
+        if (p < aabb.min[axis]) {
+            dist_sqr += (aabb.min[axis] - p) * (aabb.min[axis] - p);
+        } else if (p > aabb.max[axis]) {
+            dist_sqr += (p - aabb.max[axis]) * (p - aabb.max[axis]);
+        }
+    }
+    return dist_sqr <= light.range * light.range;
+}
+
+bool check_brute_force(const LightClusterGrid &grid,
+                       const std::vector<PointLightData> &lights,
+                       const LightClusterList &list) {
+    for (uint32_t z = 0; z < grid.size.z; z++) {
+        for (uint32_t y = 0; y < grid.size.y; y++) {
+            for (uint32_t x = 0; x < grid.size.x; x++) {
+                glm::uvec3 cluster(x, y, z);
+                auto aabb = grid.cluster_aabb_vs(cluster);
+                std::vector<uint32_t> expected{};
+                for (uint32_t i = 0; i < lights.size(); i++) {
+                    if (expected.size() >= grid.max_light_count_per_cluster) {
+                        break;
+                    }
+                    if (intersect_brute_force(lights[i], aabb)) {
+                        expected.push_back(i);
+                    }
+                }
+
+                auto range = list.clusters[grid.cluster_index(cluster)];
+                auto count = range.y;
+                auto beg = list.light_indices.begin() + range.x;
+                if (count != expected.size() ||
+                    !std::equal(expected.begin(), expected.end(), beg)) {
+                    ARS_LOG_ERROR("Cluster ({}, {}, {}) has {} lights, brute "
+                                  "force finds {}",
+                                  x,
+                                  y,
+                                  z,
+                                  count,
+                                  expected.size());
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+bool check_coverage(const glm::mat4 &P,
+                    const LightClusterGrid &grid,
+                    const std::vector<PointLightData> &lights,
+                    const LightClusterList &list,
+                    std::mt19937 &rng) {
+    std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+    constexpr int sample_count = 256;
+    for (uint32_t i = 0; i < lights.size(); i++) {
+        auto &light = lights[i];
+        for (int s = 0; s < sample_count; s++) {
+            glm::vec3 offset(dist(rng), dist(rng), dist(rng));
+            if (glm::dot(offset, offset) > 1.0f) {
+                continue;
+            }
+            auto p = light.position + offset * light.range * 0.999f;
+            auto linear_z = -p.z;
+            if (linear_z <= 0.0f || linear_z >= grid.z_far) {
+                continue;
+            }
+            auto p_hclip = P * glm::vec4(p, 1.0f);
+            auto ndc = glm::vec2(p_hclip) / p_hclip.w;
+            if (glm::any(
+                    glm::greaterThanEqual(glm::abs(ndc), glm::vec2(1.0f)))) {
+                continue;
+            }
+
+            auto cluster = grid.locate(ndc * 0.5f + 0.5f, linear_z);
+            auto range = list.clusters[grid.cluster_index(cluster)];
+            auto count = range.y;
+            if (count >= grid.max_light_count_per_cluster) {
+                // Lights beyond the limit are dropped by design
+                continue;
+            }
+            auto beg = list.light_indices.begin() + range.x;
+            if (std::find(beg, beg + count, i) == beg + count) {
+                ARS_LOG_ERROR("Light {} reaches cluster ({}, {}, {}) but is "
+                              "not binned into it",
+                              i,
+                              cluster.x,
+                              cluster.y,
+                              cluster.z);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool check(const render::CameraData &camera, std::mt19937 &rng) {
+    auto P = camera.projection_matrix(16.0f / 9.0f);
+    auto lights = create_lights(128, rng);
+    auto grid = LightClusterGrid::from_view(P, camera, lights);
+    auto list = render::vk::bin_point_lights(grid, lights);
+    return check_range(lights) && check_brute_force(grid, lights, list) &&
+           check_coverage(P, grid, lights, list, rng);
+}
+} // namespace
+
+int main() {
+    std::mt19937 rng(42);
+    render::Perspective persp{};
+    persp.z_near = 0.1f;
+    render::Perspective infinite_persp{};
+    infinite_persp.z_far = 0.0f;
+    render::Orthographic ortho{};
+    ortho.y_mag = 20.0f;
+    for (int i = 0; i < 8; i++) {
+        if (!check(persp, rng) || !check(infinite_persp, rng) ||
+            !check(ortho, rng)) {
+            return 1;
+        }
+    }
+    ARS_LOG_INFO("Light binning matches the brute force test");
+    return 0;
+}
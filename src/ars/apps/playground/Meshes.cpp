@@ -0,0 +1,81 @@
+#include "Meshes.h"
+#include <vector>
+
+namespace ars::playground {
+namespace {
+struct MeshData {
+    std::vector<glm::vec3> positions{};
+    std::vector<glm::vec3> normals{};
+    std::vector<glm::vec4> tangents{};
+    std::vector<glm::vec2> tex_coords{};
+    std::vector<glm::u32vec3> indices{};
+};
+
+std::shared_ptr<render::IMesh> create_mesh(render::IContext *ctx,
+                                           const MeshData &data,
+                                           const math::AABB<float> &aabb) {
+    auto vertex_count = data.positions.size();
+    auto triangle_count = data.indices.size();
+
+    render::MeshInfo info{};
+    info.vertex_capacity = vertex_count;
+    info.triangle_capacity = triangle_count;
+    auto mesh = ctx->create_mesh(info);
+    mesh->set_position(data.positions.data(), 0, vertex_count);
+    mesh->set_normal(data.normals.data(), 0, vertex_count);
+    mesh->set_tangent(data.tangents.data(), 0, vertex_count);
+    mesh->set_tex_coord(data.tex_coords.data(), 0, vertex_count);
+    mesh->set_indices(data.indices.data(), 0, triangle_count);
+    mesh->set_triangle_count(triangle_count);
+    mesh->set_aabb(aabb);
+    return mesh;
+}
+} // namespace
+
+std::shared_ptr<render::IMesh> create_plane(render::IContext *ctx,
+                                            uint32_t n) {
+    MeshData data{};
+    for (uint32_t y = 0; y <= n; y++) {
+        for (uint32_t x = 0; x <= n; x++) {
+            auto uv = glm::vec2(x, y) / static_cast<float>(n);
+            data.positions.emplace_back(uv.x - 0.5f, 0.0f, uv.y - 0.5f);
+            data.normals.emplace_back(0.0f, 1.0f, 0.0f);
+            data.tangents.emplace_back(1.0f, 0.0f, 0.0f, 1.0f);
+            data.tex_coords.push_back(uv);
+        }
+    }
+    for (uint32_t y = 0; y < n; y++) {
+        for (uint32_t x = 0; x < n; x++) {
+            auto i = y * (n + 1) + x;
+            data.indices.emplace_back(i, i + n + 1, i + 1);
+            data.indices.emplace_back(i + 1, i + n + 1, i + n + 2);
+        }
+    }
+    return create_mesh(ctx, data, {{-0.5f, 0.0f, -0.5f}, {0.5f, 0.0f, 0.5f}});
+}
+
+std::shared_ptr<render::IMesh> create_cube(render::IContext *ctx) {
+    MeshData data{};
+    for (int axis = 0; axis < 3; axis++) {
+        for (float sign : {-1.0f, 1.0f}) {
+            glm::vec3 n{}, t{}, b{};
+            n[axis] = sign;
+            t[(axis + 1) % 3] = 1.0f;
+            b = glm::cross(n, t);
+            auto base = static_cast<uint32_t>(data.positions.size());
+            for (int v = 0; v < 4; v++) {
+                glm::vec2 uv(v & 1, v >> 1);
+                auto p = uv * 2.0f - 1.0f;
+                data.positions.push_back((n + t * p.x + b * p.y) * 0.5f);
+                data.normals.push_back(n);
+                data.tangents.emplace_back(t, 1.0f);
+                data.tex_coords.push_back(uv);
+            }
+            data.indices.emplace_back(base, base + 1, base + 2);
+            data.indices.emplace_back(base + 2, base + 1, base + 3);
+        }
+    }
+    return create_mesh(
+        ctx, data, {{-0.5f, -0.5f, -0.5f}, {0.5f, 0.5f, 0.5f}});
+}
+} // namespace ars::playground
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <ars/runtime/render/IMesh.h>
+#include <memory>
+
+// Mesh fixtures shared by playground executables
+namespace ars::playground {
+// Unit plane on the XZ plane facing +Y and centered at the origin, split
+// into n x n quads
+std::shared_ptr<render::IMesh> create_plane(render::IContext *ctx,
+                                            uint32_t n = 1);
+
+// Unit cube centered at the origin
+std::shared_ptr<render::IMesh> create_cube(render::IContext *ctx);
+} // namespace ars::playground
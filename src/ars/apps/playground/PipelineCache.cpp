@@ -0,0 +1,81 @@
+#include "Headless.h"
+#include "Scenes.h"
+#include <ars/runtime/core/Core.h>
+#include <ars/runtime/core/Log.h>
+#include <ars/runtime/render/IContext.h>
+#include <ars/runtime/render/IScene.h>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+
+using namespace ars;
+
+// Measures startup time, from initializing the backend to the end of the first
+// frame, which compiles most pipelines, without a saved pipeline cache and then
+// with the cache saved by the previous launch. Runs headless, so a software
+// vulkan driver like lavapipe is enough.
+namespace {
+using Clock = std::chrono::high_resolution_clock;
+
+double ms_between(Clock::time_point beg, Clock::time_point end) {
+    return std::chrono::duration<double, std::milli>(end - beg).count();
+}
+
+struct Launch {
+    double startup_ms = 0.0;
+    double shutdown_ms = 0.0;
+};
+
+Launch launch(const std::filesystem::path &cache_dir) {
+    Launch result{};
+    auto beg = Clock::now();
+
+    {
+        playground::HeadlessContext ctx("Pipeline Cache Benchmark",
+                                        cache_dir.string());
+        playground::GridSceneInfo scene_info{};
+        scene_info.object_count = 1;
+        scene_info.view_size = {640, 360};
+        auto s = playground::create_grid_scene(ctx.get(), scene_info);
+
+        if (ctx->begin_frame()) {
+            s.view->render();
+            ctx->end_frame();
+        }
+        result.startup_ms = ms_between(beg, Clock::now());
+        beg = Clock::now();
+    }
+
+    // The pipeline cache is saved when the context is destroyed
+    result.shutdown_ms = ms_between(beg, Clock::now());
+    return result;
+}
+} // namespace
+
+int main() {
+#ifndef _WIN32
+    // Mesa drivers keep their own shader cache on disk, which would hide the
+    // difference
+    setenv("MESA_SHADER_CACHE_DISABLE", "true", 1);
+#endif
+    init_core();
+
+    auto cache_dir =
+        std::filesystem::temp_directory_path() / "aries_pipeline_cache_bench";
+    std::filesystem::remove_all(cache_dir);
+
+    auto cold = launch(cache_dir);
+    auto warm = launch(cache_dir);
+    auto warm_again = launch(cache_dir);
+    ARS_LOG_INFO("Cold startup {:.1f} ms, shutdown {:.1f} ms",
+                 cold.startup_ms,
+                 cold.shutdown_ms);
+    ARS_LOG_INFO("Warm startup {:.1f} ms and {:.1f} ms, shutdown {:.1f} ms",
+                 warm.startup_ms,
+                 warm_again.startup_ms,
+                 warm.shutdown_ms);
+
+    std::filesystem::remove_all(cache_dir);
+    destroy_core();
+    return 0;
+}
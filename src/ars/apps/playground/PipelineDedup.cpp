@@ -0,0 +1,94 @@
+#include "Headless.h"
+#include "Scenes.h"
+#include <ars/runtime/core/Core.h>
+#include <ars/runtime/core/Log.h>
+#include <ars/runtime/render/IContext.h>
+#include <ars/runtime/render/IMaterial.h>
+#include <ars/runtime/render/IScene.h>
+#include <ars/runtime/render/vk/Context.h>
+#include <ars/runtime/render/vk/Pipeline.h>
+#include <chrono>
+#include <vector>
+
+using namespace ars;
+
+// Measures the cost of creating a view and rendering its first frame when its
+// shaders and pipelines were already created for another view, with the
+// pipeline object cache enabled and disabled, and the cost of creating many
+// materials of the same type. Runs headless, so a software vulkan driver like
+// lavapipe is enough.
+namespace {
+using Clock = std::chrono::high_resolution_clock;
+
+double ms_since(Clock::time_point beg) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - beg)
+        .count();
+}
+
+void log_view(const char *name,
+              double ms,
+              const render::vk::PipelineObjectCacheStats &beg,
+              const render::vk::PipelineObjectCacheStats &end) {
+    ARS_LOG_INFO("{}: {:.2f} ms, {} shaders created ({} shared), {} "
+                 "pipelines created ({} shared)",
+                 name,
+                 ms,
+                 end.shader_miss_count - beg.shader_miss_count,
+                 end.shader_hit_count - beg.shader_hit_count,
+                 end.pipeline_miss_count - beg.pipeline_miss_count,
+                 end.pipeline_hit_count - beg.pipeline_hit_count);
+}
+
+std::unique_ptr<render::IView> create_and_render_view(render::vk::Context *ctx,
+                                                      render::IScene *scene,
+                                                      const char *name) {
+    auto cache = ctx->pipeline_object_cache();
+    auto stats = cache->stats();
+    auto beg = Clock::now();
+    auto view = scene->create_view({640, 360});
+    if (ctx->begin_frame()) {
+        view->render();
+        ctx->end_frame();
+    }
+    log_view(name, ms_since(beg), stats, cache->stats());
+    return view;
+}
+
+void run(render::vk::Context *ctx) {
+    // Views are created by the measures
+    playground::GridSceneInfo scene_info{};
+    scene_info.material_count = 0;
+    scene_info.view_size = {0, 0};
+    auto s = playground::create_grid_scene(ctx, scene_info);
+    auto scene = s.scene.get();
+
+    auto cache = ctx->pipeline_object_cache();
+    auto first = create_and_render_view(ctx, scene, "First view");
+    auto second = create_and_render_view(ctx, scene, "Second view");
+    cache->set_enabled(false);
+    auto uncached = create_and_render_view(ctx, scene, "Second view, no cache");
+    cache->set_enabled(true);
+
+    render::MaterialInfo info{};
+    info.features = render::MaterialFeature_AlphaClipBit;
+    auto stats = cache->stats();
+    auto beg = Clock::now();
+    std::vector<std::shared_ptr<render::IMaterial>> materials{};
+    for (int i = 0; i < 1000; i++) {
+        materials.push_back(ctx->create_material(info));
+    }
+    ctx->wait_for_material_pipelines();
+    log_view(
+        "1000 materials of a new type", ms_since(beg), stats, cache->stats());
+}
+} // namespace
+
+int main() {
+    init_core();
+    {
+        playground::HeadlessContext ctx("Pipeline Dedup Benchmark");
+        run(ctx.get());
+    }
+    destroy_core();
+    return 0;
+}
@@ -0,0 +1,180 @@
+#include "Headless.h"
+#include "Scenes.h"
+#include <ars/runtime/core/Core.h>
+#include <ars/runtime/core/Log.h>
+#include <ars/runtime/render/IContext.h>
+#include <ars/runtime/render/IMaterial.h>
+#include <ars/runtime/render/IMesh.h>
+#include <ars/runtime/render/IScene.h>
+#include <ars/runtime/render/vk/Context.h>
+#include <ars/runtime/render/vk/Material.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <vector>
+
+using namespace ars;
+
+// Counts hitches while a scene gets objects with materials of new types, one
+// type per frame, when their pipelines are compiled on the render thread, in
+// the background, or prewarmed while loading. A hitch is a frame taking twice
+// the median of warm up frames, and at least 4 ms more. Runs headless, so a
+// software vulkan driver like lavapipe is enough.
+namespace {
+using Clock = std::chrono::high_resolution_clock;
+
+enum class Mode { Sync, Async, Prewarmed };
+
+const char *mode_name(Mode mode) {
+    switch (mode) {
+    case Mode::Sync:
+        return "Sync";
+    case Mode::Async:
+        return "Async";
+    case Mode::Prewarmed:
+        return "Prewarmed";
+    }
+    return "";
+}
+
+// All material types except the default one, which is compiled with the
+// context
+std::vector<render::MaterialInfo> new_material_infos() {
+    std::vector<render::MaterialInfo> infos{};
+    for (auto model : {render::MaterialShadingModel::Unlit,
+                       render::MaterialShadingModel::MetallicRoughnessPBR}) {
+        for (render::MaterialFeatureFlags features = 0; features < 4;
+             features++) {
+            render::MaterialInfo info{};
+            info.shading_model = model;
+            info.features = features;
+            if (model != render::MaterialInfo{}.shading_model ||
+                features != 0) {
+                infos.push_back(info);
+            }
+        }
+    }
+    return infos;
+}
+
+struct Result {
+    double baseline_ms = 0.0;
+    double worst_ms = 0.0;
+    uint32_t hitch_count = 0;
+    // Frames from the first new material until all of them are drawn
+    uint32_t frames_until_drawn = 0;
+};
+
+Result run(Mode mode, const std::filesystem::path &cache_dir) {
+    constexpr uint32_t warm_up_count = 10;
+    constexpr uint32_t frame_count = 60;
+    constexpr uint32_t objects_per_material = 64;
+
+    playground::HeadlessContext ctx("Pipeline Hitch Benchmark",
+                                    cache_dir.string());
+    auto factory = ctx->material_factory();
+    factory->set_async_compilation(mode != Mode::Sync);
+    auto infos = new_material_infos();
+    if (mode == Mode::Prewarmed) {
+        ctx->prewarm_materials(infos);
+        ctx->wait_for_material_pipelines();
+    }
+    auto drawn_version = factory->ready_version();
+    if (mode != Mode::Prewarmed) {
+        drawn_version += infos.size();
+    }
+
+    // Objects are spawned later with materials of new types
+    playground::GridSceneInfo scene_info{};
+    scene_info.material_count = 0;
+    scene_info.view_size = {640, 360};
+    auto s = playground::create_grid_scene(ctx.get(), scene_info);
+    auto mesh = s.meshes[0];
+
+    Result result{};
+    std::vector<double> warm_up_ms{};
+    std::vector<double> spawn_ms{};
+    std::vector<std::shared_ptr<render::IMaterial>> materials{};
+    std::vector<std::unique_ptr<render::IRenderObject>> objects{};
+    for (uint32_t frame = 0; frame < frame_count; frame++) {
+        auto beg = Clock::now();
+        auto spawn_index = frame - warm_up_count;
+        if (frame >= warm_up_count && spawn_index < infos.size()) {
+            for (uint32_t i = 0; i < objects_per_material; i++) {
+                auto material = ctx->create_material(infos[spawn_index]);
+                auto obj = s.scene->create_render_object();
+                math::XformTRS<float> xform{};
+                xform.set_translation(
+                    {static_cast<float>(i % 8) - 4.0f,
+                     0.0f,
+                     -static_cast<float>(spawn_index * 8 + i / 8)});
+                obj->set_xform(xform);
+                obj->set_mesh(mesh);
+                obj->set_material(material);
+                materials.push_back(std::move(material));
+                objects.push_back(std::move(obj));
+            }
+        }
+        if (ctx->begin_frame()) {
+            s.view->render();
+            ctx->end_frame();
+        }
+        auto ms = std::chrono::duration<double, std::milli>(Clock::now() - beg)
+                      .count();
+
+        // The first frames compile render graphs and effects
+        if (frame >= 3 && frame < warm_up_count) {
+            warm_up_ms.push_back(ms);
+        }
+        if (frame >= warm_up_count) {
+            spawn_ms.push_back(ms);
+            if (result.frames_until_drawn == 0 &&
+                spawn_index + 1 >= infos.size() &&
+                factory->ready_version() >= drawn_version) {
+                result.frames_until_drawn = spawn_index + 1;
+            }
+        }
+    }
+
+    std::sort(warm_up_ms.begin(), warm_up_ms.end());
+    result.baseline_ms = warm_up_ms[warm_up_ms.size() / 2];
+    auto threshold =
+        std::max(result.baseline_ms * 2.0, result.baseline_ms + 4.0);
+    for (auto ms : spawn_ms) {
+        result.worst_ms = std::max(result.worst_ms, ms);
+        if (ms > threshold) {
+            result.hitch_count++;
+        }
+    }
+    return result;
+}
+} // namespace
+
+int main() {
+#ifndef _WIN32
+    // Mesa drivers keep their own shader cache on disk, which would hide
+    // compilation
+    setenv("MESA_SHADER_CACHE_DISABLE", "true", 1);
+#endif
+    init_core();
+
+    auto cache_dir =
+        std::filesystem::temp_directory_path() / "aries_pipeline_hitch_bench";
+    for (auto mode : {Mode::Sync, Mode::Async, Mode::Prewarmed}) {
+        // Start every run without a saved pipeline cache
+        std::filesystem::remove_all(cache_dir);
+        auto result = run(mode, cache_dir);
+        ARS_LOG_INFO("{}: {} hitches, worst frame {:.1f} ms, median frame "
+                     "{:.1f} ms, all materials drawn after {} frames",
+                     mode_name(mode),
+                     result.hitch_count,
+                     result.worst_ms,
+                     result.baseline_ms,
+                     result.frames_until_drawn);
+    }
+
+    std::filesystem::remove_all(cache_dir);
+    destroy_core();
+    return 0;
+}
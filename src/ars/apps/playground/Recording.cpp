@@ -0,0 +1,88 @@
+#include "Headless.h"
+#include "Meshes.h"
+#include "Scenes.h"
+#include <ars/runtime/core/Core.h>
+#include <ars/runtime/core/Jobs.h>
+#include <ars/runtime/core/Log.h>
+#include <ars/runtime/render/IContext.h>
+#include <ars/runtime/render/IMaterial.h>
+#include <ars/runtime/render/IScene.h>
+#include <ars/runtime/render/vk/View.h>
+#include <ars/runtime/render/vk/features/Drawer.h>
+#include <chrono>
+#include <cmath>
+
+using namespace ars;
+
+// Measures CPU time of recording a view with many draw batches, with draws
+// and shadow cascades recorded serially on the calling thread or in parallel
+// on job workers. Runs headless, so a software vulkan driver like lavapipe is
+// enough.
+namespace {
+// Objects with distinct meshes can't be batched, materials of the same type
+// and textures can, so the draw batch count is about
+// min(object_count, mesh_count).
+playground::GridScene create_scene(render::IContext *ctx,
+                                   uint32_t object_count,
+                                   uint32_t mesh_count,
+                                   uint32_t material_count) {
+    playground::GridSceneInfo info{};
+    info.object_count = object_count;
+    auto side = static_cast<uint32_t>(std::ceil(std::sqrt(object_count)));
+    info.columns = side;
+    info.spacing = 60.0f / static_cast<float>(side);
+    for (uint32_t i = 0; i < mesh_count; i++) {
+        info.meshes.push_back(playground::create_plane(ctx, 4));
+    }
+    info.material_count = material_count;
+    return playground::create_grid_scene(ctx, info);
+}
+
+double bench_recording(render::IContext *ctx,
+                       playground::GridScene &s,
+                       bool parallel) {
+    auto vk_view = dynamic_cast<render::vk::View *>(s.view.get());
+    vk_view->drawer()->set_parallel_recording(parallel);
+
+    constexpr int warm_up_count = 3;
+    constexpr int frame_count = 20;
+    double total_ms = 0.0;
+    for (int i = 0; i < warm_up_count + frame_count; i++) {
+        if (!ctx->begin_frame()) {
+            continue;
+        }
+        auto beg = std::chrono::high_resolution_clock::now();
+        s.view->render();
+        auto end = std::chrono::high_resolution_clock::now();
+        ctx->end_frame();
+        if (i >= warm_up_count) {
+            total_ms +=
+                std::chrono::duration<double, std::milli>(end - beg).count();
+        }
+    }
+    return total_ms / frame_count;
+}
+} // namespace
+
+int main() {
+    init_core();
+    {
+        playground::HeadlessContext ctx("Recording Benchmark");
+        ARS_LOG_INFO("{} job workers", jobs::worker_count());
+
+        for (uint32_t count : {1000, 4000}) {
+            auto scene = create_scene(ctx.get(), count, 64, count / 64);
+            auto serial_ms = bench_recording(ctx.get(), scene, false);
+            auto parallel_ms = bench_recording(ctx.get(), scene, true);
+            ARS_LOG_INFO("{} objects: serial {:.3f} ms, parallel {:.3f} ms "
+                         "per view render, {:.2f}x",
+                         count,
+                         serial_ms,
+                         parallel_ms,
+                         serial_ms / parallel_ms);
+        }
+    }
+
+    destroy_core();
+    return 0;
+}
@@ -0,0 +1,92 @@
+#include "Headless.h"
+#include "Meshes.h"
+#include "Scenes.h"
+#include <ars/runtime/core/Core.h>
+#include <ars/runtime/core/Log.h>
+#include <ars/runtime/render/IContext.h>
+#include <ars/runtime/render/IMaterial.h>
+#include <ars/runtime/render/IScene.h>
+#include <ars/runtime/render/vk/Context.h>
+#include <ars/runtime/render/vk/Scene.h>
+#include <chrono>
+#include <cmath>
+
+using namespace ars;
+
+// Measures CPU time of rendering a static scene when draw lists are retained
+// across frames, against rebuilding them every frame, which is what happens
+// when the scene changes every frame. Runs headless, so a software vulkan
+// driver like lavapipe is enough.
+namespace {
+struct Result {
+    double cpu_ms = 0.0;
+    double buffers_per_frame = 0.0;
+};
+
+// If invalidate is set, draw lists are out of date every frame
+Result bench(render::vk::Context *ctx,
+             render::vk::Scene *scene,
+             render::IView *view,
+             bool invalidate) {
+    constexpr int warm_up_count = 3;
+    constexpr int frame_count = 30;
+    Result result{};
+    uint64_t buffer_count = 0;
+    for (int i = 0; i < warm_up_count + frame_count; i++) {
+        if (!ctx->begin_frame()) {
+            continue;
+        }
+        if (invalidate) {
+            scene->mark_draw_state_changed();
+        }
+        auto buffer_count_beg = ctx->created_buffer_count();
+        auto beg = std::chrono::high_resolution_clock::now();
+        view->render();
+        auto end = std::chrono::high_resolution_clock::now();
+        ctx->end_frame();
+        if (i >= warm_up_count) {
+            result.cpu_ms +=
+                std::chrono::duration<double, std::milli>(end - beg).count();
+            buffer_count += ctx->created_buffer_count() - buffer_count_beg;
+        }
+    }
+    result.cpu_ms /= frame_count;
+    result.buffers_per_frame = static_cast<double>(buffer_count) / frame_count;
+    return result;
+}
+
+void run(render::vk::Context *ctx, uint32_t object_count) {
+    // Objects fill a 60 x 60 square whatever the count is
+    auto side = static_cast<uint32_t>(std::ceil(std::sqrt(object_count)));
+    playground::GridSceneInfo scene_info{};
+    scene_info.object_count = object_count;
+    scene_info.columns = side;
+    scene_info.spacing = 60.0f / static_cast<float>(side);
+    scene_info.meshes = {playground::create_cube(ctx)};
+    scene_info.material_count = 16;
+    auto s = playground::create_grid_scene(ctx, scene_info);
+    auto vk_scene = dynamic_cast<render::vk::Scene *>(s.scene.get());
+
+    auto rebuilt = bench(ctx, vk_scene, s.view.get(), true);
+    auto retained = bench(ctx, vk_scene, s.view.get(), false);
+    ARS_LOG_INFO("{} static objects: rebuilt {:.3f} ms, {:.1f} buffers, "
+                 "retained {:.3f} ms, {:.1f} buffers per view render",
+                 object_count,
+                 rebuilt.cpu_ms,
+                 rebuilt.buffers_per_frame,
+                 retained.cpu_ms,
+                 retained.buffers_per_frame);
+}
+} // namespace
+
+int main() {
+    init_core();
+    {
+        playground::HeadlessContext ctx("Retained Draw Benchmark");
+        for (uint32_t count : {1000, 10000, 50000}) {
+            run(ctx.get(), count);
+        }
+    }
+    destroy_core();
+    return 0;
+}
@@ -0,0 +1,54 @@
+#include "Scenes.h"
+#include "Meshes.h"
+#include <cmath>
+
+namespace ars::playground {
+GridScene create_grid_scene(render::IContext *ctx, const GridSceneInfo &info) {
+    GridScene s{};
+    s.scene = ctx->create_scene();
+    if (info.view_size.width > 0 && info.view_size.height > 0) {
+        s.view = s.scene->create_view(info.view_size);
+        math::XformTRS<float> view_xform{};
+        view_xform.set_translation({0.0f, 10.0f, 20.0f});
+        view_xform.set_rotation(glm::angleAxis(-0.4f, glm::vec3(1, 0, 0)));
+        s.view->set_xform(view_xform);
+    }
+
+    s.sun = s.scene->create_directional_light();
+    s.sun->set_is_sun(true);
+    math::XformTRS<float> sun_xform{};
+    sun_xform.set_rotation(glm::angleAxis(-1.0f, glm::vec3(1, 0, 0)));
+    s.sun->set_xform(sun_xform);
+
+    s.meshes = info.meshes;
+    if (s.meshes.empty()) {
+        s.meshes.push_back(create_plane(ctx));
+    }
+    for (uint32_t i = 0; i < info.material_count; i++) {
+        s.materials.push_back(ctx->create_material(info.material));
+    }
+
+    auto columns = info.columns;
+    if (columns == 0) {
+        columns = static_cast<uint32_t>(
+            std::ceil(std::sqrt(static_cast<float>(info.object_count))));
+    }
+    auto mesh_count = static_cast<uint32_t>(s.meshes.size());
+    for (uint32_t i = 0; i < info.object_count; i++) {
+        auto obj = s.scene->create_render_object();
+        math::XformTRS<float> xform{};
+        auto x = static_cast<float>(i % columns) -
+                 static_cast<float>(columns) * 0.5f;
+        auto z = static_cast<float>(i / columns);
+        xform.set_translation({x * info.spacing, 0.0f, -z * info.spacing});
+        obj->set_xform(xform);
+        obj->set_mesh(s.meshes[i % mesh_count]);
+        if (!s.materials.empty()) {
+            obj->set_material(
+                s.materials[(i / mesh_count) % s.materials.size()]);
+        }
+        s.objects.push_back(std::move(obj));
+    }
+    return s;
+}
+} // namespace ars::playground
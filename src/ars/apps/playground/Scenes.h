@@ -0,0 +1,40 @@
+#pragma once
+
+#include <ars/runtime/render/IContext.h>
+#include <ars/runtime/render/IMaterial.h>
+#include <ars/runtime/render/IMesh.h>
+#include <ars/runtime/render/IScene.h>
+#include <memory>
+#include <vector>
+
+// Scene fixtures shared by playground executables
+namespace ars::playground {
+struct GridSceneInfo {
+    uint32_t object_count = 0;
+    // Objects per row. Rows extend towards -Z from the origin and are
+    // centered on X. The grid is square if 0.
+    uint32_t columns = 0;
+    float spacing = 1.0f;
+    // Objects use meshes in turn. A unit plane is used if empty.
+    std::vector<std::shared_ptr<render::IMesh>> meshes{};
+    // Objects of consecutive mesh rounds use materials in turn, so objects
+    // with the same mesh are spread over the materials
+    uint32_t material_count = 1;
+    render::MaterialInfo material{};
+    // No view is created if the size is 0
+    render::Extent2D view_size{1280, 720};
+};
+
+// A sun and a view looking down at a grid of objects sharing meshes and
+// materials
+struct GridScene {
+    std::unique_ptr<render::IScene> scene{};
+    std::unique_ptr<render::IView> view{};
+    std::unique_ptr<render::IDirectionalLight> sun{};
+    std::vector<std::shared_ptr<render::IMesh>> meshes{};
+    std::vector<std::shared_ptr<render::IMaterial>> materials{};
+    std::vector<std::unique_ptr<render::IRenderObject>> objects{};
+};
+
+GridScene create_grid_scene(render::IContext *ctx, const GridSceneInfo &info);
+} // namespace ars::playground
@@ -0,0 +1,114 @@
+#include <ars/runtime/core/Core.h>
+#include <ars/runtime/core/Log.h>
+#include <ars/runtime/render/IContext.h>
+#include <ars/runtime/render/IMesh.h>
+#include <ars/runtime/render/vk/Context.h>
+#include <ars/runtime/render/vk/Upload.h>
+#include <chrono>
+#include <vector>
+
+using namespace ars;
+
+// Counts queue submissions and measures time for loading meshes through the
+// upload batching of the vulkan backend. Runs headless, so a software vulkan
+// driver is enough.
+namespace {
+struct MeshData {
+    std::vector<glm::vec3> positions{};
+    std::vector<glm::vec3> normals{};
+    std::vector<glm::vec4> tangents{};
+    std::vector<glm::vec2> tex_coords{};
+    std::vector<glm::u32vec3> indices{};
+};
+
+MeshData make_grid(uint32_t n) {
+    MeshData data{};
+    for (uint32_t y = 0; y <= n; y++) {
+        for (uint32_t x = 0; x <= n; x++) {
+            auto uv = glm::vec2(x, y) / static_cast<float>(n);
+            data.positions.emplace_back(uv.x, 0.0f, uv.y);
+            data.normals.emplace_back(0.0f, 1.0f, 0.0f);
+            data.tangents.emplace_back(1.0f, 0.0f, 0.0f, 1.0f);
+            data.tex_coords.push_back(uv);
+        }
+    }
+    for (uint32_t y = 0; y < n; y++) {
+        for (uint32_t x = 0; x < n; x++) {
+            auto i = y * (n + 1) + x;
+            data.indices.emplace_back(i, i + n + 1, i + 1);
+            data.indices.emplace_back(i + 1, i + n + 1, i + n + 2);
+        }
+    }
+    return data;
+}
+
+// If flush_each_call is true, every set_xxx call is submitted on its own, which
+// is how meshes were uploaded before batching.
+void bench_load(render::vk::Context *ctx,
+                const MeshData &data,
+                uint32_t mesh_count,
+                bool flush_each_call) {
+    auto queue = ctx->queue();
+    auto uploader = ctx->uploader();
+    auto submit_count = queue->submit_count();
+
+    auto after_call = [&]() {
+        if (flush_each_call) {
+            uploader->flush();
+        }
+    };
+
+    auto beg = std::chrono::high_resolution_clock::now();
+    std::vector<std::shared_ptr<render::IMesh>> meshes{};
+    for (uint32_t i = 0; i < mesh_count; i++) {
+        render::MeshInfo info{};
+        info.vertex_capacity = data.positions.size();
+        info.triangle_capacity = data.indices.size();
+        auto mesh = ctx->create_mesh(info);
+        auto vertex_count = data.positions.size();
+        mesh->set_position(data.positions.data(), 0, vertex_count);
+        after_call();
+        mesh->set_normal(data.normals.data(), 0, vertex_count);
+        after_call();
+        mesh->set_tangent(data.tangents.data(), 0, vertex_count);
+        after_call();
+        mesh->set_tex_coord(data.tex_coords.data(), 0, vertex_count);
+        after_call();
+        mesh->set_indices(data.indices.data(), 0, data.indices.size());
+        after_call();
+        mesh->set_triangle_count(data.indices.size());
+        meshes.push_back(mesh);
+    }
+    queue->flush();
+    auto end = std::chrono::high_resolution_clock::now();
+
+    ARS_LOG_INFO("{} {} meshes: {} submits, {:.3f} ms",
+                 flush_each_call ? "Per call upload" : "Batched upload",
+                 mesh_count,
+                 queue->submit_count() - submit_count,
+                 std::chrono::duration<double, std::milli>(end - beg).count());
+}
+} // namespace
+
+int main() {
+    init_core();
+    render::ApplicationInfo info{};
+    info.app_name = "Upload Benchmark";
+    info.enable_presentation = false;
+    render::init_render_backend(info);
+
+    {
+        auto [ctx, window] = render::IContext::create(nullptr);
+        auto vk_ctx = dynamic_cast<render::vk::Context *>(ctx.get());
+
+        auto data = make_grid(32);
+        for (uint32_t count : {100, 500}) {
+            bench_load(vk_ctx, data, count, true);
+            bench_load(vk_ctx, data, count, false);
+        }
+    }
+
+    render::destroy_render_backend();
+    destroy_core();
+    return 0;
+}
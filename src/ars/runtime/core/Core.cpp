@@ -1,4 +1,5 @@
 #include "Core.h"
+#include "Jobs.h"
 #include "Profiler.h"
 #include "Res.h"
 
@@ -6,9 +7,11 @@ namespace ars {
 void init_core() {
     IRes::register_type();
     init_profiler();
+    jobs::init_jobs();
 }
 
 void destroy_core() {
+    jobs::destroy_jobs();
     destroy_profiler();
 }
 } // namespace ars
\ No newline at end of file
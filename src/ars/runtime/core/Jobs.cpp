@@ -0,0 +1,365 @@
+#include "Jobs.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <spdlog/fmt/fmt.h>
+#include <thread>
+
+namespace ars::jobs {
+namespace {
+thread_local int32_t t_worker_index = -1;
+} // namespace
+
+bool Counter::done() const {
+    return _value.load(std::memory_order_acquire) == 0;
+}
+
+class JobSystem {
+  public:
+    explicit JobSystem(uint32_t worker_count) {
+        _workers.reserve(worker_count);
+        for (uint32_t i = 0; i < worker_count; i++) {
+            _workers.emplace_back(std::make_unique<Worker>());
+        }
+
+        for (uint32_t i = 0; i < worker_count; i++) {
+            auto group = PROFILER_GROUP_JOB_WORKER_BEGIN + i;
+            if (group < MAX_PROFILER_GROUP_NUM) {
+                profiler_enable_group(group, true);
+                profiler_set_group_name(group, fmt::format("Worker {}", i));
+            }
+        }
+
+        for (uint32_t i = 0; i < worker_count; i++) {
+            _workers[i]->thread = std::thread([this, i]() { worker_main(i); });
+        }
+    }
+
+    ARS_NO_COPY_MOVE(JobSystem);
+
+    ~JobSystem() {
+        {
+            std::lock_guard<std::mutex> lock(_sleep_mutex);
+            _stop = true;
+        }
+        _sleep_cv.notify_all();
+        for (auto &w : _workers) {
+            w->thread.join();
+        }
+    }
+
+    [[nodiscard]] uint32_t worker_count() const {
+        return static_cast<uint32_t>(_workers.size());
+    }
+
+    static void add(Counter *counter) {
+        if (counter != nullptr) {
+            counter->_value.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    void submit(Job job, Counter *counter) {
+        if (_workers.empty()) {
+            execute({std::move(job), counter});
+            return;
+        }
+
+        if (t_worker_index >= 0) {
+            auto &w = *_workers[t_worker_index];
+            std::lock_guard<std::mutex> lock(w.mutex);
+            w.tasks.push_back({std::move(job), counter});
+        } else {
+            std::lock_guard<std::mutex> lock(_global_mutex);
+            _global_tasks.push_back({std::move(job), counter});
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(_sleep_mutex);
+            _queued++;
+            _queued_foreground++;
+            if (_waiter_count > 0) {
+                _wait_cv.notify_all();
+            }
+        }
+        _sleep_cv.notify_one();
+    }
+
+    void submit_background(Job job, Counter *counter) {
+        if (_workers.empty()) {
+            execute({std::move(job), counter});
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(_global_mutex);
+            _background_tasks.push_back({std::move(job), counter});
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(_sleep_mutex);
+            _queued++;
+        }
+        _sleep_cv.notify_one();
+    }
+
+    void submit_after(Counter *dependency, Job job, Counter *counter) {
+        {
+            std::lock_guard<std::mutex> lock(dependency->_mutex);
+            if (!dependency->done()) {
+                dependency->_continuations.push_back({std::move(job), counter});
+                return;
+            }
+        }
+        submit(std::move(job), counter);
+    }
+
+    void wait(Counter *counter) {
+        while (!counter->done()) {
+            Task task{};
+            if (try_pop(task, false)) {
+                execute(std::move(task));
+                continue;
+            }
+
+            // The rest of the jobs are running on other threads or are
+            // background jobs, sleep until a job is submitted or a counter
+            // is done
+            std::unique_lock<std::mutex> lock(_sleep_mutex);
+            _waiter_count++;
+            _wait_cv.wait(lock, [&]() {
+                return counter->done() || _queued_foreground > 0;
+            });
+            _waiter_count--;
+        }
+        // The last finishing job may still hold the lock, make sure it has
+        // left before the counter can be destroyed
+        std::lock_guard<std::mutex> lock(counter->_mutex);
+    }
+
+  private:
+    struct Task {
+        Job job{};
+        Counter *counter = nullptr;
+    };
+
+    struct Worker {
+        std::mutex mutex{};
+        std::deque<Task> tasks{};
+        std::thread thread{};
+    };
+
+    void worker_main(uint32_t index) {
+        t_worker_index = static_cast<int32_t>(index);
+        profiler_set_thread_group(PROFILER_GROUP_JOB_WORKER_BEGIN + index);
+
+        while (true) {
+            Task task{};
+            if (try_pop(task, true)) {
+                execute(std::move(task));
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(_sleep_mutex);
+            _sleep_cv.wait(lock, [&]() { return _stop || _queued > 0; });
+            if (_stop) {
+                return;
+            }
+        }
+    }
+
+    bool try_pop(Task &task, bool include_background) {
+        bool background = false;
+        auto pop = [&](std::deque<Task> &tasks, std::mutex &mutex, bool back) {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (tasks.empty()) {
+                return false;
+            }
+            if (back) {
+                task = std::move(tasks.back());
+                tasks.pop_back();
+            } else {
+                task = std::move(tasks.front());
+                tasks.pop_front();
+            }
+            return true;
+        };
+
+        auto popped = [&]() {
+            // Own jobs are popped in LIFO order for locality
+            if (t_worker_index >= 0) {
+                auto &w = *_workers[t_worker_index];
+                if (pop(w.tasks, w.mutex, true)) {
+                    return true;
+                }
+            }
+
+            if (pop(_global_tasks, _global_mutex, false)) {
+                return true;
+            }
+
+            // Steal the oldest job of other workers
+            auto count = static_cast<int32_t>(_workers.size());
+            auto start = std::max(t_worker_index, 0);
+            for (int32_t i = 1; i <= count; i++) {
+                auto victim = (start + i) % count;
+                if (victim == t_worker_index) {
+                    continue;
+                }
+                auto &w = *_workers[victim];
+                if (pop(w.tasks, w.mutex, false)) {
+                    return true;
+                }
+            }
+
+            background = include_background &&
+                         pop(_background_tasks, _global_mutex, false);
+            return background;
+        }();
+
+        if (popped) {
+            std::lock_guard<std::mutex> lock(_sleep_mutex);
+            _queued--;
+            if (!background) {
+                _queued_foreground--;
+            }
+        }
+        return popped;
+    }
+
+    void execute(Task task) {
+        task.job();
+        auto counter = task.counter;
+        if (counter == nullptr) {
+            return;
+        }
+
+        std::vector<Counter::Continuation> continuations{};
+        bool done = false;
+        {
+            std::lock_guard<std::mutex> lock(counter->_mutex);
+            if (counter->_value.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                continuations = std::move(counter->_continuations);
+                counter->_continuations.clear();
+                done = true;
+            }
+        }
+        if (done) {
+            // Threads sleeping in wait() may wait for this counter
+            std::lock_guard<std::mutex> lock(_sleep_mutex);
+            if (_waiter_count > 0) {
+                _wait_cv.notify_all();
+            }
+        }
+        for (auto &c : continuations) {
+            submit(std::move(c.job), c.counter);
+        }
+    }
+
+    std::vector<std::unique_ptr<Worker>> _workers{};
+    std::mutex _global_mutex{};
+    std::deque<Task> _global_tasks{};
+    // Only popped by workers outside wait()
+    std::deque<Task> _background_tasks{};
+
+    std::mutex _sleep_mutex{};
+    std::condition_variable _sleep_cv{};
+    // Number of jobs in all queues, guarded by _sleep_mutex
+    int64_t _queued = 0;
+    // Jobs in queues other than the background queue, guarded by
+    // _sleep_mutex
+    int64_t _queued_foreground = 0;
+    bool _stop = false;
+
+    // Threads in wait() sleep on it when no jobs they can run are queued.
+    // Notified when jobs are submitted and counters are done.
+    std::condition_variable _wait_cv{};
+    // Guarded by _sleep_mutex
+    int32_t _waiter_count = 0;
+};
+
+namespace {
+std::unique_ptr<JobSystem> s_job_system{};
+// Used when the job system is not inited
+JobSystem &inline_job_system() {
+    static JobSystem system(0);
+    return system;
+}
+
+JobSystem &job_system() {
+    if (s_job_system != nullptr) {
+        return *s_job_system;
+    }
+    return inline_job_system();
+}
+} // namespace
+
+void init_jobs(uint32_t worker_count) {
+    if (worker_count == 0) {
+        auto hardware_threads = std::thread::hardware_concurrency();
+        worker_count = hardware_threads > 1 ? hardware_threads - 1 : 0;
+    }
+    s_job_system = std::make_unique<JobSystem>(worker_count);
+}
+
+void destroy_jobs() {
+    s_job_system = nullptr;
+}
+
+uint32_t worker_count() {
+    return job_system().worker_count();
+}
+
+int32_t current_worker_index() {
+    return t_worker_index;
+}
+
+void run(Job job, Counter *counter) {
+    auto &system = job_system();
+    JobSystem::add(counter);
+    system.submit(std::move(job), counter);
+}
+
+void run_after(Counter *dependency, Job job, Counter *counter) {
+    auto &system = job_system();
+    JobSystem::add(counter);
+    if (dependency == nullptr) {
+        system.submit(std::move(job), counter);
+    } else {
+        system.submit_after(dependency, std::move(job), counter);
+    }
+}
+
+void run_background(Job job, Counter *counter) {
+    auto &system = job_system();
+    JobSystem::add(counter);
+    system.submit_background(std::move(job), counter);
+}
+
+void wait(Counter *counter) {
+    if (counter != nullptr) {
+        job_system().wait(counter);
+    }
+}
+
+void parallel_for(size_t begin,
+                  size_t end,
+                  size_t grain_size,
+                  const std::function<void(size_t, size_t)> &func) {
+    if (begin >= end) {
+        return;
+    }
+    grain_size = std::max<size_t>(grain_size, 1);
+
+    // Run the first range on the calling thread
+    auto first_end = std::min(end, begin + grain_size);
+    Counter counter{};
+    for (auto b = first_end; b < end; b += grain_size) {
+        auto e = std::min(end, b + grain_size);
+        run([&func, b, e]() { func(b, e); }, &counter);
+    }
+    func(begin, first_end);
+    wait(&counter);
+}
+} // namespace ars::jobs
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "misc/Macro.h"
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+// Work stealing job system.
+//
+// Each worker owns a deque of jobs. Workers pop their own jobs in LIFO order
+// and steal from the front of other deques when they run out of work. Jobs
+// submitted from non-worker threads go to a shared queue.
+namespace ars::jobs {
+using Job = std::function<void()>;
+
+class JobSystem;
+
+// Counts unfinished jobs. Pass a counter to run() to track jobs, then use
+// wait() or run_after() to depend on them.
+//
+// A counter should outlive all jobs it tracks, and should not be reused while
+// some jobs still depend on it.
+class Counter {
+  public:
+    Counter() = default;
+    ARS_NO_COPY_MOVE(Counter);
+
+    [[nodiscard]] bool done() const;
+
+  private:
+    friend JobSystem;
+
+    struct Continuation {
+        Job job;
+        Counter *counter;
+    };
+
+    std::atomic<int64_t> _value{0};
+    std::mutex _mutex{};
+    std::vector<Continuation> _continuations{};
+};
+
+// Init with worker_count == 0 uses hardware_concurrency - 1 workers. If the
+// job system is not inited or there are no workers, jobs run inline on the
+// calling thread.
+void init_jobs(uint32_t worker_count = 0);
+void destroy_jobs();
+
+[[nodiscard]] uint32_t worker_count();
+// Index of the current worker thread, or -1 for non-worker threads
+[[nodiscard]] int32_t current_worker_index();
+
+// Submit a job, counter is incremented now and decremented after the job
+// finishes
+void run(Job job, Counter *counter = nullptr);
+// Submit a job after all jobs tracked by dependency finish
+void run_after(Counter *dependency, Job job, Counter *counter = nullptr);
+// Submit a job that only workers run, after their other jobs. Threads in
+// wait() never run it, so long jobs, e.g. pipeline compilation, don't stall
+// a frame waiting for its own jobs.
+void run_background(Job job, Counter *counter = nullptr);
+// Blocks until counter is done. The calling thread executes pending jobs while
+// waiting, so it is safe to wait inside jobs. It sleeps while only background
+// jobs or jobs running on other threads are left.
+void wait(Counter *counter);
+
+// Splits [begin, end) into ranges of at most grain_size elements and calls
+// func(range_begin, range_end) for each range in parallel. Returns after all
+// ranges finish.
+void parallel_for(size_t begin,
+                  size_t end,
+                  size_t grain_size,
+                  const std::function<void(size_t, size_t)> &func);
+} // namespace ars::jobs
@@ -1,4 +1,5 @@
 #include "Profiler.h"
+#include "misc/Arena.h"
 
 #define IMGUI_DEFINE_MATH_OPERATORS
 #include <chrono>
@@ -7,6 +8,7 @@
 
 #include <algorithm>
 #include <deque>
+#include <mutex>
 #include <spdlog/fmt/fmt.h>
 #include <stack>
 #include <vector>
@@ -31,6 +33,9 @@ struct ProfilerGroup {
     std::string name;
     std::deque<std::unique_ptr<Sample>> samples{};
     std::stack<std::unique_ptr<Sample>> working_stack{};
+    // Samples are submitted by the thread owning the group and read by the GUI
+    // thread
+    std::mutex samples_mutex{};
     bool pause = false;
     uint32_t index = 0;
 
@@ -68,6 +73,7 @@ struct ProfilerGroup {
         if (pause) {
             return;
         }
+        std::lock_guard<std::mutex> lock(samples_mutex);
         samples.emplace_back(std::move(s));
         if (samples.size() > MAX_PROFILER_SAMPLE_NUM) {
             samples.pop_front();
@@ -92,6 +98,7 @@ struct ProfilerGroup {
 
     void sample_time_ms_min_max(float &sample_min_time_ms,
                                 float &sample_max_time_ms) {
+        std::lock_guard<std::mutex> lock(samples_mutex);
         sample_min_time_ms = std::numeric_limits<float>::max();
         sample_max_time_ms = std::numeric_limits<float>::min();
 
@@ -259,13 +266,19 @@ struct ProfilerGroup {
                           true,
                           ImGuiWindowFlags_HorizontalScrollbar);
 
-        display_bar_graph(
-            frame_times_ms, display_min_time_ms, display_max_time_ms, state);
+        {
+            std::lock_guard<std::mutex> lock(samples_mutex);
+            display_bar_graph(frame_times_ms,
+                              display_min_time_ms,
+                              display_max_time_ms,
+                              state);
+        }
 
         ImGui::EndChild();
     }
 
     void clear() {
+        std::lock_guard<std::mutex> lock(samples_mutex);
         samples.clear();
     }
 };
@@ -276,6 +289,8 @@ struct Profiler {
     TimePoint start_time{};
     bool pause = false;
     std::deque<float> frame_times_ms{};
+    uint64_t last_frame_heap_allocation_count = 0;
+    uint64_t frame_heap_allocation_delta = 0;
 
     Profiler() {
         start_time = Clock::now();
@@ -397,11 +412,22 @@ struct Profiler {
         ImGui::Text("Average %.3f ms/frame (%.2f FPS)",
                     ave_frame_time_ms,
                     1000.0f / ave_frame_time_ms);
+#ifdef ARS_COUNT_HEAP_ALLOCATIONS
+        ImGui::SameLine();
+        ImGui::Text("Heap allocations %llu/frame",
+                    static_cast<unsigned long long>(
+                        frame_heap_allocation_delta));
+#endif
 
         ImGui::SliderFloat("Horizontal Scroll", &state.scroll_x, 0.0f, 1.0f);
     }
 
     void new_frame() {
+        auto heap_allocation_count = ars::heap_allocation_count();
+        frame_heap_allocation_delta =
+            heap_allocation_count - last_frame_heap_allocation_count;
+        last_frame_heap_allocation_count = heap_allocation_count;
+
         if (pause) {
             return;
         }
@@ -413,6 +439,7 @@ struct Profiler {
 };
 
 std::unique_ptr<Profiler> s_profiler{};
+thread_local size_t t_profiler_thread_group = PROFILER_GROUP_CPU_MAIN_THREAD;
 } // namespace
 
 void init_profiler() {
@@ -533,6 +560,14 @@ void profiler_new_frame() {
     }
 }
 
+size_t profiler_thread_group() {
+    return t_profiler_thread_group;
+}
+
+void profiler_set_thread_group(size_t group_id) {
+    t_profiler_thread_group = group_id;
+}
+
 ProfilerGuiState::ProfilerGuiState() {
     for (auto &h : window_heights) {
         h = 100.0f;
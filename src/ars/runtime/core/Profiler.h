@@ -17,6 +17,9 @@ constexpr size_t PROFILER_AVERAGE_FPS_GATHER_FRAMES = 64;
 // These groups are enabled by default
 constexpr size_t PROFILER_GROUP_CPU_MAIN_THREAD = 0;
 constexpr size_t PROFILER_GROUP_GPU = 1;
+// Job worker i uses group PROFILER_GROUP_JOB_WORKER_BEGIN + i, they are
+// enabled when the job system starts
+constexpr size_t PROFILER_GROUP_JOB_WORKER_BEGIN = 2;
 
 // These names are set by default
 constexpr const char *PROFILER_GROUP_CPU_MAIN_THREAD_NAME = "Main";
@@ -36,6 +39,12 @@ void profiler_set_group_name(size_t group_id, const std::string &name);
 
 void profiler_new_frame();
 
+// Group used by ARS_PROFILER_SAMPLE on the calling thread,
+// PROFILER_GROUP_CPU_MAIN_THREAD by default. A group should only be written by
+// one thread.
+size_t profiler_thread_group();
+void profiler_set_thread_group(size_t group_id);
+
 // file_name, function_name should have static lifetime, we do not copy its
 // content
 void profiler_begin_sample(size_t group_id,
@@ -69,14 +78,15 @@ void profiler_on_gui(const std::string &window_name, ProfilerGuiState &state);
 
 #ifdef ARS_PROFILER_ENABLED
 #define ARS_PROFILER_SAMPLE(name, color)                                       \
-    ars::profiler_begin_sample(PROFILER_GROUP_CPU_MAIN_THREAD,                 \
+    auto ARS_NAME_WITH_LINENO(profiler_group) = ars::profiler_thread_group();  \
+    ars::profiler_begin_sample(ARS_NAME_WITH_LINENO(profiler_group),           \
                                (name),                                         \
                                (color),                                        \
                                __FILE__,                                       \
                                __LINE__,                                       \
                                __PRETTY_FUNCTION__);                           \
     ARS_DEFER_TAGGED(profiler_sample, [&]() {                                  \
-        ars::profiler_end_sample(PROFILER_GROUP_CPU_MAIN_THREAD);              \
+        ars::profiler_end_sample(ARS_NAME_WITH_LINENO(profiler_group));        \
     })
 
 #define ARS_PROFILER_NEW_FRAME() ars::profiler_new_frame()
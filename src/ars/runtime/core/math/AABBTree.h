@@ -0,0 +1,373 @@
+#pragma once
+
+#include "AABB.h"
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+namespace ars::math {
+// Result of testing a node AABB in tree queries
+enum class Containment {
+    // Skip the whole subtree
+    Disjoint,
+    // Keep testing children
+    Intersect,
+    // All leaves of the subtree are accepted without further test
+    Contain,
+};
+
+// Incrementally maintained AABB tree for broad phase queries, e.g. frustum
+// culling.
+//
+// Leaves store enlarged (fat) AABBs, so objects moving slightly inside their
+// fat AABBs do not restructure the tree. The tree is kept balanced with
+// rotations on insertion and removal.
+template <typename T, typename Data> class AABBTree {
+  public:
+    using Proxy = int32_t;
+    static constexpr Proxy NULL_PROXY = -1;
+
+    // Fat AABBs are extended by fat_margin_ratio * extent on each side
+    explicit AABBTree(T fat_margin_ratio = static_cast<T>(0.1))
+        : _fat_margin_ratio(fat_margin_ratio) {}
+
+    Proxy insert(const AABB<T> &aabb, const Data &data) {
+        auto leaf = alloc_node();
+        auto &node = _nodes[leaf];
+        node.aabb = fatten(aabb);
+        node.data = data;
+        node.height = 0;
+        insert_leaf(leaf);
+        _leaf_count++;
+        return leaf;
+    }
+
+    void remove(Proxy proxy) {
+        assert(is_leaf(proxy));
+        remove_leaf(proxy);
+        free_node(proxy);
+        _leaf_count--;
+    }
+
+    // Returns true if the leaf is reinserted. Nothing changes if the new AABB
+    // is still contained by the fat AABB of the leaf.
+    bool update(Proxy proxy, const AABB<T> &aabb) {
+        assert(is_leaf(proxy));
+        auto &fat = _nodes[proxy].aabb;
+        if (fat.contains(aabb.min) && fat.contains(aabb.max)) {
+            return false;
+        }
+        remove_leaf(proxy);
+        _nodes[proxy].aabb = fatten(aabb);
+        insert_leaf(proxy);
+        return true;
+    }
+
+    [[nodiscard]] const Data &data(Proxy proxy) const {
+        assert(is_leaf(proxy));
+        return _nodes[proxy].data;
+    }
+
+    void set_data(Proxy proxy, const Data &data) {
+        assert(is_leaf(proxy));
+        _nodes[proxy].data = data;
+    }
+
+    [[nodiscard]] const AABB<T> &fat_aabb(Proxy proxy) const {
+        return _nodes[proxy].aabb;
+    }
+
+    [[nodiscard]] size_t leaf_count() const {
+        return _leaf_count;
+    }
+
+    [[nodiscard]] int32_t height() const {
+        return _root == NULL_PROXY ? 0 : _nodes[_root].height;
+    }
+
+    void clear() {
+        _nodes.clear();
+        _root = NULL_PROXY;
+        _free_list = NULL_PROXY;
+        _leaf_count = 0;
+    }
+
+    // test(const AABB<T> &) -> Containment is called on nodes top down.
+    // visit(const Data &, bool contained) is called on accepted leaves,
+    // contained is true if the leaf is accepted by a Containment::Contain
+    // result, otherwise the leaf fat AABB intersects the query and the caller
+    // may want to do an exact test.
+    template <typename Test, typename Visit>
+    void query(Test &&test, Visit &&visit) const {
+        if (_root == NULL_PROXY) {
+            return;
+        }
+
+        // Depth first traversal holds at most height + 1 entries, the tree is
+        // balanced so the height grows with log of the leaf count
+        struct StackEntry {
+            Proxy node;
+            bool contained;
+        };
+        assert(_nodes[_root].height < MAX_QUERY_STACK_SIZE);
+        StackEntry stack[MAX_QUERY_STACK_SIZE];
+        int32_t stack_size = 0;
+        stack[stack_size++] = {_root, false};
+
+        while (stack_size > 0) {
+            auto entry = stack[--stack_size];
+
+            auto &node = _nodes[entry.node];
+            auto contained = entry.contained;
+            if (!contained) {
+                auto res = test(node.aabb);
+                if (res == Containment::Disjoint) {
+                    continue;
+                }
+                contained = res == Containment::Contain;
+            }
+
+            if (node.is_leaf()) {
+                visit(node.data, contained);
+            } else {
+                stack[stack_size++] = {node.child1, contained};
+                stack[stack_size++] = {node.child2, contained};
+            }
+        }
+    }
+
+  private:
+    static constexpr int32_t MAX_QUERY_STACK_SIZE = 64;
+
+    struct Node {
+        AABB<T> aabb{};
+        Data data{};
+        // Parent for nodes in tree, next free node for nodes in free list
+        Proxy parent = NULL_PROXY;
+        Proxy child1 = NULL_PROXY;
+        Proxy child2 = NULL_PROXY;
+        // Leaf height is 0, free node height is -1
+        int32_t height = -1;
+
+        [[nodiscard]] bool is_leaf() const {
+            return child1 == NULL_PROXY;
+        }
+    };
+
+    static T surface_area(const AABB<T> &aabb) {
+        auto e = aabb.extent();
+        return static_cast<T>(2) * (e.x * e.y + e.y * e.z + e.z * e.x);
+    }
+
+    static AABB<T> combine(const AABB<T> &lhs, const AABB<T> &rhs) {
+        auto res = lhs;
+        res.extend_aabb(rhs);
+        return res;
+    }
+
+    [[nodiscard]] bool is_leaf(Proxy proxy) const {
+        return proxy >= 0 && proxy < static_cast<Proxy>(_nodes.size()) &&
+               _nodes[proxy].height == 0;
+    }
+
+    AABB<T> fatten(const AABB<T> &aabb) const {
+        auto margin = aabb.extent() * _fat_margin_ratio;
+        return AABB<T>(aabb.min - margin, aabb.max + margin);
+    }
+
+    Proxy alloc_node() {
+        if (_free_list == NULL_PROXY) {
+            _nodes.emplace_back();
+            return static_cast<Proxy>(_nodes.size() - 1);
+        }
+        auto node = _free_list;
+        _free_list = _nodes[node].parent;
+        _nodes[node] = Node{};
+        return node;
+    }
+
+    void free_node(Proxy node) {
+        _nodes[node] = Node{};
+        _nodes[node].parent = _free_list;
+        _free_list = node;
+    }
+
+    void insert_leaf(Proxy leaf) {
+        if (_root == NULL_PROXY) {
+            _root = leaf;
+            _nodes[leaf].parent = NULL_PROXY;
+            return;
+        }
+
+        // Find the best sibling with surface area heuristic
+        auto leaf_aabb = _nodes[leaf].aabb;
+        auto index = _root;
+        while (!_nodes[index].is_leaf()) {
+            auto &node = _nodes[index];
+            auto area = surface_area(node.aabb);
+            auto combined_area = surface_area(combine(node.aabb, leaf_aabb));
+
+            // Cost of creating a new parent for this node and the new leaf
+            auto cost = static_cast<T>(2) * combined_area;
+            // Minimum cost of pushing the leaf further down the tree
+            auto inheritance_cost =
+                static_cast<T>(2) * (combined_area - area);
+
+            auto child_cost = [&](Proxy child) {
+                auto &c = _nodes[child];
+                auto new_area = surface_area(combine(c.aabb, leaf_aabb));
+                if (c.is_leaf()) {
+                    return new_area + inheritance_cost;
+                }
+                return new_area - surface_area(c.aabb) + inheritance_cost;
+            };
+
+            auto cost1 = child_cost(node.child1);
+            auto cost2 = child_cost(node.child2);
+
+            if (cost < cost1 && cost < cost2) {
+                break;
+            }
+            index = cost1 < cost2 ? node.child1 : node.child2;
+        }
+
+        auto sibling = index;
+        auto old_parent = _nodes[sibling].parent;
+        auto new_parent = alloc_node();
+        {
+            auto &p = _nodes[new_parent];
+            p.parent = old_parent;
+            p.aabb = combine(leaf_aabb, _nodes[sibling].aabb);
+            p.height = _nodes[sibling].height + 1;
+            p.child1 = sibling;
+            p.child2 = leaf;
+        }
+        _nodes[sibling].parent = new_parent;
+        _nodes[leaf].parent = new_parent;
+
+        if (old_parent == NULL_PROXY) {
+            _root = new_parent;
+        } else if (_nodes[old_parent].child1 == sibling) {
+            _nodes[old_parent].child1 = new_parent;
+        } else {
+            _nodes[old_parent].child2 = new_parent;
+        }
+
+        refit(_nodes[leaf].parent);
+    }
+
+    void remove_leaf(Proxy leaf) {
+        if (leaf == _root) {
+            _root = NULL_PROXY;
+            return;
+        }
+
+        auto parent = _nodes[leaf].parent;
+        auto grand_parent = _nodes[parent].parent;
+        auto sibling = _nodes[parent].child1 == leaf ? _nodes[parent].child2
+                                                     : _nodes[parent].child1;
+
+        if (grand_parent == NULL_PROXY) {
+            _root = sibling;
+            _nodes[sibling].parent = NULL_PROXY;
+        } else {
+            if (_nodes[grand_parent].child1 == parent) {
+                _nodes[grand_parent].child1 = sibling;
+            } else {
+                _nodes[grand_parent].child2 = sibling;
+            }
+            _nodes[sibling].parent = grand_parent;
+            refit(grand_parent);
+        }
+        free_node(parent);
+        _nodes[leaf].parent = NULL_PROXY;
+    }
+
+    // Walk back to the root, fixing heights and AABBs
+    void refit(Proxy index) {
+        while (index != NULL_PROXY) {
+            index = balance(index);
+
+            auto &node = _nodes[index];
+            auto &c1 = _nodes[node.child1];
+            auto &c2 = _nodes[node.child2];
+            node.height = 1 + std::max(c1.height, c2.height);
+            node.aabb = combine(c1.aabb, c2.aabb);
+
+            index = node.parent;
+        }
+    }
+
+    // Rotate the subtree if it is imbalanced. Returns the new root of the
+    // subtree.
+    Proxy balance(Proxy a) {
+        if (_nodes[a].is_leaf() || _nodes[a].height < 2) {
+            return a;
+        }
+
+        auto b = _nodes[a].child1;
+        auto c = _nodes[a].child2;
+        auto diff = _nodes[c].height - _nodes[b].height;
+
+        if (diff > 1) {
+            return rotate(a, c, b);
+        }
+        if (diff < -1) {
+            return rotate(a, b, c);
+        }
+        return a;
+    }
+
+    // Promote the higher child up, a is the old subtree root
+    Proxy rotate(Proxy a, Proxy high, Proxy low) {
+        auto f = _nodes[high].child1;
+        auto g = _nodes[high].child2;
+
+        // Swap a and high
+        _nodes[high].child1 = a;
+        _nodes[high].parent = _nodes[a].parent;
+        _nodes[a].parent = high;
+
+        auto high_parent = _nodes[high].parent;
+        if (high_parent == NULL_PROXY) {
+            _root = high;
+        } else if (_nodes[high_parent].child1 == a) {
+            _nodes[high_parent].child1 = high;
+        } else {
+            _nodes[high_parent].child2 = high;
+        }
+
+        // Keep the higher grand child under high, give the other to a
+        auto keep = f;
+        auto give = g;
+        if (_nodes[f].height < _nodes[g].height) {
+            std::swap(keep, give);
+        }
+
+        _nodes[high].child2 = keep;
+        if (_nodes[a].child1 == high) {
+            _nodes[a].child1 = give;
+        } else {
+            _nodes[a].child2 = give;
+        }
+        _nodes[give].parent = a;
+
+        auto &na = _nodes[a];
+        na.aabb = combine(_nodes[low].aabb, _nodes[give].aabb);
+        na.height = 1 + std::max(_nodes[low].height, _nodes[give].height);
+
+        auto &nh = _nodes[high];
+        nh.aabb = combine(na.aabb, _nodes[keep].aabb);
+        nh.height = 1 + std::max(na.height, _nodes[keep].height);
+
+        return high;
+    }
+
+    T _fat_margin_ratio{};
+    std::vector<Node> _nodes{};
+    Proxy _root = NULL_PROXY;
+    Proxy _free_list = NULL_PROXY;
+    size_t _leaf_count = 0;
+};
+} // namespace ars::math
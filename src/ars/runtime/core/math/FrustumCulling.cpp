@@ -0,0 +1,154 @@
+#include "FrustumCulling.h"
+
+#if defined(__SSE2__) || defined(_M_X64) ||                                    \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define ARS_FRUSTUM_CULLING_SSE 1
+#include <emmintrin.h>
+#else
+#define ARS_FRUSTUM_CULLING_SSE 0
+#endif
+
+namespace ars::math {
+namespace {
+// The SIMD path evaluates exactly the same expression, keep them in sync
+inline bool culled_by_plane(const glm::vec4 &p,
+                            const glm::vec3 &min,
+                            const glm::vec3 &max) {
+    float x = p.x > 0.0f ? min.x : max.x;
+    float y = p.y > 0.0f ? min.y : max.y;
+    float z = p.z > 0.0f ? min.z : max.z;
+    float d = p.x * x;
+    d = d + p.y * y;
+    d = d + p.z * z;
+    d = d + p.w;
+    return d > 0.0f;
+}
+
+inline bool culled(const glm::vec4 *planes,
+                   uint32_t plane_count,
+                   const glm::vec3 &min,
+                   const glm::vec3 &max) {
+    for (uint32_t i = 0; i < plane_count; i++) {
+        if (culled_by_plane(planes[i], min, max)) {
+            return true;
+        }
+    }
+    return false;
+}
+} // namespace
+
+bool aabb_culled(const glm::vec4 *planes,
+                 uint32_t plane_count,
+                 const AABB<float> &aabb) {
+    return culled(planes, plane_count, aabb.min, aabb.max);
+}
+
+bool aabb_inside(const glm::vec4 *planes,
+                 uint32_t plane_count,
+                 const AABB<float> &aabb) {
+    // Test the corner with the largest signed distance to each plane
+    for (uint32_t i = 0; i < plane_count; i++) {
+        auto &p = planes[i];
+        glm::vec3 v(p.x > 0.0f ? aabb.max.x : aabb.min.x,
+                    p.y > 0.0f ? aabb.max.y : aabb.min.y,
+                    p.z > 0.0f ? aabb.max.z : aabb.min.z);
+        if (glm::dot(glm::vec3(p), v) + p.w > 0.0f) {
+            return false;
+        }
+    }
+    return true;
+}
+
+size_t cull_aabbs_scalar(const glm::vec4 *planes,
+                         uint32_t plane_count,
+                         const glm::vec3 *aabb_min,
+                         const glm::vec3 *aabb_max,
+                         const uint32_t *indices,
+                         size_t count,
+                         uint32_t *visible_indices) {
+    size_t visible_count = 0;
+    for (size_t i = 0; i < count; i++) {
+        auto index = indices[i];
+        if (!culled(planes, plane_count, aabb_min[index], aabb_max[index])) {
+            visible_indices[visible_count++] = index;
+        }
+    }
+    return visible_count;
+}
+
+#if ARS_FRUSTUM_CULLING_SSE
+size_t cull_aabbs(const glm::vec4 *planes,
+                  uint32_t plane_count,
+                  const glm::vec3 *aabb_min,
+                  const glm::vec3 *aabb_max,
+                  const uint32_t *indices,
+                  size_t count,
+                  uint32_t *visible_indices) {
+    size_t visible_count = 0;
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        // Copy indices first as visible_indices may alias indices
+        uint32_t idx[4] = {
+            indices[i], indices[i + 1], indices[i + 2], indices[i + 3]};
+
+        auto gather = [&](const glm::vec3 *arr, int c) {
+            return _mm_setr_ps(arr[idx[0]][c],
+                               arr[idx[1]][c],
+                               arr[idx[2]][c],
+                               arr[idx[3]][c]);
+        };
+
+        __m128 min[3] = {
+            gather(aabb_min, 0), gather(aabb_min, 1), gather(aabb_min, 2)};
+        __m128 max[3] = {
+            gather(aabb_max, 0), gather(aabb_max, 1), gather(aabb_max, 2)};
+
+        auto zero = _mm_setzero_ps();
+        auto culled_mask = _mm_setzero_ps();
+        for (uint32_t p = 0; p < plane_count; p++) {
+            auto &plane = planes[p];
+            auto x = plane.x > 0.0f ? min[0] : max[0];
+            auto y = plane.y > 0.0f ? min[1] : max[1];
+            auto z = plane.z > 0.0f ? min[2] : max[2];
+            auto d = _mm_mul_ps(_mm_set1_ps(plane.x), x);
+            d = _mm_add_ps(d, _mm_mul_ps(_mm_set1_ps(plane.y), y));
+            d = _mm_add_ps(d, _mm_mul_ps(_mm_set1_ps(plane.z), z));
+            d = _mm_add_ps(d, _mm_set1_ps(plane.w));
+            culled_mask = _mm_or_ps(culled_mask, _mm_cmpgt_ps(d, zero));
+        }
+
+        auto culled_bits = _mm_movemask_ps(culled_mask);
+        for (int j = 0; j < 4; j++) {
+            if ((culled_bits & (1 << j)) == 0) {
+                visible_indices[visible_count++] = idx[j];
+            }
+        }
+    }
+
+    // Tail
+    for (; i < count; i++) {
+        auto index = indices[i];
+        if (!culled(planes, plane_count, aabb_min[index], aabb_max[index])) {
+            visible_indices[visible_count++] = index;
+        }
+    }
+    return visible_count;
+}
+#else
+size_t cull_aabbs(const glm::vec4 *planes,
+                  uint32_t plane_count,
+                  const glm::vec3 *aabb_min,
+                  const glm::vec3 *aabb_max,
+                  const uint32_t *indices,
+                  size_t count,
+                  uint32_t *visible_indices) {
+    return cull_aabbs_scalar(planes,
+                             plane_count,
+                             aabb_min,
+                             aabb_max,
+                             indices,
+                             count,
+                             visible_indices);
+}
+#endif
+} // namespace ars::math
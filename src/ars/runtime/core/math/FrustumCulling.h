@@ -0,0 +1,47 @@
+#pragma once
+
+#include "AABB.h"
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+
+namespace ars::math {
+// Culling planes store (n, c) for plane function dot(n, p) + c = 0, with n
+// pointing out of the volume. An AABB is culled if it lies completely on the
+// positive side of any plane.
+//
+// The test only looks at the corner with the smallest signed distance to each
+// plane, so it is conservative in the same way as testing all 8 corners.
+[[nodiscard]] bool aabb_culled(const glm::vec4 *planes,
+                               uint32_t plane_count,
+                               const AABB<float> &aabb);
+
+// Returns true if the AABB is completely on the negative side of all planes
+[[nodiscard]] bool aabb_inside(const glm::vec4 *planes,
+                               uint32_t plane_count,
+                               const AABB<float> &aabb);
+
+// Batched culling of boxes stored in separate min and max arrays.
+// Boxes aabb_min[indices[i]], aabb_max[indices[i]] are tested for i in
+// [0, count). Indices of visible boxes are written to visible_indices in the
+// input order, and the number of visible boxes is returned. visible_indices
+// should have space for count elements and may alias indices.
+//
+// Uses SSE when available, results are bit exact with cull_aabbs_scalar.
+size_t cull_aabbs(const glm::vec4 *planes,
+                  uint32_t plane_count,
+                  const glm::vec3 *aabb_min,
+                  const glm::vec3 *aabb_max,
+                  const uint32_t *indices,
+                  size_t count,
+                  uint32_t *visible_indices);
+
+// Reference implementation of cull_aabbs
+size_t cull_aabbs_scalar(const glm::vec4 *planes,
+                         uint32_t plane_count,
+                         const glm::vec3 *aabb_min,
+                         const glm::vec3 *aabb_max,
+                         const uint32_t *indices,
+                         size_t count,
+                         uint32_t *visible_indices);
+} // namespace ars::math
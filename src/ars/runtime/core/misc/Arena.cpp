@@ -0,0 +1,148 @@
+#include "Arena.h"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace ars {
+namespace {
+size_t align_up(size_t v, size_t alignment) {
+    return (v + alignment - 1) / alignment * alignment;
+}
+} // namespace
+
+LinearArena::LinearArena(size_t block_size) : _block_size(block_size) {}
+
+void *LinearArena::alloc(size_t size, size_t alignment) {
+    if (size == 0) {
+        return nullptr;
+    }
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto fit = [&]() -> void * {
+        if (_current >= _blocks.size()) {
+            return nullptr;
+        }
+        auto &block = _blocks[_current];
+        auto base = reinterpret_cast<uintptr_t>(block.memory.get());
+        auto begin = align_up(base + _offset, alignment) - base;
+        if (begin + size > block.size) {
+            return nullptr;
+        }
+        _offset = begin + size;
+        return block.memory.get() + begin;
+    };
+
+    if (auto ptr = fit(); ptr != nullptr) {
+        return ptr;
+    }
+
+    // Move to the next block large enough, blocks skipped are wasted until
+    // reset
+    if (_current < _blocks.size()) {
+        _retired_size += _offset;
+        _current++;
+        _offset = 0;
+    }
+    while (_current < _blocks.size() &&
+           _blocks[_current].size < size + alignment) {
+        _current++;
+    }
+    if (_current >= _blocks.size()) {
+        alloc_block(size + alignment);
+        _current = _blocks.size() - 1;
+    }
+    return fit();
+}
+
+void LinearArena::alloc_block(size_t min_size) {
+    Block block{};
+    block.size = std::max(_block_size, min_size);
+    block.memory = std::make_unique<uint8_t[]>(block.size);
+    _blocks.emplace_back(std::move(block));
+    _block_allocation_count++;
+}
+
+void LinearArena::reset() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    // Merge blocks so the next frame with similar usage fits in a single block
+    if (_blocks.size() > 1) {
+        size_t total_size = 0;
+        for (auto &b : _blocks) {
+            total_size += b.size;
+        }
+        _blocks.clear();
+        alloc_block(total_size);
+    }
+    _current = 0;
+    _offset = 0;
+    _retired_size = 0;
+}
+
+size_t LinearArena::allocated_size() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _retired_size + _offset;
+}
+
+size_t LinearArena::capacity() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    size_t total_size = 0;
+    for (auto &b : _blocks) {
+        total_size += b.size;
+    }
+    return total_size;
+}
+
+uint64_t LinearArena::block_allocation_count() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _block_allocation_count;
+}
+
+LinearArena &frame_arena() {
+    static LinearArena arena{};
+    return arena;
+}
+
+#ifdef ARS_COUNT_HEAP_ALLOCATIONS
+namespace {
+std::atomic<uint64_t> s_heap_allocation_count{0};
+} // namespace
+
+uint64_t heap_allocation_count() {
+    return s_heap_allocation_count.load(std::memory_order_relaxed);
+}
+#else
+uint64_t heap_allocation_count() {
+    return 0;
+}
+#endif
+} // namespace ars
+
+#ifdef ARS_COUNT_HEAP_ALLOCATIONS
+// Replace the global operator new to count heap allocations. Other forms of
+// operator new in the standard library forward to this one.
+void *operator new(size_t size) {
+    ars::s_heap_allocation_count.fetch_add(1, std::memory_order_relaxed);
+    if (size == 0) {
+        size = 1;
+    }
+    while (true) {
+        auto ptr = std::malloc(size);
+        if (ptr != nullptr) {
+            return ptr;
+        }
+        auto handler = std::get_new_handler();
+        if (handler == nullptr) {
+            throw std::bad_alloc();
+        }
+        handler();
+    }
+}
+
+void operator delete(void *ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept {
+    std::free(ptr);
+}
+#endif
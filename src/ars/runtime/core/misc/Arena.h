@@ -0,0 +1,92 @@
+#pragma once
+
+#include "Macro.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace ars {
+// Linear (bump) allocator. Memory is released all at once by reset().
+//
+// alloc() is thread safe. reset() should only be called when no one is
+// allocating from the arena or using memory from it. Blocks are reused across
+// resets, so an arena reaches a steady state without calling malloc.
+class LinearArena {
+  public:
+    explicit LinearArena(size_t block_size = 1 << 20);
+    ARS_NO_COPY_MOVE(LinearArena);
+    ~LinearArena() = default;
+
+    // Returns nullptr if size == 0
+    void *alloc(size_t size, size_t alignment = alignof(std::max_align_t));
+    void reset();
+
+    // Bytes allocated since last reset, including padding for alignment
+    [[nodiscard]] size_t allocated_size() const;
+    // Total size of all blocks
+    [[nodiscard]] size_t capacity() const;
+    // Number of times the arena allocates new blocks from heap
+    [[nodiscard]] uint64_t block_allocation_count() const;
+
+  private:
+    struct Block {
+        std::unique_ptr<uint8_t[]> memory{};
+        size_t size = 0;
+    };
+
+    void alloc_block(size_t min_size);
+
+    size_t _block_size = 0;
+    mutable std::mutex _mutex{};
+    std::vector<Block> _blocks{};
+    // Index of the block to allocate from
+    size_t _current = 0;
+    size_t _offset = 0;
+    // Bytes allocated in blocks before the current one
+    size_t _retired_size = 0;
+    uint64_t _block_allocation_count = 0;
+};
+
+// Arena for transient per-frame data. The render context resets it at the
+// beginning of each frame.
+LinearArena &frame_arena();
+
+// std compatible allocator on a LinearArena. Deallocation is a no-op, memory
+// is reclaimed when the arena resets. Default constructed allocators use
+// frame_arena().
+template <typename T> struct ArenaAllocator {
+    using value_type = T;
+
+    ArenaAllocator() : arena(&frame_arena()) {}
+    explicit ArenaAllocator(LinearArena *arena) : arena(arena) {}
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U> &rhs) : arena(rhs.arena) {}
+
+    T *allocate(size_t n) {
+        return static_cast<T *>(arena->alloc(n * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T *, size_t) {}
+
+    template <typename U> bool operator==(const ArenaAllocator<U> &rhs) const {
+        return arena == rhs.arena;
+    }
+
+    template <typename U> bool operator!=(const ArenaAllocator<U> &rhs) const {
+        return arena != rhs.arena;
+    }
+
+    LinearArena *arena = nullptr;
+};
+
+// Containers of per-frame data. They should not outlive the frame.
+template <typename T> using FrameVector = std::vector<T, ArenaAllocator<T>>;
+
+// Number of calls to global operator new since the program starts. Compare
+// values between frames to find hot paths still allocating from heap. Only
+// counted if core is built with the ARS_COUNT_HEAP_ALLOCATIONS option, zero
+// otherwise.
+uint64_t heap_allocation_count();
+} // namespace ars
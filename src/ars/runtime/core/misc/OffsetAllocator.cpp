@@ -0,0 +1,322 @@
+#include "OffsetAllocator.h"
+#include <algorithm>
+#include <cassert>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace ars {
+namespace {
+constexpr uint32_t MANTISSA_BITS = 3;
+constexpr uint32_t MANTISSA_VALUE = 1 << MANTISSA_BITS;
+constexpr uint32_t MANTISSA_MASK = MANTISSA_VALUE - 1;
+
+uint32_t count_trailing_zeros(uint32_t v) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, v);
+    return index;
+#else
+    return __builtin_ctz(v);
+#endif
+}
+
+uint32_t highest_bit(uint32_t v) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanReverse(&index, v);
+    return index;
+#else
+    return 31 - __builtin_clz(v);
+#endif
+}
+
+// Returns the lowest set bit not lower than start_bit, or NONE
+uint32_t find_lowest_set_bit_after(uint32_t mask, uint32_t start_bit) {
+    if (start_bit >= 32) {
+        return OffsetAllocator::NO_SPACE;
+    }
+    auto bits = mask & (~0u << start_bit);
+    if (bits == 0) {
+        return OffsetAllocator::NO_SPACE;
+    }
+    return count_trailing_zeros(bits);
+}
+
+// Encode size as small float, bins of the encoded value only contain regions
+// no smaller than the size.
+uint32_t size_to_bin_round_up(uint32_t size) {
+    if (size < MANTISSA_VALUE) {
+        return size;
+    }
+    auto mantissa_start = highest_bit(size) - MANTISSA_BITS;
+    auto exp = mantissa_start + 1;
+    auto mantissa = (size >> mantissa_start) & MANTISSA_MASK;
+    auto low_mask = (1u << mantissa_start) - 1;
+    // Carry overflows to exponent correctly
+    if ((size & low_mask) != 0) {
+        mantissa++;
+    }
+    return (exp << MANTISSA_BITS) + mantissa;
+}
+
+uint32_t size_to_bin_round_down(uint32_t size) {
+    if (size < MANTISSA_VALUE) {
+        return size;
+    }
+    auto mantissa_start = highest_bit(size) - MANTISSA_BITS;
+    auto exp = mantissa_start + 1;
+    auto mantissa = (size >> mantissa_start) & MANTISSA_MASK;
+    return (exp << MANTISSA_BITS) | mantissa;
+}
+} // namespace
+
+OffsetAllocator::OffsetAllocator(uint32_t size) {
+    std::fill(std::begin(_bin_heads), std::end(_bin_heads), NONE);
+    grow(size);
+}
+
+OffsetAllocator::Allocation OffsetAllocator::allocate(uint32_t size) {
+    if (size == 0) {
+        return {};
+    }
+
+    auto min_bin = size_to_bin_round_up(size);
+    auto min_top = min_bin / LEAF_BIN_COUNT;
+    auto min_leaf = min_bin % LEAF_BIN_COUNT;
+    if (min_top >= TOP_BIN_COUNT) {
+        return {};
+    }
+
+    // Regions in min_bin and larger bins are always large enough
+    auto top = min_top;
+    auto leaf = NONE;
+    if (_used_bins_top & (1u << top)) {
+        leaf = find_lowest_set_bit_after(_used_bins[top], min_leaf);
+    }
+    if (leaf == NONE) {
+        top = find_lowest_set_bit_after(_used_bins_top, min_top + 1);
+        if (top == NONE) {
+            return {};
+        }
+        leaf = count_trailing_zeros(_used_bins[top]);
+    }
+
+    auto bin = top * LEAF_BIN_COUNT + leaf;
+    auto index = _bin_heads[bin];
+    auto region_size = _nodes[index].size;
+    auto region_offset = _nodes[index].offset;
+    auto neighbor_prev = _nodes[index].neighbor_prev;
+    auto neighbor_next = _nodes[index].neighbor_next;
+    remove_free_node(index);
+
+    auto node = new_node();
+    auto &n = _nodes[node];
+    n.offset = region_offset;
+    n.size = size;
+    n.used = true;
+    n.neighbor_prev = neighbor_prev;
+    n.neighbor_next = neighbor_next;
+    if (neighbor_prev != NONE) {
+        _nodes[neighbor_prev].neighbor_next = node;
+    }
+    if (neighbor_next != NONE) {
+        _nodes[neighbor_next].neighbor_prev = node;
+    }
+    if (_last_node == index) {
+        _last_node = node;
+    }
+
+    // Return the rest of the region to bins
+    if (region_size > size) {
+        auto rest = insert_free_node(region_offset + size, region_size - size);
+        _nodes[rest].neighbor_prev = node;
+        _nodes[rest].neighbor_next = _nodes[node].neighbor_next;
+        if (_nodes[node].neighbor_next != NONE) {
+            _nodes[_nodes[node].neighbor_next].neighbor_prev = rest;
+        }
+        _nodes[node].neighbor_next = rest;
+        if (_last_node == node) {
+            _last_node = rest;
+        }
+    }
+
+    _allocation_count++;
+    return {region_offset, node};
+}
+
+void OffsetAllocator::free(Allocation allocation) {
+    if (!allocation.valid()) {
+        return;
+    }
+
+    auto index = allocation.metadata;
+    assert(index < _nodes.size() && _nodes[index].used);
+
+    auto offset = _nodes[index].offset;
+    auto size = _nodes[index].size;
+    auto neighbor_prev = _nodes[index].neighbor_prev;
+    auto neighbor_next = _nodes[index].neighbor_next;
+    auto is_last = _last_node == index;
+    release_node(index);
+
+    // Merge with free neighbors
+    if (neighbor_prev != NONE && !_nodes[neighbor_prev].used) {
+        auto prev = neighbor_prev;
+        offset = _nodes[prev].offset;
+        size += _nodes[prev].size;
+        neighbor_prev = _nodes[prev].neighbor_prev;
+        remove_free_node(prev);
+    }
+
+    if (neighbor_next != NONE && !_nodes[neighbor_next].used) {
+        auto next = neighbor_next;
+        size += _nodes[next].size;
+        neighbor_next = _nodes[next].neighbor_next;
+        is_last = _last_node == next;
+        remove_free_node(next);
+    }
+
+    auto node = insert_free_node(offset, size);
+    _nodes[node].neighbor_prev = neighbor_prev;
+    _nodes[node].neighbor_next = neighbor_next;
+    if (neighbor_prev != NONE) {
+        _nodes[neighbor_prev].neighbor_next = node;
+    }
+    if (neighbor_next != NONE) {
+        _nodes[neighbor_next].neighbor_prev = node;
+    }
+    if (is_last) {
+        _last_node = node;
+    }
+
+    _allocation_count--;
+}
+
+void OffsetAllocator::grow(uint32_t new_size) {
+    if (new_size <= _size) {
+        return;
+    }
+
+    auto offset = _size;
+    auto size = new_size - _size;
+    auto neighbor_prev = _last_node;
+    _size = new_size;
+
+    // Extend the last region if it is free
+    if (neighbor_prev != NONE && !_nodes[neighbor_prev].used) {
+        auto last = neighbor_prev;
+        offset = _nodes[last].offset;
+        size += _nodes[last].size;
+        neighbor_prev = _nodes[last].neighbor_prev;
+        remove_free_node(last);
+    }
+
+    auto node = insert_free_node(offset, size);
+    _nodes[node].neighbor_prev = neighbor_prev;
+    if (neighbor_prev != NONE) {
+        _nodes[neighbor_prev].neighbor_next = node;
+    }
+    _last_node = node;
+}
+
+uint32_t OffsetAllocator::size() const {
+    return _size;
+}
+
+uint32_t OffsetAllocator::allocation_size(Allocation allocation) const {
+    if (!allocation.valid()) {
+        return 0;
+    }
+    return _nodes[allocation.metadata].size;
+}
+
+OffsetAllocator::Stats OffsetAllocator::stats() const {
+    Stats stats{};
+    stats.total_free = _free_storage;
+    stats.free_region_count = _free_region_count;
+    stats.allocation_count = _allocation_count;
+
+    if (_used_bins_top != 0) {
+        auto top = highest_bit(_used_bins_top);
+        auto leaf = highest_bit(_used_bins[top]);
+        auto bin = top * LEAF_BIN_COUNT + leaf;
+        for (auto i = _bin_heads[bin]; i != NONE; i = _nodes[i].bin_next) {
+            stats.largest_free_region =
+                std::max(stats.largest_free_region, _nodes[i].size);
+        }
+    }
+
+    return stats;
+}
+
+uint32_t OffsetAllocator::new_node() {
+    if (!_free_nodes.empty()) {
+        auto index = _free_nodes.back();
+        _free_nodes.pop_back();
+        _nodes[index] = {};
+        return index;
+    }
+    _nodes.emplace_back();
+    return static_cast<uint32_t>(_nodes.size() - 1);
+}
+
+void OffsetAllocator::release_node(uint32_t index) {
+    _nodes[index].used = false;
+    _free_nodes.push_back(index);
+}
+
+uint32_t OffsetAllocator::insert_free_node(uint32_t offset, uint32_t size) {
+    // Round down, so all regions in the bin are no smaller than the size the
+    // bin represents
+    auto bin = size_to_bin_round_down(size);
+    auto top = bin / LEAF_BIN_COUNT;
+    auto leaf = bin % LEAF_BIN_COUNT;
+
+    _used_bins_top |= 1u << top;
+    _used_bins[top] |= static_cast<uint8_t>(1u << leaf);
+
+    auto index = new_node();
+    auto &node = _nodes[index];
+    node.offset = offset;
+    node.size = size;
+    node.bin_next = _bin_heads[bin];
+    if (node.bin_next != NONE) {
+        _nodes[node.bin_next].bin_prev = index;
+    }
+    _bin_heads[bin] = index;
+
+    _free_storage += size;
+    _free_region_count++;
+    return index;
+}
+
+void OffsetAllocator::remove_free_node(uint32_t index) {
+    auto &node = _nodes[index];
+    assert(!node.used);
+    if (node.bin_prev != NONE) {
+        _nodes[node.bin_prev].bin_next = node.bin_next;
+        if (node.bin_next != NONE) {
+            _nodes[node.bin_next].bin_prev = node.bin_prev;
+        }
+    } else {
+        auto bin = size_to_bin_round_down(node.size);
+        auto top = bin / LEAF_BIN_COUNT;
+        auto leaf = bin % LEAF_BIN_COUNT;
+        _bin_heads[bin] = node.bin_next;
+        if (node.bin_next != NONE) {
+            _nodes[node.bin_next].bin_prev = NONE;
+        } else {
+            _used_bins[top] &= static_cast<uint8_t>(~(1u << leaf));
+            if (_used_bins[top] == 0) {
+                _used_bins_top &= ~(1u << top);
+            }
+        }
+    }
+
+    _free_storage -= node.size;
+    _free_region_count--;
+    release_node(index);
+}
+} // namespace ars
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace ars {
+// Two level segregated fit allocator for offsets in an external memory range,
+// e.g. a GPU buffer. It never touches the memory it manages.
+//
+// Free regions are put into 256 bins by their sizes, which are encoded as
+// small floats with 3 bits mantissa. Bitmasks of non-empty bins make alloc()
+// and free() O(1). Adjacent free regions are merged on free().
+class OffsetAllocator {
+  public:
+    static constexpr uint32_t NO_SPACE = 0xFFFFFFFF;
+
+    struct Allocation {
+        uint32_t offset = NO_SPACE;
+        // Internal node index, used for free
+        uint32_t metadata = NO_SPACE;
+
+        [[nodiscard]] bool valid() const {
+            return offset != NO_SPACE;
+        }
+    };
+
+    struct Stats {
+        uint32_t total_free = 0;
+        uint32_t largest_free_region = 0;
+        uint32_t free_region_count = 0;
+        uint32_t allocation_count = 0;
+    };
+
+    explicit OffsetAllocator(uint32_t size);
+
+    // Returns an invalid allocation if there is no free region large enough
+    Allocation allocate(uint32_t size);
+    void free(Allocation allocation);
+
+    // Extend the managed range to [0, new_size). Shrinking is not supported.
+    void grow(uint32_t new_size);
+
+    [[nodiscard]] uint32_t size() const;
+    [[nodiscard]] uint32_t allocation_size(Allocation allocation) const;
+    [[nodiscard]] Stats stats() const;
+
+  private:
+    static constexpr uint32_t NONE = 0xFFFFFFFF;
+    static constexpr uint32_t TOP_BIN_COUNT = 32;
+    static constexpr uint32_t LEAF_BIN_COUNT = 8;
+    static constexpr uint32_t BIN_COUNT = TOP_BIN_COUNT * LEAF_BIN_COUNT;
+
+    struct Node {
+        uint32_t offset = 0;
+        uint32_t size = 0;
+        uint32_t bin_prev = NONE;
+        uint32_t bin_next = NONE;
+        uint32_t neighbor_prev = NONE;
+        uint32_t neighbor_next = NONE;
+        bool used = false;
+    };
+
+    uint32_t new_node();
+    void release_node(uint32_t index);
+    uint32_t insert_free_node(uint32_t offset, uint32_t size);
+    void remove_free_node(uint32_t index);
+
+    uint32_t _size = 0;
+    uint32_t _free_storage = 0;
+    uint32_t _free_region_count = 0;
+    uint32_t _allocation_count = 0;
+
+    uint32_t _used_bins_top = 0;
+    uint8_t _used_bins[TOP_BIN_COUNT]{};
+    uint32_t _bin_heads[BIN_COUNT]{};
+
+    std::vector<Node> _nodes{};
+    std::vector<uint32_t> _free_nodes{};
+    // The node with the largest offset
+    uint32_t _last_node = NONE;
+};
+} // namespace ars
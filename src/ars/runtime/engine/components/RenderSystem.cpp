@@ -137,7 +137,10 @@ void PointLight::register_component() {
     engine::register_component<PointLight>("ars::engine::PointLight")
         .RTTR_MEMBER_PROPERTY(PointLight, color)(
             rttr::metadata(PropertyAttribute::Display, PropertyDisplay::Color))
-        .RTTR_MEMBER_PROPERTY(PointLight, intensity);
+        .RTTR_MEMBER_PROPERTY(PointLight, intensity)
+        .RTTR_MEMBER_PROPERTY(PointLight, has_range)
+        .RTTR_MEMBER_PROPERTY(PointLight, range)
+        .RTTR_MEMBER_PROPERTY_READONLY(PointLight, effective_range);
 }
 
 void PointLight::init(Entity *entity) {
@@ -181,6 +184,33 @@ void PointLight::set_intensity(float intensity) {
     light()->set_intensity(intensity);
 }
 
+float PointLight::range() const {
+    return _range;
+}
+
+void PointLight::set_range(float range) {
+    _range = range;
+    if (light()->has_range()) {
+        light()->set_range(range);
+    }
+}
+
+bool PointLight::has_range() const {
+    return light()->has_range();
+}
+
+void PointLight::set_has_range(bool has_range) {
+    if (has_range) {
+        light()->set_range(_range);
+    } else {
+        light()->reset_range();
+    }
+}
+
+float PointLight::effective_range() const {
+    return light()->range();
+}
+
 void DirectionalLight::register_component() {
     engine::register_component<DirectionalLight>(
         "ars::engine::DirectionalLight")
@@ -314,6 +344,10 @@ void load_node(Entity *parent,
         if (l.type == render::Model::Point) {
             auto comp = entity->add_component<PointLight>();
             set_up_light(comp->light(), l);
+            if (l.range.has_value()) {
+                comp->set_range(l.range.value());
+                comp->set_has_range(true);
+            }
         }
     }
 
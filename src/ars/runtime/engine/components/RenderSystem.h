@@ -94,10 +94,21 @@ class PointLight : public IComponent {
     void set_color(glm::vec3 color);
     [[nodiscard]] float intensity() const;
     void set_intensity(float intensity);
+    // The explicit range, only used by the light if has_range() is true.
+    // Otherwise the range is computed from color and intensity.
+    [[nodiscard]] float range() const;
+    void set_range(float range);
+    [[nodiscard]] bool has_range() const;
+    void set_has_range(bool has_range);
+    // The range used by the light
+    [[nodiscard]] float effective_range() const;
 
   private:
     RenderSystem *_render_system{};
     RenderSystem::PointLights::Id _id{};
+    // Kept while the range is not explicit, so the pair can be deserialized
+    // in any order
+    float _range = 10.0f;
 };
 
 class DirectionalLight : public IComponent {
@@ -4,6 +4,7 @@
 #include <memory>
 #include <optional>
 #include <string>
+#include <vector>
 
 namespace ars::render {
 class IWindow;
@@ -38,6 +39,10 @@ struct ApplicationInfo {
     bool enable_presentation = true;
     bool enable_validation = false;
     bool enable_profiler = false;
+
+    // Directory of caches kept across launches, e.g. the pipeline cache. If
+    // empty, a directory named by the app in the user cache directory is used.
+    std::string cache_dir{};
 };
 
 enum class DefaultTexture : uint32_t {
@@ -75,8 +80,16 @@ class IContext {
 
     virtual std::shared_ptr<IMesh> create_mesh(const MeshInfo &info) = 0;
     virtual std::shared_ptr<ISkin> create_skin(const SkinInfo &info) = 0;
+    // Pipelines of materials with new infos are compiled in the background,
+    // objects using them are not drawn until the pipelines are ready
     virtual std::shared_ptr<IMaterial>
     create_material(const MaterialInfo &info) = 0;
+    // Start compiling pipelines of materials with the infos, e.g. while
+    // loading, so materials created later are drawn at once
+    virtual void prewarm_materials(const std::vector<MaterialInfo> &infos) = 0;
+    // Block until pipelines of all materials created or prewarmed so far are
+    // compiled
+    virtual void wait_for_material_pipelines() = 0;
 
     virtual std::shared_ptr<IPanoramaSky> create_panorama_sky() = 0;
     virtual std::shared_ptr<IPhysicalSky> create_physical_sky() = 0;
@@ -1,4 +1,5 @@
 #include "IScene.h"
+#include <ars/runtime/core/math/FrustumCulling.h>
 #include <ars/runtime/core/misc/Visitor.h>
 
 namespace ars::render {
@@ -239,26 +240,11 @@ float linear_z_to_depth01(const glm::mat4 &P, float linear_z) {
 bool Frustum::culled(const math::AABB<float> &aabb) const {
     // Conservative culling, some aabb that not intersect with frustum may not
     // be culled. But those culled are definitely out of view.
-    for (int i = 0; i < plane_count; i++) {
-        auto p = planes[i];
-        auto culled_point = [&](const glm::vec3 &v) {
-            return glm::dot(p, glm::vec4(aabb.lerp(v), 1.0f)) > 0;
-        };
-
-        bool culled = true;
-        culled = culled && culled_point({0.0f, 0.0f, 0.0f});
-        culled = culled && culled_point({0.0f, 0.0f, 1.0f});
-        culled = culled && culled_point({0.0f, 1.0f, 0.0f});
-        culled = culled && culled_point({0.0f, 1.0f, 1.0f});
-        culled = culled && culled_point({1.0f, 0.0f, 0.0f});
-        culled = culled && culled_point({1.0f, 0.0f, 1.0f});
-        culled = culled && culled_point({1.0f, 1.0f, 0.0f});
-        culled = culled && culled_point({1.0f, 1.0f, 1.0f});
-        if (culled) {
-            return true;
-        }
-    }
-    return false;
+    return math::aabb_culled(planes, plane_count, aabb);
+}
+
+bool Frustum::contains(const math::AABB<float> &aabb) const {
+    return math::aabb_inside(planes, plane_count, aabb);
 }
 
 std::array<uint32_t, 24> Frustum::edges() {
@@ -89,6 +89,17 @@ class IPointLight {
     // 1.0f by default
     virtual float intensity() = 0;
     virtual void set_intensity(float intensity) = 0;
+    // Radiance smoothly falls off to zero at range. Lights are culled by range
+    // so it should be finite and > 0.
+    // If not set, it's where the radiance falls to 0.01 with inverse square
+    // falloff, computed from color and intensity. About 2.82f for the
+    // defaults.
+    virtual float range() = 0;
+    virtual void set_range(float range) = 0;
+    // Whether the range is set explicitly, reset_range() goes back to the
+    // range computed from color and intensity
+    virtual bool has_range() = 0;
+    virtual void reset_range() = 0;
     // The user data of managed lights is the Entity* in editor.
     virtual uint64_t user_data() = 0;
     virtual void set_user_data(uint64_t user_data) = 0;
@@ -116,6 +127,8 @@ struct Frustum {
     glm::vec3 vertices[8]{};
 
     [[nodiscard]] bool culled(const math::AABB<float> &aabb) const;
+    // Returns true if the aabb is completely inside the frustum
+    [[nodiscard]] bool contains(const math::AABB<float> &aabb) const;
     static std::array<uint32_t, 24> edges();
     // Get a vertex based on normalized coord.
     // p.z == 0.0f return points on the near plane, p.z == 1.0f return points on
@@ -759,6 +759,9 @@ void load_lights(const tinygltf::Model &gltf, Model &model) {
             gltf_light.color[0], gltf_light.color[1], gltf_light.color[2]);
         light.intensity = static_cast<float>(gltf_light.intensity);
         light.type = translate_light_type(gltf_light.type);
+        if (gltf_light.range > 0.0) {
+            light.range = static_cast<float>(gltf_light.range);
+        }
 
         model.lights.emplace_back(std::move(light));
     }
@@ -71,6 +71,9 @@ struct Model {
         LightType type;
         glm::vec3 color;
         float intensity;
+        // Computed from color and intensity if not set, see
+        // IPointLight::range()
+        std::optional<float> range;
     };
 
     std::optional<Index> default_scene{};
@@ -1,13 +1,141 @@
 #include "Bindless.h"
+#include "Context.h"
+#include "Pipeline.h"
 #include "Texture.h"
+#include <algorithm>
+#include <ars/runtime/core/Log.h>
 
 namespace ars::render::vk {
+namespace {
+// Upper bound of the array size, devices may support far more
+constexpr uint32_t MAX_BINDLESS_TEXTURE_COUNT = 16384;
+} // namespace
+
+BindlessResources::BindlessResources(Context *context) : _context(context) {
+    if (_context->info().support_bindless()) {
+        init_descriptor_set();
+    }
+}
+
+BindlessResources::~BindlessResources() {
+    auto device = _context->device();
+    if (_pool != VK_NULL_HANDLE) {
+        device->Destroy(_pool);
+    }
+    if (_set_layout != VK_NULL_HANDLE) {
+        device->Destroy(_set_layout);
+    }
+}
+
+void BindlessResources::init_descriptor_set() {
+    auto &limits = _context->info().descriptor_indexing_properties;
+    auto set_limit =
+        std::min(limits.maxDescriptorSetUpdateAfterBindSampledImages,
+                 limits.maxDescriptorSetUpdateAfterBindSamplers);
+    auto stage_limit =
+        std::min(limits.maxPerStageDescriptorUpdateAfterBindSampledImages,
+                 limits.maxPerStageDescriptorUpdateAfterBindSamplers);
+    _capacity =
+        std::min({MAX_BINDLESS_TEXTURE_COUNT, set_limit, stage_limit});
+
+    VkDescriptorSetLayoutBinding binding{};
+    binding.binding = 0;
+    binding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    binding.descriptorCount = _capacity;
+    binding.stageFlags = VK_SHADER_STAGE_ALL;
+
+    // Entries of destroyed textures are left invalid, and entries of new
+    // textures are written while earlier frames using the set are in flight
+    VkDescriptorBindingFlagsEXT binding_flags =
+        VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT_EXT |
+        VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT_EXT |
+        VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT_EXT;
+    VkDescriptorSetLayoutBindingFlagsCreateInfoEXT flags_info{
+        VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO_EXT};
+    flags_info.bindingCount = 1;
+    flags_info.pBindingFlags = &binding_flags;
+
+    VkDescriptorSetLayoutCreateInfo layout_info{
+        VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO};
+    layout_info.pNext = &flags_info;
+    layout_info.flags =
+        VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT_EXT;
+    layout_info.bindingCount = 1;
+    layout_info.pBindings = &binding;
+
+    auto device = _context->device();
+    if (device->Create(&layout_info, &_set_layout) != VK_SUCCESS) {
+        ARS_LOG_CRITICAL("Failed to create bindless descriptor set layout");
+    }
+
+    VkDescriptorPoolSize pool_size{VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                                   _capacity};
+    VkDescriptorPoolCreateInfo pool_info{
+        VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO};
+    pool_info.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT_EXT;
+    pool_info.maxSets = 1;
+    pool_info.poolSizeCount = 1;
+    pool_info.pPoolSizes = &pool_size;
+    if (device->Create(&pool_info, &_pool) != VK_SUCCESS) {
+        ARS_LOG_CRITICAL("Failed to create bindless descriptor pool");
+    }
+
+    VkDescriptorSetAllocateInfo alloc_info{
+        VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO};
+    alloc_info.descriptorPool = _pool;
+    alloc_info.descriptorSetCount = 1;
+    alloc_info.pSetLayouts = &_set_layout;
+    if (device->Allocate(&alloc_info, &_set) != VK_SUCCESS) {
+        ARS_LOG_CRITICAL("Failed to alloc bindless descriptor set");
+    }
+
+    ARS_LOG_INFO("Bindless texture capacity: {}", _capacity);
+}
+
 int32_t BindlessResources::make_resident(Texture *tex) {
-    if (tex->info().view_type == VK_IMAGE_VIEW_TYPE_2D) {
-        textures_2d.push_back(tex);
-        return static_cast<int32_t>(textures_2d.size() - 1);
+    if (_set == VK_NULL_HANDLE) {
+        return -1;
     }
-    return -1;
+
+    auto &info = tex->info();
+    if (info.view_type != VK_IMAGE_VIEW_TYPE_2D ||
+        info.samples != VK_SAMPLE_COUNT_1_BIT ||
+        info.aspect_mask != VK_IMAGE_ASPECT_COLOR_BIT ||
+        (info.usage & VK_IMAGE_USAGE_SAMPLED_BIT) == 0) {
+        return -1;
+    }
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    uint32_t id = 0;
+    if (!_free_ids.empty()) {
+        id = _free_ids.back();
+        _free_ids.pop_back();
+    } else if (_next_id < _capacity) {
+        id = _next_id++;
+    } else {
+        ARS_LOG_ERROR("Bindless texture array is full, texture \"{}\" can not "
+                      "be sampled by materials",
+                      info.name);
+        return -1;
+    }
+
+    // Textures are sampled by materials after their data is uploaded, which
+    // leaves them in the GENERAL layout, as does mipmap generation
+    VkDescriptorImageInfo image_info{};
+    image_info.sampler = tex->sampler();
+    image_info.imageView = tex->image_view();
+    image_info.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+    VkWriteDescriptorSet write{VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET};
+    write.dstSet = _set;
+    write.dstBinding = 0;
+    write.dstArrayElement = id;
+    write.descriptorCount = 1;
+    write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    write.pImageInfo = &image_info;
+    _context->device()->UpdateDescriptorSets(1, &write, 0, nullptr);
+
+    return static_cast<int32_t>(id);
 }
 
 void BindlessResources::make_none_resident(Texture *tex) {
@@ -15,10 +143,36 @@ void BindlessResources::make_none_resident(Texture *tex) {
         return;
     }
 
-    if (tex->info().view_type == VK_IMAGE_VIEW_TYPE_2D) {
-        textures_2d[tex->bindless_id()] = nullptr;
+    // The entry is left as is, it's not used by shaders any more
+    std::lock_guard<std::mutex> lock(_mutex);
+    _free_ids.push_back(static_cast<uint32_t>(tex->bindless_id()));
+}
+
+VkDescriptorSetLayout BindlessResources::set_layout() const {
+    return _set_layout;
+}
+
+void BindlessResources::bind(CommandBuffer *cmd,
+                             const Pipeline *pipeline) const {
+    if (_set == VK_NULL_HANDLE ||
+        !pipeline->pipeline_layout_info().sets[BINDLESS_SET].has_value()) {
+        return;
     }
+    cmd->BindDescriptorSets(pipeline->bind_point(),
+                            pipeline->pipeline_layout(),
+                            BINDLESS_SET,
+                            1,
+                            &_set,
+                            0,
+                            nullptr);
+}
+
+uint32_t BindlessResources::capacity() const {
+    return _capacity;
 }
 
-BindlessResources::BindlessResources(Context *context) : _context(context) {}
-} // namespace ars::render::vk
\ No newline at end of file
+uint32_t BindlessResources::resident_count() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _next_id - static_cast<uint32_t>(_free_ids.size());
+}
+} // namespace ars::render::vk
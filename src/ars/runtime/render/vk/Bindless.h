@@ -1,21 +1,58 @@
 #pragma once
 
-#include <vector>
+#include "Vulkan.h"
 #include <cstdint>
+#include <mutex>
+#include <vector>
 
 namespace ars::render::vk {
 class Texture;
 class Context;
+class Pipeline;
+
+// Index of the descriptor set holding the bindless texture array in shaders,
+// see MaterialAPI.glsl. Other shaders must not use this set.
+constexpr uint32_t BINDLESS_SET = 3;
 
+// Sampled 2D textures in one update-after-bind descriptor array, indexed by
+// the bindless ids of textures. Ids are given when textures are created, and
+// recycled when they are destroyed, which is after the GPU finishes with them.
+// Does nothing if the device does not support bindless.
 class BindlessResources {
   public:
     explicit BindlessResources(Context *context);
 
+    ARS_NO_COPY_MOVE(BindlessResources);
+
+    ~BindlessResources();
+
+    // Return the bindless id of the texture, or -1 if the texture can not be
+    // sampled as a 2D texture or the array is full
     int32_t make_resident(Texture *tex);
     void make_none_resident(Texture *tex);
 
+    // Null if bindless is not supported
+    [[nodiscard]] VkDescriptorSetLayout set_layout() const;
+    // Bind the texture array if the pipeline declares it
+    void bind(CommandBuffer *cmd, const Pipeline *pipeline) const;
+
+    [[nodiscard]] uint32_t capacity() const;
+    [[nodiscard]] uint32_t resident_count() const;
+
   private:
+    void init_descriptor_set();
+
     Context *_context = nullptr;
-    std::vector<Texture *> textures_2d{};
+    VkDescriptorPool _pool = VK_NULL_HANDLE;
+    VkDescriptorSetLayout _set_layout = VK_NULL_HANDLE;
+    VkDescriptorSet _set = VK_NULL_HANDLE;
+    uint32_t _capacity = 0;
+
+    // Ids in [0, _next_id) not in the free list are resident
+    uint32_t _next_id = 0;
+    std::vector<uint32_t> _free_ids{};
+    // Textures may be created on job workers, and writes to the set must be
+    // externally synchronized
+    mutable std::mutex _mutex{};
 };
 } // namespace ars::render::vk
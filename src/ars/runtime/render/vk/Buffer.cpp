@@ -1,20 +1,77 @@
 #include "Buffer.h"
 #include "Context.h"
+#include "Upload.h"
 #include <ars/runtime/core/Log.h>
+#include <ars/runtime/core/Profiler.h>
+#include <ars/runtime/core/misc/Arena.h>
+#include <atomic>
 
 namespace ars::render::vk {
+namespace {
+std::atomic<uint64_t> s_buffer_id_counter{0};
+
+// Copy ranges of the old buffer of a heap to its new buffer. The copy waits
+// for pending uploads into the old buffer, and later vertex, index or other
+// reads wait for the copy.
+void copy_heap_buffer(CommandBuffer *cmd,
+                      Buffer *src,
+                      Buffer *dst,
+                      uint32_t copy_count,
+                      const VkBufferCopy *copies) {
+    VkMemoryBarrier barrier{VK_STRUCTURE_TYPE_MEMORY_BARRIER};
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    cmd->PipelineBarrier(VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         0,
+                         1,
+                         &barrier,
+                         0,
+                         nullptr,
+                         0,
+                         nullptr);
+
+    cmd->CopyBuffer(src->buffer(), dst->buffer(), copy_count, copies);
+
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+    cmd->PipelineBarrier(VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+                         0,
+                         1,
+                         &barrier,
+                         0,
+                         nullptr,
+                         0,
+                         nullptr);
+}
+} // namespace
 
 Buffer::Buffer(Context *context,
                VkDeviceSize size,
                VkBufferUsageFlags buffer_usage,
                VmaMemoryUsage memory_usage)
     : _context(context), _size(size), _buffer_usage(buffer_usage),
-      _memory_usage(memory_usage) {
+      _memory_usage(memory_usage),
+      _id(s_buffer_id_counter.fetch_add(1, std::memory_order_relaxed)) {
     VkBufferCreateInfo buffer_info = {};
     buffer_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
     buffer_info.size = size;
     buffer_info.usage = buffer_usage;
 
+    // Buffers are shared with the async compute queue without queue family
+    // ownership transfers, so their contents stay valid on both queues,
+    // including those written by uploads.
+    uint32_t queue_families[2]{};
+    if (auto compute_queue = _context->compute_queue();
+        compute_queue != nullptr) {
+        queue_families[0] = _context->queue()->family_index();
+        queue_families[1] = compute_queue->family_index();
+        buffer_info.sharingMode = VK_SHARING_MODE_CONCURRENT;
+        buffer_info.queueFamilyIndexCount = 2;
+        buffer_info.pQueueFamilyIndices = queue_families;
+    }
+
     VmaAllocationCreateInfo alloc_info = {};
     alloc_info.usage = memory_usage;
 
@@ -55,33 +112,37 @@ VkDeviceSize Buffer::size() const {
     return _size;
 }
 
-void Buffer::set_data_raw(void *value, size_t byte_offset, size_t byte_count) {
+uint64_t Buffer::id() const {
+    return _id;
+}
+
+UploadToken
+Buffer::set_data_raw(void *value, size_t byte_offset, size_t byte_count) {
     if (value == nullptr) {
-        return;
+        return 0;
     }
 
     assert(byte_offset + byte_count <= _size);
 
     if (_memory_usage == VMA_MEMORY_USAGE_GPU_ONLY) {
-        auto staging_buffer =
-            _context->create_buffer(byte_count,
-                                    VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                                    VMA_MEMORY_USAGE_CPU_TO_GPU);
-        staging_buffer->set_data_raw(value, 0, byte_count);
-        _context->queue()->submit_once([&](CommandBuffer *cmd) {
-            VkBufferCopy copy{};
-            copy.srcOffset = 0;
-            copy.dstOffset = byte_offset;
-            copy.size = byte_count;
-            cmd->CopyBuffer(staging_buffer->buffer(), _buffer, 1, &copy);
-        });
-        return;
+        return _context->uploader()->upload(
+            value,
+            byte_count,
+            4,
+            [&](CommandBuffer *cmd, VkBuffer staging, VkDeviceSize offset) {
+                VkBufferCopy copy{};
+                copy.srcOffset = offset;
+                copy.dstOffset = byte_offset;
+                copy.size = byte_count;
+                cmd->CopyBuffer(staging, _buffer, 1, &copy);
+            });
     }
 
     map_once([&](void *ptr) {
         auto t_ptr = reinterpret_cast<uint8_t *>(ptr);
         std::memcpy(t_ptr + byte_offset, value, byte_count);
     });
+    return 0;
 }
 
 VkDeviceAddress Buffer::device_address() const {
@@ -99,26 +160,46 @@ Handle<Buffer> Heap::buffer() const {
     return _buffer;
 }
 
-uint64_t Heap::alloc(VkDeviceSize size) {
-    auto required_capacity = _size + size;
-    if (required_capacity > _buffer->size()) {
-        extend(static_cast<VkDeviceSize>(required_capacity +
-                                         (required_capacity >> 2)));
+namespace {
+// Sizes of ranges are rounded up to this, so offsets are always aligned
+constexpr VkDeviceSize HEAP_ALIGNMENT = 16;
+constexpr VkDeviceSize HEAP_INITIAL_CAPACITY = 1024;
+// Do not defragment small heaps
+constexpr VkDeviceSize HEAP_MIN_DEFRAGMENT_CAPACITY = 4 * 1024 * 1024;
+
+VkDeviceSize align_heap_size(VkDeviceSize size) {
+    return (size + HEAP_ALIGNMENT - 1) / HEAP_ALIGNMENT * HEAP_ALIGNMENT;
+}
+} // namespace
+
+OffsetAllocator::Allocation Heap::alloc(VkDeviceSize size) {
+    auto aligned_size = align_heap_size(size);
+    assert(aligned_size < OffsetAllocator::NO_SPACE);
+    auto allocation = _allocator.allocate(static_cast<uint32_t>(aligned_size));
+    if (!allocation.valid()) {
+        auto capacity = _buffer->size();
+        extend(capacity + std::max(capacity / 2, aligned_size));
+        allocation = _allocator.allocate(static_cast<uint32_t>(aligned_size));
     }
-    auto ptr = _size;
-    _size += size;
-    return ptr;
+    assert(allocation.valid());
+    return allocation;
 }
 
-void Heap::free(uint64_t ptr) {
-    // TODO correct alloc/free
+void Heap::free(HeapRangeOwned *range) {
+    _allocator.free(range->_allocation);
+    // Swap remove from the live range list
+    auto index = range->_index;
+    assert(index < _ranges.size() && _ranges[index] == range);
+    _ranges[index] = _ranges.back();
+    _ranges[index]->_index = index;
+    _ranges.pop_back();
 }
 
 Heap::Heap(Context *context, const HeapInfo &info)
-    : _context(context), _info(info) {
+    : _context(context), _info(info), _allocator(0) {
+    extend(HEAP_INITIAL_CAPACITY);
     // Just waste 128 bits, so we can always return none zero offset
-    _size = 128;
-    extend(1024);
+    _allocator.allocate(HEAP_ALIGNMENT);
 }
 
 void Heap::extend(VkDeviceSize capacity) {
@@ -126,22 +207,108 @@ void Heap::extend(VkDeviceSize capacity) {
         return;
     }
 
+    assert(capacity < OffsetAllocator::NO_SPACE);
     auto new_buffer = _context->create_buffer(
         capacity, _info.buffer_usage, _info.memory_usage);
     if (_buffer != nullptr) {
-        assert(_size <= capacity);
         _context->queue()->submit_once([&](CommandBuffer *cmd) {
             VkBufferCopy copy{};
-            copy.size = _size;
-            cmd->CopyBuffer(_buffer->buffer(), new_buffer->buffer(), 1, &copy);
+            copy.size = _buffer->size();
+            copy_heap_buffer(cmd, _buffer.get(), new_buffer.get(), 1, &copy);
         });
     }
     _buffer = new_buffer;
+    _allocator.grow(static_cast<uint32_t>(capacity));
+}
+
+void Heap::defragment() {
+    auto heap_stats = stats();
+    auto capacity =
+        std::max(HEAP_INITIAL_CAPACITY,
+                 align_heap_size(heap_stats.used + heap_stats.used / 4));
+    auto new_buffer = _context->create_buffer(
+        capacity, _info.buffer_usage, _info.memory_usage);
+
+    OffsetAllocator allocator(static_cast<uint32_t>(capacity));
+    allocator.allocate(HEAP_ALIGNMENT);
+
+    // Keep the order of ranges, so adjacent ranges are copied together
+    std::sort(_ranges.begin(), _ranges.end(), [](auto lhs, auto rhs) {
+        return lhs->_allocation.offset < rhs->_allocation.offset;
+    });
+
+    FrameVector<VkBufferCopy> copies{};
+    for (size_t i = 0; i < _ranges.size(); i++) {
+        auto range = _ranges[i];
+        auto size = _allocator.allocation_size(range->_allocation);
+        auto allocation = allocator.allocate(size);
+        assert(allocation.valid());
+
+        if (!copies.empty() &&
+            copies.back().srcOffset + copies.back().size ==
+                range->_allocation.offset &&
+            copies.back().dstOffset + copies.back().size ==
+                allocation.offset) {
+            copies.back().size += size;
+        } else {
+            VkBufferCopy copy{};
+            copy.srcOffset = range->_allocation.offset;
+            copy.dstOffset = allocation.offset;
+            copy.size = size;
+            copies.push_back(copy);
+        }
+
+        range->_allocation = allocation;
+        range->_index = i;
+    }
+
+    if (!copies.empty()) {
+        _context->queue()->submit_once([&](CommandBuffer *cmd) {
+            copy_heap_buffer(cmd,
+                             _buffer.get(),
+                             new_buffer.get(),
+                             static_cast<uint32_t>(copies.size()),
+                             copies.data());
+        });
+    }
+
+    // The old buffer is released after frames in flight finish
+    _buffer = new_buffer;
+    _allocator = std::move(allocator);
+}
+
+void Heap::defragment_if_needed() {
+    if (_info.defragment_threshold <= 0.0f) {
+        return;
+    }
+    auto heap_stats = stats();
+    if (heap_stats.capacity < HEAP_MIN_DEFRAGMENT_CAPACITY) {
+        return;
+    }
+    auto free_size = heap_stats.capacity - heap_stats.used;
+    if (static_cast<float>(free_size) >
+        static_cast<float>(heap_stats.capacity) * _info.defragment_threshold) {
+        ARS_PROFILER_SAMPLE("Defragment Heap", 0xFF813416);
+        defragment();
+    }
+}
+
+HeapStats Heap::stats() const {
+    auto allocator_stats = _allocator.stats();
+    HeapStats stats{};
+    stats.capacity = _allocator.size();
+    stats.used = stats.capacity - allocator_stats.total_free;
+    stats.largest_free_region = allocator_stats.largest_free_region;
+    stats.allocation_count = allocator_stats.allocation_count;
+    stats.free_region_count = allocator_stats.free_region_count;
+    return stats;
 }
 
 Handle<HeapRangeOwned> Heap::alloc_owned(VkDeviceSize size) {
-    auto offset = alloc(size);
-    return _context->create_heap_range_owned(this, offset, size);
+    auto range = _context->create_heap_range_owned(this, alloc(size), size);
+    range->_index = _ranges.size();
+    _ranges.push_back(range.get());
+    return range;
 }
 
 HeapInfo HeapInfo::named(NamedHeap heap) {
@@ -156,6 +323,7 @@ HeapInfo HeapInfo::named(NamedHeap heap) {
             VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR |
             VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT_KHR;
         info.memory_usage = VMA_MEMORY_USAGE_GPU_ONLY;
+        info.defragment_threshold = 0.5f;
         break;
     case NamedHeap_Indices:
         info.buffer_usage |=
@@ -163,6 +331,7 @@ HeapInfo HeapInfo::named(NamedHeap heap) {
             VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR |
             VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT_KHR;
         info.memory_usage = VMA_MEMORY_USAGE_GPU_ONLY;
+        info.defragment_threshold = 0.5f;
         break;
     case NamedHeap_Count:
         break;
@@ -171,18 +340,20 @@ HeapInfo HeapInfo::named(NamedHeap heap) {
 }
 
 HeapRangeOwned::~HeapRangeOwned() {
-    _heap->free(_offset);
+    _heap->free(this);
 }
 
-HeapRangeOwned::HeapRangeOwned(Heap *heap, uint64_t offset, VkDeviceSize size)
-    : _heap(heap), _offset(offset), _size(size) {}
+HeapRangeOwned::HeapRangeOwned(Heap *heap,
+                               OffsetAllocator::Allocation allocation,
+                               VkDeviceSize size)
+    : _heap(heap), _allocation(allocation), _size(size) {}
 
 Heap *HeapRangeOwned::heap() const {
     return _heap;
 }
 
 uint64_t HeapRangeOwned::offset() const {
-    return _offset;
+    return _allocation.offset;
 }
 
 VkDeviceSize HeapRangeOwned::size() const {
@@ -197,7 +368,7 @@ HeapRange HeapRangeOwned::slice(uint64_t offset_in_range,
                                 VkDeviceSize size) const {
     HeapRange range{};
     range.heap = heap();
-    range.offset = _offset + offset_in_range;
+    range.offset = _allocation.offset + offset_in_range;
     range.size = size;
     return range;
 }
@@ -215,13 +386,14 @@ HeapRange HeapRange::slice(uint64_t offset_in_range,
     return range;
 }
 
-void HeapRange::set_data_raw(void *value,
-                             size_t byte_offset,
-                             size_t byte_count) {
+UploadToken HeapRange::set_data_raw(void *value,
+                                    size_t byte_offset,
+                                    size_t byte_count) {
     if (heap == nullptr) {
-        return;
+        return 0;
     }
-    heap->buffer()->set_data_raw(value, offset + byte_offset, byte_count);
+    return heap->buffer()->set_data_raw(
+        value, offset + byte_offset, byte_count);
 }
 
 VkDeviceAddress HeapRange::device_address() const {
@@ -241,4 +413,90 @@ VkBuffer HeapRange::buffer() const {
     }
     return VK_NULL_HANDLE;
 }
+
+void BufferArenaRange::set_data_raw(void *value,
+                                    size_t byte_offset,
+                                    size_t byte_count) {
+    assert(byte_offset + byte_count <= size);
+    std::memcpy(static_cast<uint8_t *>(data) + byte_offset, value, byte_count);
+}
+
+BufferArena::BufferArena(Context *context, VkDeviceSize block_size)
+    : _context(context) {
+    auto &limits = _context->info().properties.limits;
+    _min_alignment = std::max({_min_alignment,
+                               limits.minUniformBufferOffsetAlignment,
+                               limits.minStorageBufferOffsetAlignment});
+    alloc_block(block_size);
+}
+
+BufferArena::~BufferArena() {
+    release_blocks();
+}
+
+void BufferArena::reset() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _offset = 0;
+    if (_blocks.size() > 1) {
+        VkDeviceSize total_size = 0;
+        for (auto &block : _blocks) {
+            total_size += block.buffer->size();
+        }
+        release_blocks();
+        alloc_block(total_size);
+    }
+}
+
+BufferArenaRange BufferArena::alloc(VkDeviceSize size,
+                                    VkDeviceSize alignment) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    alignment = std::max(alignment, _min_alignment);
+    auto offset = (_offset + alignment - 1) / alignment * alignment;
+    auto block_size = _blocks.back().buffer->size();
+    if (offset + size > block_size) {
+        alloc_block(std::max(block_size, size));
+        offset = 0;
+    }
+    _offset = offset + size;
+
+    auto &block = _blocks.back();
+    BufferArenaRange range{};
+    range.buffer = block.buffer.get();
+    range.offset = offset;
+    range.size = size;
+    range.data = block.data + offset;
+    return range;
+}
+
+VkDeviceSize BufferArena::capacity() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    VkDeviceSize capacity = 0;
+    for (auto &block : _blocks) {
+        capacity += block.buffer->size();
+    }
+    return capacity;
+}
+
+void BufferArena::alloc_block(VkDeviceSize size) {
+    Block block{};
+    block.buffer = _context->create_buffer(
+        size,
+        VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT |
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+            VK_BUFFER_USAGE_VERTEX_BUFFER_BIT |
+            VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+        VMA_MEMORY_USAGE_CPU_TO_GPU);
+    block.data = static_cast<uint8_t *>(block.buffer->map());
+    _blocks.push_back(std::move(block));
+    _offset = 0;
+}
+
+void BufferArena::release_blocks() {
+    // Buffers go through gc of the context, so they are destroyed after the
+    // current frame finishes on the GPU
+    for (auto &block : _blocks) {
+        block.buffer->unmap();
+    }
+    _blocks.clear();
+}
 } // namespace ars::render::vk
@@ -1,8 +1,11 @@
 #pragma once
 
+#include "Upload.h"
 #include "Vulkan.h"
 #include <algorithm>
 #include <ars/runtime/core/misc/Macro.h>
+#include <ars/runtime/core/misc/OffsetAllocator.h>
+#include <mutex>
 #include <vector>
 
 namespace ars::render::vk {
@@ -39,15 +42,15 @@ template <typename T> struct BufferDataViewTrait<std::vector<T>> {
 // defined in the derived type B.
 template <typename B> struct BufferSetDataMethods {
     template <typename T>
-    void set_data_array(const T *value, size_t elem_offset, size_t elem_count) {
+    auto set_data_array(const T *value, size_t elem_offset, size_t elem_count) {
         static_assert(std::is_pod_v<T> && !std::is_pointer_v<T>);
-        static_cast<B *>(this)->set_data_raw(
+        return static_cast<B *>(this)->set_data_raw(
             (void *)(value), elem_offset * sizeof(T), elem_count * sizeof(T));
     }
 
-    template <typename T> void set_data(const T &value) {
+    template <typename T> auto set_data(const T &value) {
         using DataView = details::BufferDataViewTrait<T>;
-        static_cast<B *>(this)->set_data_raw(
+        return static_cast<B *>(this)->set_data_raw(
             DataView::ptr(value), 0, DataView::size(value));
     }
 };
@@ -66,6 +69,8 @@ class Buffer : public details::BufferSetDataMethods<Buffer> {
 
     [[nodiscard]] VkBuffer buffer() const;
     [[nodiscard]] VkDeviceSize size() const;
+    // Unique in creation order and never reused, unlike VkBuffer handles
+    [[nodiscard]] uint64_t id() const;
 
     [[nodiscard]] void *map();
     void unmap();
@@ -75,7 +80,11 @@ class Buffer : public details::BufferSetDataMethods<Buffer> {
         unmap();
     }
 
-    void set_data_raw(void *value, size_t byte_offset, size_t byte_count);
+    // Data of GPU only buffers is uploaded asynchronously, use the returned
+    // token to wait for the upload. Host visible buffers are updated
+    // immediately and the token is always complete.
+    UploadToken
+    set_data_raw(void *value, size_t byte_offset, size_t byte_count);
 
     // Only valid when VK_KHR_buffer_device_address is available
     [[nodiscard]] VkDeviceAddress device_address() const;
@@ -87,6 +96,7 @@ class Buffer : public details::BufferSetDataMethods<Buffer> {
     VmaAllocation _allocation = VK_NULL_HANDLE;
     VkBufferUsageFlags _buffer_usage{};
     VmaMemoryUsage _memory_usage{};
+    uint64_t _id = 0;
 };
 
 enum NamedHeap {
@@ -98,10 +108,21 @@ enum NamedHeap {
 struct HeapInfo {
     VkBufferUsageFlags buffer_usage;
     VmaMemoryUsage memory_usage;
+    // Compact the heap when the free fraction of its capacity exceeds the
+    // threshold. 0 disables defragmentation.
+    float defragment_threshold = 0.0f;
 
     static HeapInfo named(NamedHeap heap);
 };
 
+struct HeapStats {
+    VkDeviceSize capacity = 0;
+    VkDeviceSize used = 0;
+    VkDeviceSize largest_free_region = 0;
+    uint32_t allocation_count = 0;
+    uint32_t free_region_count = 0;
+};
+
 class Heap;
 
 struct HeapRange : details::BufferSetDataMethods<HeapRange> {
@@ -111,14 +132,19 @@ struct HeapRange : details::BufferSetDataMethods<HeapRange> {
 
     HeapRange slice() const;
     HeapRange slice(uint64_t offset_in_range, VkDeviceSize size) const;
-    void set_data_raw(void *value, size_t byte_offset, size_t byte_count);
+    UploadToken
+    set_data_raw(void *value, size_t byte_offset, size_t byte_count);
     VkDeviceAddress device_address() const;
     VkBuffer buffer() const;
 };
 
+// Offset of the range may change when the heap defragments. Slice a new
+// HeapRange every time it is used instead of keeping one.
 class HeapRangeOwned {
   public:
-    HeapRangeOwned(Heap *heap, uint64_t offset, VkDeviceSize size);
+    HeapRangeOwned(Heap *heap,
+                   OffsetAllocator::Allocation allocation,
+                   VkDeviceSize size);
     ~HeapRangeOwned();
 
     ARS_NO_COPY_MOVE(HeapRangeOwned);
@@ -130,27 +156,97 @@ class HeapRangeOwned {
     HeapRange slice(uint64_t offset_in_range, VkDeviceSize size) const;
 
   private:
+    friend Heap;
+
     Heap *_heap = nullptr;
-    uint64_t _offset = 0;
+    OffsetAllocator::Allocation _allocation{};
     VkDeviceSize _size = 0;
+    // Index in the live range list of the heap
+    size_t _index = 0;
 };
 
+// Sub-allocates ranges of a device buffer. Memory of a range is reused after
+// its HeapRangeOwned is released.
 class Heap {
   public:
     Heap(Context *context, const HeapInfo &info);
 
+    ARS_NO_COPY_MOVE(Heap);
+
     Handle<Buffer> buffer() const;
-    uint64_t alloc(VkDeviceSize size);
     Handle<HeapRangeOwned> alloc_owned(VkDeviceSize size);
-    void free(uint64_t ptr);
+
+    // Move all live ranges to the front of a new buffer, and shrink the
+    // capacity to fit them.
+    void defragment();
+    // Defragment if the free memory exceeds the threshold in HeapInfo.
+    // The context calls this method at the beginning of each frame.
+    void defragment_if_needed();
+
+    [[nodiscard]] HeapStats stats() const;
 
   private:
+    friend HeapRangeOwned;
+
+    OffsetAllocator::Allocation alloc(VkDeviceSize size);
+    void free(HeapRangeOwned *range);
     void extend(VkDeviceSize capacity);
 
     Context *_context = nullptr;
     HeapInfo _info{};
     Handle<Buffer> _buffer{};
-    uint64_t _size = 0;
+    OffsetAllocator _allocator;
+    std::vector<HeapRangeOwned *> _ranges{};
+};
+
+// Range of a buffer arena, valid until the arena is reset. The memory is host
+// visible and stays mapped.
+struct BufferArenaRange : details::BufferSetDataMethods<BufferArenaRange> {
+    Buffer *buffer = nullptr;
+    VkDeviceSize offset = 0;
+    VkDeviceSize size = 0;
+    void *data = nullptr;
+
+    void set_data_raw(void *value, size_t byte_offset, size_t byte_count);
+};
+
+// Linear allocator of persistently mapped memory for data written by the CPU
+// and read by the GPU once, e.g. uniforms, instance data and UI vertices. Each
+// frame in flight owns an arena, which is reset after the frame finishes on
+// the GPU. If a frame overflows the first block, all blocks are merged into
+// one on reset, so frames of similar sizes don't create buffers.
+class BufferArena {
+  public:
+    BufferArena(Context *context, VkDeviceSize block_size);
+
+    ARS_NO_COPY_MOVE(BufferArena);
+
+    ~BufferArena();
+
+    void reset();
+
+    // The offset of the range is aligned to alignment, and to the minimal
+    // offset alignment of uniform and storage buffers. Ranges can be
+    // allocated by job workers recording in parallel.
+    BufferArenaRange alloc(VkDeviceSize size, VkDeviceSize alignment = 0);
+
+    [[nodiscard]] VkDeviceSize capacity() const;
+
+  private:
+    struct Block {
+        Handle<Buffer> buffer{};
+        uint8_t *data = nullptr;
+    };
+
+    void alloc_block(VkDeviceSize size);
+    void release_blocks();
+
+    Context *_context = nullptr;
+    VkDeviceSize _min_alignment = 16;
+    // Ranges are allocated from the last block
+    std::vector<Block> _blocks{};
+    VkDeviceSize _offset = 0;
+    mutable std::mutex _mutex{};
 };
 
 } // namespace ars::render::vk
@@ -0,0 +1,439 @@
+#include "Capture.h"
+#include "Context.h"
+#include <ars/runtime/core/Log.h>
+#include <atomic>
+#include <cassert>
+
+namespace ars::render::vk {
+namespace {
+std::atomic<CommandCapture *> s_active_capture{nullptr};
+} // namespace
+
+struct CaptureHooks {
+    static CommandCapture *capture() {
+        auto capture = s_active_capture.load();
+        assert(capture != nullptr);
+        return capture;
+    }
+
+    static void add(VkCommandBuffer cmd, CapturedCommandType type) {
+        CapturedCommand command{};
+        command.type = type;
+        command.command_buffer = cmd;
+        capture()->add_command(std::move(command));
+    }
+
+    static void VKAPI_CALL
+    pipeline_barrier(VkCommandBuffer cmd,
+                     VkPipelineStageFlags src_stage_mask,
+                     VkPipelineStageFlags dst_stage_mask,
+                     VkDependencyFlags,
+                     uint32_t memory_barrier_count,
+                     const VkMemoryBarrier *,
+                     uint32_t buffer_barrier_count,
+                     const VkBufferMemoryBarrier *buffer_barriers,
+                     uint32_t image_barrier_count,
+                     const VkImageMemoryBarrier *image_barriers) {
+        CapturedCommand command{};
+        command.type = CapturedCommandType::PipelineBarrier;
+        command.command_buffer = cmd;
+        command.src_stage_mask = src_stage_mask;
+        command.dst_stage_mask = dst_stage_mask;
+        command.memory_barrier_count = memory_barrier_count;
+        command.buffer_barriers.assign(buffer_barriers,
+                                       buffer_barriers + buffer_barrier_count);
+        command.image_barriers.assign(image_barriers,
+                                      image_barriers + image_barrier_count);
+        capture()->add_command(std::move(command));
+    }
+
+    static void VKAPI_CALL begin_render_pass(VkCommandBuffer cmd,
+                                             const VkRenderPassBeginInfo *,
+                                             VkSubpassContents) {
+        add(cmd, CapturedCommandType::BeginRenderPass);
+    }
+
+    static void VKAPI_CALL end_render_pass(VkCommandBuffer cmd) {
+        add(cmd, CapturedCommandType::EndRenderPass);
+    }
+
+    static void VKAPI_CALL
+    execute_commands(VkCommandBuffer cmd,
+                     uint32_t count,
+                     const VkCommandBuffer *secondaries) {
+        CapturedCommand command{};
+        command.type = CapturedCommandType::ExecuteCommands;
+        command.command_buffer = cmd;
+        command.executed_command_buffers.assign(secondaries,
+                                                secondaries + count);
+        capture()->add_command(std::move(command));
+    }
+
+    static void VKAPI_CALL bind_pipeline(VkCommandBuffer cmd,
+                                         VkPipelineBindPoint,
+                                         VkPipeline) {
+        add(cmd, CapturedCommandType::BindPipeline);
+    }
+
+    static void VKAPI_CALL bind_descriptor_sets(VkCommandBuffer cmd,
+                                                VkPipelineBindPoint,
+                                                VkPipelineLayout,
+                                                uint32_t,
+                                                uint32_t,
+                                                const VkDescriptorSet *,
+                                                uint32_t,
+                                                const uint32_t *) {
+        add(cmd, CapturedCommandType::BindDescriptorSets);
+    }
+
+    static void VKAPI_CALL bind_vertex_buffers(VkCommandBuffer cmd,
+                                               uint32_t,
+                                               uint32_t,
+                                               const VkBuffer *,
+                                               const VkDeviceSize *) {
+        add(cmd, CapturedCommandType::BindVertexBuffers);
+    }
+
+    static void VKAPI_CALL bind_index_buffer(VkCommandBuffer cmd,
+                                             VkBuffer,
+                                             VkDeviceSize,
+                                             VkIndexType) {
+        add(cmd, CapturedCommandType::BindIndexBuffer);
+    }
+
+    static void VKAPI_CALL push_constants(VkCommandBuffer cmd,
+                                          VkPipelineLayout,
+                                          VkShaderStageFlags,
+                                          uint32_t,
+                                          uint32_t,
+                                          const void *) {
+        add(cmd, CapturedCommandType::PushConstants);
+    }
+
+    static void VKAPI_CALL set_viewport(VkCommandBuffer cmd,
+                                        uint32_t,
+                                        uint32_t,
+                                        const VkViewport *) {
+        add(cmd, CapturedCommandType::SetDynamicState);
+    }
+
+    static void VKAPI_CALL set_scissor(VkCommandBuffer cmd,
+                                       uint32_t,
+                                       uint32_t,
+                                       const VkRect2D *) {
+        add(cmd, CapturedCommandType::SetDynamicState);
+    }
+
+    static void VKAPI_CALL set_depth_bias(VkCommandBuffer cmd,
+                                          float,
+                                          float,
+                                          float) {
+        add(cmd, CapturedCommandType::SetDynamicState);
+    }
+
+    static void VKAPI_CALL draw(VkCommandBuffer cmd,
+                                uint32_t vertex_count,
+                                uint32_t instance_count,
+                                uint32_t,
+                                uint32_t) {
+        CapturedCommand command{};
+        command.type = CapturedCommandType::Draw;
+        command.command_buffer = cmd;
+        command.element_count = vertex_count;
+        command.instance_count = instance_count;
+        capture()->add_command(std::move(command));
+    }
+
+    static void VKAPI_CALL draw_indexed(VkCommandBuffer cmd,
+                                        uint32_t index_count,
+                                        uint32_t instance_count,
+                                        uint32_t,
+                                        int32_t,
+                                        uint32_t) {
+        CapturedCommand command{};
+        command.type = CapturedCommandType::DrawIndexed;
+        command.command_buffer = cmd;
+        command.element_count = index_count;
+        command.instance_count = instance_count;
+        capture()->add_command(std::move(command));
+    }
+
+    static void VKAPI_CALL dispatch(VkCommandBuffer cmd,
+                                    uint32_t,
+                                    uint32_t,
+                                    uint32_t) {
+        add(cmd, CapturedCommandType::Dispatch);
+    }
+
+    static void VKAPI_CALL copy_buffer(VkCommandBuffer cmd,
+                                       VkBuffer,
+                                       VkBuffer,
+                                       uint32_t,
+                                       const VkBufferCopy *) {
+        add(cmd, CapturedCommandType::Transfer);
+    }
+
+    static void VKAPI_CALL copy_buffer_to_image(VkCommandBuffer cmd,
+                                                VkBuffer,
+                                                VkImage,
+                                                VkImageLayout,
+                                                uint32_t,
+                                                const VkBufferImageCopy *) {
+        add(cmd, CapturedCommandType::Transfer);
+    }
+
+    static void VKAPI_CALL copy_image_to_buffer(VkCommandBuffer cmd,
+                                                VkImage,
+                                                VkImageLayout,
+                                                VkBuffer,
+                                                uint32_t,
+                                                const VkBufferImageCopy *) {
+        add(cmd, CapturedCommandType::Transfer);
+    }
+
+    static void VKAPI_CALL blit_image(VkCommandBuffer cmd,
+                                      VkImage,
+                                      VkImageLayout,
+                                      VkImage,
+                                      VkImageLayout,
+                                      uint32_t,
+                                      const VkImageBlit *,
+                                      VkFilter) {
+        add(cmd, CapturedCommandType::Transfer);
+    }
+
+    static void VKAPI_CALL clear_color_image(VkCommandBuffer cmd,
+                                             VkImage,
+                                             VkImageLayout,
+                                             const VkClearColorValue *,
+                                             uint32_t,
+                                             const VkImageSubresourceRange *) {
+        add(cmd, CapturedCommandType::Transfer);
+    }
+
+    static void VKAPI_CALL
+    clear_depth_stencil_image(VkCommandBuffer cmd,
+                              VkImage,
+                              VkImageLayout,
+                              const VkClearDepthStencilValue *,
+                              uint32_t,
+                              const VkImageSubresourceRange *) {
+        add(cmd, CapturedCommandType::Transfer);
+    }
+
+    static void VKAPI_CALL
+    trace_rays(VkCommandBuffer cmd,
+               const VkStridedDeviceAddressRegionKHR *,
+               const VkStridedDeviceAddressRegionKHR *,
+               const VkStridedDeviceAddressRegionKHR *,
+               const VkStridedDeviceAddressRegionKHR *,
+               uint32_t,
+               uint32_t,
+               uint32_t) {
+        add(cmd, CapturedCommandType::TraceRays);
+    }
+
+    static void VKAPI_CALL build_acceleration_structures(
+        VkCommandBuffer cmd,
+        uint32_t,
+        const VkAccelerationStructureBuildGeometryInfoKHR *,
+        const VkAccelerationStructureBuildRangeInfoKHR *const *) {
+        add(cmd, CapturedCommandType::BuildAccelerationStructures);
+    }
+
+    // Calls below are forwarded to the driver after being counted
+
+    static VkResult VKAPI_CALL
+    allocate_command_buffers(VkDevice device,
+                             const VkCommandBufferAllocateInfo *info,
+                             VkCommandBuffer *command_buffers) {
+        auto capture = CaptureHooks::capture();
+        {
+            std::lock_guard<std::mutex> lock(capture->_mutex);
+            capture->_stats.allocated_command_buffer_count +=
+                info->commandBufferCount;
+        }
+        return capture->_original_table.vkAllocateCommandBuffers(
+            device, info, command_buffers);
+    }
+
+    static VkResult VKAPI_CALL
+    allocate_descriptor_sets(VkDevice device,
+                             const VkDescriptorSetAllocateInfo *info,
+                             VkDescriptorSet *sets) {
+        auto capture = CaptureHooks::capture();
+        {
+            std::lock_guard<std::mutex> lock(capture->_mutex);
+            capture->_stats.allocated_descriptor_set_count +=
+                info->descriptorSetCount;
+        }
+        return capture->_original_table.vkAllocateDescriptorSets(
+            device, info, sets);
+    }
+
+    static void VKAPI_CALL
+    update_descriptor_sets(VkDevice device,
+                           uint32_t write_count,
+                           const VkWriteDescriptorSet *writes,
+                           uint32_t copy_count,
+                           const VkCopyDescriptorSet *copies) {
+        auto capture = CaptureHooks::capture();
+        {
+            std::lock_guard<std::mutex> lock(capture->_mutex);
+            capture->_stats.descriptor_write_count += write_count;
+            // Writes of a set are adjacent
+            for (uint32_t i = 0; i < write_count; i++) {
+                if (i == 0 || writes[i].dstSet != writes[i - 1].dstSet) {
+                    capture->_stats.written_descriptor_set_count++;
+                }
+            }
+        }
+        capture->_original_table.vkUpdateDescriptorSets(
+            device, write_count, writes, copy_count, copies);
+    }
+
+    static void VKAPI_CALL update_descriptor_set_with_template(
+        VkDevice device,
+        VkDescriptorSet set,
+        VkDescriptorUpdateTemplate update_template,
+        const void *data) {
+        auto capture = CaptureHooks::capture();
+        {
+            std::lock_guard<std::mutex> lock(capture->_mutex);
+            capture->_stats.written_descriptor_set_count++;
+        }
+        capture->_original_table.vkUpdateDescriptorSetWithTemplate(
+            device, set, update_template, data);
+    }
+
+    static VkResult VKAPI_CALL queue_submit(VkQueue queue,
+                                            uint32_t submit_count,
+                                            const VkSubmitInfo *submits,
+                                            VkFence fence) {
+        auto capture = CaptureHooks::capture();
+        capture->add_submit(submit_count, submits);
+        return capture->_original_table.vkQueueSubmit(
+            queue, submit_count, submits, fence);
+    }
+};
+
+CommandCapture::CommandCapture(Context *context) : _context(context) {
+    CommandCapture *expected = nullptr;
+    if (!s_active_capture.compare_exchange_strong(expected, this)) {
+        ARS_LOG_CRITICAL("Only one command capture can be active at a time");
+    }
+
+    auto device = _context->device();
+    // Pending uploads are recorded with the original table
+    _context->uploader()->flush();
+    _original_table = device->_table;
+
+    auto &table = device->_table;
+    table.vkCmdPipelineBarrier = &CaptureHooks::pipeline_barrier;
+    table.vkCmdBeginRenderPass = &CaptureHooks::begin_render_pass;
+    table.vkCmdEndRenderPass = &CaptureHooks::end_render_pass;
+    table.vkCmdExecuteCommands = &CaptureHooks::execute_commands;
+    table.vkCmdBindPipeline = &CaptureHooks::bind_pipeline;
+    table.vkCmdBindDescriptorSets = &CaptureHooks::bind_descriptor_sets;
+    table.vkCmdBindVertexBuffers = &CaptureHooks::bind_vertex_buffers;
+    table.vkCmdBindIndexBuffer = &CaptureHooks::bind_index_buffer;
+    table.vkCmdPushConstants = &CaptureHooks::push_constants;
+    table.vkCmdSetViewport = &CaptureHooks::set_viewport;
+    table.vkCmdSetScissor = &CaptureHooks::set_scissor;
+    table.vkCmdSetDepthBias = &CaptureHooks::set_depth_bias;
+    table.vkCmdDraw = &CaptureHooks::draw;
+    table.vkCmdDrawIndexed = &CaptureHooks::draw_indexed;
+    table.vkCmdDispatch = &CaptureHooks::dispatch;
+    table.vkCmdCopyBuffer = &CaptureHooks::copy_buffer;
+    table.vkCmdCopyBufferToImage = &CaptureHooks::copy_buffer_to_image;
+    table.vkCmdCopyImageToBuffer = &CaptureHooks::copy_image_to_buffer;
+    table.vkCmdBlitImage = &CaptureHooks::blit_image;
+    table.vkCmdClearColorImage = &CaptureHooks::clear_color_image;
+    table.vkCmdClearDepthStencilImage =
+        &CaptureHooks::clear_depth_stencil_image;
+    table.vkCmdTraceRaysKHR = &CaptureHooks::trace_rays;
+    table.vkCmdBuildAccelerationStructuresKHR =
+        &CaptureHooks::build_acceleration_structures;
+    table.vkAllocateCommandBuffers = &CaptureHooks::allocate_command_buffers;
+    table.vkAllocateDescriptorSets = &CaptureHooks::allocate_descriptor_sets;
+    table.vkUpdateDescriptorSets = &CaptureHooks::update_descriptor_sets;
+    table.vkUpdateDescriptorSetWithTemplate =
+        &CaptureHooks::update_descriptor_set_with_template;
+    table.vkQueueSubmit = &CaptureHooks::queue_submit;
+
+    clear();
+}
+
+CommandCapture::~CommandCapture() {
+    // Commands recorded but not submitted yet are captured, submit them
+    // before the table is restored
+    _context->uploader()->flush();
+    _context->device()->_table = _original_table;
+    s_active_capture = nullptr;
+}
+
+void CommandCapture::clear() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _commands.clear();
+    _submitted_command_buffers.clear();
+    _stats = {};
+    _base_buffer_count = _context->created_buffer_count();
+    _base_texture_count = _context->created_texture_count();
+}
+
+CaptureStats CommandCapture::stats() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto stats = _stats;
+    stats.created_buffer_count =
+        _context->created_buffer_count() - _base_buffer_count;
+    stats.created_texture_count =
+        _context->created_texture_count() - _base_texture_count;
+    return stats;
+}
+
+std::vector<CapturedCommand> CommandCapture::submitted_commands() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    std::vector<CapturedCommand> result{};
+    for (auto cmd : _submitted_command_buffers) {
+        append_commands(cmd, result);
+    }
+    return result;
+}
+
+void CommandCapture::append_commands(
+    VkCommandBuffer command_buffer,
+    std::vector<CapturedCommand> &result) const {
+    auto it = _commands.find(command_buffer);
+    if (it == _commands.end()) {
+        return;
+    }
+    for (auto &command : it->second) {
+        result.push_back(command);
+        for (auto secondary : command.executed_command_buffers) {
+            append_commands(secondary, result);
+        }
+    }
+}
+
+void CommandCapture::add_command(CapturedCommand command) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _stats.command_counts[static_cast<size_t>(command.type)]++;
+    _stats.draw_instance_count += command.instance_count;
+    _stats.buffer_barrier_count += command.buffer_barriers.size();
+    _stats.image_barrier_count += command.image_barriers.size();
+    _commands[command.command_buffer].push_back(std::move(command));
+}
+
+void CommandCapture::add_submit(uint32_t submit_count,
+                                const VkSubmitInfo *submits) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _stats.queue_submit_count++;
+    for (uint32_t i = 0; i < submit_count; i++) {
+        auto &submit = submits[i];
+        _submitted_command_buffers.insert(_submitted_command_buffers.end(),
+                                          submit.pCommandBuffers,
+                                          submit.pCommandBuffers +
+                                              submit.commandBufferCount);
+    }
+}
+} // namespace ars::render::vk
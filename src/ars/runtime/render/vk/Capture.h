@@ -0,0 +1,127 @@
+#pragma once
+
+#include "Vulkan.h"
+#include <array>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace ars::render::vk {
+class Context;
+struct CaptureHooks;
+
+enum class CapturedCommandType {
+    PipelineBarrier,
+    BeginRenderPass,
+    EndRenderPass,
+    ExecuteCommands,
+    BindPipeline,
+    BindDescriptorSets,
+    BindVertexBuffers,
+    BindIndexBuffer,
+    PushConstants,
+    // Viewport, scissor and depth bias
+    SetDynamicState,
+    Draw,
+    DrawIndexed,
+    Dispatch,
+    // Copies, blits and clears
+    Transfer,
+    TraceRays,
+    BuildAccelerationStructures,
+    Count
+};
+
+struct CapturedCommand {
+    CapturedCommandType type = CapturedCommandType::Count;
+    VkCommandBuffer command_buffer = VK_NULL_HANDLE;
+
+    // Vertex or index count of draws
+    uint32_t element_count = 0;
+    uint32_t instance_count = 0;
+
+    // Pipeline barriers only
+    VkPipelineStageFlags src_stage_mask = 0;
+    VkPipelineStageFlags dst_stage_mask = 0;
+    uint32_t memory_barrier_count = 0;
+    std::vector<VkBufferMemoryBarrier> buffer_barriers{};
+    std::vector<VkImageMemoryBarrier> image_barriers{};
+
+    // Secondary command buffers of ExecuteCommands
+    std::vector<VkCommandBuffer> executed_command_buffers{};
+};
+
+struct CaptureStats {
+    std::array<uint64_t, static_cast<size_t>(CapturedCommandType::Count)>
+        command_counts{};
+    uint64_t draw_instance_count = 0;
+    uint64_t buffer_barrier_count = 0;
+    uint64_t image_barrier_count = 0;
+
+    uint64_t queue_submit_count = 0;
+    uint64_t allocated_command_buffer_count = 0;
+    uint64_t allocated_descriptor_set_count = 0;
+    uint64_t descriptor_write_count = 0;
+    // By descriptor writes or update templates
+    uint64_t written_descriptor_set_count = 0;
+
+    // Created through the context
+    uint64_t created_buffer_count = 0;
+    uint64_t created_texture_count = 0;
+
+    [[nodiscard]] uint64_t count(CapturedCommandType type) const {
+        return command_counts[static_cast<size_t>(type)];
+    }
+};
+
+// Captures commands recorded on the device of a context instead of executing
+// them, so the CPU side of frames, e.g. render graph compilation, barrier
+// placement and draw batching, can be checked and profiled without any GPU
+// work.
+//
+// Commands are intercepted by replacing entries of the device dispatch table,
+// so only one capture can be active at a time. Command buffers are still
+// begun, ended and submitted, but they contain no commands except timestamp
+// queries, which are kept so the GPU profiler does not wait forever. The
+// results of anything read back from the GPU are undefined while capturing.
+class CommandCapture {
+  public:
+    explicit CommandCapture(Context *context);
+
+    ARS_NO_COPY_MOVE(CommandCapture);
+
+    ~CommandCapture();
+
+    // Drop captured commands and reset stats. Command buffer handles are
+    // reused across frames, so clear between frames before inspecting
+    // submitted_commands().
+    void clear();
+
+    [[nodiscard]] CaptureStats stats() const;
+    // Commands of primary command buffers in submission order, with secondary
+    // command buffers inlined after their ExecuteCommands. The order only
+    // depends on what is recorded, even if recording is done in parallel.
+    [[nodiscard]] std::vector<CapturedCommand> submitted_commands() const;
+
+  private:
+    // Functions installed into the dispatch table
+    friend CaptureHooks;
+
+    void add_command(CapturedCommand command);
+    void add_submit(uint32_t submit_count, const VkSubmitInfo *submits);
+
+    void append_commands(VkCommandBuffer command_buffer,
+                         std::vector<CapturedCommand> &result) const;
+
+    Context *_context = nullptr;
+    VolkDeviceTable _original_table{};
+
+    mutable std::mutex _mutex{};
+    std::unordered_map<VkCommandBuffer, std::vector<CapturedCommand>>
+        _commands{};
+    std::vector<VkCommandBuffer> _submitted_command_buffers{};
+    CaptureStats _stats{};
+    uint64_t _base_buffer_count = 0;
+    uint64_t _base_texture_count = 0;
+};
+} // namespace ars::render::vk
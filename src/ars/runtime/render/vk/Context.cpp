@@ -3,16 +3,26 @@
 #include "Lut.h"
 #include "Material.h"
 #include "Mesh.h"
+#include "Pipeline.h"
 #include "Profiler.h"
 #include "Scene.h"
 #include "Sky.h"
 #include "Swapchain.h"
+#include "Upload.h"
 #include "features/RayTracing.h"
 #include "features/Renderer.h"
 #include <GLFW/glfw3.h>
 #include <algorithm>
+#include <ars/runtime/core/Jobs.h>
 #include <ars/runtime/core/Log.h>
+#include <ars/runtime/core/misc/Arena.h>
 #include <cassert>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
 #include <sstream>
 #include <vector>
 
@@ -117,6 +127,10 @@ get_instance_extension_requirement(bool enable_validation,
 }
 
 constexpr const char *PORTABILITY_SUBSET = "VK_KHR_portability_subset";
+// Initial size of the buffer arena of each frame
+constexpr VkDeviceSize FRAME_BUFFER_ARENA_BLOCK_SIZE = 1024 * 1024;
+// Cached descriptor sets beyond this are evicted once they are not in use
+constexpr uint32_t DESCRIPTOR_SET_CACHE_CAPACITY = 4096;
 
 bool check_validation_layers() {
     uint32_t layer_count;
@@ -199,6 +213,8 @@ struct VulkanEnvironment {
     std::unique_ptr<Instance> instance = nullptr;
     VkDebugUtilsMessengerEXT debug_messenger = VK_NULL_HANDLE;
     bool profiler_enabled = false;
+    // Empty if nothing should be kept across launches
+    std::filesystem::path cache_dir{};
 
     VulkanEnvironment(std::unique_ptr<Instance> ins,
                       VkDebugUtilsMessengerEXT debug,
@@ -231,6 +247,35 @@ VkDebugUtilsMessengerEXT create_debug_messenger(Instance *instance) {
     return debug_messenger;
 }
 
+// Caches live in the user cache directory unless the app gives a directory
+std::filesystem::path resolve_cache_dir(const ApplicationInfo &app_info) {
+    if (!app_info.cache_dir.empty()) {
+        return app_info.cache_dir;
+    }
+    std::filesystem::path base{};
+#if defined(_WIN32)
+    if (auto dir = std::getenv("LOCALAPPDATA")) {
+        base = dir;
+    }
+#elif defined(__APPLE__)
+    if (auto home = std::getenv("HOME")) {
+        base = std::filesystem::path(home) / "Library" / "Caches";
+    }
+#else
+    if (auto dir = std::getenv("XDG_CACHE_HOME"); dir != nullptr && *dir) {
+        base = dir;
+    } else if (auto home = std::getenv("HOME")) {
+        base = std::filesystem::path(home) / ".cache";
+    }
+#endif
+    if (base.empty()) {
+        ARS_LOG_WARN("User cache directory not found, caches will not be kept "
+                     "across launches");
+        return {};
+    }
+    return base / "aries" / app_info.app_name;
+}
+
 std::unique_ptr<VulkanEnvironment> s_vulkan{};
 
 } // namespace
@@ -257,6 +302,7 @@ void init_vulkan_backend(const ApplicationInfo &app_info) {
     }
     s_vulkan = std::make_unique<VulkanEnvironment>(
         std::move(instance), debug_messenger, app_info.enable_profiler);
+    s_vulkan->cache_dir = resolve_cache_dir(app_info);
 }
 
 void destroy_vulkan_backend() {
@@ -298,6 +344,9 @@ ExtensionRequirement get_device_extension_requirement(bool need_swapchain) {
 
     requirement.add_extension(PORTABILITY_SUBSET, false);
 
+    // Chain queue submissions without creating semaphores
+    requirement.add_extension(VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME, false);
+
     // Acceleration structure
     requirement.add_extension(VK_KHR_ACCELERATION_STRUCTURE_EXTENSION_NAME,
                               false);
@@ -323,6 +372,8 @@ ExtensionRequirement get_device_extension_requirement(bool need_swapchain) {
 struct QueueFamilyIndices {
     // this queue family supports all operations we need
     std::optional<uint32_t> primary_family;
+    // A family supports compute but not graphics, for async compute
+    std::optional<uint32_t> compute_family;
 
     [[nodiscard]] bool is_complete() const {
         return primary_family.has_value();
@@ -347,6 +398,15 @@ QueueFamilyIndices find_queue_families(Instance *instance,
             queue_family.queueFlags & VK_QUEUE_GRAPHICS_BIT;
         bool supports_compute = queue_family.queueFlags & VK_QUEUE_COMPUTE_BIT;
 
+        if (supports_compute && !supports_graphics &&
+            !indices.compute_family.has_value()) {
+            indices.compute_family = i;
+        }
+
+        if (indices.primary_family.has_value()) {
+            continue;
+        }
+
         bool valid = supports_graphics && supports_compute;
 
         if (surface != VK_NULL_HANDLE) {
@@ -359,10 +419,6 @@ QueueFamilyIndices find_queue_families(Instance *instance,
         if (valid) {
             indices.primary_family = i;
         }
-
-        if (indices.is_complete()) {
-            break;
-        }
     }
 
     return indices;
@@ -467,13 +523,20 @@ void Context::init_device_and_queues(Instance *instance,
 
     assert(indices.is_complete());
 
-    VkDeviceQueueCreateInfo queue_create_info{};
+    std::vector<VkDeviceQueueCreateInfo> queue_create_infos{};
 
     float queue_priority = 1.0f;
+    VkDeviceQueueCreateInfo queue_create_info{};
     queue_create_info.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
     queue_create_info.queueFamilyIndex = indices.primary_family.value();
     queue_create_info.queueCount = 1;
     queue_create_info.pQueuePriorities = &queue_priority;
+    queue_create_infos.push_back(queue_create_info);
+
+    if (indices.compute_family.has_value()) {
+        queue_create_info.queueFamilyIndex = indices.compute_family.value();
+        queue_create_infos.push_back(queue_create_info);
+    }
 
     _info.init(instance,
                physical_device,
@@ -481,8 +544,9 @@ void Context::init_device_and_queues(Instance *instance,
 
     VkDeviceCreateInfo create_info{};
     create_info.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
-    create_info.pQueueCreateInfos = &queue_create_info;
-    create_info.queueCreateInfoCount = 1;
+    create_info.pQueueCreateInfos = queue_create_infos.data();
+    create_info.queueCreateInfoCount =
+        static_cast<uint32_t>(queue_create_infos.size());
     create_info.pEnabledFeatures = &_info.features;
 
     set_up_vk_struct_chain({
@@ -490,6 +554,8 @@ void Context::init_device_and_queues(Instance *instance,
         &_info.ray_tracing_pipeline_features,
         &_info.acceleration_structure_features,
         &_info.device_address_features,
+        &_info.timeline_semaphore_features,
+        &_info.descriptor_indexing_features,
     });
 
     std::vector<const char *> enabled_extensions{};
@@ -514,6 +580,12 @@ void Context::init_device_and_queues(Instance *instance,
 
     _device = std::make_unique<Device>(instance, device, physical_device);
     _queue = std::make_unique<Queue>(this, indices.primary_family.value());
+    if (indices.compute_family.has_value()) {
+        _compute_queue =
+            std::make_unique<Queue>(this, indices.compute_family.value());
+        ARS_LOG_INFO("Async compute queue family: {}",
+                     indices.compute_family.value());
+    }
 
     ARS_LOG_INFO(_info.dump());
 }
@@ -523,16 +595,19 @@ Context::Context(const WindowInfo *info,
     auto [window, surface] = create_window_and_surface(info);
 
     _vma = std::make_unique<VulkanMemoryAllocator>(_device.get());
-    init_command_pool();
+    init_frames();
     init_pipeline_cache();
-    init_descriptor_arena();
+    _pipeline_object_cache =
+        std::make_unique<PipelineObjectCache>(_device.get());
+    _uploader = std::make_unique<Uploader>(this);
+    // Textures are made resident on creation
+    _bindless_resources = std::make_unique<BindlessResources>(this);
 
     // Now context ready to create the swapchain
     if (window != nullptr && surface != VK_NULL_HANDLE) {
         swapchain = std::make_unique<Swapchain>(this, surface, window, true);
     }
 
-    _bindless_resources = std::make_unique<BindlessResources>(this);
     init_default_textures();
     _lut = std::make_unique<Lut>(this);
     _ibl = std::make_unique<ImageBasedLighting>(this);
@@ -558,6 +633,23 @@ Queue *Context::queue() const {
     return _queue.get();
 }
 
+Queue *Context::compute_queue() const {
+    return _compute_queue.get();
+}
+
+VkSemaphore Context::acquire_semaphore() {
+    auto &frame = _frames[_frame_index];
+    if (frame.used_semaphore_count == frame.semaphores.size()) {
+        VkSemaphore semaphore = VK_NULL_HANDLE;
+        VkSemaphoreCreateInfo info{VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO};
+        if (_device->Create(&info, &semaphore) != VK_SUCCESS) {
+            ARS_LOG_CRITICAL("Failed to create semaphore");
+        }
+        frame.semaphores.push_back(semaphore);
+    }
+    return frame.semaphores[frame.used_semaphore_count++];
+}
+
 std::tuple<GLFWwindow *, VkSurfaceKHR>
 Context::create_window_and_surface(const WindowInfo *info) {
     GLFWwindow *window = nullptr;
@@ -596,10 +688,14 @@ Context::create_texture_impl(const TextureInfo &info) {
 
 bool Context::begin_frame() {
     glfwPollEvents();
-    _queue->flush();
-    _device->ResetCommandPool(_command_pool, 0);
-    _descriptor_arena->reset();
+    // Transient data of the last frame is only used during recording
+    frame_arena().reset();
     gc();
+    for (auto &heap : _heaps) {
+        if (heap != nullptr) {
+            heap->defragment_if_needed();
+        }
+    }
 
     if (_profiler != nullptr) {
         _profiler->flush();
@@ -612,18 +708,77 @@ void Context::end_frame() {
     for (auto swapchain : _registered_swapchains) {
         swapchain->on_frame_ends();
     }
+
+    _uploader->flush();
+    auto fence = _frames[_frame_index].fence;
+    _device->ResetFences(1, &fence);
+    _queue->submit_fence(fence);
+
+    // Switch to the next frame now, so commands submitted before next
+    // begin_frame are tracked by the fence of the next frame.
+    _frame_index = (_frame_index + 1) % MAX_FRAMES_IN_FLIGHT;
+    recycle_frame(_frame_index);
+}
+
+void Context::recycle_frame(uint32_t index) {
+    ARS_PROFILER_SAMPLE("Wait Frame", 0xFF914361);
+    auto &frame = _frames[index];
+    _device->WaitForFences(1, &frame.fence, VK_TRUE, UINT64_MAX);
+    if (_compute_queue != nullptr) {
+        _device->ResetCommandPool(frame.compute_command_pool, 0);
+    }
+    frame.used_semaphore_count = 0;
+    frame.retired_resources.clear();
+    frame.tmp_framebuffers.clear();
+    _device->ResetCommandPool(frame.command_pool, 0);
+    for (auto pool : frame.worker_command_pools) {
+        _device->ResetCommandPool(pool, 0);
+    }
+    frame.descriptor_arena->reset();
+    frame.buffer_arena->reset();
+    _descriptor_set_cache->recycle();
+}
+
+uint32_t Context::frame_index() const {
+    return _frame_index;
 }
 
 Context::~Context() {
+    if (_compute_queue != nullptr) {
+        _compute_queue->flush();
+    }
     _queue->flush();
+    _uploader.reset();
     _material_factory.reset();
+    for (auto &frame : _frames) {
+        frame.buffer_arena.reset();
+    }
     gc();
+    for (auto &frame : _frames) {
+        frame.retired_resources.clear();
+        frame.tmp_framebuffers.clear();
+    }
     if (_pipeline_cache != VK_NULL_HANDLE) {
+        save_pipeline_cache();
         _device->Destroy(_pipeline_cache);
     }
 
-    if (_command_pool != VK_NULL_HANDLE) {
-        _device->Destroy(_command_pool);
+    for (auto &frame : _frames) {
+        if (frame.fence != VK_NULL_HANDLE) {
+            _device->Destroy(frame.fence);
+        }
+        if (frame.command_pool != VK_NULL_HANDLE) {
+            _device->Destroy(frame.command_pool);
+        }
+        if (frame.compute_command_pool != VK_NULL_HANDLE) {
+            _device->Destroy(frame.compute_command_pool);
+        }
+        for (auto pool : frame.worker_command_pools) {
+            _device->Destroy(pool);
+        }
+        for (auto semaphore : frame.semaphores) {
+            _device->Destroy(semaphore);
+        }
     }
 }
 
@@ -656,39 +811,26 @@ VkQueue Queue::queue() const {
 
 void Queue::submit(CommandBuffer *command_buffer,
                    uint32_t wait_semaphore_count,
-                   VkSemaphore *wait_semaphores) {
+                   VkSemaphore *wait_semaphores,
+                   uint32_t signal_semaphore_count,
+                   VkSemaphore *signal_semaphores) {
     assert(command_buffer != nullptr);
     auto device = _context->device();
 
-    VkSubmitInfo info{VK_STRUCTURE_TYPE_SUBMIT_INFO};
-    std::vector<VkSemaphore> wait_sems{};
-    wait_sems.reserve(1 + wait_semaphore_count);
-    if (!_semaphores.empty()) {
-        wait_sems.push_back(_semaphores.back());
-    }
-
-    for (int i = 0; i < wait_semaphore_count; i++) {
-        wait_sems.push_back(wait_semaphores[i]);
+    // Pending uploads are visible to the command buffer
+    if (auto uploader = _context->uploader(); uploader != nullptr) {
+        uploader->flush();
     }
 
-    std::vector<VkPipelineStageFlags> dst_masks(
-        wait_sems.size(), VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT);
-
-    info.waitSemaphoreCount = static_cast<uint32_t>(wait_sems.size());
-    info.pWaitSemaphores = wait_sems.data();
+    VkSubmitInfo info{VK_STRUCTURE_TYPE_SUBMIT_INFO};
+    FrameVector<VkPipelineStageFlags> dst_masks(
+        wait_semaphore_count, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+    info.waitSemaphoreCount = wait_semaphore_count;
+    info.pWaitSemaphores = wait_semaphores;
     info.pWaitDstStageMask = dst_masks.data();
 
-    VkSemaphoreCreateInfo sem_info{VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO};
-    VkSemaphore signal_sem = VK_NULL_HANDLE;
-
-    if (device->Create(&sem_info, &signal_sem) != VK_SUCCESS) {
-        ARS_LOG_CRITICAL("Failed to create semaphore");
-    }
-
-    _semaphores.push_back(signal_sem);
-
-    info.signalSemaphoreCount = 1;
-    info.pSignalSemaphores = &signal_sem;
+    info.signalSemaphoreCount = signal_semaphore_count;
+    info.pSignalSemaphores = signal_semaphores;
 
     info.commandBufferCount = 1;
     auto cmd = command_buffer->command_buffer();
@@ -697,6 +839,20 @@ void Queue::submit(CommandBuffer *command_buffer,
     if (device->QueueSubmit(_queue, 1, &info, VK_NULL_HANDLE) != VK_SUCCESS) {
         ARS_LOG_CRITICAL("Failed to submit command to queue");
     }
+    _submit_count++;
+}
+
+uint64_t Queue::submit_count() const {
+    return _submit_count;
+}
+
+void Queue::submit_fence(VkFence fence) {
+    // A submission without batches signals the fence after all previously
+    // submitted commands finish.
+    if (_context->device()->QueueSubmit(_queue, 0, nullptr, fence) !=
+        VK_SUCCESS) {
+        ARS_LOG_CRITICAL("Failed to submit fence to queue");
+    }
 }
 
 Queue::~Queue() {
@@ -705,114 +861,385 @@ Queue::~Queue() {
 
 void Queue::flush() {
     auto device = _context->device();
-    device->QueueWaitIdle(_queue);
-    for (auto sem : _semaphores) {
-        device->Destroy(sem);
+    if (auto uploader = _context->uploader(); uploader != nullptr) {
+        uploader->flush();
     }
-    _semaphores.clear();
-}
-
-VkSemaphore Queue::get_semaphore() const {
-    if (!_semaphores.empty()) {
-        return _semaphores.back();
-    }
-    return VK_NULL_HANDLE;
+    device->QueueWaitIdle(_queue);
 }
 
 VkQueueFamilyProperties Queue::family_properties() const {
     return _family_properties;
 }
 
-void Context::init_command_pool() {
-    VkCommandPoolCreateInfo info{VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO};
-    info.queueFamilyIndex = _queue->family_index();
-    if (_device->Create(&info, &_command_pool) != VK_SUCCESS) {
-        ARS_LOG_CRITICAL("Can not create command pool");
+void Context::init_frames() {
+    uint32_t count = 255;
+
+    std::vector<VkDescriptorPoolSize> pool_sizes{
+        {VK_DESCRIPTOR_TYPE_SAMPLER, count},
+        {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, count},
+        {VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, count},
+        {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, count},
+        {VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER, count},
+        {VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER, count},
+        {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, count},
+        {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, count},
+        {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, count},
+        {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, count},
+        {VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, count}};
+
+    VkPhysicalDeviceProperties properties;
+    _device->instance()->GetPhysicalDeviceProperties(_device->physical_device(),
+                                                     &properties);
+
+    for (auto &frame : _frames) {
+        VkCommandPoolCreateInfo pool_info{
+            VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO};
+        pool_info.queueFamilyIndex = _queue->family_index();
+        if (_device->Create(&pool_info, &frame.command_pool) != VK_SUCCESS) {
+            ARS_LOG_CRITICAL("Can not create command pool");
+        }
+
+        frame.worker_command_pools.resize(jobs::worker_count());
+        for (auto &pool : frame.worker_command_pools) {
+            if (_device->Create(&pool_info, &pool) != VK_SUCCESS) {
+                ARS_LOG_CRITICAL("Can not create worker command pool");
+            }
+        }
+
+        if (_compute_queue != nullptr) {
+            pool_info.queueFamilyIndex = _compute_queue->family_index();
+            if (_device->Create(&pool_info, &frame.compute_command_pool) !=
+                VK_SUCCESS) {
+                ARS_LOG_CRITICAL("Can not create compute command pool");
+            }
+        }
+
+        // Frames are not in flight initially
+        VkFenceCreateInfo fence_info{VK_STRUCTURE_TYPE_FENCE_CREATE_INFO};
+        fence_info.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+        if (_device->Create(&fence_info, &frame.fence) != VK_SUCCESS) {
+            ARS_LOG_CRITICAL("Can not create frame fence");
+        }
+
+        frame.descriptor_arena = std::make_unique<DescriptorArena>(
+            _device.get(),
+            pool_sizes,
+            properties.limits.maxBoundDescriptorSets);
+        frame.buffer_arena = std::make_unique<BufferArena>(
+            this, FRAME_BUFFER_ARENA_BLOCK_SIZE);
     }
+
+    _descriptor_set_cache = std::make_unique<DescriptorSetCache>(
+        _device.get(), DESCRIPTOR_SET_CACHE_CAPACITY);
 }
 
 template <typename T, typename... Args>
 Handle<T> Context::create_handle(std::vector<std::shared_ptr<T>> &pool,
                                  Args &&...args) {
     auto res = std::make_shared<T>(std::forward<Args>(args)...);
+    std::lock_guard<std::mutex> lock(_resources_mutex);
     pool.push_back(res);
     return Handle<T>(res);
 }
 
 Handle<CommandBuffer>
-Context::create_command_buffer(VkCommandBufferLevel level) {
-    return create_handle(_command_buffers, this, _command_pool, level);
+Context::create_command_buffer(VkCommandBufferLevel level, Queue *queue) {
+    auto &frame = _frames[_frame_index];
+    auto pool = frame.command_pool;
+    auto worker = jobs::current_worker_index();
+    if (queue != nullptr && queue == _compute_queue.get()) {
+        pool = frame.compute_command_pool;
+    } else if (worker >= 0) {
+        assert(worker < frame.worker_command_pools.size());
+        pool = frame.worker_command_pools[worker];
+    }
+    return create_handle(_command_buffers, this, pool, level);
 }
 
 Handle<Texture> Context::create_texture(const TextureCreateInfo &info) {
+    _created_texture_count++;
     return create_handle(_textures, this, info);
 }
 
+Handle<Texture> Context::create_texture(const TextureCreateInfo &info,
+                                        std::shared_ptr<TextureMemory> memory,
+                                        VkDeviceSize memory_offset) {
+    _created_texture_count++;
+    return create_handle(
+        _textures, this, info, std::move(memory), memory_offset);
+}
+
 Handle<Buffer> Context::create_buffer(VkDeviceSize size,
                                       VkBufferUsageFlags buffer_usage,
                                       VmaMemoryUsage memory_usage) {
+    _created_buffer_count++;
     return create_handle(_buffers, this, size, buffer_usage, memory_usage);
 }
 
+uint64_t Context::created_buffer_count() const {
+    return _created_buffer_count;
+}
+
+uint64_t Context::created_texture_count() const {
+    return _created_texture_count;
+}
+
 namespace {
-template <typename T> void run_gc(std::vector<std::shared_ptr<T>> &pool) {
-    pool.erase(std::remove_if(pool.begin(),
-                              pool.end(),
-                              [](auto &res) { return res.use_count() <= 1; }),
-               pool.end());
+template <typename T>
+void run_gc(std::vector<std::shared_ptr<T>> &pool,
+            std::vector<std::shared_ptr<void>> &retired) {
+    auto it = std::partition(pool.begin(), pool.end(), [](auto &res) {
+        return res.use_count() > 1;
+    });
+    std::move(it, pool.end(), std::back_inserter(retired));
+    pool.erase(it, pool.end());
 }
 } // namespace
 
 void Context::gc() {
-    run_gc(_textures);
-    run_gc(_command_buffers);
-    run_gc(_heap_ranges);
-    run_gc(_buffers);
-    run_gc(_acceleration_structures);
+    std::lock_guard<std::mutex> lock(_resources_mutex);
+    auto &retired = _frames[_frame_index].retired_resources;
+    run_gc(_textures, retired);
+    run_gc(_command_buffers, retired);
+    run_gc(_heap_ranges, retired);
+    run_gc(_buffers, retired);
+    run_gc(_acceleration_structures, retired);
+}
 
-    _tmp_framebuffers.clear();
+namespace {
+constexpr uint32_t PIPELINE_CACHE_FILE_MAGIC = 0x43505241; // "ARPC"
+constexpr uint32_t PIPELINE_CACHE_FILE_VERSION = 1;
+
+// Pipeline cache data is prefixed with this header. The data is only used by
+// the device, driver and shaders that wrote it, drivers are not trusted to
+// reject data of other versions.
+struct PipelineCacheFileHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t vendor_id;
+    uint32_t device_id;
+    uint32_t driver_version;
+    uint32_t reserved;
+    uint8_t device_uuid[VK_UUID_SIZE];
+    uint8_t pipeline_cache_uuid[VK_UUID_SIZE];
+    uint64_t spirv_hash;
+    uint64_t data_size;
+    uint64_t data_hash;
+};
+
+// FNV-1a
+uint64_t hash_bytes(const uint8_t *data, size_t size) {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ data[i]) * 0x100000001b3ull;
+    }
+    return hash;
+}
+
+PipelineCacheFileHeader
+make_pipeline_cache_header(const ContextInfo &info,
+                           const std::vector<uint8_t> &data) {
+    PipelineCacheFileHeader header{};
+    header.magic = PIPELINE_CACHE_FILE_MAGIC;
+    header.version = PIPELINE_CACHE_FILE_VERSION;
+    header.vendor_id = info.properties.vendorID;
+    header.device_id = info.properties.deviceID;
+    header.driver_version = info.properties.driverVersion;
+    std::memcpy(header.device_uuid,
+                info.id_properties.deviceUUID,
+                sizeof(header.device_uuid));
+    std::memcpy(header.pipeline_cache_uuid,
+                info.properties.pipelineCacheUUID,
+                sizeof(header.pipeline_cache_uuid));
+    header.spirv_hash = embedded_spirv_hash();
+    header.data_size = data.size();
+    header.data_hash = hash_bytes(data.data(), data.size());
+    return header;
+}
+
+// Returns why data written with the header can't be used, or nullptr if it
+// can
+const char *pipeline_cache_mismatch(const PipelineCacheFileHeader &header,
+                                    const PipelineCacheFileHeader &expected) {
+    if (header.magic != expected.magic ||
+        header.version != expected.version) {
+        return "unknown file format";
+    }
+    if (header.vendor_id != expected.vendor_id ||
+        header.device_id != expected.device_id ||
+        std::memcmp(header.device_uuid,
+                    expected.device_uuid,
+                    sizeof(header.device_uuid)) != 0) {
+        return "device changed";
+    }
+    if (header.driver_version != expected.driver_version ||
+        std::memcmp(header.pipeline_cache_uuid,
+                    expected.pipeline_cache_uuid,
+                    sizeof(header.pipeline_cache_uuid)) != 0) {
+        return "driver changed";
+    }
+    if (header.spirv_hash != expected.spirv_hash) {
+        return "shaders changed";
+    }
+    return nullptr;
+}
+
+std::filesystem::path pipeline_cache_path() {
+    if (s_vulkan->cache_dir.empty()) {
+        return {};
+    }
+    return s_vulkan->cache_dir / "pipeline_cache.bin";
+}
+
+// Returns empty data if there is no usable cache
+std::vector<uint8_t> load_pipeline_cache_data(const ContextInfo &info) {
+    auto path = pipeline_cache_path();
+    std::error_code ec{};
+    if (path.empty() || !std::filesystem::exists(path, ec)) {
+        return {};
+    }
+    auto file_size = std::filesystem::file_size(path, ec);
+    std::ifstream file(path, std::ios::binary);
+    PipelineCacheFileHeader header{};
+    if (ec || !file ||
+        !file.read(reinterpret_cast<char *>(&header), sizeof(header))) {
+        ARS_LOG_WARN("Failed to read pipeline cache {}", path.string());
+        return {};
+    }
+
+    auto reason =
+        pipeline_cache_mismatch(header, make_pipeline_cache_header(info, {}));
+    if (reason == nullptr && header.data_size != file_size - sizeof(header)) {
+        reason = "file truncated";
+    }
+    std::vector<uint8_t> data{};
+    if (reason == nullptr) {
+        data.resize(header.data_size);
+        if (!file.read(reinterpret_cast<char *>(data.data()), data.size()) ||
+            hash_bytes(data.data(), data.size()) != header.data_hash) {
+            reason = "file corrupted";
+        }
+    }
+    if (reason != nullptr) {
+        ARS_LOG_INFO(
+            "Pipeline cache {} is discarded: {}", path.string(), reason);
+        return {};
+    }
+    return data;
+}
+
+void save_pipeline_cache_data(const ContextInfo &info,
+                              const std::vector<uint8_t> &data) {
+    auto path = pipeline_cache_path();
+    std::error_code ec{};
+    std::filesystem::create_directories(path.parent_path(), ec);
+    if (ec) {
+        ARS_LOG_ERROR("Failed to create cache directory {}: {}",
+                      path.parent_path().string(),
+                      ec.message());
+        return;
+    }
+
+    // Write to a temporary file and replace the cache with it, so an
+    // interrupted write never leaves a broken cache behind
+    auto tmp_path = path;
+    tmp_path += ".tmp";
+    {
+        auto header = make_pipeline_cache_header(info, data);
+        std::ofstream file(tmp_path, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char *>(data.data()), data.size());
+        if (!file) {
+            ARS_LOG_ERROR("Failed to write pipeline cache {}",
+                          tmp_path.string());
+            file.close();
+            std::filesystem::remove(tmp_path, ec);
+            return;
+        }
+    }
+    std::filesystem::rename(tmp_path, path, ec);
+    if (ec) {
+        ARS_LOG_ERROR("Failed to replace pipeline cache {}: {}",
+                      path.string(),
+                      ec.message());
+        std::filesystem::remove(tmp_path, ec);
+    }
 }
+} // namespace
 
 VkPipelineCache Context::pipeline_cache() const {
     return _pipeline_cache;
 }
 
 void Context::init_pipeline_cache() {
+    auto beg = std::chrono::high_resolution_clock::now();
+    auto data = load_pipeline_cache_data(_info);
+    auto end = std::chrono::high_resolution_clock::now();
+    if (!data.empty()) {
+        ARS_LOG_INFO(
+            "Loaded {} KB pipeline cache in {:.3f} ms",
+            data.size() / 1024,
+            std::chrono::duration<double, std::milli>(end - beg).count());
+    }
+
     VkPipelineCacheCreateInfo info{
         VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO};
+    info.initialDataSize = data.size();
+    info.pInitialData = data.data();
 
-    if (_device->Create(&info, &_pipeline_cache) != VK_SUCCESS) {
-        ARS_LOG_ERROR(
-            "Failed to create pipeline cache, pipeline creation might be slow");
+    if (_device->Create(&info, &_pipeline_cache) == VK_SUCCESS) {
+        return;
     }
+    if (!data.empty()) {
+        ARS_LOG_WARN("Failed to create pipeline cache from saved data, start "
+                     "with an empty one");
+        info.initialDataSize = 0;
+        info.pInitialData = nullptr;
+        if (_device->Create(&info, &_pipeline_cache) == VK_SUCCESS) {
+            return;
+        }
+    }
+    _pipeline_cache = VK_NULL_HANDLE;
+    ARS_LOG_ERROR(
+        "Failed to create pipeline cache, pipeline creation might be slow");
 }
 
-DescriptorArena *Context::descriptor_arena() const {
-    return _descriptor_arena.get();
+void Context::save_pipeline_cache() {
+    if (pipeline_cache_path().empty()) {
+        return;
+    }
+    size_t size = 0;
+    std::vector<uint8_t> data{};
+    if (_device->GetPipelineCacheData(_pipeline_cache, &size, nullptr) ==
+        VK_SUCCESS) {
+        data.resize(size);
+        if (_device->GetPipelineCacheData(
+                _pipeline_cache, &size, data.data()) != VK_SUCCESS) {
+            size = 0;
+        }
+        data.resize(size);
+    }
+    if (data.empty()) {
+        ARS_LOG_WARN("Pipeline cache has no data to save");
+        return;
+    }
+    save_pipeline_cache_data(_info, data);
 }
 
-void Context::init_descriptor_arena() {
-    uint32_t count = 255;
+DescriptorArena *Context::descriptor_arena() const {
+    return _frames[_frame_index].descriptor_arena.get();
+}
 
-    std::vector<VkDescriptorPoolSize> pool_sizes{
-        {VK_DESCRIPTOR_TYPE_SAMPLER, count},
-        {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, count},
-        {VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, count},
-        {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, count},
-        {VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER, count},
-        {VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER, count},
-        {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, count},
-        {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, count},
-        {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, count},
-        {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, count},
-        {VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, count}};
+DescriptorSetCache *Context::descriptor_set_cache() const {
+    return _descriptor_set_cache.get();
+}
 
-    VkPhysicalDeviceProperties properties;
-    _device->instance()->GetPhysicalDeviceProperties(_device->physical_device(),
-                                                     &properties);
+PipelineObjectCache *Context::pipeline_object_cache() const {
+    return _pipeline_object_cache.get();
+}
 
-    _descriptor_arena = std::make_unique<DescriptorArena>(
-        _device.get(), pool_sizes, properties.limits.maxBoundDescriptorSets);
+BufferArena *Context::buffer_arena() const {
+    return _frames[_frame_index].buffer_arena.get();
 }
 
 const ContextInfo &Context::info() const {
@@ -873,8 +1300,9 @@ Context::create_tmp_framebuffer(RenderPass *render_pass,
                                 std::vector<Handle<Texture>> attachments) {
     auto framebuffer =
         std::make_unique<Framebuffer>(render_pass, std::move(attachments));
-    _tmp_framebuffers.emplace_back(std::move(framebuffer));
-    return _tmp_framebuffers.back().get();
+    auto &tmp_framebuffers = _frames[_frame_index].tmp_framebuffers;
+    tmp_framebuffers.emplace_back(std::move(framebuffer));
+    return tmp_framebuffers.back().get();
 }
 
 void Context::register_swapchain(Swapchain *swapchain) {
@@ -889,6 +1317,14 @@ std::shared_ptr<IMaterial> Context::create_material(const MaterialInfo &info) {
     return _material_factory->create_material(info);
 }
 
+void Context::prewarm_materials(const std::vector<MaterialInfo> &infos) {
+    _material_factory->prewarm(infos);
+}
+
+void Context::wait_for_material_pipelines() {
+    _material_factory->wait_for_pipelines();
+}
+
 std::shared_ptr<ITexture> Context::default_texture(DefaultTexture tex) {
     assert(tex != DefaultTexture::Count);
     return _default_textures[static_cast<uint32_t>(tex)];
@@ -1013,6 +1449,10 @@ std::shared_ptr<Material> Context::default_material_vk() {
     return _material_factory->default_material();
 }
 
+MaterialFactory *Context::material_factory() const {
+    return _material_factory.get();
+}
+
 std::shared_ptr<ISkin> Context::create_skin(const SkinInfo &info) {
     return std::make_shared<Skin>(this, info);
 }
@@ -1031,16 +1471,21 @@ Heap *Context::heap(NamedHeap name) {
     return _heaps[name].get();
 }
 
-Handle<HeapRangeOwned> Context::create_heap_range_owned(Heap *heap,
-                                                        uint64_t offset,
-                                                        VkDeviceSize size) {
-    return create_handle(_heap_ranges, heap, offset, size);
+Handle<HeapRangeOwned>
+Context::create_heap_range_owned(Heap *heap,
+                                 OffsetAllocator::Allocation allocation,
+                                 VkDeviceSize size) {
+    return create_handle(_heap_ranges, heap, allocation, size);
 }
 
 BindlessResources *Context::bindless_resources() const {
     return _bindless_resources.get();
 }
 
+Uploader *Context::uploader() const {
+    return _uploader.get();
+}
+
 std::string ContextInfo::dump() const {
     std::stringstream ss;
     auto to_str = [](VkBool32 b) { return b ? "true" : "false"; };
@@ -1059,6 +1504,9 @@ std::string ContextInfo::dump() const {
     ss << "acceleration structure: "
        << to_str(acceleration_structure_features.accelerationStructure)
        << std::endl;
+    ss << "timeline semaphore: "
+       << to_str(timeline_semaphore_features.timelineSemaphore) << std::endl;
+    ss << "bindless: " << to_str(support_bindless()) << std::endl;
 
     return ss.str();
 }
@@ -1075,6 +1523,8 @@ void ContextInfo::init(Instance *instance,
         &acceleration_structure_features,
         &ray_tracing_pipeline_features,
         &device_address_features,
+        &timeline_semaphore_features,
+        &descriptor_indexing_features,
     });
 
     instance->GetPhysicalDeviceFeatures2(physical_device, &device_features2);
@@ -1088,6 +1538,8 @@ void ContextInfo::init(Instance *instance,
     set_up_vk_struct_chain({
         &device_properties2,
         &ray_tracing_pipeline_properties,
+        &descriptor_indexing_properties,
+        &id_properties,
     });
     instance->GetPhysicalDeviceProperties2(physical_device,
                                            &device_properties2);
@@ -10,6 +10,9 @@
 
 #include <ars/runtime/core/misc/Defer.h>
 
+#include <array>
+#include <atomic>
+#include <mutex>
 #include <set>
 #include <vector>
 
@@ -17,6 +20,7 @@ struct GLFWwindow;
 
 namespace ars::render::vk {
 class BindlessResources;
+class PipelineObjectCache;
 class Lut;
 class DescriptorArena;
 class Swapchain;
@@ -27,6 +31,7 @@ class Profiler;
 class AccelerationStructure;
 class ImageBasedLighting;
 class RendererContextData;
+class Uploader;
 
 void init_vulkan_backend(const ApplicationInfo &app_info);
 void destroy_vulkan_backend();
@@ -43,29 +48,39 @@ class Queue {
     [[nodiscard]] uint32_t family_index() const;
     [[nodiscard]] VkQueue queue() const;
 
+    // Submissions are not chained: ordering between submissions comes from
+    // pipeline barriers recorded in the command buffers. All commands of the
+    // submission wait for the wait semaphores. Signal semaphores are signaled
+    // when the command buffer finishes, and should be binary semaphores.
     void submit(CommandBuffer *command_buffer,
                 uint32_t wait_semaphore_count = 0,
-                VkSemaphore *wait_semaphores = nullptr);
+                VkSemaphore *wait_semaphores = nullptr,
+                uint32_t signal_semaphore_count = 0,
+                VkSemaphore *signal_semaphores = nullptr);
 
     // record a command buffer and submit it immediately
     template <typename Func>
     auto submit_once(Func &&func,
                      uint32_t wait_semaphore_count = 0,
-                     VkSemaphore *wait_semaphores = nullptr);
+                     VkSemaphore *wait_semaphores = nullptr,
+                     uint32_t signal_semaphore_count = 0,
+                     VkSemaphore *signal_semaphores = nullptr);
 
-    // The signaled semaphore for the last submitted command.
-    // If the queue is flushed, this method returns VK_NULL_HANDLE
-    [[nodiscard]] VkSemaphore get_semaphore() const;
+    // The fence is signaled after all commands submitted so far finish.
+    // The fence should be unsignaled.
+    void submit_fence(VkFence fence);
 
     // wait the queue idle
     void flush();
 
+    // Number of command buffers submitted since the queue is created
+    [[nodiscard]] uint64_t submit_count() const;
+
     [[nodiscard]] VkQueueFamilyProperties family_properties() const;
 
   private:
-    // A queue for synchronizing each command buffer submissions
-    std::vector<VkSemaphore> _semaphores;
     Context *_context = nullptr;
+    uint64_t _submit_count = 0;
     uint32_t _family_index = 0;
     VkQueue _queue = VK_NULL_HANDLE;
     VkQueueFamilyProperties _family_properties{};
@@ -102,16 +117,36 @@ struct ContextInfo {
         VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_RAY_TRACING_PIPELINE_FEATURES_KHR};
     VkPhysicalDeviceBufferDeviceAddressFeaturesEXT device_address_features{
         VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_BUFFER_ADDRESS_FEATURES_EXT};
+    VkPhysicalDeviceTimelineSemaphoreFeaturesKHR timeline_semaphore_features{
+        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES_KHR};
+    VkPhysicalDeviceDescriptorIndexingFeaturesEXT descriptor_indexing_features{
+        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT};
 
     VkPhysicalDeviceProperties properties{};
     VkPhysicalDeviceRayTracingPipelinePropertiesKHR
         ray_tracing_pipeline_properties{
             VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_RAY_TRACING_PIPELINE_PROPERTIES_KHR};
+    VkPhysicalDeviceDescriptorIndexingPropertiesEXT
+        descriptor_indexing_properties{
+            VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES_EXT};
+    VkPhysicalDeviceIDProperties id_properties{
+        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ID_PROPERTIES};
 
     std::vector<std::string> enabled_extensions{};
 
+    // Textures can be sampled by bindless ids from an update-after-bind
+    // descriptor array, see BindlessResources
     [[nodiscard]] bool support_bindless() const {
-        return false;
+        auto &f = descriptor_indexing_features;
+        return f.runtimeDescriptorArray == VK_TRUE &&
+               f.descriptorBindingPartiallyBound == VK_TRUE &&
+               f.descriptorBindingSampledImageUpdateAfterBind == VK_TRUE &&
+               f.descriptorBindingUpdateUnusedWhilePending == VK_TRUE &&
+               f.shaderSampledImageArrayNonUniformIndexing == VK_TRUE;
+    }
+
+    [[nodiscard]] bool support_timeline_semaphore() const {
+        return timeline_semaphore_features.timelineSemaphore == VK_TRUE;
     }
 
     void init(Instance *instance,
@@ -138,6 +173,8 @@ class Context : public IContext {
     std::shared_ptr<ISkin> create_skin(const SkinInfo &info) override;
     std::shared_ptr<IMaterial>
     create_material(const MaterialInfo &info) override;
+    void prewarm_materials(const std::vector<MaterialInfo> &infos) override;
+    void wait_for_material_pipelines() override;
     std::shared_ptr<IPanoramaSky> create_panorama_sky() override;
     std::shared_ptr<IPhysicalSky> create_physical_sky() override;
     [[nodiscard]] Instance *instance() const;
@@ -159,7 +196,35 @@ class Context : public IContext {
     // It will be rare for us to find no such queue.
     [[nodiscard]] Queue *queue() const;
 
+    // Queue from a compute only family, which runs concurrently with the
+    // primary queue. Returns nullptr if the device has no such family, and all
+    // work should go to queue().
+    //
+    // Work submitted to this queue must be waited by the primary queue before
+    // the frame ends, as only the primary queue signals frame fences.
+    [[nodiscard]] Queue *compute_queue() const;
+
+    // Binary semaphore for synchronization between queues in the current
+    // frame. Each semaphore should be signaled and waited exactly once. It is
+    // reused after the frame finishes on the GPU.
+    VkSemaphore acquire_semaphore();
+
+    // Descriptor arena of the current frame. Descriptor sets allocated from
+    // it are valid until the frame finishes on the GPU.
     [[nodiscard]] DescriptorArena *descriptor_arena() const;
+    // Descriptor sets kept across frames
+    [[nodiscard]] DescriptorSetCache *descriptor_set_cache() const;
+    // Shader modules and pipelines shared by creators with the same state
+    [[nodiscard]] PipelineObjectCache *pipeline_object_cache() const;
+
+    // Buffer arena of the current frame for data read by the GPU only in the
+    // frame. Ranges allocated from it are valid until the frame finishes on
+    // the GPU.
+    [[nodiscard]] BufferArena *buffer_arena() const;
+
+    // Index of the frame in flight currently recorded, in range
+    // [0, MAX_FRAMES_IN_FLIGHT)
+    [[nodiscard]] uint32_t frame_index() const;
 
     [[nodiscard]] const ContextInfo &info() const;
 
@@ -170,12 +235,21 @@ class Context : public IContext {
     Handle<Texture> default_texture_vk(DefaultTexture tex);
 
     std::shared_ptr<Material> default_material_vk();
+    [[nodiscard]] MaterialFactory *material_factory() const;
 
     std::shared_ptr<ITexture> create_single_color_texture_2d(glm::vec4 color);
     std::shared_ptr<ITexture> create_single_color_cube_map(glm::vec4 color);
 
     Handle<Texture> create_texture(const TextureCreateInfo &info);
-    Handle<CommandBuffer> create_command_buffer(VkCommandBufferLevel level);
+    Handle<Texture> create_texture(const TextureCreateInfo &info,
+                                   std::shared_ptr<TextureMemory> memory,
+                                   VkDeviceSize memory_offset);
+    // The command buffer is allocated for the queue family of queue, or the
+    // primary queue if queue is nullptr. Command buffers of the primary queue
+    // created on job workers come from the command pool of the worker, so
+    // workers can record secondary command buffers in parallel.
+    Handle<CommandBuffer> create_command_buffer(VkCommandBufferLevel level,
+                                                Queue *queue = nullptr);
     Handle<Buffer> create_buffer(VkDeviceSize size,
                                  VkBufferUsageFlags buffer_usage,
                                  VmaMemoryUsage memory_usage);
@@ -183,6 +257,10 @@ class Context : public IContext {
     create_acceleration_structure(VkAccelerationStructureTypeKHR type,
                                   VkDeviceSize buffer_size);
 
+    // Count of buffers and textures created since the context is created
+    [[nodiscard]] uint64_t created_buffer_count() const;
+    [[nodiscard]] uint64_t created_texture_count() const;
+
     Framebuffer *
     create_tmp_framebuffer(RenderPass *render_pass,
                            std::vector<Handle<Texture>> attachments);
@@ -202,8 +280,11 @@ class Context : public IContext {
     [[nodiscard]] RendererContextData *renderer_data() const;
     [[nodiscard]] Heap *heap(NamedHeap name);
     [[nodiscard]] BindlessResources *bindless_resources() const;
+    [[nodiscard]] Uploader *uploader() const;
     [[nodiscard]] Handle<HeapRangeOwned>
-    create_heap_range_owned(Heap *heap, uint64_t offset, VkDeviceSize size);
+    create_heap_range_owned(Heap *heap,
+                            OffsetAllocator::Allocation allocation,
+                            VkDeviceSize size);
 
     void set_debug_name_internal(const std::string &name,
                                  uint64_t object_handle,
@@ -232,30 +313,56 @@ class Context : public IContext {
     void init_device_and_queues(Instance *instance,
                                 bool enable_validation,
                                 VkSurfaceKHR surface);
-    void init_command_pool();
+    void init_frames();
+    // The pipeline cache is loaded from and saved to the cache directory of
+    // the app, so pipelines compiled by earlier launches are reused
     void init_pipeline_cache();
-    void init_descriptor_arena();
+    void save_pipeline_cache();
     void init_default_textures();
     void init_profiler();
 
-    // Clear unused resources
+    struct Frame {
+        // Signaled when all commands submitted during the frame finish
+        VkFence fence = VK_NULL_HANDLE;
+        VkCommandPool command_pool = VK_NULL_HANDLE;
+        // For the compute queue if the device has one
+        VkCommandPool compute_command_pool = VK_NULL_HANDLE;
+        // For the primary queue, indexed by job worker index
+        std::vector<VkCommandPool> worker_command_pools{};
+        std::vector<VkSemaphore> semaphores{};
+        uint32_t used_semaphore_count = 0;
+        std::unique_ptr<DescriptorArena> descriptor_arena{};
+        std::unique_ptr<BufferArena> buffer_arena{};
+        // Resources released during the frame. The GPU may still use them
+        // until the fence is signaled.
+        std::vector<std::shared_ptr<void>> retired_resources{};
+        std::vector<std::unique_ptr<Framebuffer>> tmp_framebuffers{};
+    };
+
+    // Move unused resources to the retire list of the current frame
     void gc();
+    // Wait for the GPU to finish the frame, then release its resources and
+    // reset its pools for recording
+    void recycle_frame(uint32_t index);
 
     template <typename T, typename... Args>
-    static Handle<T> create_handle(std::vector<std::shared_ptr<T>> &pool,
-                                   Args &&...args);
+    Handle<T> create_handle(std::vector<std::shared_ptr<T>> &pool,
+                            Args &&...args);
 
     ContextInfo _info{};
     std::unique_ptr<Device> _device{};
     std::unique_ptr<Queue> _queue{};
+    std::unique_ptr<Queue> _compute_queue{};
 
     std::unique_ptr<VulkanMemoryAllocator> _vma{};
 
-    std::unique_ptr<DescriptorArena> _descriptor_arena{};
-
-    VkCommandPool _command_pool = VK_NULL_HANDLE;
+    std::array<Frame, MAX_FRAMES_IN_FLIGHT> _frames{};
+    uint32_t _frame_index = 0;
+    std::unique_ptr<DescriptorSetCache> _descriptor_set_cache{};
 
     VkPipelineCache _pipeline_cache = VK_NULL_HANDLE;
+    // Destroyed after the members owning pipelines
+    std::unique_ptr<PipelineObjectCache> _pipeline_object_cache{};
 
     // Must declare bindless resources pool before other resources cache, as the
     // resources cache should be released before bindless pool.
@@ -267,8 +374,10 @@ class Context : public IContext {
     std::vector<std::shared_ptr<AccelerationStructure>>
         _acceleration_structures{};
     std::vector<std::shared_ptr<HeapRangeOwned>> _heap_ranges{};
-
-    std::vector<std::unique_ptr<Framebuffer>> _tmp_framebuffers{};
+    // Resources may be created on job workers while recording
+    std::mutex _resources_mutex{};
+    std::atomic<uint64_t> _created_buffer_count{0};
+    std::atomic<uint64_t> _created_texture_count{0};
 
     std::set<Swapchain *> _registered_swapchains{};
 
@@ -283,18 +392,26 @@ class Context : public IContext {
     std::unique_ptr<Profiler> _profiler{};
     std::unique_ptr<RendererContextData> _renderer_data{};
     std::array<std::unique_ptr<Heap>, NamedHeap_Count> _heaps{};
+    std::unique_ptr<Uploader> _uploader{};
 };
 
 template <typename Func>
 auto Queue::submit_once(Func &&func,
                         uint32_t wait_semaphore_count,
-                        VkSemaphore *wait_semaphores) {
-    auto cmd = _context->create_command_buffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY);
+                        VkSemaphore *wait_semaphores,
+                        uint32_t signal_semaphore_count,
+                        VkSemaphore *signal_semaphores) {
+    auto cmd =
+        _context->create_command_buffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, this);
     cmd->begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
 
     ARS_DEFER([&]() {
         cmd->end();
-        submit(cmd.get(), wait_semaphore_count, wait_semaphores);
+        submit(cmd.get(),
+               wait_semaphore_count,
+               wait_semaphores,
+               signal_semaphore_count,
+               signal_semaphores);
     });
 
     if constexpr (std::is_void_v<
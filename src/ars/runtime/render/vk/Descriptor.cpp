@@ -1,6 +1,7 @@
 #include "Descriptor.h"
 #include "Pipeline.h"
 #include "Texture.h"
+#include <algorithm>
 #include <ars/runtime/core/Log.h>
 #include <cassert>
 
@@ -177,6 +178,14 @@ void DescriptorArena::alloc(VkDescriptorSetLayout layout,
                             const DescriptorSetInfo &info,
                             uint32_t count,
                             VkDescriptorSet *result) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    alloc_locked(layout, info, count, result);
+}
+
+void DescriptorArena::alloc_locked(VkDescriptorSetLayout layout,
+                                   const DescriptorSetInfo &info,
+                                   uint32_t count,
+                                   VkDescriptorSet *result) {
     if (count == 0) {
         return;
     }
@@ -195,7 +204,7 @@ void DescriptorArena::alloc(VkDescriptorSetLayout layout,
 
     if (count != 0) {
         next_pool();
-        alloc(layout, info, count, result);
+        alloc_locked(layout, info, count, result);
     }
 }
 
@@ -218,4 +227,160 @@ void DescriptorArena::alloc_new_pool() {
         std::make_unique<DescriptorPool>(_device, _pool_sizes, _pool_max_set));
 }
 
+namespace {
+constexpr uint32_t CACHE_POOL_MAX_SETS = 512;
+constexpr uint32_t CACHE_POOL_DESCRIPTOR_COUNT = 2048;
+} // namespace
+
+DescriptorSetCache::DescriptorSetCache(Device *device, uint32_t capacity)
+    : _device(device), _capacity(capacity) {}
+
+DescriptorSetCache::~DescriptorSetCache() {
+    // Sets are freed with their pools
+    for (auto pool : _pools) {
+        _device->Destroy(pool);
+    }
+}
+
+VkDescriptorSet DescriptorSetCache::find(uint64_t hash,
+                                         ars::Span<const uint64_t> key) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto it = _entry_of_hash.find(hash);
+    if (it == _entry_of_hash.end() ||
+        !std::equal(key.begin(),
+                    key.end(),
+                    it->second->key.begin(),
+                    it->second->key.end())) {
+        _stats.miss_count++;
+        return VK_NULL_HANDLE;
+    }
+
+    _stats.hit_count++;
+    auto entry = it->second;
+    entry->last_used_frame = _frame;
+    _entries.splice(_entries.begin(), _entries, entry);
+    return entry->set;
+}
+
+VkDescriptorSet DescriptorSetCache::alloc(VkDescriptorSetLayout layout,
+                                          const DescriptorSetInfo &info,
+                                          VkDescriptorPool *pool) {
+    VkDescriptorSetAllocateInfo alloc_info{
+        VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO};
+    alloc_info.descriptorSetCount = 1;
+    alloc_info.pSetLayouts = &layout;
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    VkDescriptorSet set = VK_NULL_HANDLE;
+    // Recently created pools are more likely to have space
+    for (auto it = _pools.rbegin(); it != _pools.rend(); it++) {
+        alloc_info.descriptorPool = *it;
+        if (_device->Allocate(&alloc_info, &set) == VK_SUCCESS) {
+            *pool = *it;
+            return set;
+        }
+    }
+
+    alloc_info.descriptorPool = create_pool();
+    if (_device->Allocate(&alloc_info, &set) != VK_SUCCESS) {
+        ARS_LOG_CRITICAL("Failed to alloc cached descriptor set");
+    }
+    *pool = alloc_info.descriptorPool;
+    return set;
+}
+
+VkDescriptorSet DescriptorSetCache::insert(uint64_t hash,
+                                           ars::Span<const uint64_t> key,
+                                           VkDescriptorSet set,
+                                           VkDescriptorPool pool) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto it = _entry_of_hash.find(hash);
+    if (it != _entry_of_hash.end() &&
+        std::equal(key.begin(),
+                   key.end(),
+                   it->second->key.begin(),
+                   it->second->key.end())) {
+        // The set is never used
+        _device->FreeDescriptorSets(pool, 1, &set);
+        it->second->last_used_frame = _frame;
+        return it->second->set;
+    }
+
+    Entry entry{};
+    entry.hash = hash;
+    entry.key.assign(key.begin(), key.end());
+    entry.set = set;
+    entry.pool = pool;
+    entry.last_used_frame = _frame;
+    _entries.push_front(std::move(entry));
+    _entry_of_hash[hash] = _entries.begin();
+    _stats.set_count = static_cast<uint32_t>(_entries.size());
+    return set;
+}
+
+void DescriptorSetCache::recycle() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _frame++;
+    while (_entries.size() > _capacity) {
+        auto &entry = _entries.back();
+        // The GPU may still use sets of frames in flight
+        if (entry.last_used_frame + MAX_FRAMES_IN_FLIGHT > _frame) {
+            break;
+        }
+        auto it = _entry_of_hash.find(entry.hash);
+        if (it != _entry_of_hash.end() && &*it->second == &entry) {
+            _entry_of_hash.erase(it);
+        }
+        _device->FreeDescriptorSets(entry.pool, 1, &entry.set);
+        _entries.pop_back();
+    }
+    _stats.set_count = static_cast<uint32_t>(_entries.size());
+}
+
+bool DescriptorSetCache::enabled() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _enabled;
+}
+
+void DescriptorSetCache::set_enabled(bool enabled) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _enabled = enabled;
+}
+
+DescriptorSetCacheStats DescriptorSetCache::stats() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _stats;
+}
+
+VkDescriptorPool DescriptorSetCache::create_pool() {
+    std::vector<VkDescriptorPoolSize> sizes{};
+    for (auto type : {VK_DESCRIPTOR_TYPE_SAMPLER,
+                      VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                      VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,
+                      VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                      VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER,
+                      VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER,
+                      VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+                      VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                      VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+                      VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC,
+                      VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT}) {
+        sizes.push_back({type, CACHE_POOL_DESCRIPTOR_COUNT});
+    }
+
+    VkDescriptorPoolCreateInfo info{
+        VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO};
+    info.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
+    info.maxSets = CACHE_POOL_MAX_SETS;
+    info.poolSizeCount = static_cast<uint32_t>(sizes.size());
+    info.pPoolSizes = sizes.data();
+
+    VkDescriptorPool pool = VK_NULL_HANDLE;
+    if (_device->Create(&info, &pool) != VK_SUCCESS) {
+        ARS_LOG_CRITICAL("Failed to create descriptor set cache pool");
+    }
+    _pools.push_back(pool);
+    return pool;
+}
+
 } // namespace ars::render::vk
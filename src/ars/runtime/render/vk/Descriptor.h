@@ -2,6 +2,10 @@
 
 #include "Vulkan.h"
 #include <array>
+#include <ars/runtime/core/misc/Span.h>
+#include <list>
+#include <mutex>
+#include <unordered_map>
 #include <vector>
 
 namespace ars::render::vk {
@@ -72,8 +76,100 @@ class DescriptorArena {
 
     std::vector<VkDescriptorPoolSize> _pool_sizes;
     uint32_t _pool_max_set;
+    // Sets are allocated by job workers recording in parallel
+    std::mutex _mutex{};
 
+    void alloc_locked(VkDescriptorSetLayout layout,
+                      const DescriptorSetInfo &info,
+                      uint32_t count,
+                      VkDescriptorSet *result);
     void next_pool();
     void alloc_new_pool();
 };
+
+struct DescriptorSetCacheStats {
+    uint64_t hit_count = 0;
+    uint64_t miss_count = 0;
+    uint32_t set_count = 0;
+};
+
+// Descriptor sets kept across frames, keyed by words identifying the pipeline,
+// the set index and the bound resources, see DescriptorEncoder::commit. Sets
+// referring to per-frame buffer arena ranges are not cached. Sets are written
+// once when they are created and never updated. When there are
+// more sets than the capacity, sets are evicted in least recently used order
+// once the GPU finishes the frames using them.
+class DescriptorSetCache {
+  public:
+    DescriptorSetCache(Device *device, uint32_t capacity);
+
+    ARS_NO_COPY_MOVE(DescriptorSetCache);
+
+    ~DescriptorSetCache();
+
+    // Return the set of the key. If it's not cached, a new set is allocated
+    // and passed to write(VkDescriptorSet) before it's cached, so sets are
+    // never seen unwritten.
+    template <typename Writer>
+    VkDescriptorSet get(uint64_t hash,
+                        ars::Span<const uint64_t> key,
+                        VkDescriptorSetLayout layout,
+                        const DescriptorSetInfo &info,
+                        Writer &&write) {
+        auto set = find(hash, key);
+        if (set == VK_NULL_HANDLE) {
+            VkDescriptorPool pool = VK_NULL_HANDLE;
+            set = alloc(layout, info, &pool);
+            write(set);
+            set = insert(hash, key, set, pool);
+        }
+        return set;
+    }
+
+    // Called when a frame is recycled, after waiting for its fence
+    void recycle();
+
+    // If disabled, DescriptorEncoder allocates sets from the frame arena and
+    // writes them every commit
+    [[nodiscard]] bool enabled() const;
+    void set_enabled(bool enabled);
+
+    [[nodiscard]] DescriptorSetCacheStats stats() const;
+
+  private:
+    struct Entry {
+        uint64_t hash = 0;
+        std::vector<uint64_t> key{};
+        VkDescriptorSet set = VK_NULL_HANDLE;
+        VkDescriptorPool pool = VK_NULL_HANDLE;
+        uint64_t last_used_frame = 0;
+    };
+    using EntryList = std::list<Entry>;
+
+    VkDescriptorSet find(uint64_t hash, ars::Span<const uint64_t> key);
+    VkDescriptorSet alloc(VkDescriptorSetLayout layout,
+                          const DescriptorSetInfo &info,
+                          VkDescriptorPool *pool);
+    // Return the cached set if another thread inserted the key first
+    VkDescriptorSet insert(uint64_t hash,
+                           ars::Span<const uint64_t> key,
+                           VkDescriptorSet set,
+                           VkDescriptorPool pool);
+    VkDescriptorPool create_pool();
+
+    Device *_device = nullptr;
+    uint32_t _capacity = 0;
+    bool _enabled = true;
+    uint64_t _frame = 0;
+
+    // Pools are created with VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT
+    std::vector<VkDescriptorPool> _pools{};
+    // Most recently used at the front. Entries replaced in the map by hash
+    // collisions stay in the list until they are evicted.
+    EntryList _entries{};
+    std::unordered_map<uint64_t, EntryList::iterator> _entry_of_hash{};
+    DescriptorSetCacheStats _stats{};
+    // Sets are committed by job workers recording in parallel
+    mutable std::mutex _mutex{};
+};
 } // namespace ars::render::vk
@@ -73,16 +73,6 @@ class ImGuiViewportData {
         }
     }
 
-    Buffer *vertex_buffer(VkDeviceSize size = 0) {
-        return create_or_resize(
-            _vertex_buffer, size, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
-    }
-
-    Buffer *index_buffer(VkDeviceSize size = 0) {
-        return create_or_resize(
-            _index_buffer, size, VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
-    }
-
     [[nodiscard]] Swapchain *swapchain() const {
         return _swapchain;
     }
@@ -96,19 +86,6 @@ class ImGuiViewportData {
         init_pipeline();
     }
 
-    Buffer *create_or_resize(Handle<Buffer> &buffer,
-                             VkDeviceSize size,
-                             VkBufferUsageFlags usage) {
-        if (buffer.get() == nullptr || buffer->size() < size) {
-            buffer = _swapchain->context()->create_buffer(
-                std::max<VkDeviceSize>(size, 256),
-                usage,
-                VMA_MEMORY_USAGE_CPU_TO_GPU);
-        }
-
-        return buffer.get();
-    }
-
     void init_pipeline() {
         auto ctx = _swapchain->context();
         auto vert_shader = Shader::find_precompiled(ctx, "ImGui.vert");
@@ -171,8 +148,6 @@ class ImGuiViewportData {
 
     Swapchain *_swapchain = nullptr;
     bool _owns_swapchain = false;
-    Handle<Buffer> _vertex_buffer{};
-    Handle<Buffer> _index_buffer{};
     std::unique_ptr<GraphicsPipeline> _pipeline{};
 };
 
@@ -319,15 +294,19 @@ void ImGuiPass::draw(CommandBuffer *cmd, ImGuiViewport *viewport) {
 
     auto swapchain = vp_data->swapchain();
 
+    // Vertices and indices are only used in this frame
+    BufferArenaRange vertices{};
+    BufferArenaRange indices{};
     if (draw_data->TotalVtxCount > 0) {
         size_t vertex_size = draw_data->TotalVtxCount * sizeof(ImDrawVert);
         size_t index_size = draw_data->TotalIdxCount * sizeof(ImDrawIdx);
 
-        auto vertex_buffer = vp_data->vertex_buffer(vertex_size);
-        auto index_buffer = vp_data->index_buffer(index_size);
+        auto arena = cmd->context()->buffer_arena();
+        vertices = arena->alloc(vertex_size);
+        indices = arena->alloc(index_size);
 
-        auto vtx_dst = reinterpret_cast<ImDrawVert *>(vertex_buffer->map());
-        auto idx_dst = reinterpret_cast<ImDrawIdx *>(index_buffer->map());
+        auto vtx_dst = static_cast<ImDrawVert *>(vertices.data);
+        auto idx_dst = static_cast<ImDrawIdx *>(indices.data);
 
         for (int n = 0; n < draw_data->CmdListsCount; n++) {
             const ImDrawList *cmd_list = draw_data->CmdLists[n];
@@ -340,9 +319,6 @@ void ImGuiPass::draw(CommandBuffer *cmd, ImGuiViewport *viewport) {
             vtx_dst += cmd_list->VtxBuffer.Size;
             idx_dst += cmd_list->IdxBuffer.Size;
         }
-
-        vertex_buffer->unmap();
-        index_buffer->unmap();
     }
 
     auto fb_extent = swapchain->physical_size();
@@ -378,15 +354,15 @@ void ImGuiPass::draw(CommandBuffer *cmd, ImGuiViewport *viewport) {
 
         // Bind vertex and index buffers
         if (draw_data->TotalVtxCount > 0) {
-            VkBuffer vertex_buffers[1] = {vp_data->vertex_buffer()->buffer()};
-            VkDeviceSize vertex_offset[1] = {0};
+            VkBuffer vertex_buffers[1] = {vertices.buffer->buffer()};
+            VkDeviceSize vertex_offset[1] = {vertices.offset};
             cmd->BindVertexBuffers(0, 1, vertex_buffers, vertex_offset);
 
             // There might be a warning for sizeof(ImDrawIdx) == 2 since the
             // linter thinks this expr is always true and redundant, which is
             // not, as the sizeof ImDrawIdx is configurable at compile time.
-            cmd->BindIndexBuffer(vp_data->index_buffer()->buffer(),
-                                 0,
+            cmd->BindIndexBuffer(indices.buffer->buffer(),
+                                 indices.offset,
                                  sizeof(ImDrawIdx) == 2 ? VK_INDEX_TYPE_UINT16
                                                         : VK_INDEX_TYPE_UINT32);
         }
@@ -3,6 +3,7 @@
 #include "materials/MaterialTemplate.h"
 #include <ars/runtime/core/Log.h>
 #include <ars/runtime/core/misc/Visitor.h>
+#include <atomic>
 #include <sstream>
 
 namespace ars::render::vk {
@@ -143,9 +144,82 @@ Context *MaterialPropertyBlockLayout::context() const {
     return _context;
 }
 
+Handle<Buffer> MaterialPropertyBlockLayout::data_buffer() const {
+    return _data_buffer;
+}
+
+namespace {
+constexpr uint32_t INITIAL_DATA_BLOCK_CAPACITY = 64;
+} // namespace
+
+uint32_t MaterialPropertyBlockLayout::alloc_slot(MaterialPropertyBlock *block) {
+    uint32_t slot = 0;
+    if (!_free_slots.empty()) {
+        slot = _free_slots.back();
+        _free_slots.pop_back();
+        _slot_blocks[slot] = block;
+    } else {
+        slot = static_cast<uint32_t>(_slot_blocks.size());
+        _slot_blocks.push_back(block);
+    }
+
+    if (_data_block_size == 0) {
+        return slot;
+    }
+    uint32_t capacity = 0;
+    if (_data_buffer.get() != nullptr) {
+        capacity =
+            static_cast<uint32_t>(_data_buffer->size() / _data_block_size);
+    }
+    if (slot >= capacity) {
+        grow_data_buffer(std::max(capacity * 2, INITIAL_DATA_BLOCK_CAPACITY));
+    } else {
+        upload_slot(slot);
+    }
+    return slot;
+}
+
+void MaterialPropertyBlockLayout::free_slot(uint32_t slot) {
+    assert(slot < _slot_blocks.size());
+    _slot_blocks[slot] = nullptr;
+    _free_slots.push_back(slot);
+}
+
+void MaterialPropertyBlockLayout::upload_slot(uint32_t slot) {
+    if (_data_block_size == 0) {
+        return;
+    }
+    FrameVector<uint8_t> data(_data_block_size);
+    _slot_blocks[slot]->fill_data(data.data());
+    _data_buffer->set_data_raw(
+        data.data(), slot * _data_block_size, _data_block_size);
+}
+
+void MaterialPropertyBlockLayout::grow_data_buffer(uint32_t capacity) {
+    // Contents are not copied, the GPU may still read the old buffer
+    _data_buffer = _context->create_buffer(
+        static_cast<VkDeviceSize>(_data_block_size) * capacity,
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        VMA_MEMORY_USAGE_GPU_ONLY);
+
+    FrameVector<uint8_t> data(_data_block_size * _slot_blocks.size());
+    for (size_t i = 0; i < _slot_blocks.size(); i++) {
+        if (_slot_blocks[i] != nullptr) {
+            _slot_blocks[i]->fill_data(data.data() + i * _data_block_size);
+        }
+    }
+    _data_buffer->set_data_raw(data.data(), 0, data.size());
+}
+
+namespace {
+std::atomic<uint32_t> s_property_block_id_counter{0};
+} // namespace
+
 MaterialPropertyBlock::MaterialPropertyBlock(
     std::shared_ptr<MaterialPropertyBlockLayout> layout)
-    : _layout(std::move(layout)) {
+    : _layout(std::move(layout)),
+      _id(s_property_block_id_counter.fetch_add(1,
+                                                std::memory_order_relaxed)) {
     assert(_layout != nullptr);
 
     auto &info = _layout->info();
@@ -156,6 +230,11 @@ MaterialPropertyBlock::MaterialPropertyBlock(
     for (int i = 0; i < info.properties.size(); i++) {
         set_variant_by_index(i, info.properties[i].default_value);
     }
+    _slot = _layout->alloc_slot(this);
+}
+
+MaterialPropertyBlock::~MaterialPropertyBlock() {
+    _layout->free_slot(_slot);
 }
 
 void MaterialPropertyBlock::set_variant(const std::string &name,
@@ -169,6 +248,11 @@ void MaterialPropertyBlock::set_variant(const std::string &name,
     }
 
     set_variant_by_index(*index, value);
+    // Without bindless, indices of textures in the data block never change
+    if (value.type() != MaterialPropertyType::Texture ||
+        _layout->context()->info().support_bindless()) {
+        _layout->upload_slot(_slot);
+    }
 }
 
 std::optional<MaterialPropertyVariant>
@@ -186,6 +270,18 @@ MaterialPropertyBlock::layout() const {
     return _layout;
 }
 
+uint32_t MaterialPropertyBlock::id() const {
+    return _id;
+}
+
+uint32_t MaterialPropertyBlock::slot() const {
+    return _slot;
+}
+
+uint32_t MaterialPropertyBlock::texture_version() const {
+    return _texture_version;
+}
+
 void MaterialPropertyBlock::set_variant_by_index(
     uint32_t index, const MaterialPropertyVariant &value) {
     auto &info = _layout->info();
@@ -205,6 +301,7 @@ void MaterialPropertyBlock::set_variant_by_index(
                        std::remove_cv_t<std::remove_reference_t<decltype(v)>>;
                    if constexpr (std::is_same_v<T, std::shared_ptr<ITexture>>) {
                        _texture_owners[index] = v;
+                       _texture_version++;
                    } else {
                        *reinterpret_cast<T *>(data_ptr) = v;
                    }
@@ -212,12 +309,12 @@ void MaterialPropertyBlock::set_variant_by_index(
                value);
 }
 
-// TODO bindless on supported platform, currently the textures are simply
-// returned in their property order, and the shader use index of that tex in the
-// returned vector to access them
-std::vector<Handle<Texture>> MaterialPropertyBlock::referenced_textures() {
-    std::vector<Handle<Texture>> textures{};
-    auto props = _layout->info().properties;
+// Without bindless, the textures are returned in their property order, and the
+// shader use index of that tex in the returned vector to access them. With
+// bindless, the shader use bindless ids of textures and this is not needed.
+FrameVector<Handle<Texture>> MaterialPropertyBlock::referenced_textures() {
+    FrameVector<Handle<Texture>> textures{};
+    auto &props = _layout->info().properties;
     for (int i = 0; i < props.size(); i++) {
         if (props[i].type == MaterialPropertyType::Texture) {
             textures.push_back(upcast(get_texture_by_index(i).get()));
@@ -229,14 +326,26 @@ std::vector<Handle<Texture>> MaterialPropertyBlock::referenced_textures() {
 void MaterialPropertyBlock::fill_data(void *ptr) {
     std::memcpy(ptr, _data_block.data(), _data_block.size());
 
-    auto props = _layout->info().properties;
+    auto ctx = _layout->context();
+    auto bindless = ctx->info().support_bindless();
+    auto &props = _layout->info().properties;
     uint32_t tex_id = 0;
     for (int i = 0; i < props.size(); i++) {
         if (props[i].type == MaterialPropertyType::Texture) {
             auto offset = _layout->property_offset(i);
             auto mem_ptr =
-                reinterpret_cast<uint32_t *>((uint8_t *)(ptr) + offset);
-            *mem_ptr = tex_id++;
+                reinterpret_cast<int32_t *>((uint8_t *)(ptr) + offset);
+            if (!bindless) {
+                *mem_ptr = static_cast<int32_t>(tex_id++);
+                continue;
+            }
+            auto id = upcast(get_texture_by_index(i).get())->bindless_id();
+            if (id < 0) {
+                // Not resident, e.g. cube maps or the bindless array is full
+                id = upcast(ctx->default_texture(DefaultTexture::White).get())
+                         ->bindless_id();
+            }
+            *mem_ptr = id;
         }
     }
 }
@@ -289,11 +398,65 @@ MaterialFactory::MaterialFactory(Context *context) : _context(context) {
 
 std::shared_ptr<Material>
 MaterialFactory::create_material(const MaterialInfo &info) {
-    auto it = _material_prototypes.find(info);
-    if (it == _material_prototypes.end()) {
-        _material_prototypes[info] = create_material_prototype(_context, info);
+    return prototype(info)->create();
+}
+
+MaterialPrototype *MaterialFactory::prototype(const MaterialInfo &info) {
+    auto &proto = _material_prototypes[info];
+    if (proto == nullptr) {
+        proto = create_material_prototype(_context, info);
+        compile(proto.get());
+    }
+    return proto.get();
+}
+
+void MaterialFactory::compile(MaterialPrototype *proto) {
+    auto pass_count = static_cast<uint32_t>(proto->passes.size());
+    proto->pending_pass_count = pass_count;
+    for (uint32_t id = 0; id < pass_count; id++) {
+        // Inverse of MaterialPassInfo::encode()
+        MaterialPassInfo pass_info{};
+        pass_info.pass_id = static_cast<RenderPassID>(id >> 1);
+        pass_info.skinned = (id & 1) != 0;
+
+        auto job = [this, proto, pass_info]() {
+            proto->passes[pass_info.encode()] = create_material_pass_pipeline(
+                _context, proto->info, pass_info);
+            if (proto->pending_pass_count.fetch_sub(1) == 1) {
+                proto->ready.store(true, std::memory_order_release);
+                _ready_version.fetch_add(1);
+            }
+        };
+        if (_async_compilation) {
+            jobs::run_background(job, &proto->compile_counter);
+        } else {
+            job();
+        }
     }
-    return _material_prototypes[info]->create();
+}
+
+bool MaterialFactory::async_compilation() const {
+    return _async_compilation;
+}
+
+void MaterialFactory::set_async_compilation(bool enabled) {
+    _async_compilation = enabled;
+}
+
+void MaterialFactory::prewarm(ars::Span<const MaterialInfo> infos) {
+    for (auto &info : infos) {
+        prototype(info);
+    }
+}
+
+void MaterialFactory::wait_for_pipelines() {
+    for (auto &[info, proto] : _material_prototypes) {
+        jobs::wait(&proto->compile_counter);
+    }
+}
+
+uint64_t MaterialFactory::ready_version() const {
+    return _ready_version.load();
 }
 
 std::shared_ptr<Material> MaterialFactory::default_material() {
@@ -305,6 +468,8 @@ void MaterialFactory::init_default_material() {
     info.shading_model = MaterialShadingModel::MetallicRoughnessPBR;
 
     _default_material = create_material(info);
+    // Objects without materials are drawn with it from the first frame
+    jobs::wait(&prototype(info)->compile_counter);
     _default_material->set("base_color_factor",
                            glm::vec4(0.8f, 0.8f, 0.8f, 1.0f));
     _default_material->set("metallic_factor", 0.0f);
@@ -346,7 +511,9 @@ MaterialPass Material::pass(const MaterialPassInfo &info) {
 
     MaterialPass p{};
     p.property_block = _property_block.get();
-    p.pipeline = _prototype->passes[id].get();
+    if (_prototype->ready.load(std::memory_order_acquire)) {
+        p.pipeline = _prototype->passes[id].get();
+    }
 
     return p;
 }
@@ -359,6 +526,10 @@ std::shared_ptr<Material> upcast(const std::shared_ptr<IMaterial> &m) {
     return std::dynamic_pointer_cast<Material>(m);
 }
 
+MaterialPrototype::~MaterialPrototype() {
+    jobs::wait(&compile_counter);
+}
+
 std::shared_ptr<Material> MaterialPrototype::create() {
     return std::make_shared<Material>(info, this);
 }
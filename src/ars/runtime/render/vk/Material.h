@@ -1,13 +1,19 @@
 #pragma once
 
 #include "../IMaterial.h"
+#include "Buffer.h"
 #include "Texture.h"
 #include "Vulkan.h"
 #include "features/Renderer.h"
+#include <ars/runtime/core/Jobs.h>
+#include <ars/runtime/core/misc/Arena.h>
+#include <ars/runtime/core/misc/Span.h>
+#include <atomic>
 
 namespace ars::render::vk {
 class Context;
 class GraphicsPipeline;
+class MaterialPropertyBlock;
 
 struct MaterialPropertyBlockInfo {
     std::string name;
@@ -44,13 +50,30 @@ class MaterialPropertyBlockLayout {
     [[nodiscard]] uint32_t data_block_size() const;
     [[nodiscard]] Context *context() const;
 
+    // Data blocks of all property blocks of the layout, indexed by their
+    // slots. Null if no block is created or the data block is empty.
+    [[nodiscard]] Handle<Buffer> data_buffer() const;
+
   private:
+    friend MaterialPropertyBlock;
+
     void init_data_block_layout();
 
+    uint32_t alloc_slot(MaterialPropertyBlock *block);
+    void free_slot(uint32_t slot);
+    void upload_slot(uint32_t slot);
+    // Create a larger data buffer and upload all blocks to it
+    void grow_data_buffer(uint32_t capacity);
+
     Context *_context{};
     MaterialPropertyBlockInfo _info{};
     std::vector<uint32_t> _property_offsets{};
     uint32_t _data_block_size{};
+
+    Handle<Buffer> _data_buffer{};
+    // Null for free slots
+    std::vector<MaterialPropertyBlock *> _slot_blocks{};
+    std::vector<uint32_t> _free_slots{};
 };
 
 class MaterialPropertyBlock {
@@ -58,7 +81,18 @@ class MaterialPropertyBlock {
     explicit MaterialPropertyBlock(
         std::shared_ptr<MaterialPropertyBlockLayout> layout);
 
+    ARS_NO_COPY_MOVE(MaterialPropertyBlock);
+
+    ~MaterialPropertyBlock();
+
     [[nodiscard]] std::shared_ptr<MaterialPropertyBlockLayout> layout() const;
+    // Unique in creation order, e.g. for sorting draws by material
+    [[nodiscard]] uint32_t id() const;
+    // Index of the data block in the data buffer of the layout, which is
+    // updated when a property is set
+    [[nodiscard]] uint32_t slot() const;
+    // Increased when a texture property is set
+    [[nodiscard]] uint32_t texture_version() const;
 
     // If the property with name is not found, return std::nullopt.
     // If the property is found and is not set, return default value.
@@ -71,7 +105,7 @@ class MaterialPropertyBlock {
     void set_variant(const std::string &name,
                      const MaterialPropertyVariant &value);
 
-    std::vector<Handle<Texture>> referenced_textures();
+    FrameVector<Handle<Texture>> referenced_textures();
     void fill_data(void *ptr);
 
     template <typename T> void set(const std::string &name, T &&value) {
@@ -96,6 +130,9 @@ class MaterialPropertyBlock {
     std::shared_ptr<MaterialPropertyBlockLayout> _layout = nullptr;
     std::vector<uint8_t> _data_block{};
     std::vector<std::shared_ptr<ITexture>> _texture_owners{};
+    uint32_t _id = 0;
+    uint32_t _slot = 0;
+    uint32_t _texture_version = 0;
 };
 
 struct MaterialPass {
@@ -139,8 +176,16 @@ std::shared_ptr<Material> upcast(const std::shared_ptr<IMaterial> &m);
 struct MaterialPrototype {
     MaterialInfo info{};
     std::shared_ptr<MaterialPropertyBlockLayout> property_layout{};
+    // Written by compilation jobs, only read after ready is set
     std::array<std::shared_ptr<GraphicsPipeline>, MaterialPassInfo::MAX_INDEX>
         passes{};
+    std::atomic<uint32_t> pending_pass_count{0};
+    // Set when pipelines of all passes are compiled
+    std::atomic<bool> ready{false};
+    jobs::Counter compile_counter{};
+
+    // Waits for compilation
+    ~MaterialPrototype();
 
     std::shared_ptr<Material> create();
 };
@@ -152,14 +197,35 @@ class MaterialFactory {
     std::shared_ptr<Material> create_material(const MaterialInfo &info);
     std::shared_ptr<Material> default_material();
 
+    // Pipelines of new prototypes are compiled by background jobs, materials
+    // return no pipelines, so they are not drawn, until all pipelines of
+    // their prototype are ready. If disabled, pipelines are compiled before
+    // returning new materials.
+    [[nodiscard]] bool async_compilation() const;
+    void set_async_compilation(bool enabled);
+
+    // Start compiling pipelines of the infos, e.g. while loading, so
+    // materials created later are drawn at once
+    void prewarm(ars::Span<const MaterialInfo> infos);
+    // Block until pipelines of all known prototypes are compiled
+    void wait_for_pipelines();
+    // Incremented whenever pipelines of a prototype become ready, draw lists
+    // built before may miss objects
+    [[nodiscard]] uint64_t ready_version() const;
+
     [[nodiscard]] const std::map<MaterialInfo,
                                  std::unique_ptr<MaterialPrototype>> &
     prototypes() const;
 
   private:
     void init_default_material();
+    MaterialPrototype *prototype(const MaterialInfo &info);
+    void compile(MaterialPrototype *proto);
 
     Context *_context{};
+    bool _async_compilation = true;
+    // Declared before prototypes, which wait for compilation jobs using it
+    std::atomic<uint64_t> _ready_version{0};
     std::map<MaterialInfo, std::unique_ptr<MaterialPrototype>>
         _material_prototypes{};
     std::shared_ptr<Material> _default_material{};
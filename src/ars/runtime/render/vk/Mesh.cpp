@@ -3,10 +3,17 @@
 #include "Context.h"
 #include "features/RayTracing.h"
 #include <ars/runtime/core/Log.h>
+#include <atomic>
 
 namespace ars::render::vk {
+namespace {
+std::atomic<uint32_t> s_mesh_id_counter{0};
+std::atomic<uint64_t> s_mesh_aabb_version_counter{0};
+} // namespace
+
 Mesh::Mesh(Context *context, const MeshInfo &info)
-    : IMesh(info), _context(context) {
+    : IMesh(info), _context(context),
+      _id(s_mesh_id_counter.fetch_add(1, std::memory_order_relaxed)) {
     auto vert_heap = _context->heap(NamedHeap_Vertices);
     _position_buffer =
         vert_heap->alloc_owned(info.vertex_capacity * sizeof(glm::vec3));
@@ -93,6 +100,17 @@ math::AABB<float> Mesh::aabb() {
 
 void Mesh::set_aabb(const math::AABB<float> &aabb) {
     _aabb = aabb;
+    _aabb_version =
+        s_mesh_aabb_version_counter.fetch_add(1, std::memory_order_relaxed) +
+        1;
+}
+
+uint64_t Mesh::aabb_version() const {
+    return _aabb_version;
+}
+
+uint64_t Mesh::latest_aabb_version() {
+    return s_mesh_aabb_version_counter.load(std::memory_order_relaxed);
 }
 
 void Mesh::set_joint(const glm::uvec4 *joints,
@@ -128,6 +146,10 @@ Context *Mesh::context() const {
     return _context;
 }
 
+uint32_t Mesh::id() const {
+    return _id;
+}
+
 Handle<AccelerationStructure> Mesh::acceleration_structure() const {
     return _acceleration_structure;
 }
@@ -58,9 +58,16 @@ class Mesh : public IMesh {
     [[nodiscard]] HeapRange index_buffer() const;
 
     [[nodiscard]] Context *context() const;
+    // Unique in creation order, e.g. for sorting draws by mesh
+    [[nodiscard]] uint32_t id() const;
+    // Changes when the AABB is set. Versions of all meshes are drawn from one
+    // counter, so a greater latest_aabb_version() means some mesh changed.
+    [[nodiscard]] uint64_t aabb_version() const;
+    [[nodiscard]] static uint64_t latest_aabb_version();
 
   private:
     Context *_context = nullptr;
+    uint32_t _id = 0;
 
     Handle<HeapRangeOwned> _position_buffer{};
     Handle<HeapRangeOwned> _normal_buffer{};
@@ -72,6 +79,7 @@ class Mesh : public IMesh {
     Handle<HeapRangeOwned> _index_buffer{};
     size_t _triangle_count = 0;
     math::AABB<float> _aabb{};
+    uint64_t _aabb_version = 0;
 
     Handle<AccelerationStructure> _acceleration_structure{};
 };
@@ -1,52 +1,37 @@
 #include "Pipeline.h"
+#include "Bindless.h"
 #include "Context.h"
+#include "Descriptor.h"
 #include <ars/runtime/core/Log.h>
+#include <algorithm>
 #include <ars/runtime/core/misc/Visitor.h>
+#include <atomic>
 #include <cassert>
+#include <cstring>
 #include <vulkan/spirv_reflect.h>
 
 namespace ars::render::vk {
-Shader::Shader(Context *context,
-               const char *name,
-               const uint8_t *spirv_code,
-               size_t code_size)
-    : _context(context) {
-    load_reflection_info(code_size, spirv_code);
-
-    VkShaderModuleCreateInfo info{VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO};
-    info.pCode = reinterpret_cast<const uint32_t *>(spirv_code);
-    info.codeSize = code_size;
-
-    if (_context->device()->Create(&info, &_module) != VK_SUCCESS) {
-        ARS_LOG_CRITICAL("Failed to load shader module ", name);
-    }
-}
-
-Shader::~Shader() {
-    if (_module != VK_NULL_HANDLE) {
-        _context->device()->Destroy(_module);
-    }
-}
-
-VkShaderModule Shader::module() const {
-    return _module;
-}
-
-const PipelineLayoutInfo &Shader::pipeline_layout_info() const {
-    return _layout_info;
-}
+namespace {
+std::atomic<uint32_t> s_shader_module_id_counter{0};
+std::atomic<uint32_t> s_pipeline_id_counter{0};
+} // namespace
 
-void Shader::load_reflection_info(size_t code_size, const uint8_t *code) {
-    spv_reflect::ShaderModule reflect(code_size, code);
+ShaderModule::ShaderModule(Device *device,
+                           const char *name,
+                           const uint8_t *spirv_code,
+                           size_t code_size)
+    : device(device), code(spirv_code, spirv_code + code_size),
+      id(s_shader_module_id_counter.fetch_add(1, std::memory_order_relaxed)) {
+    spv_reflect::ShaderModule reflect(code_size, spirv_code);
     // Not sure what's the usage for a shader without entry...
     assert(reflect.GetEntryPointCount() > 0);
-    _stage = static_cast<VkShaderStageFlagBits>(reflect.GetShaderStage());
-    _entry = reflect.GetEntryPointName();
+    stage = static_cast<VkShaderStageFlagBits>(reflect.GetShaderStage());
+    entry = reflect.GetEntryPointName();
 
-    auto &entry = reflect.GetShaderModule().entry_points[0];
-    _local_size.x = entry.local_size.x;
-    _local_size.y = entry.local_size.y;
-    _local_size.z = entry.local_size.z;
+    auto &entry_point = reflect.GetShaderModule().entry_points[0];
+    local_size.x = entry_point.local_size.x;
+    local_size.y = entry_point.local_size.y;
+    local_size.z = entry_point.local_size.z;
 
     uint32_t set_count;
     std::vector<SpvReflectDescriptorSet *> sets;
@@ -63,7 +48,7 @@ void Shader::load_reflection_info(size_t code_size, const uint8_t *code) {
             auto binding = desc_set->bindings[b];
 
             binding_info.binding = binding->binding;
-            binding_info.stageFlags = _stage;
+            binding_info.stageFlags = stage;
             binding_info.descriptorCount = binding->count;
             binding_info.descriptorType =
                 static_cast<VkDescriptorType>(binding->descriptor_type);
@@ -71,20 +56,55 @@ void Shader::load_reflection_info(size_t code_size, const uint8_t *code) {
             set_info.bindings[binding->binding] = binding_info;
         }
 
-        _layout_info.sets[desc_set->set] = set_info;
+        layout_info.sets[desc_set->set] = set_info;
+    }
+
+    VkShaderModuleCreateInfo info{VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO};
+    info.pCode = reinterpret_cast<const uint32_t *>(spirv_code);
+    info.codeSize = code_size;
+
+    if (device->Create(&info, &module) != VK_SUCCESS) {
+        ARS_LOG_CRITICAL("Failed to load shader module {}", name);
     }
 }
 
+ShaderModule::~ShaderModule() {
+    if (module != VK_NULL_HANDLE) {
+        device->Destroy(module);
+    }
+}
+
+Shader::Shader(Context *context,
+               const char *name,
+               const uint8_t *spirv_code,
+               size_t code_size)
+    : _module(context->pipeline_object_cache()->get_shader_module(
+          name, spirv_code, code_size)) {}
+
+Shader::~Shader() = default;
+
+VkShaderModule Shader::module() const {
+    return _module->module;
+}
+
+uint32_t Shader::module_id() const {
+    return _module->id;
+}
+
+const PipelineLayoutInfo &Shader::pipeline_layout_info() const {
+    return _module->layout_info;
+}
+
 VkShaderStageFlagBits Shader::stage() const {
-    return _stage;
+    return _module->stage;
 }
 
 const char *Shader::entry() const {
-    return _entry.c_str();
+    return _module->entry.c_str();
 }
 
 ShaderLocalSize Shader::local_size() const {
-    return _local_size;
+    return _module->local_size;
 }
 
 std::unique_ptr<Shader>
@@ -176,48 +196,211 @@ std::optional<T> merge(const std::optional<T> &lhs,
     return lhs;
 }
 
+// Key of the state a pipeline is created from. Values behind pointers are
+// keyed instead of the pointers. Extension structs are not keyed, a state
+// with them can't be shared.
+struct PipelineKey {
+    std::vector<uint64_t> words{};
+    bool keyable = true;
+
+    void add(uint64_t word) {
+        words.push_back(word);
+    }
+
+    void add_float(float value) {
+        uint32_t bits = 0;
+        std::memcpy(&bits, &value, sizeof(bits));
+        words.push_back(bits);
+    }
+
+    void add_bytes(const void *data, size_t size) {
+        words.push_back(size);
+        auto bytes = static_cast<const uint8_t *>(data);
+        for (size_t i = 0; i < size; i += sizeof(uint64_t)) {
+            uint64_t word = 0;
+            std::memcpy(
+                &word, bytes + i, std::min(sizeof(uint64_t), size - i));
+            words.push_back(word);
+        }
+    }
+
+    void add_next(const void *next) {
+        if (next != nullptr) {
+            keyable = false;
+        }
+    }
+
+    // Empty if the state can't be keyed
+    [[nodiscard]] ars::Span<const uint64_t> span() const {
+        if (!keyable) {
+            return {words.data(), 0};
+        }
+        return {words.data(), words.size()};
+    }
+};
+
+void add_state(PipelineKey &key,
+               uint32_t push_constant_range_count,
+               const VkPushConstantRange *push_constant_ranges) {
+    key.add(push_constant_range_count);
+    for (uint32_t i = 0; i < push_constant_range_count; i++) {
+        auto &range = push_constant_ranges[i];
+        key.add(range.stageFlags);
+        key.add(range.offset);
+        key.add(range.size);
+    }
+}
+
+void add_state(PipelineKey &key, const VkPipelineShaderStageCreateInfo &s) {
+    key.add_next(s.pNext);
+    key.add(s.flags);
+    key.add(s.stage);
+    key.add_bytes(s.pName, std::strlen(s.pName));
+    auto spec = s.pSpecializationInfo;
+    key.add(spec != nullptr);
+    if (spec == nullptr) {
+        return;
+    }
+    key.add(spec->mapEntryCount);
+    for (uint32_t i = 0; i < spec->mapEntryCount; i++) {
+        auto &entry = spec->pMapEntries[i];
+        key.add(entry.constantID);
+        key.add(entry.offset);
+        key.add(entry.size);
+    }
+    key.add_bytes(spec->pData, spec->dataSize);
+}
+
+void add_state(PipelineKey &key,
+               const VkPipelineVertexInputStateCreateInfo &s) {
+    key.add_next(s.pNext);
+    key.add(s.flags);
+    key.add(s.vertexBindingDescriptionCount);
+    for (uint32_t i = 0; i < s.vertexBindingDescriptionCount; i++) {
+        auto &binding = s.pVertexBindingDescriptions[i];
+        key.add(binding.binding);
+        key.add(binding.stride);
+        key.add(binding.inputRate);
+    }
+    key.add(s.vertexAttributeDescriptionCount);
+    for (uint32_t i = 0; i < s.vertexAttributeDescriptionCount; i++) {
+        auto &attribute = s.pVertexAttributeDescriptions[i];
+        key.add(attribute.location);
+        key.add(attribute.binding);
+        key.add(attribute.format);
+        key.add(attribute.offset);
+    }
+}
+
+void add_state(PipelineKey &key,
+               const VkPipelineInputAssemblyStateCreateInfo &s) {
+    key.add_next(s.pNext);
+    key.add(s.flags);
+    key.add(s.topology);
+    key.add(s.primitiveRestartEnable);
+}
+
+void add_state(PipelineKey &key,
+               const VkPipelineRasterizationStateCreateInfo &s) {
+    key.add_next(s.pNext);
+    key.add(s.flags);
+    key.add(s.depthClampEnable);
+    key.add(s.rasterizerDiscardEnable);
+    key.add(s.polygonMode);
+    key.add(s.cullMode);
+    key.add(s.frontFace);
+    key.add(s.depthBiasEnable);
+    key.add_float(s.depthBiasConstantFactor);
+    key.add_float(s.depthBiasClamp);
+    key.add_float(s.depthBiasSlopeFactor);
+    key.add_float(s.lineWidth);
+}
+
+void add_state(PipelineKey &key, const VkStencilOpState &s) {
+    key.add(s.failOp);
+    key.add(s.passOp);
+    key.add(s.depthFailOp);
+    key.add(s.compareOp);
+    key.add(s.compareMask);
+    key.add(s.writeMask);
+    key.add(s.reference);
+}
+
+void add_state(PipelineKey &key,
+               const VkPipelineDepthStencilStateCreateInfo &s) {
+    key.add_next(s.pNext);
+    key.add(s.flags);
+    key.add(s.depthTestEnable);
+    key.add(s.depthWriteEnable);
+    key.add(s.depthCompareOp);
+    key.add(s.depthBoundsTestEnable);
+    key.add(s.stencilTestEnable);
+    add_state(key, s.front);
+    add_state(key, s.back);
+    key.add_float(s.minDepthBounds);
+    key.add_float(s.maxDepthBounds);
+}
+
+void add_state(PipelineKey &key,
+               const VkPipelineColorBlendStateCreateInfo &s) {
+    key.add_next(s.pNext);
+    key.add(s.flags);
+    key.add(s.logicOpEnable);
+    key.add(s.logicOp);
+    key.add(s.attachmentCount);
+    for (uint32_t i = 0; i < s.attachmentCount; i++) {
+        auto &attachment = s.pAttachments[i];
+        key.add(attachment.blendEnable);
+        key.add(attachment.srcColorBlendFactor);
+        key.add(attachment.dstColorBlendFactor);
+        key.add(attachment.colorBlendOp);
+        key.add(attachment.srcAlphaBlendFactor);
+        key.add(attachment.dstAlphaBlendFactor);
+        key.add(attachment.alphaBlendOp);
+        key.add(attachment.colorWriteMask);
+    }
+    for (auto constant : s.blendConstants) {
+        key.add_float(constant);
+    }
+}
+
 } // namespace
 
 GraphicsPipeline::GraphicsPipeline(Context *context,
                                    const GraphicsPipelineInfo &info)
     : Pipeline(context, VK_PIPELINE_BIND_POINT_GRAPHICS) {
-    init_layout(info);
     init_pipeline(info);
     if (info.name.has_value()) {
         Pipeline::set_name(info.name.value());
     }
 }
 
-Pipeline::~Pipeline() {
-    auto device = _context->device();
+PipelineObjects::PipelineObjects(Device *device)
+    : device(device),
+      id(s_pipeline_id_counter.fetch_add(1, std::memory_order_relaxed)) {}
 
-    for (auto desc_layout : _descriptor_layouts) {
+PipelineObjects::~PipelineObjects() {
+    for (auto &update_template : update_templates) {
+        if (update_template.handle != VK_NULL_HANDLE) {
+            device->Destroy(update_template.handle);
+        }
+    }
+
+    for (auto desc_layout : descriptor_layouts) {
         if (desc_layout != VK_NULL_HANDLE) {
             device->Destroy(desc_layout);
         }
     }
 
-    if (_pipeline_layout != VK_NULL_HANDLE) {
-        device->Destroy(_pipeline_layout);
+    if (pipeline_layout != VK_NULL_HANDLE) {
+        device->Destroy(pipeline_layout);
     }
 
-    if (_pipeline != VK_NULL_HANDLE) {
-        device->Destroy(_pipeline);
+    if (pipeline != VK_NULL_HANDLE) {
+        device->Destroy(pipeline);
     }
 }
 
-void GraphicsPipeline::init_layout(const GraphicsPipelineInfo &info) {
-    PipelineLayoutInfo pipeline_layout_info{};
-    for (auto shader : info.shaders) {
-        pipeline_layout_info =
-            merge(pipeline_layout_info, shader->pipeline_layout_info());
-    }
-
-    Pipeline::init_layout(pipeline_layout_info,
-                          info.push_constant_range_count,
-                          info.push_constant_ranges);
-}
-
 void GraphicsPipeline::init_pipeline(const GraphicsPipelineInfo &info) {
     VkGraphicsPipelineCreateInfo create_info{
         VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO};
@@ -327,70 +510,216 @@ void GraphicsPipeline::init_pipeline(const GraphicsPipelineInfo &info) {
 
     create_info.pDynamicState = &dynamic_state;
 
-    create_info.layout = _pipeline_layout;
     create_info.renderPass = info.subpass.render_pass->render_pass();
     create_info.subpass = info.subpass.index;
 
-    if (_context->device()->Create(
-            _context->pipeline_cache(), 1, &create_info, &_pipeline) !=
-        VK_SUCCESS) {
-        ARS_LOG_CRITICAL("Failed to create graphics pipeline");
+    // The layout is derived from the shaders, viewport, multisample and
+    // dynamic states are derived from the keyed states
+    PipelineKey key{};
+    key.add(VK_PIPELINE_BIND_POINT_GRAPHICS);
+    add_state(key, info.push_constant_range_count, info.push_constant_ranges);
+    key.add(info.shaders.size());
+    for (uint32_t i = 0; i < info.shaders.size(); i++) {
+        key.add(info.shaders[i]->module_id());
+        add_state(key, stages[i]);
     }
+    add_state(key, *create_info.pVertexInputState);
+    add_state(key, *create_info.pInputAssemblyState);
+    add_state(key, *create_info.pRasterizationState);
+    add_state(key, *create_info.pDepthStencilState);
+    add_state(key, *create_info.pColorBlendState);
+    for (auto word : info.subpass.render_pass->compatibility_key()) {
+        key.add(word);
+    }
+    key.add(info.subpass.index);
+
+    auto create = [&](PipelineObjects &objects) {
+        PipelineLayoutInfo pipeline_layout_info{};
+        for (auto shader : info.shaders) {
+            pipeline_layout_info =
+                merge(pipeline_layout_info, shader->pipeline_layout_info());
+        }
+        init_layout(objects,
+                    pipeline_layout_info,
+                    info.push_constant_range_count,
+                    info.push_constant_ranges);
+
+        create_info.layout = objects.pipeline_layout;
+        if (_context->device()->Create(_context->pipeline_cache(),
+                                       1,
+                                       &create_info,
+                                       &objects.pipeline) != VK_SUCCESS) {
+            ARS_LOG_CRITICAL("Failed to create graphics pipeline");
+        }
+    };
+    _objects =
+        _context->pipeline_object_cache()->get_pipeline(key.span(), create);
 }
 
 VkPipeline Pipeline::pipeline() const {
-    return _pipeline;
+    return _objects->pipeline;
 }
 
 VkDescriptorSet Pipeline::alloc_desc_set(uint32_t set) const {
     return _context->descriptor_arena()->alloc(
-        _descriptor_layouts[set], _pipeline_layout_info.sets[set].value());
+        _objects->descriptor_layouts[set],
+        _objects->pipeline_layout_info.sets[set].value());
+}
+
+VkDescriptorSetLayout Pipeline::descriptor_layout(uint32_t set) const {
+    return _objects->descriptor_layouts[set];
+}
+
+const DescriptorUpdateTemplate &
+Pipeline::update_template(uint32_t set) const {
+    return _objects->update_templates[set];
 }
 
 VkPipelineLayout Pipeline::pipeline_layout() const {
-    return _pipeline_layout;
+    return _objects->pipeline_layout;
 }
 
 Pipeline::Pipeline(Context *context, VkPipelineBindPoint bind_point)
     : _context(context), _bind_point(bind_point) {}
 
-void Pipeline::init_layout(const PipelineLayoutInfo &pipeline_layout_info,
+void Pipeline::init_layout(PipelineObjects &objects,
+                           const PipelineLayoutInfo &pipeline_layout_info,
                            uint32_t push_constant_range_count,
                            const VkPushConstantRange *push_constant_ranges) {
-    _pipeline_layout_info = pipeline_layout_info;
+    objects.pipeline_layout_info = pipeline_layout_info;
 
-    std::vector<VkDescriptorSetLayout> valid_desc_sets{};
-    valid_desc_sets.reserve(MAX_DESC_SET_COUNT);
+    uint32_t set_count = 0;
+    for (uint32_t i = 0; i < MAX_DESC_SET_COUNT; i++) {
+        if (pipeline_layout_info.sets[i].has_value()) {
+            set_count = i + 1;
+        }
+    }
 
-    for (int i = 0; i < MAX_DESC_SET_COUNT; i++) {
+    // Set numbers in shaders must match indices of the pipeline layout, so
+    // unused sets below the last one get empty layouts
+    std::array<VkDescriptorSetLayout, MAX_DESC_SET_COUNT> set_layouts{};
+    auto bindless_layout = _context->bindless_resources()->set_layout();
+    for (uint32_t i = 0; i < MAX_DESC_SET_COUNT; i++) {
+        objects.descriptor_layouts[i] = VK_NULL_HANDLE;
+        if (i >= set_count) {
+            continue;
+        }
         auto &s = pipeline_layout_info.sets[i];
-        if (s.has_value()) {
-            auto desc_set = s->create_desc_set_layout(_context->device());
-            _descriptor_layouts[i] = desc_set;
-            valid_desc_sets.push_back(desc_set);
-        } else {
-            _descriptor_layouts[i] = VK_NULL_HANDLE;
+        if (i == BINDLESS_SET && s.has_value() &&
+            bindless_layout != VK_NULL_HANDLE) {
+            // Owned by the bindless resources, sets are never allocated
+            set_layouts[i] = bindless_layout;
+            continue;
         }
+        objects.descriptor_layouts[i] =
+            s.value_or(DescriptorSetInfo{})
+                .create_desc_set_layout(_context->device());
+        set_layouts[i] = objects.descriptor_layouts[i];
     }
 
     VkPipelineLayoutCreateInfo create_info{
         VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO};
 
-    create_info.setLayoutCount = static_cast<uint32_t>(valid_desc_sets.size());
-    create_info.pSetLayouts = valid_desc_sets.data();
+    create_info.setLayoutCount = set_count;
+    create_info.pSetLayouts = set_layouts.data();
     create_info.pushConstantRangeCount = push_constant_range_count;
     create_info.pPushConstantRanges = push_constant_ranges;
 
-    if (_context->device()->Create(&create_info, &_pipeline_layout) !=
+    if (_context->device()->Create(&create_info, &objects.pipeline_layout) !=
         VK_SUCCESS) {
         ARS_LOG_CRITICAL("Failed to create pipeline layout");
     }
+
+    init_update_templates(objects);
+}
+
+namespace {
+bool is_image_descriptor(VkDescriptorType type) {
+    switch (type) {
+    case VK_DESCRIPTOR_TYPE_SAMPLER:
+    case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER:
+    case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE:
+    case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE:
+    case VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT:
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool is_buffer_descriptor(VkDescriptorType type) {
+    switch (type) {
+    case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER:
+    case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER:
+    case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC:
+    case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC:
+        return true;
+    default:
+        return false;
+    }
+}
+} // namespace
+
+void Pipeline::init_update_templates(PipelineObjects &objects) {
+    for (uint32_t set = 0; set < MAX_DESC_SET_COUNT; set++) {
+        auto &t = objects.update_templates[set];
+        t.element_offsets.fill(-1);
+        auto &s = objects.pipeline_layout_info.sets[set];
+        if (!s.has_value() ||
+            objects.descriptor_layouts[set] == VK_NULL_HANDLE) {
+            continue;
+        }
+
+        std::array<VkDescriptorUpdateTemplateEntry, MAX_DESC_BINDING_COUNT>
+            entries{};
+        uint32_t entry_count = 0;
+        bool supported = true;
+        for (uint32_t i = 0; i < MAX_DESC_BINDING_COUNT; i++) {
+            auto &b = s->bindings[i];
+            if (!b.has_value()) {
+                continue;
+            }
+            if (!is_image_descriptor(b->descriptorType) &&
+                !is_buffer_descriptor(b->descriptorType)) {
+                supported = false;
+                break;
+            }
+            auto &entry = entries[entry_count++];
+            entry.dstBinding = i;
+            entry.dstArrayElement = 0;
+            entry.descriptorCount = b->descriptorCount;
+            entry.descriptorType = b->descriptorType;
+            entry.offset = t.element_count * sizeof(DescriptorUpdateData);
+            entry.stride = sizeof(DescriptorUpdateData);
+            t.element_offsets[i] = static_cast<int32_t>(t.element_count);
+            t.element_count += b->descriptorCount;
+        }
+        if (!supported || entry_count == 0) {
+            t.element_count = 0;
+            t.element_offsets.fill(-1);
+            continue;
+        }
+
+        VkDescriptorUpdateTemplateCreateInfo info{
+            VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO};
+        info.descriptorUpdateEntryCount = entry_count;
+        info.pDescriptorUpdateEntries = entries.data();
+        info.templateType = VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_DESCRIPTOR_SET;
+        info.descriptorSetLayout = objects.descriptor_layouts[set];
+        if (_context->device()->Create(&info, &t.handle) != VK_SUCCESS) {
+            ARS_LOG_CRITICAL("Failed to create descriptor update template");
+        }
+    }
 }
 
 Context *Pipeline::context() const {
     return _context;
 }
 
+uint32_t Pipeline::id() const {
+    return _objects->id;
+}
+
 VkPipelineBindPoint Pipeline::bind_point() const {
     return _bind_point;
 }
@@ -400,12 +729,13 @@ void Pipeline::bind(CommandBuffer *cmd) const {
 }
 
 const PipelineLayoutInfo &Pipeline::pipeline_layout_info() const {
-    return _pipeline_layout_info;
+    return _objects->pipeline_layout_info;
 }
 
 void Pipeline::set_name(const std::string &name) {
-    _context->set_debug_name(name, _pipeline);
-    _context->set_debug_name(fmt::format("{}.layout", name), _pipeline_layout);
+    _context->set_debug_name(name, _objects->pipeline);
+    _context->set_debug_name(fmt::format("{}.layout", name),
+                             _objects->pipeline_layout);
 }
 
 VkPipelineColorBlendAttachmentState
@@ -441,19 +771,12 @@ ComputePipeline::ComputePipeline(Context *context,
     : Pipeline(context, VK_PIPELINE_BIND_POINT_COMPUTE) {
     assert(info.shader);
     _local_size = info.shader->local_size();
-    init_layout(info);
     init_pipeline(info);
     if (info.name.has_value()) {
         Pipeline::set_name(info.name.value());
     }
 }
 
-void ComputePipeline::init_layout(const ComputePipelineInfo &info) {
-    Pipeline::init_layout(info.shader->pipeline_layout_info(),
-                          info.push_constant_range_count,
-                          info.push_constant_ranges);
-}
-
 void ComputePipeline::init_pipeline(const ComputePipelineInfo &info) {
     VkComputePipelineCreateInfo create_info{
         VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO};
@@ -466,13 +789,28 @@ void ComputePipeline::init_pipeline(const ComputePipelineInfo &info) {
     si.pName = shader->entry();
     si.pSpecializationInfo = info.specialization_info;
 
-    create_info.layout = _pipeline_layout;
-
-    if (_context->device()->Create(
-            _context->pipeline_cache(), 1, &create_info, &_pipeline) !=
-        VK_SUCCESS) {
-        ARS_LOG_CRITICAL("Failed to create compute pipeline");
-    }
+    PipelineKey key{};
+    key.add(VK_PIPELINE_BIND_POINT_COMPUTE);
+    add_state(key, info.push_constant_range_count, info.push_constant_ranges);
+    key.add(shader->module_id());
+    add_state(key, si);
+
+    auto create = [&](PipelineObjects &objects) {
+        init_layout(objects,
+                    shader->pipeline_layout_info(),
+                    info.push_constant_range_count,
+                    info.push_constant_ranges);
+
+        create_info.layout = objects.pipeline_layout;
+        if (_context->device()->Create(_context->pipeline_cache(),
+                                       1,
+                                       &create_info,
+                                       &objects.pipeline) != VK_SUCCESS) {
+            ARS_LOG_CRITICAL("Failed to create compute pipeline");
+        }
+    };
+    _objects =
+        _context->pipeline_object_cache()->get_pipeline(key.span(), create);
 }
 
 ShaderLocalSize ComputePipeline::local_size() const {
@@ -500,157 +838,215 @@ DescriptorEncoder::DescriptorEncoder() {
 }
 
 namespace {
-void fill_desc_buffer(VkWriteDescriptorSet *write,
-                      VkDescriptorBufferInfo *buffer_info,
-                      VkDescriptorSet dst_set,
-                      uint32_t binding,
-                      VkBuffer buffer,
-                      VkDeviceSize offset,
-                      VkDeviceSize range,
-                      VkDescriptorType type) {
-    write->sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    write->descriptorType = type;
-    write->dstSet = dst_set;
-    write->dstBinding = binding;
-    write->dstArrayElement = 0;
-    write->descriptorCount = 1;
-    write->pBufferInfo = buffer_info;
-    write->pImageInfo = nullptr;
-    write->pTexelBufferView = nullptr;
-
-    buffer_info->buffer = buffer;
-    buffer_info->offset = offset;
-    buffer_info->range = range;
+// Descriptors of a binding, elements are in the resolved descriptors of the set
+struct ResolvedBinding {
+    uint32_t binding = 0;
+    VkDescriptorType type{};
+    uint32_t element_offset = 0;
+    uint32_t element_count = 0;
+};
+
+uint64_t hash_key(ars::Span<const uint64_t> key) {
+    uint64_t hash = 0;
+    for (auto word : key) {
+        hash ^= word + 0x9e3779b97f4a7c15ull + (hash << 6) + (hash >> 2);
+    }
+    return hash;
 }
-} // namespace
 
-void DescriptorEncoder::commit(CommandBuffer *cmd, Pipeline *pipeline) {
-    assert(pipeline != nullptr);
-    assert(cmd != nullptr);
-
-    VkDescriptorSet desc_sets[MAX_DESC_SET_COUNT]{};
-
-    std::vector<VkWriteDescriptorSet> writes{};
-    std::vector<VkDescriptorImageInfo> image_infos{};
-    std::vector<VkDescriptorBufferInfo> buffer_infos{};
-
-    writes.resize(_bindings.size());
-    buffer_infos.resize(_bindings.size());
+// Write with the update template of the set if all its bindings are given,
+// otherwise write the given bindings one by one
+void write_desc_set(Context *ctx,
+                    const Pipeline *pipeline,
+                    uint32_t set,
+                    VkDescriptorSet dst_set,
+                    ars::Span<const ResolvedBinding> bindings,
+                    ars::Span<const DescriptorUpdateData> elements) {
+    auto &update_template = pipeline->update_template(set);
+    auto &set_info = pipeline->pipeline_layout_info().sets[set].value();
+
+    bool complete = update_template.handle != VK_NULL_HANDLE;
+    uint32_t given_count = 0;
+    for (auto &b : bindings) {
+        auto &info = set_info.bindings[b.binding].value();
+        complete = complete && b.element_count == info.descriptorCount;
+        given_count += b.element_count;
+    }
+    complete = complete && given_count == update_template.element_count;
+
+    auto device = ctx->device();
+    if (complete) {
+        FrameVector<DescriptorUpdateData> data(update_template.element_count);
+        for (auto &b : bindings) {
+            std::copy_n(
+                elements.begin() + b.element_offset,
+                b.element_count,
+                data.begin() + update_template.element_offsets[b.binding]);
+        }
+        device->UpdateDescriptorSetWithTemplate(
+            dst_set, update_template.handle, data.data());
+        return;
+    }
 
-    size_t image_info_reserve_count = 0;
-    for (auto &b : _bindings) {
-        using ImageInfos = std::vector<ImageInfo>;
-        if (std::holds_alternative<ImageInfos>(b.data)) {
-            image_info_reserve_count += std::get<ImageInfos>(b.data).size();
+    FrameVector<VkWriteDescriptorSet> writes{};
+    FrameVector<VkDescriptorImageInfo> image_infos(elements.size());
+    FrameVector<VkDescriptorBufferInfo> buffer_infos(elements.size());
+    writes.reserve(bindings.size());
+    for (auto &b : bindings) {
+        if (b.element_count == 0) {
+            continue;
+        }
+        VkWriteDescriptorSet w{VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET};
+        w.descriptorType = b.type;
+        w.dstSet = dst_set;
+        w.dstBinding = b.binding;
+        w.dstArrayElement = 0;
+        w.descriptorCount = b.element_count;
+        for (uint32_t i = 0; i < b.element_count; i++) {
+            auto &e = elements[b.element_offset + i];
+            image_infos[b.element_offset + i] = e.image;
+            buffer_infos[b.element_offset + i] = e.buffer;
         }
+        if (is_image_descriptor(b.type)) {
+            w.pImageInfo = &image_infos[b.element_offset];
+        } else {
+            w.pBufferInfo = &buffer_infos[b.element_offset];
+        }
+        writes.push_back(w);
     }
-    image_infos.resize(image_info_reserve_count);
+    device->UpdateDescriptorSets(
+        static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+}
+} // namespace
 
-    size_t write_count = 0;
-    size_t image_count = 0;
-    size_t buffer_count = 0;
+void DescriptorEncoder::commit(CommandBuffer *cmd, Pipeline *pipeline) {
+    assert(pipeline != nullptr);
+    assert(cmd != nullptr);
 
     auto ctx = pipeline->context();
     auto &layout_info = pipeline->pipeline_layout_info();
+    auto cache = ctx->descriptor_set_cache();
+    bool use_cache = cache->enabled();
 
+    uint32_t used_sets = 0;
     for (auto &b : _bindings) {
-        auto &set = desc_sets[b.set];
-        if (set == VK_NULL_HANDLE) {
-            set = pipeline->alloc_desc_set(b.set);
-        }
+        used_sets |= 1u << b.set;
+    }
 
-        auto bind_info = layout_info.binding(b.set, b.binding);
-        if (!bind_info.has_value()) {
+    FrameVector<ResolvedBinding> bindings{};
+    FrameVector<DescriptorUpdateData> elements{};
+    // Identifies the pipeline, the set and the resources of the descriptors.
+    // Buffers and textures are identified by ids, as their handles may be
+    // reused after they are destroyed.
+    FrameVector<uint64_t> key{};
+
+    for (uint32_t set = 0; set < MAX_DESC_SET_COUNT; set++) {
+        auto &set_info = layout_info.sets[set];
+        if ((used_sets & (1u << set)) == 0 || !set_info.has_value() ||
+            pipeline->descriptor_layout(set) == VK_NULL_HANDLE) {
             continue;
         }
 
-        auto desc_type = bind_info->descriptorType;
-        ars::visit(make_visitor(
-                       [&](const std::vector<ImageInfo> &data) {
-                           auto &w = writes[write_count++];
-                           auto img_desc_infos = &image_infos[image_count];
-                           image_count += data.size();
-
-                           w.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-                           w.descriptorType = desc_type;
-                           w.dstSet = set;
-                           w.dstBinding = b.binding;
-                           w.dstArrayElement = 0;
-                           w.descriptorCount = data.size();
-                           w.pBufferInfo = nullptr;
-                           w.pImageInfo = img_desc_infos;
-                           w.pTexelBufferView = nullptr;
-
-                           for (int i = 0; i < data.size(); i++) {
-                               auto &image_info = img_desc_infos[i];
-                               auto tex = data[i].texture;
-                               auto level = data[i].level;
-                               image_info.imageLayout = tex->layout();
-                               if (level.has_value()) {
-                                   image_info.imageView =
-                                       tex->image_view_of_level(level.value());
-                               } else {
-                                   image_info.imageView = tex->image_view();
-                               }
-                               image_info.sampler = tex->sampler();
-                           }
-                       },
-                       [&](const BufferDataInfo &data) {
-                           auto &w = writes[write_count++];
-                           auto &buf_info = buffer_infos[buffer_count++];
-
-                           VkBufferUsageFlags usage = 0;
-                           if (desc_type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER) {
-                               usage |= VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
-                           }
-
-                           if (desc_type == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER) {
-                               usage |= VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
-                           }
-
-                           auto buf = ctx->create_buffer(
-                               data.size, usage, VMA_MEMORY_USAGE_CPU_TO_GPU);
-                           buf->set_data_raw(data.data.get(), 0, data.size);
-
-                           fill_desc_buffer(&w,
-                                            &buf_info,
-                                            set,
-                                            b.binding,
-                                            buf->buffer(),
-                                            0,
-                                            data.size,
-                                            desc_type);
-                       },
-                       [&](const BufferInfo &data) {
-                           auto &w = writes[write_count++];
-                           auto &buf_info = buffer_infos[buffer_count++];
-
-                           fill_desc_buffer(&w,
-                                            &buf_info,
-                                            set,
-                                            b.binding,
-                                            data.buffer->buffer(),
-                                            data.offset,
-                                            data.size,
-                                            desc_type);
-                       }),
-                   b.data);
-    }
-
-    ctx->device()->UpdateDescriptorSets(
-        static_cast<uint32_t>(write_count), writes.data(), 0, nullptr);
-
-    for (int i = 0; i < std::size(desc_sets); i++) {
-        auto set = desc_sets[i];
-        if (set != VK_NULL_HANDLE) {
-            cmd->BindDescriptorSets(pipeline->bind_point(),
-                                    pipeline->pipeline_layout(),
-                                    i,
-                                    1,
-                                    &set,
-                                    0,
-                                    nullptr);
+        bindings.clear();
+        elements.clear();
+        key.clear();
+        key.push_back(pipeline->id());
+        key.push_back(set);
+        // Set if the set refers to the buffer arena of the frame
+        bool per_frame = false;
+
+        for (auto &b : _bindings) {
+            if (b.set != set) {
+                continue;
+            }
+            auto &bind_info = set_info->bindings[b.binding];
+            if (!bind_info.has_value()) {
+                continue;
+            }
+
+            ResolvedBinding resolved{};
+            resolved.binding = b.binding;
+            resolved.type = bind_info->descriptorType;
+            resolved.element_offset = static_cast<uint32_t>(elements.size());
+            key.push_back(b.binding);
+
+            auto add_buffer = [&](Buffer *buffer,
+                                  VkDeviceSize offset,
+                                  VkDeviceSize size) {
+                DescriptorUpdateData e{};
+                e.buffer.buffer = buffer->buffer();
+                e.buffer.offset = offset;
+                e.buffer.range = size;
+                elements.push_back(e);
+                key.push_back(buffer->id());
+                key.push_back(offset);
+                key.push_back(size);
+            };
+
+            ars::visit(
+                make_visitor(
+                    [&](const FrameVector<ImageInfo> &data) {
+                        auto count = std::min<size_t>(
+                            data.size(), bind_info->descriptorCount);
+                        key.push_back(count);
+                        for (size_t i = 0; i < count; i++) {
+                            auto tex = data[i].texture;
+                            auto level = data[i].level;
+                            DescriptorUpdateData e{};
+                            e.image.imageLayout = tex->layout();
+                            if (level.has_value()) {
+                                e.image.imageView =
+                                    tex->image_view_of_level(level.value());
+                            } else {
+                                e.image.imageView = tex->image_view();
+                            }
+                            e.image.sampler = tex->sampler();
+                            elements.push_back(e);
+                            key.push_back(tex->id());
+                            key.push_back(level.has_value() ? *level + 1 : 0);
+                            key.push_back(e.image.imageLayout);
+                        }
+                    },
+                    [&](const BufferDataInfo &data) {
+                        auto range = ctx->buffer_arena()->alloc(data.size);
+                        range.set_data_raw(data.data, 0, data.size);
+                        per_frame = true;
+                        key.push_back(1);
+                        add_buffer(range.buffer, range.offset, range.size);
+                    },
+                    [&](const BufferInfo &data) {
+                        key.push_back(1);
+                        add_buffer(data.buffer, data.offset, data.size);
+                    }),
+                b.data);
+
+            resolved.element_count = static_cast<uint32_t>(elements.size()) -
+                                     resolved.element_offset;
+            bindings.push_back(resolved);
+        }
+
+        auto write = [&](VkDescriptorSet dst_set) {
+            write_desc_set(ctx, pipeline, set, dst_set, bindings, elements);
+        };
+        VkDescriptorSet desc_set = VK_NULL_HANDLE;
+        if (use_cache && !per_frame) {
+            desc_set = cache->get(hash_key(key),
+                                  key,
+                                  pipeline->descriptor_layout(set),
+                                  set_info.value(),
+                                  write);
+        } else {
+            desc_set = pipeline->alloc_desc_set(set);
+            write(desc_set);
         }
+
+        cmd->BindDescriptorSets(pipeline->bind_point(),
+                                pipeline->pipeline_layout(),
+                                set,
+                                1,
+                                &desc_set,
+                                0,
+                                nullptr);
     }
 }
 
@@ -682,10 +1078,11 @@ void DescriptorEncoder::set_buffer_data(uint32_t set,
         ARS_LOG_ERROR("Try to set a buffer with zero sized data");
         return;
     }
+    auto copy = static_cast<uint8_t *>(frame_arena().alloc(data_size));
+    std::memcpy(copy, data, data_size);
     BufferDataInfo info{};
-    info.data = std::make_unique<uint8_t[]>(data_size);
+    info.data = copy;
     info.size = data_size;
-    std::memcpy(info.data.get(), data, data_size);
     set_binding(set, binding, std::move(info));
 }
 
@@ -711,7 +1108,7 @@ void DescriptorEncoder::set_texture(uint32_t set,
                                     uint32_t binding,
                                     Texture *texture,
                                     std::optional<uint32_t> level) {
-    std::vector<ImageInfo> info(1);
+    FrameVector<ImageInfo> info(1);
     info[0].texture = texture;
     info[0].level = level;
     set_binding(set, binding, std::move(info));
@@ -720,7 +1117,7 @@ void DescriptorEncoder::set_texture(uint32_t set,
 void DescriptorEncoder::set_textures(uint32_t set,
                                      uint32_t binding,
                                      ars::Span<Handle<Texture>> textures) {
-    std::vector<ImageInfo> infos{};
+    FrameVector<ImageInfo> infos{};
     infos.reserve(textures.size());
     for (auto &t : textures) {
         ImageInfo info{};
@@ -766,4 +1163,133 @@ PipelineLayoutInfo::binding(uint32_t set, uint32_t binding) const {
 VkSubpassDescription SubpassInfo::description() const {
     return render_pass->subpasses()[index];
 }
+
+namespace {
+// FNV-1a over 64-bit words
+uint64_t hash_code(const uint8_t *code, size_t size) {
+    uint64_t hash = 0xcbf29ce484222325ull ^ size;
+    for (size_t i = 0; i < size; i += sizeof(uint64_t)) {
+        uint64_t word = 0;
+        std::memcpy(&word, code + i, std::min(sizeof(uint64_t), size - i));
+        hash = (hash ^ word) * 0x100000001b3ull;
+    }
+    return hash;
+}
+
+bool same_code(const ShaderModule &module,
+               const uint8_t *spirv_code,
+               size_t code_size) {
+    return module.code.size() == code_size &&
+           std::memcmp(module.code.data(), spirv_code, code_size) == 0;
+}
+
+bool same_key(const PipelineObjects &objects, ars::Span<const uint64_t> key) {
+    return objects.key.size() == key.size() &&
+           std::equal(key.begin(), key.end(), objects.key.begin());
+}
+
+template <typename T, typename Pred>
+std::shared_ptr<T> find_entry(
+    const std::unordered_map<uint64_t, std::vector<std::shared_ptr<T>>> &map,
+    uint64_t hash,
+    Pred &&pred) {
+    auto it = map.find(hash);
+    if (it == map.end()) {
+        return nullptr;
+    }
+    for (auto &entry : it->second) {
+        if (pred(*entry)) {
+            return entry;
+        }
+    }
+    return nullptr;
+}
+} // namespace
+
+PipelineObjectCache::PipelineObjectCache(Device *device) : _device(device) {}
+
+std::shared_ptr<const ShaderModule>
+PipelineObjectCache::get_shader_module(const char *name,
+                                       const uint8_t *spirv_code,
+                                       size_t code_size) {
+    auto hash = hash_code(spirv_code, code_size);
+    auto pred = [&](const ShaderModule &module) {
+        return same_code(module, spirv_code, code_size);
+    };
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_enabled) {
+            if (auto module = find_entry(_shader_modules, hash, pred)) {
+                _stats.shader_hit_count++;
+                return module;
+            }
+        }
+        _stats.shader_miss_count++;
+    }
+
+    // Reflect and create without the lock, so different shaders can be
+    // created in parallel
+    auto module =
+        std::make_shared<ShaderModule>(_device, name, spirv_code, code_size);
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (!_enabled) {
+        return module;
+    }
+    // Another thread may have created the same module meanwhile
+    if (auto existing = find_entry(_shader_modules, hash, pred)) {
+        return existing;
+    }
+    _shader_modules[hash].push_back(module);
+    return module;
+}
+
+std::shared_ptr<const PipelineObjects> PipelineObjectCache::get_pipeline(
+    ars::Span<const uint64_t> key,
+    const std::function<void(PipelineObjects &)> &create) {
+    auto hash = hash_key(key);
+    auto pred = [&](const PipelineObjects &objects) {
+        return same_key(objects, key);
+    };
+    bool cacheable = key.size() > 0;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_enabled && cacheable) {
+            if (auto objects = find_entry(_pipelines, hash, pred)) {
+                _stats.pipeline_hit_count++;
+                return objects;
+            }
+        }
+        _stats.pipeline_miss_count++;
+    }
+
+    auto objects = std::make_shared<PipelineObjects>(_device);
+    create(*objects);
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (!_enabled || !cacheable) {
+        return objects;
+    }
+    if (auto existing = find_entry(_pipelines, hash, pred)) {
+        return existing;
+    }
+    objects->key.assign(key.begin(), key.end());
+    _pipelines[hash].push_back(objects);
+    return objects;
+}
+
+bool PipelineObjectCache::enabled() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _enabled;
+}
+
+void PipelineObjectCache::set_enabled(bool enabled) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _enabled = enabled;
+}
+
+PipelineObjectCacheStats PipelineObjectCache::stats() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _stats;
+}
 } // namespace ars::render::vk
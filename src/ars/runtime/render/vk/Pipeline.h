@@ -3,9 +3,13 @@
 #include "Buffer.h"
 #include "Vulkan.h"
 #include <array>
+#include <ars/runtime/core/misc/Arena.h>
 #include <ars/runtime/core/misc/Span.h>
+#include <functional>
+#include <mutex>
 #include <optional>
 #include <string>
+#include <unordered_map>
 #include <variant>
 #include <vector>
 
@@ -32,6 +36,24 @@ struct PipelineLayoutInfo {
     binding(uint32_t set, uint32_t binding) const;
 };
 
+// One element of the data passed to a descriptor update template
+union DescriptorUpdateData {
+    VkDescriptorImageInfo image;
+    VkDescriptorBufferInfo buffer;
+};
+
+// Update template of a descriptor set of a pipeline, generated from the
+// reflection data. Descriptors of all bindings of the set are written at once
+// from an array of DescriptorUpdateData, array elements of a binding are
+// adjacent.
+struct DescriptorUpdateTemplate {
+    // Null if the set has bindings of other descriptor types
+    VkDescriptorUpdateTemplate handle = VK_NULL_HANDLE;
+    uint32_t element_count = 0;
+    // Index of the first element of bindings, -1 if not declared
+    std::array<int32_t, MAX_DESC_BINDING_COUNT> element_offsets{};
+};
+
 struct ShaderLocalSize {
     uint32_t x = 1;
     uint32_t y = 1;
@@ -47,6 +69,30 @@ struct ShaderLocalSize {
     void dispatch(CommandBuffer *cmd, const VkExtent3D &thread_extent) const;
 };
 
+// Module and reflection data of SPIR-V code, shared by shaders with the same
+// code, see PipelineObjectCache
+struct ShaderModule {
+    ShaderModule(Device *device,
+                 const char *name,
+                 const uint8_t *spirv_code,
+                 size_t code_size);
+
+    ARS_NO_COPY_MOVE(ShaderModule);
+
+    ~ShaderModule();
+
+    Device *device = nullptr;
+    // Compared on hash collisions
+    std::vector<uint8_t> code{};
+    std::string entry{};
+    ShaderLocalSize local_size{};
+    PipelineLayoutInfo layout_info{};
+    VkShaderStageFlagBits stage{};
+    VkShaderModule module = VK_NULL_HANDLE;
+    // Unique in creation order
+    uint32_t id = 0;
+};
+
 class Shader {
   public:
     static std::unique_ptr<Shader>
@@ -74,6 +120,9 @@ class Shader {
 
     [[nodiscard]] VkShaderModule module() const;
 
+    // Shared by shaders with the same code
+    [[nodiscard]] uint32_t module_id() const;
+
     [[nodiscard]] VkShaderStageFlagBits stage() const;
 
     [[nodiscard]] const char *entry() const;
@@ -83,14 +132,78 @@ class Shader {
     [[nodiscard]] ShaderLocalSize local_size() const;
 
   private:
-    void load_reflection_info(size_t code_size, const uint8_t *code);
+    std::shared_ptr<const ShaderModule> _module{};
+};
 
-    Context *_context = nullptr;
-    std::string _entry{};
-    ShaderLocalSize _local_size{};
-    PipelineLayoutInfo _layout_info{};
-    VkShaderStageFlagBits _stage{};
-    VkShaderModule _module = VK_NULL_HANDLE;
+// Vulkan objects of a pipeline, shared by pipelines created with the same
+// state, see PipelineObjectCache
+struct PipelineObjects {
+    explicit PipelineObjects(Device *device);
+
+    ARS_NO_COPY_MOVE(PipelineObjects);
+
+    ~PipelineObjects();
+
+    Device *device = nullptr;
+    std::array<VkDescriptorSetLayout, MAX_DESC_SET_COUNT> descriptor_layouts{};
+    std::array<DescriptorUpdateTemplate, MAX_DESC_SET_COUNT>
+        update_templates{};
+    PipelineLayoutInfo pipeline_layout_info{};
+    VkPipelineLayout pipeline_layout = VK_NULL_HANDLE;
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    // Compared on hash collisions
+    std::vector<uint64_t> key{};
+    // Unique in creation order
+    uint32_t id = 0;
+};
+
+struct PipelineObjectCacheStats {
+    uint64_t shader_hit_count = 0;
+    uint64_t shader_miss_count = 0;
+    uint64_t pipeline_hit_count = 0;
+    uint64_t pipeline_miss_count = 0;
+};
+
+// Shader modules keyed by the hash of their SPIR-V code, and pipelines keyed
+// by their shaders, states and the compatibility of their render pass. Objects
+// are kept until the context is destroyed, so creating the same shaders and
+// pipelines again, e.g. for another view, only costs a lookup.
+class PipelineObjectCache {
+  public:
+    explicit PipelineObjectCache(Device *device);
+
+    ARS_NO_COPY_MOVE(PipelineObjectCache);
+
+    ~PipelineObjectCache() = default;
+
+    [[nodiscard]] std::shared_ptr<const ShaderModule>
+    get_shader_module(const char *name,
+                      const uint8_t *spirv_code,
+                      size_t code_size);
+
+    // Calls create to fill the objects on miss. An empty key means the state
+    // can't be keyed and the pipeline is never shared.
+    [[nodiscard]] std::shared_ptr<const PipelineObjects>
+    get_pipeline(ars::Span<const uint64_t> key,
+                 const std::function<void(PipelineObjects &)> &create);
+
+    // If disabled, every shader and pipeline is created from scratch
+    [[nodiscard]] bool enabled() const;
+    void set_enabled(bool enabled);
+
+    [[nodiscard]] PipelineObjectCacheStats stats() const;
+
+  private:
+    Device *_device = nullptr;
+    bool _enabled = true;
+
+    // Shaders and pipelines may be created on job workers
+    mutable std::mutex _mutex{};
+    std::unordered_map<uint64_t, std::vector<std::shared_ptr<ShaderModule>>>
+        _shader_modules{};
+    std::unordered_map<uint64_t, std::vector<std::shared_ptr<PipelineObjects>>>
+        _pipelines{};
+    PipelineObjectCacheStats _stats{};
 };
 
 class Pipeline {
@@ -99,29 +212,33 @@ class Pipeline {
 
     ARS_NO_COPY_MOVE(Pipeline);
 
-    ~Pipeline();
+    ~Pipeline() = default;
 
     [[nodiscard]] VkPipeline pipeline() const;
     [[nodiscard]] VkPipelineLayout pipeline_layout() const;
     [[nodiscard]] const PipelineLayoutInfo &pipeline_layout_info() const;
     [[nodiscard]] VkDescriptorSet alloc_desc_set(uint32_t set) const;
+    [[nodiscard]] VkDescriptorSetLayout descriptor_layout(uint32_t set) const;
+    [[nodiscard]] const DescriptorUpdateTemplate &
+    update_template(uint32_t set) const;
     [[nodiscard]] Context *context() const;
     [[nodiscard]] VkPipelineBindPoint bind_point() const;
+    // Unique in creation order, e.g. for sorting draws by pipeline. Pipelines
+    // sharing objects from the cache share the id.
+    [[nodiscard]] uint32_t id() const;
 
     void bind(CommandBuffer *cmd) const;
 
   protected:
-    void init_layout(const PipelineLayoutInfo &pipeline_layout_info,
+    void init_layout(PipelineObjects &objects,
+                     const PipelineLayoutInfo &pipeline_layout_info,
                      uint32_t push_constant_range_count,
                      const VkPushConstantRange *push_constant_ranges);
+    void init_update_templates(PipelineObjects &objects);
     void set_name(const std::string &name);
 
     Context *_context = nullptr;
-
-    std::array<VkDescriptorSetLayout, MAX_DESC_SET_COUNT> _descriptor_layouts{};
-    PipelineLayoutInfo _pipeline_layout_info{};
-    VkPipelineLayout _pipeline_layout = VK_NULL_HANDLE;
-    VkPipeline _pipeline = VK_NULL_HANDLE;
+    std::shared_ptr<const PipelineObjects> _objects{};
     VkPipelineBindPoint _bind_point = VK_PIPELINE_BIND_POINT_MAX_ENUM;
 };
 
@@ -162,7 +279,6 @@ class GraphicsPipeline : public Pipeline {
     GraphicsPipeline(Context *context, const GraphicsPipelineInfo &info);
 
   private:
-    void init_layout(const GraphicsPipelineInfo &info);
     void init_pipeline(const GraphicsPipelineInfo &info);
 };
 
@@ -189,7 +305,6 @@ class ComputePipeline : public Pipeline {
     [[nodiscard]] ShaderLocalSize local_size() const;
 
   private:
-    void init_layout(const ComputePipelineInfo &info);
     void init_pipeline(const ComputePipelineInfo &info);
 
     ShaderLocalSize _local_size{};
@@ -240,6 +355,11 @@ struct DescriptorEncoder {
                       uint32_t binding,
                       ars::Span<Handle<Texture>> textures);
 
+    // Sets are taken from the descriptor set cache of the context if the same
+    // resources were committed to the pipeline before, otherwise they are
+    // written with the update templates of the pipeline. Sets with bindings
+    // from set_buffer_data() get new buffer arena ranges every commit, so
+    // they are allocated from the descriptor arena of the frame instead.
     void commit(CommandBuffer *cmd, Pipeline *pipeline);
 
   private:
@@ -248,8 +368,10 @@ struct DescriptorEncoder {
         std::optional<uint32_t> level{};
     };
 
+    // Data is copied to the frame arena, and to the buffer arena of the context
+    // on commit
     struct BufferDataInfo {
-        std::unique_ptr<uint8_t[]> data{};
+        uint8_t *data = nullptr;
         size_t size{};
     };
 
@@ -260,7 +382,7 @@ struct DescriptorEncoder {
     };
 
     using BindingData =
-        std::variant<std::vector<ImageInfo>, BufferDataInfo, BufferInfo>;
+        std::variant<FrameVector<ImageInfo>, BufferDataInfo, BufferInfo>;
 
     struct BindingInfo {
         uint32_t set{};
@@ -271,7 +393,7 @@ struct DescriptorEncoder {
     void set_binding(uint32_t set, uint32_t binding, BindingData data);
 
     int _binding_indices[MAX_DESC_SET_COUNT][MAX_DESC_BINDING_COUNT]{};
-    std::vector<BindingInfo> _bindings;
+    FrameVector<BindingInfo> _bindings;
 };
 
 } // namespace ars::render::vk
\ No newline at end of file
@@ -4,6 +4,8 @@
 
 namespace ars::render::vk {
 constexpr uint32_t MAX_PROFILER_QUERY_COUNT_VK = 4000;
+constexpr uint32_t MAX_PROFILER_QUERY_COUNT_PER_FRAME_VK =
+    MAX_PROFILER_QUERY_COUNT_VK / MAX_FRAMES_IN_FLIGHT;
 
 Profiler::Profiler(Context *context)
     : _context(context),
@@ -58,17 +60,20 @@ void Profiler::end_sample(CommandBuffer *cmd) {
 }
 
 void Profiler::flush() {
-    if (_commands.empty()) {
+    auto &commands = _commands[_context->frame_index()];
+    if (commands.empty()) {
         return;
     }
 
+    auto first_query =
+        _context->frame_index() * MAX_PROFILER_QUERY_COUNT_PER_FRAME_VK;
     std::vector<uint64_t> time_stamps{};
-    time_stamps.resize(_commands.size());
+    time_stamps.resize(commands.size());
 
     auto device = _context->device();
     device->GetQueryPoolResults(_query_pool,
-                                0,
-                                _commands.size(),
+                                first_query,
+                                commands.size(),
                                 sizeof(uint64_t) * time_stamps.size(),
                                 time_stamps.data(),
                                 sizeof(uint64_t),
@@ -76,9 +81,9 @@ void Profiler::flush() {
                                     VK_QUERY_RESULT_WAIT_BIT);
     ARS_DEFER([&]() {
         _context->queue()->submit_once([&](CommandBuffer *cmd) {
-            cmd->ResetQueryPool(_query_pool, 0, _commands.size());
+            cmd->ResetQueryPool(_query_pool, first_query, commands.size());
         });
-        _commands.clear();
+        commands.clear();
     });
 
     int pending_count = 0;
@@ -88,8 +93,8 @@ void Profiler::flush() {
     auto get_time_ms = [&](uint64_t ts) {
         return delta_time_ms(frame_start_ts, ts) + frame_start_time_ms;
     };
-    for (int i = 0; i < _commands.size(); i++) {
-        auto &cmd = _commands[i];
+    for (int i = 0; i < commands.size(); i++) {
+        auto &cmd = commands[i];
         auto ts = time_stamps[i];
         auto time_ms = get_time_ms(ts);
         switch (cmd.type) {
@@ -144,15 +149,19 @@ float Profiler::delta_time_ms(uint64_t ts_from, uint64_t ts_to) const {
 
 Profiler::QueryCommand *
 Profiler::add_query_command(CommandBuffer *cmd, VkPipelineStageFlagBits stage) {
-    if (_commands.size() > MAX_PROFILER_QUERY_COUNT_VK) {
-        ARS_LOG_ERROR(
-            "Profiler sample count exceeds MAX_PROFILER_QUERY_COUNT_VK = {}",
-            MAX_PROFILER_QUERY_COUNT_VK);
+    auto &commands = _commands[_context->frame_index()];
+    if (commands.size() >= MAX_PROFILER_QUERY_COUNT_PER_FRAME_VK) {
+        ARS_LOG_ERROR("Profiler sample count exceeds "
+                      "MAX_PROFILER_QUERY_COUNT_PER_FRAME_VK = {}",
+                      MAX_PROFILER_QUERY_COUNT_PER_FRAME_VK);
         return nullptr;
     }
 
-    cmd->WriteTimestamp(stage, _query_pool, _commands.size());
-    _commands.emplace_back();
-    return &_commands.back();
+    auto query = _context->frame_index() *
+                     MAX_PROFILER_QUERY_COUNT_PER_FRAME_VK +
+                 static_cast<uint32_t>(commands.size());
+    cmd->WriteTimestamp(stage, _query_pool, query);
+    commands.emplace_back();
+    return &commands.back();
 }
 } // namespace ars::render::vk
\ No newline at end of file
@@ -2,6 +2,7 @@
 
 #include "Vulkan.h"
 #include <ars/runtime/core/Profiler.h>
+#include <array>
 #include <vector>
 
 namespace ars::render::vk {
@@ -19,6 +20,9 @@ class Profiler {
     void end_sample(CommandBuffer *cmd);
     void begin_frame();
 
+    // Read back samples of the current frame in flight, which were recorded
+    // MAX_FRAMES_IN_FLIGHT frames ago. Called after the context waits the
+    // frame.
     void flush();
 
   private:
@@ -47,7 +51,8 @@ class Profiler {
         float frame_start_time_ms{};
     };
 
-    std::vector<QueryCommand> _commands{};
+    // The query pool is split evenly between frames in flight
+    std::array<std::vector<QueryCommand>, MAX_FRAMES_IN_FLIGHT> _commands{};
 
     QueryCommand *add_query_command(CommandBuffer *cmd,
                                     VkPipelineStageFlagBits stage);
@@ -1,71 +1,101 @@
 #include "RenderGraph.h"
+#include "Buffer.h"
 #include "Context.h"
 #include "Profiler.h"
+#include <algorithm>
+#include <map>
+#include <type_traits>
 
 namespace ars::render::vk {
-void PassDependency::barrier(CommandBuffer *cmd,
-                             const std::vector<PassDependency> &src_deps,
-                             const std::vector<PassDependency> &dst_deps) {
-    std::vector<VkImageMemoryBarrier> barriers{};
-    barriers.reserve(src_deps.size() + dst_deps.size());
-
-    VkPipelineStageFlags src_stage_mask = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-    VkPipelineStageFlags dst_stage_mask = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
-
-    for (auto &dep : src_deps) {
-        assert(dep.texture.get() != nullptr);
-
-        src_stage_mask |= dep.stage_mask;
+namespace {
+bool same_image(const TextureCreateInfo &lhs, const TextureCreateInfo &rhs) {
+    return lhs.image_type == rhs.image_type &&
+           lhs.view_type == rhs.view_type && lhs.format == rhs.format &&
+           lhs.extent.width == rhs.extent.width &&
+           lhs.extent.height == rhs.extent.height &&
+           lhs.extent.depth == rhs.extent.depth &&
+           lhs.mip_levels == rhs.mip_levels &&
+           lhs.array_layers == rhs.array_layers &&
+           lhs.samples == rhs.samples && lhs.usage == rhs.usage;
+}
 
-        VkImageMemoryBarrier b{VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER};
-        b.subresourceRange = dep.texture->subresource_range();
-        b.srcAccessMask = dep.access_mask;
-        b.dstAccessMask = 0;
+bool same_texture(const TextureCreateInfo &lhs, const TextureCreateInfo &rhs) {
+    return same_image(lhs, rhs) && lhs.name == rhs.name &&
+           lhs.aspect_mask == rhs.aspect_mask &&
+           lhs.min_filter == rhs.min_filter &&
+           lhs.mag_filter == rhs.mag_filter &&
+           lhs.mipmap_mode == rhs.mipmap_mode &&
+           lhs.address_mode_u == rhs.address_mode_u &&
+           lhs.address_mode_v == rhs.address_mode_v &&
+           lhs.address_mode_w == rhs.address_mode_w;
+}
 
-        // Maybe we should ignore dep.layout for src?
-        assert(dep.layout == dep.texture->layout());
+VkDeviceSize align_up(VkDeviceSize value, VkDeviceSize alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
 
-        // If there is only src dependency, do not change image layout
-        b.oldLayout = dep.layout;
-        b.newLayout = dep.layout;
-        b.image = dep.texture->image();
+// FNV-1a hash of render graph declarations
+struct DeclarationHasher {
+    uint64_t value = 0xcbf29ce484222325ull;
 
-        barriers.push_back(b);
+    void add_bytes(const void *data, size_t size) {
+        auto bytes = reinterpret_cast<const uint8_t *>(data);
+        for (size_t i = 0; i < size; i++) {
+            value = (value ^ bytes[i]) * 0x100000001b3ull;
+        }
     }
 
-    auto find_src_barrier =
-        [&](const PassDependency &dep) -> VkImageMemoryBarrier * {
-        assert(dep.texture.get() != nullptr);
+    template <typename T> void add(const T &v) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        add_bytes(&v, sizeof(T));
+    }
 
-        for (auto &b : barriers) {
-            if (b.image == dep.texture->image()) {
-                return &b;
-            }
-        }
-        return nullptr;
-    };
+    void add(const std::string &str) {
+        add(str.size());
+        add_bytes(str.data(), str.size());
+    }
 
-    for (auto &dep : dst_deps) {
-        dst_stage_mask |= dep.stage_mask;
+    void add(const TextureCreateInfo &info) {
+        add(info.name);
+        add(info.image_type);
+        add(info.view_type);
+        add(info.format);
+        add(info.extent.width);
+        add(info.extent.height);
+        add(info.extent.depth);
+        add(info.mip_levels);
+        add(info.array_layers);
+        add(info.samples);
+        add(info.usage);
+        add(info.aspect_mask);
+        add(info.min_filter);
+        add(info.mag_filter);
+        add(info.mipmap_mode);
+        add(info.address_mode_u);
+        add(info.address_mode_v);
+        add(info.address_mode_w);
+    }
+};
 
-        auto src_barrier = find_src_barrier(dep);
-        if (src_barrier != nullptr) {
-            auto &b = *src_barrier;
-            b.dstAccessMask = dep.access_mask;
-            b.newLayout = dep.layout;
-        } else {
-            VkImageMemoryBarrier b{VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER};
-            b.subresourceRange = dep.texture->subresource_range();
-            b.srcAccessMask = 0;
-            b.dstAccessMask = dep.access_mask;
-            b.oldLayout = dep.texture->layout();
-            b.newLayout = dep.layout;
-            b.image = dep.texture->image();
+// Stages a compute only queue supports
+constexpr VkPipelineStageFlags COMPUTE_QUEUE_STAGE_MASK =
+    VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT | VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT |
+    VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT |
+    VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT | VK_PIPELINE_STAGE_HOST_BIT |
+    VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
 
-            barriers.push_back(b);
-        }
+void record_barriers(CommandBuffer *cmd,
+                     VkPipelineStageFlags src_stage_mask,
+                     VkPipelineStageFlags dst_stage_mask,
+                     const std::vector<VkImageMemoryBarrier> &barriers,
+                     const std::vector<Texture *> &textures,
+                     bool update_layout) {
+    if (barriers.empty()) {
+        return;
+    }
+    for (size_t i = 0; i < barriers.size(); i++) {
+        assert(barriers[i].oldLayout == textures[i]->layout());
     }
-
     cmd->PipelineBarrier(src_stage_mask,
                          dst_stage_mask,
                          0,
@@ -75,50 +105,235 @@ void PassDependency::barrier(CommandBuffer *cmd,
                          nullptr,
                          static_cast<uint32_t>(barriers.size()),
                          barriers.data());
-
-    for (auto &dep : dst_deps) {
-        dep.texture->assure_layout(dep.layout);
+    if (update_layout) {
+        for (size_t i = 0; i < barriers.size(); i++) {
+            textures[i]->assure_layout(barriers[i].newLayout);
+        }
     }
 }
+} // namespace
 
 void RenderGraph::execute() {
-    _view->context()->queue()->submit_once([&](CommandBuffer *cmd) {
-        ARS_PROFILER_SAMPLE_VK(cmd, "Render Graph Execute", 0xFF772183);
-        RenderGraphPass *last_pass = nullptr;
-        for (auto &pass_info : _passes) {
-            if (!pass_info.active) {
-                continue;
+    auto ctx = _view->context();
+    auto &batches = _compiled->batches;
+    // Semaphores signaled by batches
+    FrameVector<VkSemaphore> semaphores(batches.size(), VK_NULL_HANDLE);
+    for (size_t i = 0; i < batches.size(); i++) {
+        auto &batch = batches[i];
+        auto queue = batch.queue == QueueType_AsyncCompute
+                         ? ctx->compute_queue()
+                         : ctx->queue();
+
+        uint32_t wait_count = 0;
+        VkSemaphore wait_semaphore = VK_NULL_HANDLE;
+        if (batch.wait_batch >= 0) {
+            wait_semaphore = semaphores[batch.wait_batch];
+            wait_count = 1;
+        }
+        uint32_t signal_count = 0;
+        if (batch.signal) {
+            semaphores[i] = ctx->acquire_semaphore();
+            signal_count = 1;
+        }
+
+        queue->submit_once([&](CommandBuffer *cmd) { record_batch(cmd, i); },
+                           wait_count,
+                           &wait_semaphore,
+                           signal_count,
+                           &semaphores[i]);
+    }
+}
+
+void RenderGraph::record_batch(CommandBuffer *cmd, size_t batch_index) {
+    auto &batches = _compiled->batches;
+    auto &batch = batches[batch_index];
+    ARS_PROFILER_SAMPLE_VK(cmd,
+                           batch.queue == QueueType_AsyncCompute
+                               ? "Render Graph Async Compute"
+                               : "Render Graph Execute",
+                           0xFF772183);
+    for (auto p = batch.pass_begin; p < batch.pass_end; p++) {
+        auto &pass_info = _compiled->passes[p];
+        if (!pass_info.active) {
+            continue;
+        }
+
+        auto &image_barriers = pass_info.image_barriers;
+        auto &buffer_barriers = pass_info.buffer_barriers;
+        // Writes to aliased memory must finish before it is reused
+        VkMemoryBarrier alias_barrier{VK_STRUCTURE_TYPE_MEMORY_BARRIER};
+        alias_barrier.srcAccessMask = pass_info.alias_access_mask;
+        alias_barrier.dstAccessMask =
+            VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+        uint32_t memory_barrier_count =
+            pass_info.alias_access_mask != 0 ? 1 : 0;
+
+        if (!image_barriers.empty() || !buffer_barriers.empty() ||
+            memory_barrier_count != 0) {
+            for (size_t i = 0; i < image_barriers.size(); i++) {
+                assert(image_barriers[i].oldLayout ==
+                       pass_info.barrier_textures[i]->layout());
             }
-            auto cur_pass = &pass_info.pass;
-            // TODO optimize barrier
-            if (last_pass) {
-                PassDependency::barrier(cmd,
-                                        last_pass->dst_dependencies(),
-                                        cur_pass->src_dependencies());
-            } else {
-                // Perform layout transformation for those uninitialized write
-                // deps
-                PassDependency::barrier(cmd, {}, cur_pass->src_dependencies());
+            cmd->PipelineBarrier(pass_info.src_stage_mask,
+                                 pass_info.dst_stage_mask,
+                                 0,
+                                 memory_barrier_count,
+                                 &alias_barrier,
+                                 static_cast<uint32_t>(buffer_barriers.size()),
+                                 buffer_barriers.data(),
+                                 static_cast<uint32_t>(image_barriers.size()),
+                                 image_barriers.data());
+            for (size_t i = 0; i < image_barriers.size(); i++) {
+                pass_info.barrier_textures[i]->assure_layout(
+                    image_barriers[i].newLayout);
             }
-            cur_pass->execute(cmd);
-            last_pass = cur_pass;
         }
-    });
+
+        _passes[p].execute(cmd);
+    }
+
+    // Layouts are updated by the matching acquire barriers
+    record_barriers(cmd,
+                    batch.release_stage_mask,
+                    VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                    batch.release_barriers,
+                    batch.release_textures,
+                    false);
+
+    if (batch_index + 1 != batches.size()) {
+        return;
+    }
+
+    record_barriers(cmd,
+                    _compiled->join_stage_mask,
+                    VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+                    _compiled->join_barriers,
+                    _compiled->join_textures,
+                    true);
+
+    if (_compiled->read_back_stage_mask != 0) {
+        VkMemoryBarrier barrier{VK_STRUCTURE_TYPE_MEMORY_BARRIER};
+        barrier.srcAccessMask = _compiled->read_back_access_mask;
+        barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+        cmd->PipelineBarrier(_compiled->read_back_stage_mask,
+                             VK_PIPELINE_STAGE_HOST_BIT,
+                             0,
+                             1,
+                             &barrier,
+                             0,
+                             nullptr,
+                             0,
+                             nullptr);
+    }
 }
 
 void RenderGraph::compile() {
     ARS_PROFILER_SAMPLE("Render Graph Compile", 0xFF125512);
 
+    bool found = false;
+    _compiled = _view->render_graph_cache()->acquire(hash_declarations(),
+                                                     &found);
+    if (found) {
+        // Contents of aliased memory are undefined when lifetimes begin
+        for (auto &tex : _compiled->transient_textures) {
+            if (tex.get() != nullptr) {
+                tex->assure_layout(VK_IMAGE_LAYOUT_UNDEFINED);
+            }
+        }
+        return;
+    }
+
+    _compiled->passes.resize(_passes.size());
+    cull_passes();
+    schedule_queues();
+    alloc_transients();
+    build_barriers();
+}
+
+uint64_t RenderGraph::hash_declarations() const {
+    DeclarationHasher h{};
+    h.add(_view->context()->compute_queue() != nullptr);
+
+    // Barriers depend on initial layouts of textures
+    auto add_texture = [&](Texture *tex) {
+        h.add(tex);
+        if (tex != nullptr) {
+            h.add(tex->image());
+            h.add(tex->layout());
+            h.add(tex->info());
+        }
+    };
+
+    h.add(_transients.size());
+    for (auto &t : _transients) {
+        h.add(t.info);
+    }
+
+    h.add(_passes.size());
+    for (auto &pass : _passes) {
+        h.add(pass.has_side_effect);
+        h.add(pass.async_compute);
+        h.add(pass.dependencies.size());
+        for (auto &d : pass.dependencies) {
+            if (d.transient.valid()) {
+                h.add(d.transient.index);
+            } else if (d.buffer.get() != nullptr) {
+                h.add(d.buffer.get());
+                h.add(d.buffer->buffer());
+            } else {
+                add_texture(d.texture.get());
+            }
+            h.add(d.access_mask);
+            h.add(d.layout);
+            h.add(d.stage_mask);
+            h.add(d.full_rewrite);
+        }
+    }
+
+    auto rt_manager = _view->rt_manager();
+    h.add(_output_rts.size());
+    for (auto rt : _output_rts) {
+        add_texture(rt_manager->get(rt).get());
+    }
+    h.add(_output_buffers.size());
+    for (auto &buffer : _output_buffers) {
+        h.add(buffer.get());
+    }
+    h.add(_read_back_buffers.size());
+    for (auto &buffer : _read_back_buffers) {
+        h.add(buffer.get());
+    }
+    return h.value;
+}
+
+void RenderGraph::cull_passes() {
+    // Transients have no texture before compiling
+    auto resource = [&](const PassDependency &d) -> const void * {
+        if (d.transient.valid()) {
+            return &_transients[d.transient.index];
+        }
+        if (d.buffer.get() != nullptr) {
+            return d.buffer.get();
+        }
+        return d.texture.get();
+    };
+
     // Culling
-    std::set<Texture *> alive{};
+    std::set<const void *, std::less<>, ArenaAllocator<const void *>> alive{};
     auto rt_manager = _view->rt_manager();
     for (auto rt : _output_rts) {
         alive.insert(rt_manager->get(rt).get());
     }
+    for (auto &buffer : _output_buffers) {
+        alive.insert(buffer.get());
+    }
+    for (auto &buffer : _read_back_buffers) {
+        alive.insert(buffer.get());
+    }
 
     for (int i = static_cast<int>(_passes.size()) - 1; i >= 0; i--) {
-        auto &info = _passes[i];
-        auto &pass = info.pass;
+        auto &info = _compiled->passes[i];
+        auto &pass = _passes[i];
 
         info.active = false;
         if (pass.has_side_effect) {
@@ -130,7 +345,7 @@ void RenderGraph::compile() {
             if (!(d.access_mask & VULKAN_ACCESS_WRITE_MASK)) {
                 continue;
             }
-            auto it = alive.find(d.texture.get());
+            auto it = alive.find(resource(d));
             if (it != alive.end()) {
                 info.active = true;
                 if (d.full_rewrite) {
@@ -144,18 +359,602 @@ void RenderGraph::compile() {
                 if (!(d.access_mask & VULKAN_ACCESS_READ_MASK)) {
                     continue;
                 }
-                alive.insert(d.texture.get());
+                alive.insert(resource(d));
+            }
+        }
+    }
+}
+
+void RenderGraph::schedule_queues() {
+    auto &batches = _compiled->batches;
+    auto has_compute_queue = _view->context()->compute_queue() != nullptr;
+
+    for (size_t i = 0; i < _passes.size(); i++) {
+        auto &info = _compiled->passes[i];
+        auto &pass = _passes[i];
+        if (!info.active) {
+            continue;
+        }
+
+        if (pass.async_compute) {
+            for (auto &d : pass.dependencies) {
+                assert((d.stage_mask & ~COMPUTE_QUEUE_STAGE_MASK) == 0);
+            }
+        }
+
+        // Fallback to the graphics queue if the device has only one family
+        info.queue = has_compute_queue && pass.async_compute
+                         ? QueueType_AsyncCompute
+                         : QueueType_Graphics;
+
+        if (batches.empty() && info.queue != QueueType_Graphics) {
+            // Async compute waits for graphics work submitted before the graph
+            // through an empty graphics batch
+            auto &first = batches.emplace_back();
+            first.pass_begin = i;
+            first.pass_end = i;
+        }
+        if (batches.empty() || batches.back().queue != info.queue) {
+            auto &batch = batches.emplace_back();
+            batch.queue = info.queue;
+            batch.pass_begin = i;
+        }
+        info.batch = static_cast<int32_t>(batches.size()) - 1;
+        batches.back().pass_end = i + 1;
+    }
+
+    // Read back barriers are recorded even if no pass is active
+    if (batches.empty()) {
+        batches.emplace_back();
+    }
+}
+
+void RenderGraph::add_queue_dependency(int32_t batch, int32_t wait_batch) {
+    auto &batches = _compiled->batches;
+    auto &b = batches[batch];
+    // Batches on the same queue are executed in order
+    if (wait_batch < 0 || batches[wait_batch].queue == b.queue) {
+        return;
+    }
+
+    assert(wait_batch < batch);
+    auto &waited = _waited_batches[b.queue];
+    if (wait_batch <= waited) {
+        return;
+    }
+    waited = wait_batch;
+    b.wait_batch = std::max(b.wait_batch, wait_batch);
+}
+
+void RenderGraph::build_barriers() {
+    auto &batches = _compiled->batches;
+    auto &stats = _compiled->barrier_stats;
+    std::fill(std::begin(_waited_batches), std::end(_waited_batches), -1);
+
+    auto ctx = _view->context();
+    auto family_index = [&](QueueType queue) {
+        return queue == QueueType_AsyncCompute
+                   ? ctx->compute_queue()->family_index()
+                   : ctx->queue()->family_index();
+    };
+
+    using StateAllocator =
+        ArenaAllocator<std::pair<const void *const, ResourceState>>;
+    std::map<const void *, ResourceState, std::less<>, StateAllocator>
+        states{};
+    FrameVector<PassDependency> deps{};
+
+    auto resource = [](const PassDependency &d) -> const void * {
+        if (d.buffer.get() != nullptr) {
+            return d.buffer.get();
+        }
+        assert(d.texture.get() != nullptr);
+        return d.texture.get();
+    };
+
+    for (size_t i = 0; i < _passes.size(); i++) {
+        auto &info = _compiled->passes[i];
+        if (!info.active) {
+            continue;
+        }
+
+        auto queue = info.queue;
+        auto batch = info.batch;
+        if (queue == QueueType_AsyncCompute) {
+            stats.async_compute_pass_count++;
+            // Previous frames may still use resources on the graphics queue
+            add_queue_dependency(batch, 0);
+
+            // Graphics stages of previous users of aliased memory are not
+            // supported by the compute queue
+            if (info.alias_access_mask != 0) {
+                info.alias_stage_mask = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+                info.alias_access_mask = VK_ACCESS_MEMORY_WRITE_BIT;
+            }
+        }
+        if (info.alias_wait_pass >= 0) {
+            add_queue_dependency(
+                batch, _compiled->passes[info.alias_wait_pass].batch);
+        }
+
+        // Merge accesses to the same resource, so each resource gets at most
+        // one barrier per pass
+        deps.clear();
+        for (auto &d : _passes[i].dependencies) {
+            auto it = std::find_if(deps.begin(), deps.end(), [&](auto &m) {
+                return resource(m) == resource(d);
+            });
+            if (it == deps.end()) {
+                deps.push_back(d);
+            } else {
+                assert(it->layout == d.layout);
+                it->access_mask |= d.access_mask;
+                it->stage_mask |= d.stage_mask;
+            }
+        }
+
+        stats.naive_pipeline_barrier_count++;
+        for (auto &d : deps) {
+            if (d.buffer.get() != nullptr) {
+                stats.naive_buffer_barrier_count++;
+            } else {
+                stats.naive_image_barrier_count++;
+            }
+        }
+
+        info.src_stage_mask = info.alias_stage_mask;
+        for (auto &d : deps) {
+            auto tex = d.texture.get();
+            auto buffer = d.buffer.get();
+            auto it = states.find(resource(d));
+            if (it == states.end()) {
+                ResourceState init{};
+                init.texture = tex;
+                init.transient = d.transient.valid();
+                if (tex != nullptr) {
+                    init.layout = tex->layout();
+                }
+                // Previous frames may still be accessing persistent resources,
+                // and submissions are not chained, so the first access waits
+                // for everything before. Transients are synchronized by
+                // aliasing, and contents of undefined textures are discarded.
+                if (!init.transient &&
+                    (tex == nullptr ||
+                     init.layout != VK_IMAGE_LAYOUT_UNDEFINED)) {
+                    init.write_stage_mask = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+                    init.write_access_mask = VK_ACCESS_MEMORY_WRITE_BIT;
+                }
+                it = states.emplace(resource(d), init).first;
+            }
+            auto &state = it->second;
+
+            if (state.queue != queue) {
+                // Resources not used by the graph yet are owned by the
+                // graphics queue, whose first batch runs before any async
+                // compute batch
+                auto release_batch = std::max(state.batch, 0);
+                add_queue_dependency(batch, release_batch);
+
+                // Buffers are shared by queues, and contents of undefined
+                // textures need not be preserved. Other textures are
+                // released by the previous queue and acquired by this one.
+                if (tex != nullptr &&
+                    state.layout != VK_IMAGE_LAYOUT_UNDEFINED) {
+                    VkImageMemoryBarrier b{
+                        VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER};
+                    b.subresourceRange = tex->subresource_range();
+                    b.srcAccessMask = state.write_access_mask;
+                    b.oldLayout = state.layout;
+                    b.newLayout = d.layout;
+                    b.srcQueueFamilyIndex = family_index(state.queue);
+                    b.dstQueueFamilyIndex = family_index(queue);
+                    b.image = tex->image();
+
+                    auto &release = batches[release_batch];
+                    auto release_stage_mask =
+                        state.write_stage_mask | state.read_stage_mask;
+                    release.release_stage_mask |=
+                        release_stage_mask != 0
+                            ? release_stage_mask
+                            : static_cast<VkPipelineStageFlags>(
+                                  VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT);
+                    release.release_barriers.push_back(b);
+                    release.release_textures.push_back(tex);
+
+                    b.srcAccessMask = 0;
+                    b.dstAccessMask = d.access_mask;
+                    info.image_barriers.push_back(b);
+                    info.barrier_textures.push_back(tex);
+                    info.src_stage_mask |= d.stage_mask;
+                    info.dst_stage_mask |= d.stage_mask;
+                    state.layout = d.layout;
+                    stats.ownership_transfer_count++;
+                }
+
+                // Previous accesses are finished and visible after waiting for
+                // the semaphore
+                state.queue = queue;
+                state.write_stage_mask = 0;
+                state.write_access_mask = 0;
+                state.read_stage_mask = 0;
+                state.visible_stage_mask = 0;
+                state.visible_access_mask = 0;
+            }
+
+            auto writes = (d.access_mask & VULKAN_ACCESS_WRITE_MASK) != 0;
+            auto transition = tex != nullptr && state.layout != d.layout;
+
+            bool need_barrier = false;
+            VkPipelineStageFlags src_stage_mask = 0;
+            VkAccessFlags src_access_mask = 0;
+            if (writes || transition) {
+                // Writes and layout transitions wait for all previous accesses
+                src_stage_mask =
+                    state.write_stage_mask | state.read_stage_mask;
+                src_access_mask = state.write_access_mask;
+                need_barrier = transition || src_stage_mask != 0;
+            } else if (state.write_stage_mask != 0 &&
+                       ((d.stage_mask & ~state.visible_stage_mask) != 0 ||
+                        (d.access_mask & ~state.visible_access_mask) != 0)) {
+                // Reads wait for the last write if it is not visible yet.
+                // Reads after reads need no barrier.
+                src_stage_mask = state.write_stage_mask;
+                src_access_mask = state.write_access_mask;
+                need_barrier = true;
+            }
+
+            if (need_barrier && buffer != nullptr) {
+                VkBufferMemoryBarrier b{
+                    VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER};
+                b.srcAccessMask = src_access_mask;
+                b.dstAccessMask = d.access_mask;
+                b.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                b.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                b.buffer = buffer->buffer();
+                b.offset = 0;
+                b.size = VK_WHOLE_SIZE;
+                info.buffer_barriers.push_back(b);
+            } else if (need_barrier) {
+                VkImageMemoryBarrier b{VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER};
+                b.subresourceRange = tex->subresource_range();
+                b.srcAccessMask = src_access_mask;
+                b.dstAccessMask = d.access_mask;
+                b.oldLayout = state.layout;
+                b.newLayout = d.layout;
+                b.image = tex->image();
+                info.image_barriers.push_back(b);
+                info.barrier_textures.push_back(tex);
+            }
+
+            if (need_barrier) {
+                info.src_stage_mask |= src_stage_mask;
+                info.dst_stage_mask |= d.stage_mask;
+            }
+
+            if (writes) {
+                state.host_stage_mask = d.stage_mask;
+                state.host_access_mask =
+                    d.access_mask & VULKAN_ACCESS_WRITE_MASK;
+            }
+            if (writes || transition) {
+                state.write_stage_mask = d.stage_mask;
+                state.write_access_mask =
+                    d.access_mask & VULKAN_ACCESS_WRITE_MASK;
+                // A layout transition is visible to the pass performing it
+                state.read_stage_mask = writes ? 0 : d.stage_mask;
+                state.visible_stage_mask = writes ? 0 : d.stage_mask;
+                state.visible_access_mask = writes ? 0 : d.access_mask;
+            } else {
+                state.read_stage_mask |= d.stage_mask;
+                if (need_barrier) {
+                    state.visible_stage_mask |= d.stage_mask;
+                    state.visible_access_mask |= d.access_mask;
+                }
+            }
+            state.layout = d.layout;
+            state.batch = batch;
+        }
+
+        if (info.src_stage_mask == 0) {
+            info.src_stage_mask = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+        }
+        if (info.dst_stage_mask == 0) {
+            info.dst_stage_mask = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+        }
+
+        if (!info.image_barriers.empty() || !info.buffer_barriers.empty() ||
+            info.alias_access_mask != 0) {
+            stats.pipeline_barrier_count++;
+            stats.image_barrier_count +=
+                static_cast<uint32_t>(info.image_barriers.size());
+            stats.buffer_barrier_count +=
+                static_cast<uint32_t>(info.buffer_barriers.size());
+        }
+    }
+
+    // Only the graphics queue signals the frame fence, so it waits for all
+    // async compute work at the end of the graph. Textures are returned to
+    // the graphics queue, except transients, whose contents are discarded.
+    int32_t last_compute_batch = -1;
+    for (int32_t i = 0; i < static_cast<int32_t>(batches.size()); i++) {
+        if (batches[i].queue == QueueType_AsyncCompute) {
+            last_compute_batch = i;
+        }
+    }
+    if (last_compute_batch >= 0 &&
+        _waited_batches[QueueType_Graphics] < last_compute_batch) {
+        auto &join = batches.emplace_back();
+        join.pass_begin = _passes.size();
+        join.pass_end = _passes.size();
+        add_queue_dependency(static_cast<int32_t>(batches.size()) - 1,
+                             last_compute_batch);
+    }
+    for (auto &[res, state] : states) {
+        if (state.queue == QueueType_Graphics || state.texture == nullptr ||
+            state.transient || state.layout == VK_IMAGE_LAYOUT_UNDEFINED) {
+            continue;
+        }
+
+        auto tex = state.texture;
+        VkImageMemoryBarrier b{VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER};
+        b.subresourceRange = tex->subresource_range();
+        b.srcAccessMask = state.write_access_mask;
+        b.oldLayout = state.layout;
+        b.newLayout = state.layout;
+        b.srcQueueFamilyIndex = family_index(QueueType_AsyncCompute);
+        b.dstQueueFamilyIndex = family_index(QueueType_Graphics);
+        b.image = tex->image();
+
+        auto &release = batches[state.batch];
+        auto release_stage_mask =
+            state.write_stage_mask | state.read_stage_mask;
+        release.release_stage_mask |=
+            release_stage_mask != 0 ? release_stage_mask
+                                    : static_cast<VkPipelineStageFlags>(
+                                          VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT);
+        release.release_barriers.push_back(b);
+        release.release_textures.push_back(tex);
+
+        b.srcAccessMask = 0;
+        b.dstAccessMask =
+            VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+        _compiled->join_barriers.push_back(b);
+        _compiled->join_textures.push_back(tex);
+        _compiled->join_stage_mask = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+        stats.ownership_transfer_count++;
+    }
+
+    // Host reads happen after the graph, wait for the last writes
+    for (auto &buffer : _read_back_buffers) {
+        auto it = states.find(buffer.get());
+        if (it != states.end()) {
+            _compiled->read_back_stage_mask |= it->second.host_stage_mask;
+            _compiled->read_back_access_mask |= it->second.host_access_mask;
+        }
+    }
+
+    for (auto &b : batches) {
+        if (b.wait_batch >= 0) {
+            batches[b.wait_batch].signal = true;
+        }
+        if (!b.release_barriers.empty()) {
+            stats.pipeline_barrier_count++;
+        }
+    }
+    if (!_compiled->join_barriers.empty()) {
+        stats.pipeline_barrier_count++;
+    }
+    if (_compiled->read_back_stage_mask != 0) {
+        stats.pipeline_barrier_count++;
+    }
+    stats.queue_submit_count = static_cast<uint32_t>(batches.size());
+}
+
+void RenderGraph::alloc_transients() {
+    auto &stats = _compiled->transient_stats;
+    _compiled->transient_textures.resize(_transients.size());
+    if (_transients.empty()) {
+        return;
+    }
+
+    // Lifetimes of transients span from their first to last active users
+    auto pass_count = static_cast<int32_t>(_passes.size());
+    for (int32_t i = 0; i < pass_count; i++) {
+        if (!_compiled->passes[i].active) {
+            continue;
+        }
+        for (auto &d : _passes[i].dependencies) {
+            if (!d.transient.valid()) {
+                continue;
+            }
+            auto &t = _transients[d.transient.index];
+            if (t.first_pass < 0) {
+                t.first_pass = i;
+            }
+            t.last_pass = i;
+            t.stage_mask |= d.stage_mask;
+            t.access_mask |= d.access_mask;
+        }
+    }
+
+    auto pool = _view->transient_pool();
+    FrameVector<TransientInfo *> live{};
+    for (auto &t : _transients) {
+        if (t.first_pass < 0) {
+            continue;
+        }
+        t.requirements = pool->memory_requirements(t.info);
+        live.push_back(&t);
+        stats.texture_count++;
+        stats.unaliased_size += t.requirements.size;
+    }
+
+    auto overlap_in_time = [](const TransientInfo *lhs,
+                              const TransientInfo *rhs) {
+        return lhs->first_pass <= rhs->last_pass &&
+               rhs->first_pass <= lhs->last_pass;
+    };
+
+    // Group transients by memory types, place larger ones first
+    std::sort(live.begin(), live.end(), [](auto lhs, auto rhs) {
+        auto &l = lhs->requirements;
+        auto &r = rhs->requirements;
+        if (l.memoryTypeBits != r.memoryTypeBits) {
+            return l.memoryTypeBits < r.memoryTypeBits;
+        }
+        if (l.size != r.size) {
+            return l.size > r.size;
+        }
+        return lhs->first_pass < rhs->first_pass;
+    });
+
+    using Range = std::pair<VkDeviceSize, VkDeviceSize>;
+    FrameVector<Range> occupied{};
+    size_t group_begin = 0;
+    while (group_begin < live.size()) {
+        auto memory_type_bits = live[group_begin]->requirements.memoryTypeBits;
+        auto group_end = group_begin;
+        VkDeviceSize group_size = 0;
+        VkDeviceSize group_alignment = 1;
+
+        // Each transient takes the lowest offset not used by placed transients
+        // alive at the same time
+        for (; group_end < live.size() &&
+               live[group_end]->requirements.memoryTypeBits == memory_type_bits;
+             group_end++) {
+            auto t = live[group_end];
+            occupied.clear();
+            for (auto k = group_begin; k < group_end; k++) {
+                auto placed = live[k];
+                if (overlap_in_time(t, placed)) {
+                    occupied.emplace_back(placed->offset,
+                                          placed->offset +
+                                              placed->requirements.size);
+                }
+            }
+            std::sort(occupied.begin(), occupied.end());
+
+            auto size = t->requirements.size;
+            auto alignment = std::max<VkDeviceSize>(
+                t->requirements.alignment, 1);
+            VkDeviceSize offset = 0;
+            for (auto &[begin, end] : occupied) {
+                if (offset + size <= begin) {
+                    break;
+                }
+                offset = std::max(offset, align_up(end, alignment));
+            }
+            t->offset = offset;
+            group_size = std::max(group_size, offset + size);
+            group_alignment = std::max(group_alignment, alignment);
+        }
+
+        auto memory =
+            pool->memory(memory_type_bits, group_size, group_alignment);
+        for (auto k = group_begin; k < group_end; k++) {
+            auto t = live[k];
+            t->texture = pool->texture(t->info, memory, t->offset);
+            // Contents of aliased memory are undefined when the lifetime
+            // begins
+            t->texture->assure_layout(VK_IMAGE_LAYOUT_UNDEFINED);
+        }
+
+        // The first users of memory wait for previous users in this frame. If
+        // no previous user covers the whole range, wait for everything
+        // submitted before, as previous frames may still use the memory.
+        for (auto k = group_begin; k < group_end; k++) {
+            auto t = live[k];
+            auto &pass = _compiled->passes[t->first_pass];
+            auto begin = t->offset;
+            auto end = t->offset + t->requirements.size;
+
+            occupied.clear();
+            for (auto j = group_begin; j < group_end; j++) {
+                auto prev = live[j];
+                auto prev_begin = prev->offset;
+                auto prev_end = prev->offset + prev->requirements.size;
+                if (prev->last_pass < t->first_pass && prev_begin < end &&
+                    begin < prev_end) {
+                    occupied.emplace_back(prev_begin, prev_end);
+                    pass.alias_stage_mask |= prev->stage_mask;
+                    pass.alias_access_mask |=
+                        prev->access_mask & VULKAN_ACCESS_WRITE_MASK;
+                    if (_compiled->passes[prev->last_pass].queue !=
+                        pass.queue) {
+                        pass.alias_wait_pass =
+                            std::max(pass.alias_wait_pass, prev->last_pass);
+                    }
+                }
+            }
+            std::sort(occupied.begin(), occupied.end());
+
+            auto covered = begin;
+            for (auto &[prev_begin, prev_end] : occupied) {
+                if (prev_begin > covered) {
+                    break;
+                }
+                covered = std::max(covered, prev_end);
+            }
+            if (covered < end) {
+                pass.alias_stage_mask |= VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+                pass.alias_access_mask |= VK_ACCESS_MEMORY_WRITE_BIT;
+            }
+        }
+
+        stats.aliased_size += group_size;
+        group_begin = group_end;
+    }
+
+    pool->collect_unused();
+
+    for (size_t i = 0; i < _transients.size(); i++) {
+        _compiled->transient_textures[i] = _transients[i].texture;
+    }
+    for (auto &pass : _passes) {
+        for (auto &d : pass.dependencies) {
+            if (d.transient.valid()) {
+                d.texture = _transients[d.transient.index].texture;
             }
         }
     }
-    // TODO virtual resource management, automatic scheduling
+}
+
+TransientTextureId RenderGraph::create_transient(const TextureCreateInfo &info,
+                                                 float scale) {
+    auto size = _view->size();
+    auto scale_value = [&](uint32_t v) {
+        return std::max(static_cast<uint32_t>(static_cast<float>(v) * scale),
+                        1u);
+    };
+
+    TransientInfo t{};
+    t.info = info;
+    t.info.extent = {scale_value(size.width), scale_value(size.height), 1};
+
+    TransientTextureId id{};
+    id.index = static_cast<uint32_t>(_transients.size());
+    _transients.emplace_back(std::move(t));
+    return id;
+}
+
+Handle<Texture> RenderGraph::texture(TransientTextureId id) const {
+    assert(id.valid());
+    return _compiled->transient_textures[id.index];
+}
+
+TransientMemoryStats RenderGraph::transient_stats() const {
+    return _compiled->transient_stats;
+}
+
+BarrierStats RenderGraph::barrier_stats() const {
+    return _compiled->barrier_stats;
 }
 
 RenderGraph::RenderGraph(View *view) : _view(view) {}
 
 RenderGraphPass *RenderGraph::alloc_pass() {
     _passes.emplace_back();
-    return &_passes.back().pass;
+    return &_passes.back();
 }
 
 void RenderGraph::output(RenderTargetId id) {
@@ -166,18 +965,26 @@ void RenderGraph::output(NamedRT rt) {
     output(_view->rt_id(rt));
 }
 
+void RenderGraph::output(const Handle<Buffer> &buffer) {
+    _output_buffers.push_back(buffer);
+}
+
+void RenderGraph::read_back(const Handle<Buffer> &buffer) {
+    _read_back_buffers.push_back(buffer);
+}
+
 View *RenderGraph::view() const {
     return _view;
 }
 
-std::vector<PassDependency> RenderGraphPass::src_dependencies() const {
+FrameVector<PassDependency> RenderGraphPass::src_dependencies() const {
     return dependencies;
 }
 
-std::vector<PassDependency> RenderGraphPass::dst_dependencies() const {
-    std::vector<PassDependency> deps{};
+FrameVector<PassDependency> RenderGraphPass::dst_dependencies() const {
+    FrameVector<PassDependency> deps{};
     deps.reserve(dependencies.size());
-    for (auto &d : deps) {
+    for (auto &d : dependencies) {
         if (d.access_mask & VULKAN_ACCESS_WRITE_MASK) {
             deps.push_back(d);
         }
@@ -199,8 +1006,12 @@ void RenderGraphPassBuilder::has_side_effect(bool side_effect) {
     _pass->has_side_effect = side_effect;
 }
 
+void RenderGraphPassBuilder::async_compute(bool async) {
+    _pass->async_compute = async;
+}
+
 PassDependencyBuilder::PassDependencyBuilder(View *view,
-                                             std::vector<PassDependency> *deps)
+                                             FrameVector<PassDependency> *deps)
     : _view(view), _deps(deps) {
     assert(_view != nullptr);
     assert(_deps != nullptr);
@@ -233,6 +1044,34 @@ void PassDependencyBuilder::add(const Handle<Texture> &rt,
     _deps->emplace_back(std::move(dep));
 }
 
+void PassDependencyBuilder::add(TransientTextureId rt,
+                                VkAccessFlags access_mask,
+                                VkPipelineStageFlags stage_mask,
+                                bool full_rewrite,
+                                VkImageLayout layout) {
+    PassDependency dep{};
+    dep.transient = rt;
+    dep.access_mask = access_mask;
+    dep.stage_mask = stage_mask;
+    dep.layout = layout;
+    dep.full_rewrite = full_rewrite;
+
+    _deps->emplace_back(std::move(dep));
+}
+
+void PassDependencyBuilder::add(const Handle<Buffer> &buffer,
+                                VkAccessFlags access_mask,
+                                VkPipelineStageFlags stage_mask,
+                                bool full_rewrite) {
+    PassDependency dep{};
+    dep.buffer = buffer;
+    dep.access_mask = access_mask;
+    dep.stage_mask = stage_mask;
+    dep.full_rewrite = full_rewrite;
+
+    _deps->emplace_back(std::move(dep));
+}
+
 void PassDependencyBuilder::add(RenderTargetId rt,
                                 VkAccessFlags access_mask,
                                 VkPipelineStageFlags stage_mask,
@@ -244,4 +1083,118 @@ void PassDependencyBuilder::add(RenderTargetId rt,
         full_rewrite,
         layout);
 }
+RenderGraph::Compiled *RenderGraphCache::acquire(uint64_t hash, bool *found) {
+    auto it = std::find_if(_entries.begin(), _entries.end(), [&](auto &e) {
+        return e->hash == hash;
+    });
+    *found = it != _entries.end();
+    if (*found) {
+        _hit_count++;
+    } else {
+        _miss_count++;
+        if (_entries.size() >= MAX_ENTRY_COUNT) {
+            // Evict the least recently used one
+            it = _entries.end() - 1;
+            *it = std::make_unique<RenderGraph::Compiled>();
+        } else {
+            it = _entries.insert(_entries.end(),
+                                 std::make_unique<RenderGraph::Compiled>());
+        }
+        (*it)->hash = hash;
+    }
+
+    // Keep the most recently used one at front
+    std::rotate(_entries.begin(), it, it + 1);
+    return _entries.front().get();
+}
+
+uint64_t RenderGraphCache::hit_count() const {
+    return _hit_count;
+}
+
+uint64_t RenderGraphCache::miss_count() const {
+    return _miss_count;
+}
+
+TransientTexturePool::TransientTexturePool(Context *context)
+    : _context(context) {}
+
+VkMemoryRequirements
+TransientTexturePool::memory_requirements(const TextureCreateInfo &info) {
+    for (auto &r : _requirements) {
+        if (same_image(r.info, info)) {
+            r.used = true;
+            return r.requirements;
+        }
+    }
+
+    Requirements r{};
+    r.info = info;
+    r.requirements = Texture::memory_requirements(_context, info);
+    r.used = true;
+    _requirements.push_back(r);
+    return r.requirements;
+}
+
+std::shared_ptr<TextureMemory>
+TransientTexturePool::memory(uint32_t memory_type_bits,
+                             VkDeviceSize size,
+                             VkDeviceSize alignment) {
+    auto it = std::find_if(_blocks.begin(), _blocks.end(), [&](auto &b) {
+        return b.memory_type_bits == memory_type_bits;
+    });
+    if (it == _blocks.end()) {
+        it = _blocks.emplace(_blocks.end());
+        it->memory_type_bits = memory_type_bits;
+    }
+
+    it->used = true;
+    if (it->memory == nullptr || it->memory->size() < size ||
+        it->alignment < alignment) {
+        VkMemoryRequirements requirements{};
+        requirements.size = size;
+        requirements.alignment = alignment;
+        requirements.memoryTypeBits = memory_type_bits;
+        it->memory = std::make_shared<TextureMemory>(_context, requirements);
+        it->alignment = alignment;
+    }
+    return it->memory;
+}
+
+Handle<Texture>
+TransientTexturePool::texture(const TextureCreateInfo &info,
+                              const std::shared_ptr<TextureMemory> &memory,
+                              VkDeviceSize offset) {
+    for (auto &t : _textures) {
+        if (!t.used && t.memory == memory.get() && t.offset == offset &&
+            same_texture(t.info, info)) {
+            t.used = true;
+            return t.texture;
+        }
+    }
+
+    CachedTexture t{};
+    t.info = info;
+    t.memory = memory.get();
+    t.offset = offset;
+    t.texture = _context->create_texture(info, memory, offset);
+    t.used = true;
+    _textures.push_back(t);
+    return t.texture;
+}
+
+void TransientTexturePool::collect_unused() {
+    auto collect = [](auto &vec) {
+        vec.erase(std::remove_if(vec.begin(),
+                                 vec.end(),
+                                 [](auto &v) { return !v.used; }),
+                  vec.end());
+        for (auto &v : vec) {
+            v.used = false;
+        }
+    };
+    collect(_requirements);
+    collect(_blocks);
+    collect(_textures);
+}
 } // namespace ars::render::vk
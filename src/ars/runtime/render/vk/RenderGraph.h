@@ -2,14 +2,35 @@
 
 #include "Texture.h"
 #include "View.h"
+#include <ars/runtime/core/misc/Arena.h>
+#include <memory>
 #include <set>
 #include <vector>
 
 namespace ars::render::vk {
+class Buffer;
 class Texture;
 
+// Texture declared by a render graph, which only lives during the graph
+// execution
+struct TransientTextureId {
+    static constexpr uint32_t INVALID = 0xFFFFFFFF;
+
+    uint32_t index = INVALID;
+
+    [[nodiscard]] bool valid() const {
+        return index != INVALID;
+    }
+};
+
+// Exactly one of texture, transient and buffer is set
 struct PassDependency {
     Handle<Texture> texture{};
+    // Valid for transient textures, whose texture is set in
+    // RenderGraph::compile
+    TransientTextureId transient{};
+    // The whole buffer is synchronized. Layout is ignored for buffers.
+    Handle<Buffer> buffer{};
     VkAccessFlags access_mask{};
     VkImageLayout layout{};
     VkPipelineStageFlags stage_mask{};
@@ -17,12 +38,6 @@ struct PassDependency {
     // rewrite, previous write to the rt will be considered useless and previous
     // passes write to this rt might be culled
     bool full_rewrite = true;
-
-    // Textures in the src vector should be unique, so does the dst vector
-    // Textures should be not null
-    static void barrier(CommandBuffer *cmd,
-                        const std::vector<PassDependency> &src_deps,
-                        const std::vector<PassDependency> &dst_deps);
 };
 
 struct RenderGraphPassBuilder;
@@ -31,21 +46,26 @@ struct RenderGraphPassBuilder;
 // 1. has no side effect
 // 2. write not used by later passes or execute_action is nullptr
 // A pass should be marked has side effect if it writes something other than
-// given rt
+// given rts and buffers
+//
+// Async compute passes run on the compute queue of the context if it has one,
+// overlapping with graphics passes they do not depend on. They must only
+// record compute and transfer commands.
 class RenderGraphPass {
   public:
-    [[nodiscard]] std::vector<PassDependency> src_dependencies() const;
-    [[nodiscard]] std::vector<PassDependency> dst_dependencies() const;
+    [[nodiscard]] FrameVector<PassDependency> src_dependencies() const;
+    [[nodiscard]] FrameVector<PassDependency> dst_dependencies() const;
     void execute(CommandBuffer *cmd) const;
 
-    std::vector<PassDependency> dependencies{};
+    FrameVector<PassDependency> dependencies{};
     std::function<void(CommandBuffer *)> execute_action{};
     bool has_side_effect = false;
+    bool async_compute = false;
 };
 
 struct PassDependencyBuilder {
   public:
-    PassDependencyBuilder(View *view, std::vector<PassDependency> *deps);
+    PassDependencyBuilder(View *view, FrameVector<PassDependency> *deps);
 
     void add(NamedRT rt,
              VkAccessFlags access_mask,
@@ -65,9 +85,20 @@ struct PassDependencyBuilder {
              bool full_rewrite = true,
              VkImageLayout layout = VK_IMAGE_LAYOUT_GENERAL);
 
+    void add(TransientTextureId rt,
+             VkAccessFlags access_mask,
+             VkPipelineStageFlags stage_mask,
+             bool full_rewrite = true,
+             VkImageLayout layout = VK_IMAGE_LAYOUT_GENERAL);
+
+    void add(const Handle<Buffer> &buffer,
+             VkAccessFlags access_mask,
+             VkPipelineStageFlags stage_mask,
+             bool full_rewrite = true);
+
   private:
     View *_view = nullptr;
-    std::vector<PassDependency> *_deps{};
+    FrameVector<PassDependency> *_deps{};
 };
 
 struct RenderGraphPassBuilder {
@@ -97,12 +128,35 @@ struct RenderGraphPassBuilder {
                       VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
     }
 
+    template <typename Res>
+    RenderGraphPassBuilder &transfer_read(Res &&res) {
+        return access(std::forward<Res>(res),
+                      VK_ACCESS_TRANSFER_READ_BIT,
+                      VK_PIPELINE_STAGE_TRANSFER_BIT);
+    }
+
+    template <typename Res>
+    RenderGraphPassBuilder &transfer_write(Res &&res,
+                                           bool full_rewrite = true) {
+        return access(std::forward<Res>(res),
+                      VK_ACCESS_TRANSFER_WRITE_BIT,
+                      VK_PIPELINE_STAGE_TRANSFER_BIT,
+                      full_rewrite);
+    }
+
+    RenderGraphPassBuilder &indirect_read(const Handle<Buffer> &buffer) {
+        return access(buffer,
+                      VK_ACCESS_INDIRECT_COMMAND_READ_BIT,
+                      VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT);
+    }
+
     template <typename... Args> RenderGraphPassBuilder &access(Args &&...args) {
         _deps_builder.add(std::forward<Args>(args)...);
         return *this;
     }
 
     void has_side_effect(bool side_effect);
+    void async_compute(bool async);
 
   private:
     View *_view = nullptr;
@@ -110,16 +164,84 @@ struct RenderGraphPassBuilder {
     PassDependencyBuilder _deps_builder;
 };
 
+// Memory and textures backing transients of render graphs of a view. They
+// persist across frames, so textures are only recreated when the aliasing
+// layout changes.
+class TransientTexturePool {
+  public:
+    explicit TransientTexturePool(Context *context);
+
+    [[nodiscard]] VkMemoryRequirements
+    memory_requirements(const TextureCreateInfo &info);
+
+    // Memory shared by transients with the memory type bits. It is reallocated
+    // if smaller than size.
+    std::shared_ptr<TextureMemory> memory(uint32_t memory_type_bits,
+                                          VkDeviceSize size,
+                                          VkDeviceSize alignment);
+
+    Handle<Texture> texture(const TextureCreateInfo &info,
+                            const std::shared_ptr<TextureMemory> &memory,
+                            VkDeviceSize offset);
+
+    // Release memory and textures not requested since the last call. Memory is
+    // freed after all textures bound to it retire.
+    void collect_unused();
+
+  private:
+    struct Requirements {
+        TextureCreateInfo info{};
+        VkMemoryRequirements requirements{};
+        bool used = false;
+    };
+
+    struct Block {
+        uint32_t memory_type_bits = 0;
+        std::shared_ptr<TextureMemory> memory{};
+        VkDeviceSize alignment = 0;
+        bool used = false;
+    };
+
+    struct CachedTexture {
+        TextureCreateInfo info{};
+        TextureMemory *memory = nullptr;
+        VkDeviceSize offset = 0;
+        Handle<Texture> texture{};
+        bool used = false;
+    };
+
+    Context *_context = nullptr;
+    std::vector<Requirements> _requirements{};
+    std::vector<Block> _blocks{};
+    std::vector<CachedTexture> _textures{};
+};
+
 struct RenderGraph {
   public:
     explicit RenderGraph(View *view);
 
+    // Declare a texture which is only used by passes of this graph. The extent
+    // of texture create info is ignored, the actual size is the view size
+    // multiplied by scale. Transients whose lifetimes do not overlap share
+    // memory, so never rely on their contents from previous frames.
+    TransientTextureId create_transient(const TextureCreateInfo &info,
+                                        float scale = 1.0f);
+
+    // Only valid after compile, and only if some active pass uses the texture
+    [[nodiscard]] Handle<Texture> texture(TransientTextureId id) const;
+
     // Mark render target as output, any pass that writes to it will not be
     // culled.
     // Use this method to mark the final rt for present and rts used in the next
     // frame.
     void output(RenderTargetId id);
     void output(NamedRT rt);
+    // Mark buffer as output, e.g. for buffers used in the next frame
+    void output(const Handle<Buffer> &buffer);
+    // Mark buffer as output and make the last write to it visible to the host
+    // when the graph finishes. The host still needs to wait for the frame to
+    // complete before reading.
+    void read_back(const Handle<Buffer> &buffer);
     void compile();
     void execute();
 
@@ -133,17 +255,161 @@ struct RenderGraph {
 
     View *view() const;
 
+    // Valid after compile
+    [[nodiscard]] TransientMemoryStats transient_stats() const;
+    [[nodiscard]] BarrierStats barrier_stats() const;
+
   private:
+    friend class RenderGraphCache;
+
+    enum QueueType {
+        QueueType_Graphics,
+        QueueType_AsyncCompute,
+        QueueType_Count,
+    };
+
     RenderGraphPass *alloc_pass();
+    [[nodiscard]] uint64_t hash_declarations() const;
+    void cull_passes();
+    void schedule_queues();
+    void alloc_transients();
+    void build_barriers();
+    // Make the batch wait for a batch on the other queue
+    void add_queue_dependency(int32_t batch, int32_t wait_batch);
+    void record_batch(CommandBuffer *cmd, size_t batch_index);
 
     View *_view = nullptr;
 
+    // Compiled states of a pass
     struct PassInfo {
-        RenderGraphPass pass{};
         bool active = false;
+        QueueType queue = QueueType_Graphics;
+        int32_t batch = -1;
+        // Previous users of the memory of transients first used by this pass
+        VkPipelineStageFlags alias_stage_mask = 0;
+        VkAccessFlags alias_access_mask = 0;
+        // The last pass on the other queue using the memory before, or -1
+        int32_t alias_wait_pass = -1;
+
+        // All dependencies of the pass are synchronized by one barrier
+        VkPipelineStageFlags src_stage_mask = 0;
+        VkPipelineStageFlags dst_stage_mask = 0;
+        std::vector<VkImageMemoryBarrier> image_barriers{};
+        // Textures of image_barriers
+        std::vector<Texture *> barrier_textures{};
+        std::vector<VkBufferMemoryBarrier> buffer_barriers{};
+    };
+
+    // Consecutive active passes on the same queue, which are submitted
+    // together. Batches are submitted in order, and the first batch is always
+    // on the graphics queue.
+    struct Batch {
+        QueueType queue = QueueType_Graphics;
+        // Range of passes in the batch, inactive passes are skipped
+        size_t pass_begin = 0;
+        size_t pass_end = 0;
+        // Batch on the other queue waited before the batch starts, or -1
+        int32_t wait_batch = -1;
+        // Signal a semaphore when finishes if some batch waits for it
+        bool signal = false;
+        // Queue family ownership releases recorded after passes of the batch
+        VkPipelineStageFlags release_stage_mask = 0;
+        std::vector<VkImageMemoryBarrier> release_barriers{};
+        std::vector<Texture *> release_textures{};
+    };
+
+    // Everything derived from declarations of the graph, reused by later
+    // graphs with the same declarations
+    struct Compiled {
+        uint64_t hash = 0;
+        // Indexed the same as declared passes
+        std::vector<PassInfo> passes{};
+        std::vector<Batch> batches{};
+        // Indexed by TransientTextureId
+        std::vector<Handle<Texture>> transient_textures{};
+        // Acquire textures left on the compute queue, recorded at the end of
+        // the last batch
+        VkPipelineStageFlags join_stage_mask = 0;
+        std::vector<VkImageMemoryBarrier> join_barriers{};
+        std::vector<Texture *> join_textures{};
+        // Makes writes to read back buffers visible to the host
+        VkPipelineStageFlags read_back_stage_mask = 0;
+        VkAccessFlags read_back_access_mask = 0;
+        TransientMemoryStats transient_stats{};
+        BarrierStats barrier_stats{};
+    };
+
+    // Access state of a resource while walking through active passes
+    struct ResourceState {
+        // Queue owning the resource. All resources are owned by the graphics
+        // queue between graph executions.
+        QueueType queue = QueueType_Graphics;
+        // The last batch accessing the resource, or -1
+        int32_t batch = -1;
+        // Null for buffers
+        Texture *texture = nullptr;
+        bool transient = false;
+        // Only used for textures
+        VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+        // The last write or layout transition
+        VkPipelineStageFlags write_stage_mask = 0;
+        VkAccessFlags write_access_mask = 0;
+        // Reads since the last write
+        VkPipelineStageFlags read_stage_mask = 0;
+        // Stages and accesses the last write has been made visible to
+        VkPipelineStageFlags visible_stage_mask = 0;
+        VkAccessFlags visible_access_mask = 0;
+        // The last write on any queue, for read backs
+        VkPipelineStageFlags host_stage_mask = 0;
+        VkAccessFlags host_access_mask = 0;
+    };
+
+    struct TransientInfo {
+        TextureCreateInfo info{};
+        Handle<Texture> texture{};
+        VkMemoryRequirements requirements{};
+        VkDeviceSize offset = 0;
+        // Indices of the first and the last active passes using the texture
+        int32_t first_pass = -1;
+        int32_t last_pass = -1;
+        VkPipelineStageFlags stage_mask = 0;
+        VkAccessFlags access_mask = 0;
     };
 
     std::set<RenderTargetId> _output_rts{};
-    std::vector<PassInfo> _passes{};
+    FrameVector<Handle<Buffer>> _output_buffers{};
+    FrameVector<Handle<Buffer>> _read_back_buffers{};
+    FrameVector<RenderGraphPass> _passes{};
+    FrameVector<TransientInfo> _transients{};
+    // Owned by the render graph cache of the view, valid after compile
+    Compiled *_compiled = nullptr;
+    // Latest batch on the other queue waited by each queue so far
+    int32_t _waited_batches[QueueType_Count]{};
+};
+
+// Compiled render graphs of a view. Graph topology is usually stable across
+// frames, so a graph whose declarations hash to a cached one reuses its
+// culling result, queue schedule, transient placement and barriers. Graphs
+// are only recompiled when options, resolution or resources change.
+class RenderGraphCache {
+  public:
+    [[nodiscard]] uint64_t hit_count() const;
+    [[nodiscard]] uint64_t miss_count() const;
+
+  private:
+    friend struct RenderGraph;
+
+    // Graphs alternate between a few variants, e.g. for history buffers
+    // swapped every frame
+    static constexpr size_t MAX_ENTRY_COUNT = 8;
+
+    // Returns the cached graph with the hash, or an empty one replacing the
+    // least recently used
+    RenderGraph::Compiled *acquire(uint64_t hash, bool *found);
+
+    // The most recently used first
+    std::vector<std::unique_ptr<RenderGraph::Compiled>> _entries{};
+    uint64_t _hit_count = 0;
+    uint64_t _miss_count = 0;
 };
 } // namespace ars::render::vk
\ No newline at end of file
@@ -1,9 +1,70 @@
 #include "RenderPass.h"
 #include "Context.h"
+#include <ars/runtime/core/Jobs.h>
 #include <ars/runtime/core/Log.h>
+#include <ars/runtime/core/misc/Arena.h>
 #include <cassert>
 
 namespace ars::render::vk {
+namespace {
+void add_attachment_refs(std::vector<uint64_t> &key,
+                         uint32_t count,
+                         const VkAttachmentReference *refs) {
+    key.push_back(refs == nullptr ? 0 : count);
+    for (uint32_t i = 0; refs != nullptr && i < count; i++) {
+        key.push_back(refs[i].attachment);
+    }
+}
+
+std::vector<uint64_t>
+make_compatibility_key(VkRenderPass render_pass,
+                       const VkRenderPassCreateInfo &info) {
+    std::vector<uint64_t> key{};
+    // Extensions are not keyed, such render passes are only compatible with
+    // themselves
+    key.push_back(info.pNext == nullptr
+                      ? 0
+                      : reinterpret_cast<uint64_t>(render_pass));
+    key.push_back(info.flags);
+    key.push_back(info.attachmentCount);
+    for (uint32_t i = 0; i < info.attachmentCount; i++) {
+        auto &attachment = info.pAttachments[i];
+        key.push_back(attachment.flags);
+        key.push_back(attachment.format);
+        key.push_back(attachment.samples);
+    }
+    key.push_back(info.subpassCount);
+    for (uint32_t i = 0; i < info.subpassCount; i++) {
+        auto &subpass = info.pSubpasses[i];
+        key.push_back(subpass.flags);
+        key.push_back(subpass.pipelineBindPoint);
+        add_attachment_refs(
+            key, subpass.inputAttachmentCount, subpass.pInputAttachments);
+        add_attachment_refs(
+            key, subpass.colorAttachmentCount, subpass.pColorAttachments);
+        add_attachment_refs(
+            key, subpass.colorAttachmentCount, subpass.pResolveAttachments);
+        add_attachment_refs(key, 1, subpass.pDepthStencilAttachment);
+        key.push_back(subpass.preserveAttachmentCount);
+        for (uint32_t p = 0; p < subpass.preserveAttachmentCount; p++) {
+            key.push_back(subpass.pPreserveAttachments[p]);
+        }
+    }
+    key.push_back(info.dependencyCount);
+    for (uint32_t i = 0; i < info.dependencyCount; i++) {
+        auto &dependency = info.pDependencies[i];
+        key.push_back(dependency.srcSubpass);
+        key.push_back(dependency.dstSubpass);
+        key.push_back(dependency.srcStageMask);
+        key.push_back(dependency.dstStageMask);
+        key.push_back(dependency.srcAccessMask);
+        key.push_back(dependency.dstAccessMask);
+        key.push_back(dependency.dependencyFlags);
+    }
+    return key;
+}
+} // namespace
+
 RenderPass::RenderPass(Context *context, const VkRenderPassCreateInfo &info)
     : _context(context) {
     if (_context->device()->Create(&info, &_render_pass) != VK_SUCCESS) {
@@ -18,6 +79,7 @@ RenderPass::RenderPass(Context *context, const VkRenderPassCreateInfo &info)
     for (int i = 0; i < info.subpassCount; i++) {
         _subpasses.push_back(info.pSubpasses[i]);
     }
+    _compatibility_key = make_compatibility_key(_render_pass, info);
 }
 
 RenderPass::~RenderPass() {
@@ -30,6 +92,10 @@ VkRenderPass RenderPass::render_pass() const {
     return _render_pass;
 }
 
+const std::vector<uint64_t> &RenderPass::compatibility_key() const {
+    return _compatibility_key;
+}
+
 RenderPassExecution RenderPass::begin(CommandBuffer *cmd,
                                       Framebuffer *framebuffer,
                                       const VkClearValue *clear_values,
@@ -46,14 +112,60 @@ RenderPassExecution RenderPass::begin(CommandBuffer *cmd,
 
     cmd->BeginRenderPass(&rp_begin, contents);
 
-    framebuffer->set_viewport_scissor(cmd);
+    // Only secondary command buffers may record into the subpass
+    if (contents == VK_SUBPASS_CONTENTS_INLINE) {
+        framebuffer->set_viewport_scissor(cmd);
+    }
 
     RenderPassExecution execution{};
+    execution.render_pass = this;
     execution.command_buffer = cmd;
     execution.framebuffer = framebuffer;
+    execution.contents = contents;
     return execution;
 }
 
+void RenderPass::record(
+    const RenderPassExecution &execution,
+    uint32_t count,
+    const std::function<void(CommandBuffer *, uint32_t)> &func) {
+    if (execution.contents == VK_SUBPASS_CONTENTS_INLINE) {
+        for (uint32_t i = 0; i < count; i++) {
+            func(execution.command_buffer, i);
+        }
+        return;
+    }
+
+    VkCommandBufferInheritanceInfo inheritance{
+        VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO};
+    inheritance.renderPass = _render_pass;
+    inheritance.subpass = 0;
+    inheritance.framebuffer = execution.framebuffer->framebuffer();
+
+    FrameVector<Handle<CommandBuffer>> secondaries(count);
+    jobs::parallel_for(0, count, 1, [&](size_t begin, size_t end) {
+        for (auto i = begin; i < end; i++) {
+            // Allocated from the command pool of the current thread
+            auto cmd = _context->create_command_buffer(
+                VK_COMMAND_BUFFER_LEVEL_SECONDARY);
+            cmd->begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT |
+                           VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT,
+                       inheritance);
+            execution.framebuffer->set_viewport_scissor(cmd.get());
+            func(cmd.get(), static_cast<uint32_t>(i));
+            cmd->end();
+            secondaries[i] = std::move(cmd);
+        }
+    });
+
+    FrameVector<VkCommandBuffer> command_buffers{};
+    command_buffers.reserve(count);
+    for (auto &cmd : secondaries) {
+        command_buffers.push_back(cmd->command_buffer());
+    }
+    execution.command_buffer->ExecuteCommands(count, command_buffers.data());
+}
+
 void RenderPass::end(const RenderPassExecution &execution) {
     auto cmd = execution.command_buffer;
     auto fb = execution.framebuffer;
@@ -1,16 +1,20 @@
 #pragma once
 
 #include "Vulkan.h"
+#include <functional>
 #include <vector>
 
 namespace ars::render::vk {
 class Context;
 class Framebuffer;
+class RenderPass;
 class Texture;
 
 struct RenderPassExecution {
+    RenderPass *render_pass;
     CommandBuffer *command_buffer;
     Framebuffer *framebuffer;
+    VkSubpassContents contents;
 };
 
 struct RenderPassAttachmentInfo {
@@ -38,6 +42,10 @@ class RenderPass {
     [[nodiscard]] const std::vector<VkAttachmentDescription> &
     attachments() const;
     [[nodiscard]] const std::vector<VkSubpassDescription> &subpasses() const;
+    // Equal for compatible render passes, which only differ in image layouts
+    // and load and store operations. Pipelines created with a render pass can
+    // be used with compatible ones.
+    [[nodiscard]] const std::vector<uint64_t> &compatibility_key() const;
 
     // clear value size must match with framebuffer attachment count
     RenderPassExecution begin(CommandBuffer *cmd,
@@ -48,6 +56,17 @@ class RenderPass {
                               const std::vector<Handle<Texture>> &attachments,
                               VkSubpassContents contents);
 
+    // Calls func(cmd, index) for index in [0, count) to record the contents
+    // of the subpass. With inline contents, all calls record into the primary
+    // command buffer in order. With secondary command buffer contents, each
+    // call records its own secondary command buffer on a job worker, and they
+    // are executed in index order. Secondary command buffers don't inherit
+    // dynamic states, the viewport and scissor are reset to the whole
+    // framebuffer before each call.
+    void record(const RenderPassExecution &execution,
+                uint32_t count,
+                const std::function<void(CommandBuffer *, uint32_t)> &func);
+
     void end(const RenderPassExecution &execution);
 
   private:
@@ -55,6 +74,7 @@ class RenderPass {
     VkRenderPass _render_pass = VK_NULL_HANDLE;
     std::vector<VkAttachmentDescription> _attachments{};
     std::vector<VkSubpassDescription> _subpasses{};
+    std::vector<uint64_t> _compatibility_key{};
 };
 
 class Framebuffer {
@@ -6,6 +6,9 @@
 #include "View.h"
 #include "features/Drawer.h"
 #include "features/RayTracing.h"
+#include <algorithm>
+#include <cmath>
+#include <ars/runtime/core/math/FrustumCulling.h>
 
 namespace ars::render::vk {
 std::unique_ptr<IRenderObject> Scene::create_render_object() {
@@ -24,7 +27,30 @@ std::unique_ptr<IPointLight> Scene::create_point_light() {
     return std::make_unique<PointLight>(this);
 }
 
-Scene::Scene(Context *context) : _context(context) {}
+namespace {
+constexpr uint32_t INITIAL_OBJECT_TRANSFORM_CAPACITY = 256;
+
+Handle<Buffer> create_object_transform_buffer(Context *context,
+                                              uint64_t capacity) {
+    return context->create_buffer(sizeof(ObjectTransform) * capacity,
+                                  VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+                                      VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                  VMA_MEMORY_USAGE_GPU_ONLY);
+}
+} // namespace
+
+float point_light_range(const Light &light) {
+    auto &c = light.color;
+    // Matches the radiance of radiance_to_point() in Light.glsl at distance 1
+    auto radiance = light.intensity * std::max({c.r, c.g, c.b}) /
+                    (4.0f * glm::pi<float>());
+    return std::sqrt(std::max(radiance, 0.0f) / POINT_LIGHT_RADIANCE_CUTOFF);
+}
+
+Scene::Scene(Context *context) : _context(context) {
+    _object_transform_buffer = create_object_transform_buffer(
+        _context, INITIAL_OBJECT_TRANSFORM_CAPACITY);
+}
 
 Context *Scene::context() const {
     return _context;
@@ -33,38 +59,198 @@ Context *Scene::context() const {
 CullingResult Scene::cull(const Frustum &frustum_ws) {
     // This method might be called from different thread, don't put profiler
     // sample here.
-    auto rd_obj_cnt = render_objects.size();
-
     CullingResult res{};
-
     res.scene = this;
-    res.objects.reserve(rd_obj_cnt);
+    res.draw_state_version = _draw_state_version;
+    // Read before requests are gathered, so lists missing materials that
+    // become ready later are rebuilt
+    res.material_ready_version = _context->material_factory()->ready_version();
+
+    auto test = [&](const math::AABB<float> &aabb) {
+        if (frustum_ws.culled(aabb)) {
+            return math::Containment::Disjoint;
+        }
+        if (frustum_ws.contains(aabb)) {
+            return math::Containment::Contain;
+        }
+        return math::Containment::Intersect;
+    };
+
+    // Tree leaves store fat AABBs, leaves not fully contained by the frustum
+    // are tested again with exact AABBs in batch
+    FrameVector<uint32_t> visible_indices{};
+    FrameVector<uint32_t> candidate_indices{};
+    auto visit = [&](RenderObjects::Id id, bool contained) {
+        auto index = static_cast<uint32_t>(render_objects.get_soa_index(id));
+        if (contained) {
+            visible_indices.push_back(index);
+        } else {
+            candidate_indices.push_back(index);
+        }
+    };
+
+    _render_object_tree.query(test, visit);
+
+    auto contained_count = visible_indices.size();
+    visible_indices.resize(contained_count + candidate_indices.size());
+    auto candidate_visible_count = math::cull_aabbs(
+        frustum_ws.planes,
+        frustum_ws.plane_count,
+        &render_objects.get_array<WorldAABBMin>()->value,
+        &render_objects.get_array<WorldAABBMax>()->value,
+        candidate_indices.data(),
+        candidate_indices.size(),
+        visible_indices.data() + contained_count);
+    visible_indices.resize(contained_count + candidate_visible_count);
+
+    res.objects.reserve(visible_indices.size());
+    for (int i = 0; i < visible_indices.size(); i++) {
+        auto index = visible_indices[i];
+        res.objects.push_back(render_objects.get_id_from_soa_index(index));
+        auto aabb_ws = render_object_aabb_ws(index);
+        if (i == 0) {
+            res.visible_aabb_ws = aabb_ws;
+        } else {
+            res.visible_aabb_ws.extend_aabb(aabb_ws);
+        }
+    }
 
-    std::vector<math::AABB<float>> visible_aabbs{};
-    visible_aabbs.reserve(rd_obj_cnt);
+    return res;
+}
 
-    auto matrix_arr = render_objects.get_array<glm::mat4>();
-    auto mesh_arr = render_objects.get_array<std::shared_ptr<Mesh>>();
+void Scene::mark_render_object_bounds_dirty(RenderObjects::Id id) {
+    auto &dirty = render_objects.get<BoundsDirty>(id).value;
+    if (!dirty) {
+        dirty = true;
+        _dirty_render_object_bounds.push_back(id);
+    }
+}
 
-    for (int i = 0; i < rd_obj_cnt; i++) {
-        auto &matrix = matrix_arr[i];
+void Scene::mark_mesh_aabb_changed_render_objects() {
+    auto latest = Mesh::latest_aabb_version();
+    if (latest == _mesh_aabb_version) {
+        return;
+    }
+    _mesh_aabb_version = latest;
+
+    auto count = render_objects.size();
+    auto mesh_arr = render_objects.get_array<std::shared_ptr<Mesh>>();
+    auto version_arr = render_objects.get_array<MeshAABBVersion>();
+    for (int i = 0; i < count; i++) {
         auto &mesh = mesh_arr[i];
-        auto aabb_ws = math::transform_aabb(matrix, mesh->aabb());
-        if (frustum_ws.culled(aabb_ws)) {
-            continue;
+        if (mesh != nullptr && mesh->aabb_version() != version_arr[i].value) {
+            mark_render_object_bounds_dirty(
+                render_objects.get_id_from_soa_index(i));
         }
-        res.objects.push_back(render_objects.get_id_from_soa_index(i));
-        visible_aabbs.push_back(aabb_ws);
     }
+}
 
-    if (!visible_aabbs.empty()) {
-        res.visible_aabb_ws = visible_aabbs.front();
-        for (auto &aabb : visible_aabbs) {
-            res.visible_aabb_ws.extend_aabb(aabb);
+void Scene::update_dirty_render_object_bounds() {
+    ARS_PROFILER_SAMPLE("Update Render Object Bounds", 0xFF316482);
+    mark_mesh_aabb_changed_render_objects();
+    FrameVector<RenderObjects::Id> transform_ids{};
+    transform_ids.reserve(_dirty_render_object_bounds.size());
+    for (auto id : _dirty_render_object_bounds) {
+        update_render_object_bounds(id);
+        transform_ids.push_back(id);
+    }
+    _dirty_render_object_bounds.clear();
+    upload_object_transforms(transform_ids);
+}
+
+void Scene::upload_object_transforms(FrameVector<RenderObjects::Id> &ids) {
+    if (ids.empty()) {
+        return;
+    }
+
+    auto by_value = [](RenderObjects::Id lhs, RenderObjects::Id rhs) {
+        return lhs.value() < rhs.value();
+    };
+    auto capacity = _object_transform_buffer->size() / sizeof(ObjectTransform);
+    auto required =
+        std::max_element(ids.begin(), ids.end(), by_value)->value() + 1;
+    if (required > capacity) {
+        // Contents are not copied, upload transforms of all render objects
+        // to the new buffer
+        capacity = std::max(capacity * 2, required);
+        _object_transform_buffer =
+            create_object_transform_buffer(_context, capacity);
+        ids.clear();
+        render_objects.for_each_id(
+            [&](RenderObjects::Id id) { ids.push_back(id); });
+    }
+
+    // Upload transforms of consecutive ids together
+    std::sort(ids.begin(), ids.end(), by_value);
+    FrameVector<ObjectTransform> transforms{};
+    transforms.reserve(ids.size());
+    size_t range_begin = 0;
+    for (size_t i = 0; i < ids.size(); i++) {
+        auto &M = render_objects.get<glm::mat4>(ids[i]);
+        transforms.push_back({M, glm::inverse(M)});
+
+        if (i + 1 == ids.size() ||
+            ids[i + 1].value() != ids[i].value() + 1) {
+            _object_transform_buffer->set_data_raw(
+                transforms.data() + range_begin,
+                ids[range_begin].value() * sizeof(ObjectTransform),
+                (i + 1 - range_begin) * sizeof(ObjectTransform));
+            range_begin = i + 1;
         }
     }
+}
 
-    return res;
+void Scene::update_render_object_bounds(RenderObjects::Id id) {
+    render_objects.get<BoundsDirty>(id).value = false;
+    auto &proxy = render_objects.get<CullingProxy>(id).value;
+    auto &mesh = render_objects.get<std::shared_ptr<Mesh>>(id);
+    if (mesh == nullptr) {
+        if (proxy >= 0) {
+            _render_object_tree.remove(proxy);
+            proxy = -1;
+        }
+        return;
+    }
+
+    render_objects.get<MeshAABBVersion>(id).value = mesh->aabb_version();
+    auto aabb_ws =
+        math::transform_aabb(render_objects.get<glm::mat4>(id), mesh->aabb());
+    render_objects.get<WorldAABBMin>(id).value = aabb_ws.min;
+    render_objects.get<WorldAABBMax>(id).value = aabb_ws.max;
+    if (proxy < 0) {
+        proxy = _render_object_tree.insert(aabb_ws, id);
+    } else {
+        _render_object_tree.update(proxy, aabb_ws);
+    }
+}
+
+void Scene::remove_render_object_bounds(RenderObjects::Id id) {
+    if (render_objects.get<BoundsDirty>(id).value) {
+        auto &dirty = _dirty_render_object_bounds;
+        dirty.erase(std::find(dirty.begin(), dirty.end(), id));
+    }
+    auto &proxy = render_objects.get<CullingProxy>(id).value;
+    if (proxy >= 0) {
+        _render_object_tree.remove(proxy);
+        proxy = -1;
+    }
+}
+
+math::AABB<float> Scene::render_object_aabb_ws(uint32_t rd_obj_index) const {
+    return {render_objects.get_array<WorldAABBMin>()[rd_obj_index].value,
+            render_objects.get_array<WorldAABBMax>()[rd_obj_index].value};
+}
+
+Handle<Buffer> Scene::object_transform_buffer() const {
+    return _object_transform_buffer;
+}
+
+uint64_t Scene::draw_state_version() const {
+    return _draw_state_version;
+}
+
+void Scene::mark_draw_state_changed() {
+    _draw_state_version++;
 }
 
 math::AABB<float> Scene::loaded_aabb_ws() const {
@@ -74,23 +260,33 @@ math::AABB<float> Scene::loaded_aabb_ws() const {
 void Scene::update_loaded_aabb() {
     ARS_PROFILER_SAMPLE("Update Loaded AABB", 0xFF817135);
     auto obj_count = render_objects.size();
-    if (obj_count == 0) {
-        _loaded_aabb_ws = {};
-        return;
-    }
-    auto matrix_arr = render_objects.get_array<glm::mat4>();
     auto mesh_arr = render_objects.get_array<std::shared_ptr<Mesh>>();
-    _loaded_aabb_ws = math::transform_aabb(matrix_arr[0], mesh_arr[0]->aabb());
-    for (int i = 1; i < obj_count; i++) {
-        auto aabb_ws = math::transform_aabb(matrix_arr[i], mesh_arr[i]->aabb());
-        _loaded_aabb_ws.extend_aabb(aabb_ws);
+    auto min_arr = render_objects.get_array<WorldAABBMin>();
+    auto max_arr = render_objects.get_array<WorldAABBMax>();
+
+    _loaded_aabb_ws = {};
+    bool empty = true;
+    for (int i = 0; i < obj_count; i++) {
+        if (mesh_arr[i] == nullptr) {
+            continue;
+        }
+        math::AABB<float> aabb_ws(min_arr[i].value, max_arr[i].value);
+        if (empty) {
+            _loaded_aabb_ws = aabb_ws;
+            empty = false;
+        } else {
+            _loaded_aabb_ws.extend_aabb(aabb_ws);
+        }
     }
 }
 
 CullingResult Scene::cull(const math::XformTRS<float> &xform,
                           const Frustum &frustum_local) {
     auto frustum_ws = transform_frustum(xform.matrix_no_scale(), frustum_local);
-    return cull(frustum_ws);
+    auto res = cull(frustum_ws);
+    res.view_position_ws = xform.translation();
+    res.view_direction_ws = xform.forward();
+    return res;
 }
 
 std::optional<DrawRequest>
@@ -139,7 +335,10 @@ std::optional<DrawRequest> Scene::get_draw_request(
     }
 
     req.M = matrix;
+    req.object_id = static_cast<uint32_t>(
+        render_objects.get_id_from_soa_index(rd_obj_index).value());
     req.mesh = mesh.get();
+    req.sort_key = make_draw_sort_key(req, 0.0f);
 
     return req;
 }
@@ -158,13 +357,14 @@ Handle<AccelerationStructure> Scene::acceleration_structure() const {
 }
 
 void Scene::update_before_render() {
+    update_dirty_render_object_bounds();
     update_loaded_aabb();
     update_acceleration_structure();
 }
 
-std::vector<DrawRequest> Scene::gather_draw_request(RenderPassID pass_id) {
+FrameVector<DrawRequest> Scene::gather_draw_request(RenderPassID pass_id) {
     auto cnt = render_objects.size();
-    std::vector<DrawRequest> reqs{};
+    FrameVector<DrawRequest> reqs{};
     reqs.reserve(cnt);
     for (int i = 0; i < cnt; i++) {
         auto req = get_draw_request(pass_id, i);
@@ -244,6 +444,7 @@ math::XformTRS<float> RenderObject::xform() {
 
 void RenderObject::set_xform(const math::XformTRS<float> &xform) {
     get<glm::mat4>() = xform.matrix();
+    _scene->mark_render_object_bounds_dirty(_id);
 }
 
 IScene *RenderObject::scene() {
@@ -256,6 +457,8 @@ std::shared_ptr<IMesh> RenderObject::mesh() {
 
 void RenderObject::set_mesh(std::shared_ptr<IMesh> mesh) {
     get<std::shared_ptr<Mesh>>() = upcast(mesh);
+    _scene->mark_render_object_bounds_dirty(_id);
+    _scene->mark_draw_state_changed();
 }
 
 std::shared_ptr<IMaterial> RenderObject::material() {
@@ -264,14 +467,18 @@ std::shared_ptr<IMaterial> RenderObject::material() {
 
 void RenderObject::set_material(std::shared_ptr<IMaterial> material) {
     get<std::shared_ptr<Material>>() = upcast(material);
+    _scene->mark_draw_state_changed();
 }
 
 RenderObject::RenderObject(Scene *scene) : _scene(scene) {
     _id = _scene->render_objects.alloc();
+    _scene->mark_draw_state_changed();
 }
 
 RenderObject::~RenderObject() {
+    _scene->remove_render_object_bounds(_id);
     _scene->render_objects.free(_id);
+    _scene->mark_draw_state_changed();
 }
 
 uint64_t RenderObject::user_data() {
@@ -288,6 +495,7 @@ std::shared_ptr<ISkin> RenderObject::skin() {
 
 void RenderObject::set_skin(std::shared_ptr<ISkin> skin) {
     get<std::shared_ptr<Skin>>() = upcast(skin);
+    _scene->mark_draw_state_changed();
 }
 
 Scene::RenderObjects::Id RenderObject::id() const {
@@ -330,6 +538,22 @@ void PointLight::set_intensity(float intensity) {
     get<Light>().intensity = intensity;
 }
 
+float PointLight::range() {
+    return get<LightRange>().value.value_or(point_light_range(get<Light>()));
+}
+
+void PointLight::set_range(float range) {
+    get<LightRange>().value = range;
+}
+
+bool PointLight::has_range() {
+    return get<LightRange>().value.has_value();
+}
+
+void PointLight::reset_range() {
+    get<LightRange>().value.reset();
+}
+
 uint64_t PointLight::user_data() {
     return get<UserData>().value;
 }
@@ -338,16 +562,19 @@ void PointLight::set_user_data(uint64_t user_data) {
     get<UserData>().value = user_data;
 }
 
-std::vector<DrawRequest>
+FrameVector<DrawRequest>
 CullingResult::gather_draw_requests(RenderPassID pass_id) const {
     // This method may called from different thread, don't put profiler sample
     // here.
-    std::vector<DrawRequest> requests{};
+    FrameVector<DrawRequest> requests{};
     requests.reserve(objects.size());
 
     for (auto obj_id : objects) {
         auto req = scene->get_draw_request(pass_id, obj_id);
         if (req.has_value()) {
+            auto depth = glm::dot(glm::vec3(req->M[3]) - view_position_ws,
+                                  view_direction_ws);
+            req->sort_key = make_draw_sort_key(*req, depth);
             requests.push_back(req.value());
         }
     }
@@ -3,7 +3,10 @@
 #include "../IScene.h"
 #include "features/Renderer.h"
 #include "features/Shadow.h"
+#include <ars/runtime/core/math/AABBTree.h>
+#include <ars/runtime/core/misc/Arena.h>
 #include <ars/runtime/core/misc/SoA.h>
+#include <optional>
 
 namespace ars::render::vk {
 class Mesh;
@@ -22,6 +25,55 @@ struct UserData {
     uint64_t value = 0;
 };
 
+// Computed by point_light_range() if not set
+struct LightRange {
+    std::optional<float> value{};
+};
+
+// Radiance of point lights without range is cut off below this value
+constexpr float POINT_LIGHT_RADIANCE_CUTOFF = 0.01f;
+
+// Distance where the radiance of the light falls to the cutoff with inverse
+// square falloff, about 2.82f for the default color and intensity
+[[nodiscard]] float point_light_range(const Light &light);
+
+// Leaf of the object in the culling tree
+struct CullingProxy {
+    int32_t value = -1;
+};
+
+// World space AABB of the render object. Min and max are kept in separate
+// columns. Only valid for render objects with mesh.
+struct WorldAABBMin {
+    glm::vec3 value{};
+};
+
+struct WorldAABBMax {
+    glm::vec3 value{};
+};
+
+// Columns are passed to math::cull_aabbs as plain glm::vec3 arrays
+static_assert(sizeof(WorldAABBMin) == sizeof(glm::vec3));
+static_assert(sizeof(WorldAABBMax) == sizeof(glm::vec3));
+
+// Set when the transform or the mesh changes, cleared once the world AABB is
+// updated
+struct BoundsDirty {
+    bool value = false;
+};
+
+// AABB version of the mesh when the world AABB is updated
+struct MeshAABBVersion {
+    uint64_t value = 0;
+};
+
+// World transform of a render object, in the object transform buffer of the
+// scene
+struct ObjectTransform {
+    glm::mat4 M;
+    glm::mat4 I_M;
+};
+
 struct CullingResult;
 
 class Scene : public IScene {
@@ -49,14 +101,40 @@ class Scene : public IScene {
                               std::shared_ptr<Mesh>,
                               std::shared_ptr<Material>,
                               std::shared_ptr<Skin>,
-                              UserData>;
+                              UserData,
+                              CullingProxy,
+                              WorldAABBMin,
+                              WorldAABBMax,
+                              BoundsDirty,
+                              MeshAABBVersion>;
     RenderObjects render_objects{};
 
+    // Should be called when the transform or the mesh of the render object
+    // changes. Bounds and the object transform are updated lazily in
+    // update_before_render(), which also updates bounds of render objects
+    // whose mesh AABB changes.
+    void mark_render_object_bounds_dirty(RenderObjects::Id id);
+    void remove_render_object_bounds(RenderObjects::Id id);
+    void update_dirty_render_object_bounds();
+    [[nodiscard]] math::AABB<float>
+    render_object_aabb_ws(uint32_t rd_obj_index) const;
+
+    // Transforms of render objects indexed by their ids, persistent across
+    // frames. Only transforms of dirty render objects are uploaded.
+    [[nodiscard]] Handle<Buffer> object_transform_buffer() const;
+
+    // Increased when render objects are created or destroyed, or their
+    // meshes, materials or skins change, but not when they move. Draw lists
+    // built from an older version are out of date.
+    [[nodiscard]] uint64_t draw_state_version() const;
+    void mark_draw_state_changed();
+
     using DirectionalLights =
         SoA<math::XformTRS<float>, Light, UserData, std::unique_ptr<ShadowMap>>;
     DirectionalLights directional_lights{};
 
-    using PointLights = SoA<math::XformTRS<float>, Light, UserData>;
+    using PointLights =
+        SoA<math::XformTRS<float>, Light, LightRange, UserData>;
     PointLights point_lights{};
 
     DirectionalLights::Id sun_id{};
@@ -71,22 +149,39 @@ class Scene : public IScene {
                      uint32_t rd_obj_index,
                      Material *override_material = nullptr);
 
-    std::vector<DrawRequest> gather_draw_request(RenderPassID pass_id);
+    FrameVector<DrawRequest> gather_draw_request(RenderPassID pass_id);
 
   private:
     CullingResult cull(const Frustum &frustum_ws);
+    void update_render_object_bounds(RenderObjects::Id id);
+    void mark_mesh_aabb_changed_render_objects();
+    void upload_object_transforms(FrameVector<RenderObjects::Id> &ids);
 
     Context *_context = nullptr;
+    math::AABBTree<float, RenderObjects::Id> _render_object_tree{};
+    std::vector<RenderObjects::Id> _dirty_render_object_bounds{};
+    // Latest mesh AABB version when bounds are updated
+    uint64_t _mesh_aabb_version = 0;
     math::AABB<float> _loaded_aabb_ws{};
     Handle<AccelerationStructure> _acceleration_structure{};
+    Handle<Buffer> _object_transform_buffer{};
+    uint64_t _draw_state_version = 0;
 };
 
 struct CullingResult {
     Scene *scene = nullptr;
-    std::vector<Scene::RenderObjects::Id> objects{};
+    FrameVector<Scene::RenderObjects::Id> objects{};
     math::AABB<float> visible_aabb_ws{};
-
-    [[nodiscard]] std::vector<DrawRequest>
+    // Sort keys of gathered requests order instances front to back along
+    // the view direction, which is zero if the culling has no view
+    glm::vec3 view_position_ws{};
+    glm::vec3 view_direction_ws{};
+    // Draw state version of the scene when culled
+    uint64_t draw_state_version = 0;
+    // See MaterialFactory::ready_version()
+    uint64_t material_ready_version = 0;
+
+    [[nodiscard]] FrameVector<DrawRequest>
     gather_draw_requests(RenderPassID pass_id) const;
 };
 
@@ -127,6 +222,10 @@ class PointLight : public IPointLight {
     void set_color(const glm::vec3 &color) override;
     float intensity() override;
     void set_intensity(float intensity) override;
+    float range() override;
+    void set_range(float range) override;
+    bool has_range() override;
+    void reset_range() override;
     uint64_t user_data() override;
     void set_user_data(uint64_t user_data) override;
     IScene *scene() override;
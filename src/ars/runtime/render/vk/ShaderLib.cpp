@@ -1,34 +1,54 @@
 #include "Vulkan.h"
 #include <ars/runtime/core/Log.h>
 #include <frill.h>
-#include <set>
-#include <sstream>
+#include <frill_hash.h>
+#include <algorithm>
+#include <mutex>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
 
 namespace ars::render::vk {
+namespace {
+// Code embedded by frill never moves, so lookups are kept by URI
+std::mutex s_spirv_code_mutex{};
+std::unordered_map<std::string, MemoryView> s_spirv_code{};
+} // namespace
+
 MemoryView
 load_spirv_code(const char *path, const char **flags, uint32_t flag_count) {
-    void *code = {};
-    size_t size = {};
-    std::set<std::string> unique_flags{};
-    for (int i = 0; i < flag_count; i++) {
-        unique_flags.emplace(flags[i]);
-    }
-    std::stringstream ss{};
-    bool is_first = true;
-    for (auto &flag : unique_flags) {
-        if (is_first) {
-            is_first = false;
-        } else {
-            ss << ",";
+    std::vector<std::string_view> unique_flags(flags, flags + flag_count);
+    std::sort(unique_flags.begin(), unique_flags.end());
+    unique_flags.erase(std::unique(unique_flags.begin(), unique_flags.end()),
+                       unique_flags.end());
+    std::string uri = path;
+    uri += "/flags=";
+    for (size_t i = 0; i < unique_flags.size(); i++) {
+        if (i > 0) {
+            uri += ",";
         }
-        ss << flag;
+        uri += unique_flags[i];
+    }
+
+    std::lock_guard<std::mutex> lock(s_spirv_code_mutex);
+    auto it = s_spirv_code.find(uri);
+    if (it != s_spirv_code.end()) {
+        return it->second;
     }
-    auto uri = fmt::format("{}/flags={}", path, ss.str());
+    void *code = {};
+    size_t size = {};
     frill::get_asset_bytes(uri.c_str(), &code, &size);
+    MemoryView view{reinterpret_cast<uint8_t *>(code), size};
     if (code == nullptr) {
         ARS_LOG_CRITICAL("Shader {} not found, have you add it to frill.json?",
                          path);
+        return view;
     }
-    return MemoryView{reinterpret_cast<uint8_t *>(code), size};
+    s_spirv_code.emplace(std::move(uri), view);
+    return view;
+}
+
+uint64_t embedded_spirv_hash() {
+    return ARS_EMBEDDED_SPIRV_HASH;
 }
 } // namespace ars::render::vk
\ No newline at end of file
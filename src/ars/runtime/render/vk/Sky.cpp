@@ -202,6 +202,7 @@ void SkyData::update_cache(RenderGraph &rg,
         [&](RenderGraphPassBuilder &builder) {
             builder.compute_shader_read(_tmp_env_map);
             builder.compute_shader_write(_irradiance_cube_map);
+            builder.async_compute(true);
         },
         [=](CommandBuffer *cmd) {
             ARS_PROFILER_SAMPLE_VK(cmd, "Prefilter Irradiance", 0xFF87411A);
@@ -260,10 +261,11 @@ void PhysicalSky::update(View *view, RenderGraph &rg) {
 }
 
 void PhysicalSky::init_atmosphere_settings_buffer() {
-    _atmosphere_settings_buffer =
-        _context->create_buffer(sizeof(AtmosphereSettings),
-                                VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-                                VMA_MEMORY_USAGE_CPU_TO_GPU);
+    for (auto &buffer : _atmosphere_settings_buffers) {
+        buffer = _context->create_buffer(sizeof(AtmosphereSettings),
+                                         VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+                                         VMA_MEMORY_USAGE_CPU_TO_GPU);
+    }
 
     // Initialize with earth data
     // Length unit is km
@@ -342,6 +344,7 @@ void PhysicalSky::update_transmittance_lut(RenderGraph &rg) {
     rg.add_pass(
         [&](RenderGraphPassBuilder &builder) {
             builder.compute_shader_write(_transmittance_lut);
+            builder.async_compute(true);
         },
         [=](CommandBuffer *cmd) {
             ARS_PROFILER_SAMPLE_VK(cmd, "Update Transmittance LUT", 0xFF692627);
@@ -349,7 +352,7 @@ void PhysicalSky::update_transmittance_lut(RenderGraph &rg) {
 
             DescriptorEncoder desc{};
             desc.set_texture(0, 0, _transmittance_lut.get());
-            desc.set_buffer(1, 0, _atmosphere_settings_buffer.get());
+            desc.set_buffer(1, 0, atmosphere_settings_buffer().get());
             desc.commit(cmd, _transmittance_lut_pipeline.get());
 
             _transmittance_lut_pipeline->local_size().dispatch(
@@ -381,6 +384,7 @@ void PhysicalSky::update_multi_scattering_lut(RenderGraph &rg) {
         [&](RenderGraphPassBuilder &builder) {
             builder.compute_shader_read(_transmittance_lut);
             builder.compute_shader_write(_multi_scattering_lut);
+            builder.async_compute(true);
         },
         [=](CommandBuffer *cmd) {
             ARS_PROFILER_SAMPLE_VK(
@@ -390,7 +394,7 @@ void PhysicalSky::update_multi_scattering_lut(RenderGraph &rg) {
             DescriptorEncoder desc{};
             desc.set_texture(0, 0, _multi_scattering_lut.get());
             desc.set_texture(0, 1, _transmittance_lut.get());
-            desc.set_buffer(1, 0, _atmosphere_settings_buffer.get());
+            desc.set_buffer(1, 0, atmosphere_settings_buffer().get());
             desc.commit(cmd, _multi_scattering_lut_pipeline.get());
 
             _multi_scattering_lut_pipeline->local_size().dispatch(
@@ -399,7 +403,7 @@ void PhysicalSky::update_multi_scattering_lut(RenderGraph &rg) {
 }
 
 Handle<Buffer> PhysicalSky::atmosphere_settings_buffer() {
-    return _atmosphere_settings_buffer;
+    return _atmosphere_settings_buffers[_context->frame_index()];
 }
 
 Handle<Texture> PhysicalSky::transmittance_lut() {
@@ -444,6 +448,7 @@ void PhysicalSky::update_aerial_perspective_lut(View *view, RenderGraph &rg) {
             builder.compute_shader_read(_transmittance_lut);
             builder.compute_shader_read(_multi_scattering_lut);
             builder.compute_shader_write(_aerial_perspective_lut);
+            builder.async_compute(true);
         },
         [=](CommandBuffer *cmd) {
             ARS_PROFILER_SAMPLE_VK(
@@ -454,7 +459,7 @@ void PhysicalSky::update_aerial_perspective_lut(View *view, RenderGraph &rg) {
             desc.set_texture(0, 0, _aerial_perspective_lut.get());
             desc.set_texture(0, 1, _transmittance_lut.get());
             desc.set_texture(0, 2, _multi_scattering_lut.get());
-            desc.set_buffer(1, 0, _atmosphere_settings_buffer.get());
+            desc.set_buffer(1, 0, atmosphere_settings_buffer().get());
             auto sun_param = get_atmosphere_sun_param(view);
             desc.set_buffer_data(1, 1, sun_param);
             desc.set_buffer(1, 2, view->transform_buffer().get());
@@ -512,6 +517,8 @@ void PhysicalSky::ray_march_sky_view(View *view,
             if (background) {
                 builder.compute_shader_read(NamedRT_Depth);
             }
+            // Sky view LUT only depends on other LUTs
+            builder.async_compute(!background);
         },
         [=](CommandBuffer *cmd) {
             ARS_PROFILER_SAMPLE_VK(cmd, "Ray March Sky View", 0xFF184371);
@@ -521,7 +528,7 @@ void PhysicalSky::ray_march_sky_view(View *view,
             desc.set_texture(0, 0, output_image.get());
             desc.set_texture(0, 1, _transmittance_lut.get());
             desc.set_texture(0, 2, _multi_scattering_lut.get());
-            desc.set_buffer(1, 0, _atmosphere_settings_buffer.get());
+            desc.set_buffer(1, 0, atmosphere_settings_buffer().get());
             auto sun_param = get_atmosphere_sun_param(view);
             desc.set_buffer_data(1, 1, sun_param);
             desc.set_buffer(1, 2, view->transform_buffer().get());
@@ -545,7 +552,7 @@ void PhysicalSky::update_atmosphere_settings_buffer() {
         _rayleigh_scattering * _rayleigh_scattering_strength;
     _atmosphere_settings.ozone_absorption =
         _ozone_absorption * _ozone_absorption_strength;
-    _atmosphere_settings_buffer->set_data(_atmosphere_settings);
+    atmosphere_settings_buffer()->set_data(_atmosphere_settings);
 }
 
 PhysicalSky::~PhysicalSky() = default;
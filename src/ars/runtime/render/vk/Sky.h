@@ -2,6 +2,7 @@
 
 #include "../IEffect.h"
 #include "Texture.h"
+#include <array>
 
 namespace ars::render::vk {
 class Context;
@@ -164,6 +165,7 @@ class PhysicalSky : public IPhysicalSky, public SkyBase {
 
     void update(View *view, RenderGraph &rg) override;
     void render_background(View *view, RenderGraph &rg) override;
+    // Buffer of the frame in flight being recorded
     Handle<Buffer> atmosphere_settings_buffer();
     Handle<Texture> transmittance_lut();
 
@@ -236,7 +238,9 @@ class PhysicalSky : public IPhysicalSky, public SkyBase {
     float _ozone_absorption_strength = {};
     glm::vec3 _ozone_absorption = {};
 
-    Handle<Buffer> _atmosphere_settings_buffer{};
+    // One per frame in flight, as settings are written every frame
+    std::array<Handle<Buffer>, MAX_FRAMES_IN_FLIGHT>
+        _atmosphere_settings_buffers{};
     Handle<Texture> _transmittance_lut{};
     Handle<Texture> _multi_scattering_lut{};
     Handle<Texture> _aerial_perspective_lut{};
@@ -618,9 +618,17 @@ void Swapchain::init_image_views() {
 void Swapchain::cleanup_swapchain() {
     Device *device = _context->device();
 
-    if (_image_ready_semaphore != VK_NULL_HANDLE) {
-        device->Destroy(_image_ready_semaphore);
+    for (auto &sem : _image_ready_semaphores) {
+        if (sem != VK_NULL_HANDLE) {
+            device->Destroy(sem);
+            sem = VK_NULL_HANDLE;
+        }
+    }
+
+    for (auto sem : _render_finished_semaphores) {
+        device->Destroy(sem);
     }
+    _render_finished_semaphores.clear();
 
     for (auto fb : _framebuffers) {
         device->Destroy(fb);
@@ -648,9 +656,11 @@ void Swapchain::present(ITexture *texture) {
     }
 
     uint32_t image_index = 0;
+    auto image_ready_semaphore =
+        _image_ready_semaphores[_context->frame_index()];
     auto acquire_result = device->AcquireNextImageKHR(_swapchain,
                                                       UINT64_MAX,
-                                                      _image_ready_semaphore,
+                                                      image_ready_semaphore,
                                                       VK_NULL_HANDLE,
                                                       &image_index);
     if (acquire_result == VK_ERROR_OUT_OF_DATE_KHR) {
@@ -718,15 +728,16 @@ void Swapchain::present(ITexture *texture) {
             cmd->EndRenderPass();
         },
         1,
-        &_image_ready_semaphore);
+        &image_ready_semaphore,
+        1,
+        &_render_finished_semaphores[image_index]);
 
     {
         ARS_PROFILER_SAMPLE("Submit", 0xFF715391);
-        auto blit_finish_sem = queue->get_semaphore();
-
         VkPresentInfoKHR present_info{VK_STRUCTURE_TYPE_PRESENT_INFO_KHR};
         present_info.waitSemaphoreCount = 1;
-        present_info.pWaitSemaphores = &blit_finish_sem;
+        present_info.pWaitSemaphores =
+            &_render_finished_semaphores[image_index];
         present_info.swapchainCount = 1;
         present_info.pSwapchains = &_swapchain;
         present_info.pImageIndices = &image_index;
@@ -830,10 +841,19 @@ void Swapchain::init_render_pass() {
 }
 
 void Swapchain::init_semaphores() {
+    auto device = _context->device();
     VkSemaphoreCreateInfo info{VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO};
-    if (_context->device()->Create(&info, &_image_ready_semaphore) !=
-        VK_SUCCESS) {
-        ARS_LOG_CRITICAL("Failed to create image ready semaphore");
+    for (auto &sem : _image_ready_semaphores) {
+        if (device->Create(&info, &sem) != VK_SUCCESS) {
+            ARS_LOG_CRITICAL("Failed to create image ready semaphore");
+        }
+    }
+
+    _render_finished_semaphores.resize(_images.size());
+    for (auto &sem : _render_finished_semaphores) {
+        if (device->Create(&info, &sem) != VK_SUCCESS) {
+            ARS_LOG_CRITICAL("Failed to create render finished semaphore");
+        }
     }
 }
 
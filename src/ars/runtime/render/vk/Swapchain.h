@@ -3,6 +3,7 @@
 #include "../ITexture.h"
 #include "../IWindow.h"
 #include "Vulkan.h"
+#include <array>
 #include <vector>
 
 struct GLFWwindow;
@@ -106,8 +107,12 @@ class Swapchain : public IWindow {
     std::unique_ptr<GraphicsPipeline> _pipeline{};
     std::vector<VkFramebuffer> _framebuffers{};
 
-    // Now we don't support frames in flight. One semaphore is fine.
-    VkSemaphore _image_ready_semaphore{};
+    // Acquire semaphores are indexed by the frame in flight, and can be
+    // reused after the context waits the frame. Present semaphores are
+    // indexed by swapchain images, as the wait of presentation can not be
+    // tracked by fences.
+    std::array<VkSemaphore, MAX_FRAMES_IN_FLIGHT> _image_ready_semaphores{};
+    std::vector<VkSemaphore> _render_finished_semaphores{};
 
     std::unique_ptr<ImGuiPass> _imgui{};
     std::optional<std::function<void()>> _imgui_callback{};
@@ -4,7 +4,9 @@
 #include "Profiler.h"
 #include "RenderGraph.h"
 #include <ars/runtime/core/Log.h>
+#include <atomic>
 #include <cassert>
+#include <numeric>
 
 namespace ars::render::vk {
 namespace {
@@ -30,19 +32,129 @@ remove_unsupported_image_usages(VkImageUsageFlags usages,
 
     return usages;
 }
+
+TextureCreateInfo correct_texture_create_info(Context *context,
+                                              const TextureCreateInfo &info) {
+    auto corrected = info;
+    corrected.mip_levels = std::clamp(
+        calculate_mip_levels(
+            info.extent.width, info.extent.height, info.extent.depth),
+        1u,
+        info.mip_levels);
+
+    auto inst = context->instance();
+
+    VkFormatProperties properties{};
+    inst->GetPhysicalDeviceFormatProperties(
+        context->device()->physical_device(), info.format, &properties);
+    corrected.usage = remove_unsupported_image_usages(
+        info.usage, properties.optimalTilingFeatures);
+    return corrected;
+}
+
+VkImageCreateInfo image_create_info(const TextureCreateInfo &info) {
+    VkImageCreateInfo image_info{VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO};
+    image_info.arrayLayers = info.array_layers;
+    image_info.imageType = info.image_type;
+    image_info.mipLevels = info.mip_levels;
+    image_info.samples = info.samples;
+    image_info.extent = info.extent;
+    image_info.format = info.format;
+    image_info.usage = info.usage;
+
+    image_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    image_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+
+    if (info.view_type == VK_IMAGE_VIEW_TYPE_CUBE ||
+        info.view_type == VK_IMAGE_VIEW_TYPE_CUBE_ARRAY) {
+        image_info.flags |= VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT;
+    }
+
+    // All textures are used exclusively.
+    // Concurrent access disables some potential optimizations from driver.
+    // (Like Delta Color Compression(DCC) from AMD drivers, see
+    // https://www.khronos.org/assets/uploads/developers/presentations/06-Optimising-aaa-vulkan-title-on-desktop-May19.pdf)
+    image_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    return image_info;
+}
+} // namespace
+
+TextureMemory::TextureMemory(Context *context,
+                             const VkMemoryRequirements &requirements)
+    : _context(context), _size(requirements.size) {
+    VmaAllocationCreateInfo alloc_info{};
+    alloc_info.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+
+    if (vmaAllocateMemory(_context->vma()->raw(),
+                          &requirements,
+                          &alloc_info,
+                          &_allocation,
+                          nullptr) != VK_SUCCESS) {
+        ARS_LOG_CRITICAL("Failed to allocate texture memory");
+    }
+}
+
+TextureMemory::~TextureMemory() {
+    if (_allocation != VK_NULL_HANDLE) {
+        vmaFreeMemory(_context->vma()->raw(), _allocation);
+    }
+}
+
+VmaAllocation TextureMemory::allocation() const {
+    return _allocation;
+}
+
+VkDeviceSize TextureMemory::size() const {
+    return _size;
+}
+
+namespace {
+std::atomic<uint64_t> s_texture_id_counter{0};
 } // namespace
 
 Texture::Texture(Context *context, const TextureCreateInfo &info)
-    : _context(context), _info(info) {
-    correct_texture_create_info();
+    : _context(context), _info(correct_texture_create_info(context, info)) {
+    _image_view_of_levels.resize(_info.mip_levels);
+
+    init();
 
+    _id = s_texture_id_counter.fetch_add(1, std::memory_order_relaxed);
+    _bindless_id = _context->bindless_resources()->make_resident(this);
+}
+
+Texture::Texture(Context *context,
+                 const TextureCreateInfo &info,
+                 std::shared_ptr<TextureMemory> memory,
+                 VkDeviceSize memory_offset)
+    : _context(context), _memory(std::move(memory)),
+      _memory_offset(memory_offset),
+      _info(correct_texture_create_info(context, info)) {
+    assert(_memory != nullptr);
     _image_view_of_levels.resize(_info.mip_levels);
 
     init();
 
+    _id = s_texture_id_counter.fetch_add(1, std::memory_order_relaxed);
     _bindless_id = _context->bindless_resources()->make_resident(this);
 }
 
+VkMemoryRequirements
+Texture::memory_requirements(Context *context, const TextureCreateInfo &info) {
+    auto image_info =
+        image_create_info(correct_texture_create_info(context, info));
+    auto device = context->device();
+
+    VkMemoryRequirements requirements{};
+    VkImage image = VK_NULL_HANDLE;
+    if (device->Create(&image_info, &image) != VK_SUCCESS) {
+        ARS_LOG_CRITICAL("Failed to create image");
+        return requirements;
+    }
+    device->GetImageMemoryRequirements(image, &requirements);
+    device->Destroy(image);
+    return requirements;
+}
+
 Texture::~Texture() {
     _context->bindless_resources()->make_none_resident(this);
     if (_sampler != VK_NULL_HANDLE) {
@@ -60,7 +172,11 @@ Texture::~Texture() {
     }
 
     if (_image != VK_NULL_HANDLE) {
-        vmaDestroyImage(_context->vma()->raw(), _image, _allocation);
+        if (_memory != nullptr) {
+            _context->device()->Destroy(_image);
+        } else {
+            vmaDestroyImage(_context->vma()->raw(), _image, _allocation);
+        }
     }
 }
 
@@ -68,50 +184,60 @@ VkImageSubresourceRange Texture::subresource_range() const {
     return subresource_range(0, _info.mip_levels);
 }
 
-void Texture::set_data(void *data,
-                       size_t size,
-                       uint32_t mip_level,
-                       uint32_t layer,
-                       int32_t x_offset,
-                       int32_t y_offset,
-                       int32_t z_offset,
-                       uint32_t x_size,
-                       uint32_t y_size,
-                       uint32_t z_size) {
-    _context->queue()->submit_once([&](CommandBuffer *cmd) {
-        auto stage_buffer = _context->create_buffer(
-            size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_ONLY);
-        stage_buffer->map_once(
-            [&](void *ptr) { std::memcpy(ptr, data, size); });
-
-        transfer_layout(cmd,
-                        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-                        VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
-                        0,
-                        VK_PIPELINE_STAGE_TRANSFER_BIT,
-                        VK_ACCESS_TRANSFER_WRITE_BIT);
-
-        VkBufferImageCopy region{};
-        region.bufferOffset = 0;
-        region.bufferRowLength = 0;
-        region.bufferImageHeight = 0;
-        region.imageSubresource.aspectMask = _info.aspect_mask;
-        region.imageSubresource.mipLevel = mip_level;
-        region.imageSubresource.baseArrayLayer = layer;
-        region.imageSubresource.layerCount = 1;
-        region.imageOffset = {x_offset, y_offset, z_offset};
-        region.imageExtent = {x_size, y_size, z_size};
-
-        cmd->CopyBufferToImage(
-            stage_buffer->buffer(), _image, _layout, 1, &region);
-
-        transfer_layout(cmd,
-                        VK_IMAGE_LAYOUT_GENERAL,
-                        VK_PIPELINE_STAGE_TRANSFER_BIT,
-                        VK_ACCESS_TRANSFER_WRITE_BIT,
-                        VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
-                        0);
-    });
+UploadToken Texture::set_data(void *data,
+                              size_t size,
+                              uint32_t mip_level,
+                              uint32_t layer,
+                              int32_t x_offset,
+                              int32_t y_offset,
+                              int32_t z_offset,
+                              uint32_t x_size,
+                              uint32_t y_size,
+                              uint32_t z_size) {
+    // Offset of staging data must be multiple of both texel size and 4
+    auto texel_count = static_cast<VkDeviceSize>(x_size) * y_size * z_size;
+    auto texel_size = std::max<VkDeviceSize>(size / texel_count, 1);
+    auto alignment = std::lcm<VkDeviceSize>(texel_size, 4);
+
+    return _context->uploader()->upload(
+        data,
+        size,
+        alignment,
+        [&](CommandBuffer *cmd, VkBuffer staging, VkDeviceSize offset) {
+            transfer_layout(cmd,
+                            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                            VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                            0,
+                            VK_PIPELINE_STAGE_TRANSFER_BIT,
+                            VK_ACCESS_TRANSFER_WRITE_BIT);
+
+            VkBufferImageCopy region{};
+            region.bufferOffset = offset;
+            region.bufferRowLength = 0;
+            region.bufferImageHeight = 0;
+            region.imageSubresource.aspectMask = _info.aspect_mask;
+            region.imageSubresource.mipLevel = mip_level;
+            region.imageSubresource.baseArrayLayer = layer;
+            region.imageSubresource.layerCount = 1;
+            region.imageOffset = {x_offset, y_offset, z_offset};
+            region.imageExtent = {x_size, y_size, z_size};
+
+            cmd->CopyBufferToImage(staging, _image, _layout, 1, &region);
+
+            // Uploaded textures are sampled by shaders, or read by
+            // transfers like mipmap generation
+            transfer_layout(cmd,
+                            VK_IMAGE_LAYOUT_GENERAL,
+                            VK_PIPELINE_STAGE_TRANSFER_BIT,
+                            VK_ACCESS_TRANSFER_WRITE_BIT,
+                            VK_PIPELINE_STAGE_VERTEX_SHADER_BIT |
+                                VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT |
+                                VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT |
+                                VK_PIPELINE_STAGE_TRANSFER_BIT,
+                            VK_ACCESS_SHADER_READ_BIT |
+                                VK_ACCESS_TRANSFER_READ_BIT |
+                                VK_ACCESS_TRANSFER_WRITE_BIT);
+        });
 }
 
 void Texture::generate_mipmap(CommandBuffer *cmd,
@@ -375,40 +501,33 @@ Context *Texture::context() const {
 }
 
 void Texture::init() {
-    VkImageCreateInfo image_info{VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO};
-    image_info.arrayLayers = _info.array_layers;
-    image_info.imageType = _info.image_type;
-    image_info.mipLevels = _info.mip_levels;
-    image_info.samples = _info.samples;
-    image_info.extent = _info.extent;
-    image_info.format = _info.format;
-    image_info.usage = _info.usage;
-
-    image_info.initialLayout = _layout = VK_IMAGE_LAYOUT_UNDEFINED;
-    image_info.tiling = VK_IMAGE_TILING_OPTIMAL;
-
-    if (_info.view_type == VK_IMAGE_VIEW_TYPE_CUBE ||
-        _info.view_type == VK_IMAGE_VIEW_TYPE_CUBE_ARRAY) {
-        image_info.flags |= VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT;
-    }
-
-    // All textures are used exclusively.
-    // Concurrent access disables some potential optimizations from driver.
-    // (Like Delta Color Compression(DCC) from AMD drivers, see
-    // https://www.khronos.org/assets/uploads/developers/presentations/06-Optimising-aaa-vulkan-title-on-desktop-May19.pdf)
-    image_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-
-    VmaAllocationCreateInfo alloc_info{};
-    alloc_info.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+    auto image_info = image_create_info(_info);
+    _layout = image_info.initialLayout;
 
     auto vma = _context->vma();
-    if (vmaCreateImage(vma->raw(),
-                       &image_info,
-                       &alloc_info,
-                       &_image,
-                       &_allocation,
-                       nullptr) != VK_SUCCESS) {
-        ARS_LOG_CRITICAL("Failed to create image");
+    if (_memory != nullptr) {
+        if (_context->device()->Create(&image_info, &_image) != VK_SUCCESS) {
+            ARS_LOG_CRITICAL("Failed to create image");
+        }
+        if (vmaBindImageMemory2(vma->raw(),
+                                _memory->allocation(),
+                                _memory_offset,
+                                _image,
+                                nullptr) != VK_SUCCESS) {
+            ARS_LOG_CRITICAL("Failed to bind image memory");
+        }
+    } else {
+        VmaAllocationCreateInfo alloc_info{};
+        alloc_info.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+
+        if (vmaCreateImage(vma->raw(),
+                           &image_info,
+                           &alloc_info,
+                           &_image,
+                           &_allocation,
+                           nullptr) != VK_SUCCESS) {
+            ARS_LOG_CRITICAL("Failed to create image");
+        }
     }
 
     _image_view = create_image_view(0, _info.mip_levels);
@@ -459,26 +578,14 @@ void Texture::generate_mipmap(const Handle<Texture> &tex, RenderGraph &rg) {
         });
 }
 
-void Texture::correct_texture_create_info() {
-    _info.mip_levels = std::clamp(calculate_mip_levels(_info.extent.width,
-                                                       _info.extent.height,
-                                                       _info.extent.depth),
-                                  1u,
-                                  _info.mip_levels);
-
-    auto inst = _context->instance();
-
-    VkFormatProperties properties{};
-    inst->GetPhysicalDeviceFormatProperties(
-        _context->device()->physical_device(), _info.format, &properties);
-    _info.usage = remove_unsupported_image_usages(
-        _info.usage, properties.optimalTilingFeatures);
-}
-
 int32_t Texture::bindless_id() const {
     return _bindless_id;
 }
 
+uint64_t Texture::id() const {
+    return _id;
+}
+
 TextureCreateInfo
 TextureCreateInfo::sampled_2d(VkFormat format,
                               uint32_t width,
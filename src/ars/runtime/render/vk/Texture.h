@@ -1,6 +1,7 @@
 #pragma once
 
 #include "../ITexture.h"
+#include "Upload.h"
 #include "Vulkan.h"
 #include <vector>
 
@@ -57,24 +58,51 @@ VkFormat translate(render::Format format);
 
 TextureCreateInfo translate(const render::TextureInfo &info);
 
+// Device memory shared by textures whose contents never live at the same time.
+// Aliased textures keep the memory alive.
+class TextureMemory {
+  public:
+    TextureMemory(Context *context, const VkMemoryRequirements &requirements);
+
+    ARS_NO_COPY_MOVE(TextureMemory);
+
+    ~TextureMemory();
+
+    [[nodiscard]] VmaAllocation allocation() const;
+    [[nodiscard]] VkDeviceSize size() const;
+
+  private:
+    Context *_context = nullptr;
+    VmaAllocation _allocation = VK_NULL_HANDLE;
+    VkDeviceSize _size = 0;
+};
+
 class Texture : public ITextureHandle {
   public:
     Texture(Context *context, const TextureCreateInfo &info);
+    // Bind the image to the memory at offset instead of allocating its own.
+    // Contents are undefined whenever another texture aliasing the same range
+    // has been written.
+    Texture(Context *context,
+            const TextureCreateInfo &info,
+            std::shared_ptr<TextureMemory> memory,
+            VkDeviceSize memory_offset);
 
     ARS_NO_COPY_MOVE(Texture);
 
     ~Texture() override;
 
-    void set_data(void *data,
-                  size_t size,
-                  uint32_t mip_level,
-                  uint32_t layer,
-                  int32_t x_offset,
-                  int32_t y_offset,
-                  int32_t z_offset,
-                  uint32_t x_size,
-                  uint32_t y_size,
-                  uint32_t z_size);
+    // The upload is asynchronous, use the returned token to wait for it
+    UploadToken set_data(void *data,
+                         size_t size,
+                         uint32_t mip_level,
+                         uint32_t layer,
+                         int32_t x_offset,
+                         int32_t y_offset,
+                         int32_t z_offset,
+                         uint32_t x_size,
+                         uint32_t y_size,
+                         uint32_t z_size);
 
     void generate_mipmap(CommandBuffer *cmd,
                          VkPipelineStageFlags src_stage_mask,
@@ -96,9 +124,16 @@ class Texture : public ITextureHandle {
     [[nodiscard]] const TextureCreateInfo &info() const;
 
     [[nodiscard]] int32_t bindless_id() const;
+    // Unique in creation order and never reused, unlike VkImage handles
+    [[nodiscard]] uint64_t id() const;
 
     void assure_layout(VkImageLayout layout);
 
+    // Memory requirements of the image created with the info, without creating
+    // the texture
+    static VkMemoryRequirements
+    memory_requirements(Context *context, const TextureCreateInfo &info);
+
     [[nodiscard]] VkImageSubresourceRange subresource_range() const;
     [[nodiscard]] VkImageSubresourceRange
     subresource_range(uint32_t base_mip_level, uint32_t level_count) const;
@@ -117,7 +152,6 @@ class Texture : public ITextureHandle {
                          VkAccessFlags dst_access_mask);
 
   private:
-    void correct_texture_create_info();
     void init();
 
     // Call this method after _image and _info initialized
@@ -126,6 +160,9 @@ class Texture : public ITextureHandle {
 
     Context *_context = nullptr;
     VmaAllocation _allocation = VK_NULL_HANDLE;
+    // Not null if the image is bound to shared memory
+    std::shared_ptr<TextureMemory> _memory{};
+    VkDeviceSize _memory_offset = 0;
     VkImage _image = VK_NULL_HANDLE;
     VkImageView _image_view = VK_NULL_HANDLE;
     std::vector<VkImageView> _image_view_of_levels{};
@@ -134,6 +171,7 @@ class Texture : public ITextureHandle {
     // the same layout
     VkImageLayout _layout = VK_IMAGE_LAYOUT_UNDEFINED;
     int32_t _bindless_id{};
+    uint64_t _id = 0;
 
     TextureCreateInfo _info{};
 };
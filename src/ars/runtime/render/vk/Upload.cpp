@@ -0,0 +1,216 @@
+#include "Upload.h"
+#include "Buffer.h"
+#include "Context.h"
+#include <ars/runtime/core/Log.h>
+#include <cassert>
+#include <cstring>
+
+namespace ars::render::vk {
+Uploader::Uploader(Context *context, VkDeviceSize staging_size)
+    : _context(context) {
+    _ring = _context->create_buffer(staging_size,
+                                    VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                                    VMA_MEMORY_USAGE_CPU_ONLY);
+    // Keep the ring mapped during the life time of the uploader
+    _ring_data = reinterpret_cast<uint8_t *>(_ring->map());
+    _batch.token = 1;
+}
+
+Uploader::~Uploader() {
+    flush();
+    while (!_batches_in_flight.empty()) {
+        wait_oldest_batch();
+    }
+
+    auto device = _context->device();
+    for (auto fence : _free_fences) {
+        device->Destroy(fence);
+    }
+
+    _ring->unmap();
+}
+
+void Uploader::flush() {
+    std::lock_guard<std::recursive_mutex> lock(_mutex);
+    flush_locked();
+}
+
+bool Uploader::is_complete(UploadToken token) {
+    std::lock_guard<std::recursive_mutex> lock(_mutex);
+    retire_completed_batches();
+    return token <= _completed_token;
+}
+
+void Uploader::wait(UploadToken token) {
+    std::lock_guard<std::recursive_mutex> lock(_mutex);
+    if (token >= _batch.token) {
+        flush_locked();
+    }
+    while (token > _completed_token && !_batches_in_flight.empty()) {
+        wait_oldest_batch();
+    }
+}
+
+uint64_t Uploader::submitted_batch_count() const {
+    return _submitted_batch_count;
+}
+
+Uploader::Staging Uploader::stage(const void *data,
+                                  VkDeviceSize size,
+                                  VkDeviceSize alignment) {
+    auto ring_size = _ring->size();
+
+    // Large uploads use their own staging buffer to avoid draining the ring
+    if (size > ring_size / 2) {
+        auto buffer = _context->create_buffer(
+            size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_ONLY);
+        buffer->map_once([&](void *ptr) { std::memcpy(ptr, data, size); });
+        _batch.dedicated_buffers.push_back(buffer);
+        return {buffer->buffer(), 0};
+    }
+
+    while (true) {
+        auto pos = _ring_head % ring_size;
+        auto offset = (pos + alignment - 1) / alignment * alignment;
+        auto begin = _ring_head + (offset - pos);
+        if (offset + size > ring_size) {
+            // Skip the rest of the ring and wrap around
+            offset = 0;
+            begin = _ring_head + (ring_size - pos);
+        }
+        auto end = begin + size;
+
+        if (end - _ring_tail <= ring_size) {
+            _ring_head = end;
+            std::memcpy(_ring_data + offset, data, size);
+            return {_ring->buffer(), offset};
+        }
+
+        // Not enough space, wait for previous uploads to release memory
+        auto tail = _ring_tail;
+        retire_completed_batches();
+        if (_ring_tail != tail) {
+            continue;
+        }
+
+        if (!_batches_in_flight.empty()) {
+            wait_oldest_batch();
+        } else if (_ring_head != _ring_tail) {
+            // The pending batch holds the memory
+            flush_locked();
+        } else {
+            // The ring is empty, restart from its beginning
+            _ring_head -= pos;
+            _ring_tail = _ring_head;
+        }
+    }
+}
+
+CommandBuffer *Uploader::command_buffer() {
+    if (_cmd == nullptr) {
+        _cmd = _context->create_command_buffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY);
+        _cmd->begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+        // Persistent buffers like object transforms are overwritten while
+        // earlier submissions may still read them
+        _cmd->PipelineBarrier(VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+                              VK_PIPELINE_STAGE_TRANSFER_BIT,
+                              0,
+                              0,
+                              nullptr,
+                              0,
+                              nullptr,
+                              0,
+                              nullptr);
+    } else if (_batch_has_commands) {
+        // Uploads may write to the same memory
+        VkMemoryBarrier barrier{VK_STRUCTURE_TYPE_MEMORY_BARRIER};
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask =
+            VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+        _cmd->PipelineBarrier(VK_PIPELINE_STAGE_TRANSFER_BIT,
+                              VK_PIPELINE_STAGE_TRANSFER_BIT,
+                              0,
+                              1,
+                              &barrier,
+                              0,
+                              nullptr,
+                              0,
+                              nullptr);
+    }
+    _batch_has_commands = true;
+    return _cmd.get();
+}
+
+void Uploader::flush_locked() {
+    if (_cmd == nullptr) {
+        return;
+    }
+
+    // Reset the pending command buffer first, as the queue flushes the
+    // uploader again on submission
+    auto cmd = _cmd;
+    _cmd = nullptr;
+    // Submissions after the batch only wait for it at the top of pipe, make
+    // the uploaded data visible to whatever reads it later
+    VkMemoryBarrier barrier{VK_STRUCTURE_TYPE_MEMORY_BARRIER};
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT |
+                            VK_ACCESS_MEMORY_WRITE_BIT;
+    cmd->PipelineBarrier(VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+                         0,
+                         1,
+                         &barrier,
+                         0,
+                         nullptr,
+                         0,
+                         nullptr);
+    cmd->end();
+
+    auto queue = _context->queue();
+    queue->submit(cmd.get());
+
+    VkFence fence = VK_NULL_HANDLE;
+    auto device = _context->device();
+    if (!_free_fences.empty()) {
+        fence = _free_fences.back();
+        _free_fences.pop_back();
+        device->ResetFences(1, &fence);
+    } else {
+        VkFenceCreateInfo fence_info{VK_STRUCTURE_TYPE_FENCE_CREATE_INFO};
+        if (device->Create(&fence_info, &fence) != VK_SUCCESS) {
+            ARS_LOG_CRITICAL("Failed to create upload fence");
+        }
+    }
+    queue->submit_fence(fence);
+
+    auto token = _batch.token;
+    _batch.fence = fence;
+    _batch.ring_end = _ring_head;
+    _batches_in_flight.push_back(std::move(_batch));
+    _batch = Batch{};
+    _batch.token = token + 1;
+    _batch_has_commands = false;
+    _submitted_batch_count++;
+}
+
+void Uploader::retire_completed_batches() {
+    auto device = _context->device();
+    while (!_batches_in_flight.empty() &&
+           device->GetFenceStatus(_batches_in_flight.front().fence) ==
+               VK_SUCCESS) {
+        auto &batch = _batches_in_flight.front();
+        _ring_tail = batch.ring_end;
+        _completed_token = batch.token;
+        _free_fences.push_back(batch.fence);
+        _batches_in_flight.pop_front();
+    }
+}
+
+void Uploader::wait_oldest_batch() {
+    assert(!_batches_in_flight.empty());
+    auto fence = _batches_in_flight.front().fence;
+    _context->device()->WaitForFences(1, &fence, VK_TRUE, UINT64_MAX);
+    retire_completed_batches();
+}
+} // namespace ars::render::vk
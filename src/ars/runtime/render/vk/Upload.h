@@ -0,0 +1,106 @@
+#pragma once
+
+#include "Vulkan.h"
+#include <deque>
+#include <mutex>
+
+namespace ars::render::vk {
+class Buffer;
+class Context;
+
+// Identifies the batch an upload is recorded in
+using UploadToken = uint64_t;
+
+// Batches transfers from host memory into GPU only resources.
+//
+// Data is copied into a persistently mapped staging ring, and copy commands
+// from all uploads are recorded into one command buffer. The batch is
+// submitted before any other submission on the primary queue, or at the end
+// of the frame, and ends with a barrier making the transfers visible to all
+// later commands.
+class Uploader {
+  public:
+    explicit Uploader(Context *context,
+                      VkDeviceSize staging_size = 16 * 1024 * 1024);
+
+    ARS_NO_COPY_MOVE(Uploader);
+
+    ~Uploader();
+
+    // Copy size bytes of data into staging memory aligned to alignment, then
+    // call func(cmd, staging_buffer, staging_offset) to record copy commands.
+    // Commands recorded by previous uploads are visible to transfer
+    // operations of this upload.
+    template <typename Func>
+    UploadToken upload(const void *data,
+                       VkDeviceSize size,
+                       VkDeviceSize alignment,
+                       Func &&func);
+
+    // Submit the pending batch
+    void flush();
+
+    [[nodiscard]] bool is_complete(UploadToken token);
+    void wait(UploadToken token);
+
+    // Number of batches submitted since the uploader is created
+    [[nodiscard]] uint64_t submitted_batch_count() const;
+
+  private:
+    struct Staging {
+        VkBuffer buffer = VK_NULL_HANDLE;
+        VkDeviceSize offset = 0;
+    };
+
+    struct Batch {
+        UploadToken token = 0;
+        VkFence fence = VK_NULL_HANDLE;
+        // Staging ring memory before this position is free once the batch
+        // completes
+        uint64_t ring_end = 0;
+        // Staging buffers for uploads larger than the ring
+        std::vector<Handle<Buffer>> dedicated_buffers{};
+    };
+
+    // These methods require the mutex locked
+    Staging stage(const void *data, VkDeviceSize size, VkDeviceSize alignment);
+    CommandBuffer *command_buffer();
+    void flush_locked();
+    void retire_completed_batches();
+    // Wait the oldest batch in flight
+    void wait_oldest_batch();
+
+    Context *_context = nullptr;
+    // Uploads are recorded while the queue may flush the batch in the same
+    // thread
+    std::recursive_mutex _mutex{};
+
+    Handle<Buffer> _ring{};
+    uint8_t *_ring_data = nullptr;
+    // Monotonic positions in the ring. The ring offset of a position is
+    // position % ring size.
+    uint64_t _ring_head = 0;
+    uint64_t _ring_tail = 0;
+
+    // The batch being recorded
+    Handle<CommandBuffer> _cmd{};
+    Batch _batch{};
+    bool _batch_has_commands = false;
+
+    std::deque<Batch> _batches_in_flight{};
+    std::vector<VkFence> _free_fences{};
+    UploadToken _completed_token = 0;
+    uint64_t _submitted_batch_count = 0;
+};
+
+template <typename Func>
+UploadToken Uploader::upload(const void *data,
+                             VkDeviceSize size,
+                             VkDeviceSize alignment,
+                             Func &&func) {
+    std::lock_guard<std::recursive_mutex> lock(_mutex);
+    auto staging = stage(data, size, alignment);
+    func(command_buffer(), staging.buffer, staging.offset);
+    return _batch.token;
+}
+} // namespace ars::render::vk
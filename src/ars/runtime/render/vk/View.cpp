@@ -6,6 +6,7 @@
 #include "Mesh.h"
 #include "Pipeline.h"
 #include "Profiler.h"
+#include "RenderGraph.h"
 #include "Scene.h"
 #include "Sky.h"
 #include "features/Drawer.h"
@@ -37,6 +38,8 @@ void View::render(const RenderOptions &options) {
     rg.output(NamedRT_LinearColor);
     rg.compile();
     rg.execute();
+    _transient_stats = rg.transient_stats();
+    _barrier_stats = rg.barrier_stats();
 
     // Finalize render
     update_color_tex_adapter(final_rt);
@@ -53,11 +56,15 @@ View::View(Scene *scene, const Extent2D &size) : _scene(scene) {
 
     _rt_manager = std::make_unique<RenderTargetManager>(scene->context());
     _rt_manager->update(translate(size));
-
-    _transform_buffer =
-        context()->create_buffer(sizeof(ViewTransform),
-                                 VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-                                 VMA_MEMORY_USAGE_CPU_TO_GPU);
+    _transient_pool =
+        std::make_unique<TransientTexturePool>(scene->context());
+    _render_graph_cache = std::make_unique<RenderGraphCache>();
+
+    for (auto &buffer : _transform_buffers) {
+        buffer = context()->create_buffer(sizeof(ViewTransform),
+                                          VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+                                          VMA_MEMORY_USAGE_CPU_TO_GPU);
+    }
     alloc_render_targets();
 
     _renderer = std::make_unique<Renderer>(this);
@@ -149,6 +156,14 @@ RenderTargetId View::rt_id(NamedRT name) const {
     return _rt_ids[name];
 }
 
+TransientTexturePool *View::transient_pool() const {
+    return _transient_pool.get();
+}
+
+RenderGraphCache *View::render_graph_cache() const {
+    return _render_graph_cache.get();
+}
+
 Scene *View::scene_vk() const {
     return _scene;
 }
@@ -294,6 +309,37 @@ void View::debug_gui() {
     draw_rt("GBuffer 2", NamedRT_GBuffer2);
     draw_rt("GBuffer 3", NamedRT_GBuffer3);
     draw_rt("Reflection", NamedRT_Reflection);
+
+    auto to_mib = [](VkDeviceSize size) {
+        return static_cast<double>(size) / (1024.0 * 1024.0);
+    };
+    ImGui::Text("Transient Textures: %u", _transient_stats.texture_count);
+    ImGui::Text("Transient Memory: %.2f MiB (%.2f MiB without aliasing)",
+                to_mib(_transient_stats.aliased_size),
+                to_mib(_transient_stats.unaliased_size));
+    ImGui::Text("Pipeline Barriers: %u (%u without state tracking)",
+                _barrier_stats.pipeline_barrier_count,
+                _barrier_stats.naive_pipeline_barrier_count);
+    ImGui::Text("Image Barriers: %u (%u without state tracking)",
+                _barrier_stats.image_barrier_count,
+                _barrier_stats.naive_image_barrier_count);
+    ImGui::Text("Buffer Barriers: %u (%u without state tracking)",
+                _barrier_stats.buffer_barrier_count,
+                _barrier_stats.naive_buffer_barrier_count);
+    ImGui::Text("Async Compute Passes: %u",
+                _barrier_stats.async_compute_pass_count);
+    ImGui::Text("Queue Submits: %u, Ownership Transfers: %u",
+                _barrier_stats.queue_submit_count,
+                _barrier_stats.ownership_transfer_count);
+    ImGui::Text("Compiled Graph Cache: %llu hits, %llu misses",
+                static_cast<unsigned long long>(
+                    _render_graph_cache->hit_count()),
+                static_cast<unsigned long long>(
+                    _render_graph_cache->miss_count()));
+    auto parallel_recording = _drawer->parallel_recording();
+    if (ImGui::Checkbox("Parallel Recording", &parallel_recording)) {
+        _drawer->set_parallel_recording(parallel_recording);
+    }
     ImGui::End();
 }
 
@@ -324,7 +370,7 @@ Effect *View::effect_vk() {
 }
 
 Handle<Buffer> View::transform_buffer() {
-    return _transform_buffer;
+    return _transform_buffers[context()->frame_index()];
 }
 
 void View::update_transform_buffer() {
@@ -343,7 +389,7 @@ void View::update_transform_buffer() {
     t.z_near = camera().z_near();
     t.z_far = camera().z_far();
 
-    _transform_buffer->set_data(t);
+    transform_buffer()->set_data(t);
 }
 
 ViewData View::data() const {
@@ -2,6 +2,7 @@
 
 #include "../IScene.h"
 #include "RenderTarget.h"
+#include <array>
 
 namespace ars::render::vk {
 class Buffer;
@@ -13,6 +14,8 @@ class Renderer;
 class OverlayRenderer;
 class RenderPass;
 class Drawer;
+class TransientTexturePool;
+class RenderGraphCache;
 
 enum NamedRT {
     NamedRT_GBuffer0, // for base color
@@ -46,6 +49,31 @@ constexpr VkFormat RT_FORMAT_GBUFFER2 = VK_FORMAT_R8G8B8A8_UNORM;
 constexpr VkFormat RT_FORMAT_GBUFFER3 = RT_FORMAT_DEFAULT_HDR;
 constexpr VkFormat RT_FORMAT_DEPTH = VK_FORMAT_D32_SFLOAT;
 
+// Memory used by transient textures of a render graph
+struct TransientMemoryStats {
+    uint32_t texture_count = 0;
+    // Peak memory if every transient texture had its own memory
+    VkDeviceSize unaliased_size = 0;
+    // Peak memory after aliasing textures with non-overlapping lifetimes
+    VkDeviceSize aliased_size = 0;
+};
+
+// Synchronization recorded by a render graph
+struct BarrierStats {
+    uint32_t pipeline_barrier_count = 0;
+    uint32_t image_barrier_count = 0;
+    uint32_t buffer_barrier_count = 0;
+    // Barriers if every pass boundary had a barrier for all dependencies of
+    // the pass, without tracking texture states
+    uint32_t naive_pipeline_barrier_count = 0;
+    uint32_t naive_image_barrier_count = 0;
+    uint32_t naive_buffer_barrier_count = 0;
+    // Passes moved to the async compute queue
+    uint32_t async_compute_pass_count = 0;
+    uint32_t queue_submit_count = 0;
+    uint32_t ownership_transfer_count = 0;
+};
+
 struct ViewTransform {
     glm::mat4 V;
     glm::mat4 P;
@@ -109,6 +137,8 @@ class View : public IView {
     [[nodiscard]] Handle<Texture> render_target(NamedRT name) const;
     [[nodiscard]] RenderTargetManager *rt_manager() const;
     [[nodiscard]] RenderTargetId rt_id(NamedRT name) const;
+    [[nodiscard]] TransientTexturePool *transient_pool() const;
+    [[nodiscard]] RenderGraphCache *render_graph_cache() const;
     [[nodiscard]] TextureCreateInfo rt_info(NamedRT name) const;
     [[nodiscard]] std::unique_ptr<RenderPass> create_single_pass_render_pass(
         NamedRT *colors, uint32_t color_count, NamedRT depth_stencil) const;
@@ -118,6 +148,9 @@ class View : public IView {
     [[nodiscard]] ViewData data() const;
     [[nodiscard]] ViewData last_frame_data() const;
 
+    // Buffer of the frame in flight being recorded. Each frame in flight has
+    // its own buffer, so writing it doesn't race with earlier frames still
+    // reading theirs on the GPU.
     [[nodiscard]] Handle<Buffer> transform_buffer();
 
   private:
@@ -133,6 +166,10 @@ class View : public IView {
 
     std::unique_ptr<RenderTargetManager> _rt_manager{};
     RenderTargetId _rt_ids[NamedRT_Count]{};
+    std::unique_ptr<TransientTexturePool> _transient_pool{};
+    std::unique_ptr<RenderGraphCache> _render_graph_cache{};
+    TransientMemoryStats _transient_stats{};
+    BarrierStats _barrier_stats{};
 
     std::unique_ptr<TextureAdapter> _color_tex_adapter{};
 
@@ -141,6 +178,6 @@ class View : public IView {
     std::unique_ptr<Drawer> _drawer{};
     std::unique_ptr<Effect> _effect{};
 
-    Handle<Buffer> _transform_buffer{};
+    std::array<Handle<Buffer>, MAX_FRAMES_IN_FLIGHT> _transform_buffers{};
 };
 } // namespace ars::render::vk
\ No newline at end of file
@@ -114,6 +114,16 @@ void CommandBuffer::begin(VkCommandBufferUsageFlags usage) {
     }
 }
 
+void CommandBuffer::begin(VkCommandBufferUsageFlags usage,
+                          const VkCommandBufferInheritanceInfo &inheritance) {
+    VkCommandBufferBeginInfo info{VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO};
+    info.flags = usage;
+    info.pInheritanceInfo = &inheritance;
+    if (_device->BeginCommandBuffer(_command_buffer, &info) != VK_SUCCESS) {
+        ARS_LOG_CRITICAL("Failed to begin command buffer");
+    }
+}
+
 Context *CommandBuffer::context() const {
     return _context;
 }
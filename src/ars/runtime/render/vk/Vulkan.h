@@ -13,6 +13,10 @@
 #include <vulkan/volk.hpp>
 
 namespace ars::render::vk {
+// Number of frames the CPU can record ahead of the GPU. Each frame in flight
+// owns its command pool, descriptor arena and resources waiting for release.
+constexpr uint32_t MAX_FRAMES_IN_FLIGHT = 2;
+
 // By now in this project we only use a single allocator.
 //
 // These wrappers will take the ownership of vulkan handles and release
@@ -60,6 +64,9 @@ class Device : public volk::Device {
     }
 
   private:
+    // Replaces entries of the dispatch table to intercept commands
+    friend class CommandCapture;
+
     Instance *_instance = nullptr;
     VkPhysicalDevice _physical_device = VK_NULL_HANDLE;
 };
@@ -90,6 +97,9 @@ struct MemoryView {
 MemoryView
 load_spirv_code(const char *path, const char **flags, uint32_t flag_count);
 
+// Changes when any of the embedded shaders changes
+uint64_t embedded_spirv_hash();
+
 class Context;
 
 class CommandBuffer : public volk::CommandBuffer {
@@ -103,6 +113,9 @@ class CommandBuffer : public volk::CommandBuffer {
     ~CommandBuffer();
 
     void begin(VkCommandBufferUsageFlags usage);
+    // For secondary command buffers
+    void begin(VkCommandBufferUsageFlags usage,
+               const VkCommandBufferInheritanceInfo &inheritance);
 
     void end();
 
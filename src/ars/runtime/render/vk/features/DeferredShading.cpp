@@ -5,6 +5,7 @@
 #include "../Profiler.h"
 #include "../Scene.h"
 #include "../Sky.h"
+#include "LightCulling.h"
 #include "Renderer.h"
 
 namespace ars::render::vk {
@@ -18,13 +19,20 @@ void DeferredShading::init_pipeline() {
 
 DeferredShading::DeferredShading(View *view) : _view(view) {
     init_pipeline();
+    _light_culling = std::make_unique<LightCulling>(_view);
 }
 
+DeferredShading::~DeferredShading() = default;
+
 void DeferredShading::execute(CommandBuffer *cmd) {
     ARS_PROFILER_SAMPLE_VK(cmd, "Deferred Shading", 0xFF771233);
 
     auto ctx = _view->context();
 
+    // Light culling dispatches compute shader, which should be done outside the
+    // render pass
+    auto has_point_light = _light_culling->execute(cmd);
+
     auto rp = render_pass().render_pass;
     auto fb = ctx->create_tmp_framebuffer(
         rp, {_view->render_target(NamedRT_LinearColor)});
@@ -45,7 +53,7 @@ void DeferredShading::execute(CommandBuffer *cmd) {
         shade_sun(cmd, physical_sky);
     }
 
-    shade_point_lights(cmd);
+    shade_point_lights(cmd, has_point_light);
 
     rp->end(rp_exec);
 }
@@ -209,27 +217,6 @@ get_directional_light_data(View *view, Scene::DirectionalLights::Id id) {
     return data;
 }
 
-struct alignas(16) PointLightData {
-    glm::vec3 position;
-    ARS_PADDING_FIELD(float);
-    glm::vec3 color;
-    float intensity;
-};
-
-PointLightData get_point_light_data(View *view, Scene::PointLights::Id id) {
-    auto &soa = view->scene_vk()->point_lights;
-    auto v_matrix = view->view_matrix();
-
-    PointLightData data{};
-    data.position = math::transform_position(
-        v_matrix, soa.get<math::XformTRS<float>>(id).translation());
-    auto &light = soa.get<Light>(id);
-    data.color = light.color;
-    data.intensity = light.intensity;
-
-    return data;
-}
-
 void set_up_directional_shadow(DescriptorEncoder &desc,
                                View *view,
                                Scene::DirectionalLights::Id id) {
@@ -272,24 +259,21 @@ void DeferredShading::shade_directional_lights(CommandBuffer *cmd,
     });
 }
 
-void DeferredShading::shade_point_lights(CommandBuffer *cmd) {
+void DeferredShading::shade_point_lights(CommandBuffer *cmd,
+                                         bool has_point_light) {
     ARS_PROFILER_SAMPLE_VK(cmd, "Shade Point Lights", 0xFF113422);
-    auto scene = _view->scene_vk();
-    auto light_count = scene->point_lights.size();
-    if (light_count == 0) {
+    if (!has_point_light) {
         return;
     }
 
     set_up_shade(_lit_point_light_pipeline.get(), cmd);
-    scene->point_lights.for_each_id([&](auto id) {
-        auto data = get_point_light_data(_view, id);
 
-        DescriptorEncoder desc{};
-        desc.set_buffer_data(1, 0, data);
-        desc.commit(cmd, _lit_point_light_pipeline.get());
+    // All point lights are shaded in a single pass with light lists of clusters
+    DescriptorEncoder desc{};
+    _light_culling->set_up_shade(desc, 1);
+    desc.commit(cmd, _lit_point_light_pipeline.get());
 
-        cmd->Draw(3, 1, 0, 0);
-    });
+    cmd->Draw(3, 1, 0, 0);
 }
 
 void DeferredShading::shade_sun(CommandBuffer *cmd, PhysicalSky *sky) {
@@ -6,10 +6,12 @@
 
 namespace ars::render::vk {
 class PhysicalSky;
+class LightCulling;
 
 class DeferredShading {
   public:
     explicit DeferredShading(View *view);
+    ~DeferredShading();
 
     void render(RenderGraph &rg);
 
@@ -21,11 +23,12 @@ class DeferredShading {
     void shade_unlit(CommandBuffer *cmd);
     void shade_reflection_emission(CommandBuffer *cmd);
     void shade_directional_lights(CommandBuffer *cmd, bool ignore_sun);
-    void shade_point_lights(CommandBuffer *cmd);
+    void shade_point_lights(CommandBuffer *cmd, bool has_point_light);
     void shade_sun(CommandBuffer *cmd, PhysicalSky *sky);
     SubpassInfo render_pass();
 
     View *_view = nullptr;
+    std::unique_ptr<LightCulling> _light_culling{};
     std::unique_ptr<GraphicsPipeline> _lit_point_light_pipeline{};
     std::unique_ptr<GraphicsPipeline> _lit_directional_light_pipeline{};
     std::unique_ptr<GraphicsPipeline> _lit_reflection_pipeline{};
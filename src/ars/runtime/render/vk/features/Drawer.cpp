@@ -1,8 +1,43 @@
 #include "Drawer.h"
+#include "../Bindless.h"
 #include "../Context.h"
 #include "../Profiler.h"
+#include "../Scene.h"
+#include <algorithm>
+#include <array>
+#include <ars/runtime/core/Jobs.h>
+#include <cstring>
 
 namespace ars::render::vk {
+uint64_t make_draw_sort_key(const DrawRequest &req, float view_depth) {
+    constexpr uint32_t PIPELINE_BITS = 14;
+    constexpr uint32_t MESH_BITS = 20;
+    constexpr uint32_t MATERIAL_BITS = 18;
+    constexpr uint32_t DEPTH_BITS = 12;
+    static_assert(PIPELINE_BITS + MESH_BITS + MATERIAL_BITS + DEPTH_BITS ==
+                  64);
+
+    uint64_t key = 0;
+    auto pack = [&](uint64_t value, uint32_t bits) {
+        key = (key << bits) | (value & ((uint64_t(1) << bits) - 1));
+    };
+
+    auto pipeline = req.material.pipeline;
+    auto block = req.material.property_block;
+    pack(pipeline != nullptr ? pipeline->id() : 0, PIPELINE_BITS);
+    pack(req.mesh != nullptr ? req.mesh->id() : 0, MESH_BITS);
+    pack(block != nullptr ? block->id() : 0, MATERIAL_BITS);
+
+    // Bits of non-negative floats are ordered as the floats, keep the
+    // exponent and the highest mantissa bits for a logarithmic quantization
+    auto depth = std::max(view_depth, 0.0f);
+    uint32_t depth_bits = 0;
+    std::memcpy(&depth_bits, &depth, sizeof(depth));
+    pack(depth_bits >> (31 - DEPTH_BITS), DEPTH_BITS);
+
+    return key;
+}
+
 Drawer::Drawer(View *view) : _view(view) {
     init_draw_id_billboard_alpha_clip();
 }
@@ -84,232 +119,556 @@ void Drawer::init_draw_id_billboard_alpha_clip() {
         std::make_unique<GraphicsPipeline>(ctx, info);
 }
 
-void Drawer::draw(CommandBuffer *cmd,
-                  const glm::mat4 &P,
-                  const glm::mat4 &V,
-                  ars::Span<const DrawRequest> requests,
-                  const DrawCallbacks &callbacks) {
-    if (requests.empty()) {
+namespace {
+// Property blocks of a batch are indexed per instance by their slots in the
+// data buffer of their layout, so they must share a layout. Their textures are
+// checked separately.
+bool can_be_batched(const DrawRequest &lhs, const DrawRequest &rhs) {
+    if (lhs.material.pipeline != rhs.material.pipeline ||
+        lhs.mesh != rhs.mesh || lhs.skeleton != rhs.skeleton) {
+        return false;
+    }
+    auto lhs_block = lhs.material.property_block;
+    auto rhs_block = rhs.material.property_block;
+    if (lhs_block == nullptr || rhs_block == nullptr) {
+        return lhs_block == rhs_block;
+    }
+    return lhs_block->layout() == rhs_block->layout();
+}
+
+// Stable LSD radix sort of values by keys, 8 bits a pass. Passes where all
+// keys have the same digit are skipped, which is common for the high bits as
+// ids are small.
+void radix_sort(FrameVector<uint64_t> &keys, FrameVector<uint32_t> &values) {
+    auto count = keys.size();
+    if (count <= 1) {
         return;
     }
 
-    auto transform_buffer =
-        cmd->context()->create_buffer(sizeof(ViewTransform),
-                                      VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-                                      VMA_MEMORY_USAGE_CPU_TO_GPU);
-    transform_buffer->set_data(ViewTransform::from_V_P(V, P));
-    draw(cmd, P, V, transform_buffer, requests, callbacks);
-}
+    FrameVector<uint64_t> tmp_keys(count);
+    FrameVector<uint32_t> tmp_values(count);
+    auto src_keys = keys.data();
+    auto src_values = values.data();
+    auto dst_keys = tmp_keys.data();
+    auto dst_values = tmp_values.data();
+
+    constexpr uint32_t RADIX_BITS = 8;
+    constexpr uint32_t RADIX_SIZE = 1 << RADIX_BITS;
+    for (uint32_t shift = 0; shift < 64; shift += RADIX_BITS) {
+        std::array<uint32_t, RADIX_SIZE> offsets{};
+        for (size_t i = 0; i < count; i++) {
+            offsets[(src_keys[i] >> shift) & (RADIX_SIZE - 1)]++;
+        }
+        if (offsets[(src_keys[0] >> shift) & (RADIX_SIZE - 1)] == count) {
+            continue;
+        }
 
-void Drawer::draw(CommandBuffer *cmd,
-                  View *view,
-                  ars::Span<const DrawRequest> requests) {
-    draw(cmd,
-         view->projection_matrix(),
-         view->view_matrix(),
-         view->transform_buffer(),
-         requests,
-         {});
-}
+        uint32_t sum = 0;
+        for (auto &offset : offsets) {
+            auto digit_count = offset;
+            offset = sum;
+            sum += digit_count;
+        }
+        for (size_t i = 0; i < count; i++) {
+            auto dst = offsets[(src_keys[i] >> shift) & (RADIX_SIZE - 1)]++;
+            dst_keys[dst] = src_keys[i];
+            dst_values[dst] = src_values[i];
+        }
+        std::swap(src_keys, dst_keys);
+        std::swap(src_values, dst_values);
+    }
 
-namespace {
-bool can_be_batched(const DrawRequest &lhs, const DrawRequest &rhs) {
-    return lhs.material.pipeline == rhs.material.pipeline &&
-           lhs.material.property_block == rhs.material.property_block &&
-           lhs.mesh == rhs.mesh && lhs.skeleton == rhs.skeleton;
+    if (src_keys != keys.data()) {
+        std::copy(src_keys, src_keys + count, keys.data());
+        std::copy(src_values, src_values + count, values.data());
+    }
 }
 
+// Textures of a batch are given by the draw list
 void dispatch_batch(CommandBuffer *cmd,
-                    const DrawRequest &req,
-                    Buffer *view_buffer,
-                    Buffer *inst_buffer,
-                    uint32_t start_index,
-                    uint32_t end_index,
-                    const DrawRequest &bound_req,
+                    const DrawBatch &batch,
+                    ars::Span<const Handle<Texture>> textures,
+                    const BufferArenaRange &view_transform,
+                    Buffer *object_buffer,
+                    const BufferArenaRange &instances,
+                    const DrawBatch &bound_batch,
                     const DrawCallbacks &callbacks) {
-    if (end_index <= start_index) {
+    if (batch.instance_count == 0) {
         return;
     }
 
     auto ctx = cmd->context();
 
-    auto pipeline = req.material.pipeline;
-    if (pipeline != bound_req.material.pipeline) {
+    auto pipeline = batch.pipeline;
+    if (pipeline != bound_batch.pipeline) {
         pipeline->bind(cmd);
         if (callbacks.on_pipeline_bound) {
             callbacks.on_pipeline_bound(cmd);
         }
     }
 
-    DescriptorEncoder desc{};
-    desc.set_buffer(0, 0, view_buffer);
-    desc.set_buffer(0, 1, inst_buffer);
-    // The property block can be null, if that happens the shader should not
-    // declare material and texture bindings
-    auto prop_block = req.material.property_block;
-    std::vector<Handle<Texture>> ref_textures{};
-    if (prop_block != nullptr) {
-        auto prop_buf =
-            ctx->create_buffer(prop_block->layout()->data_block_size(),
-                               VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
-                               VMA_MEMORY_USAGE_CPU_TO_GPU);
-        prop_buf->map_once([&](void *ptr) { prop_block->fill_data(ptr); });
-        desc.set_buffer(0, 2, prop_buf.get());
-        ref_textures = prop_block->referenced_textures();
-    }
+    // Batches sharing the pipeline, textures and skin use the same
+    // descriptors, as property blocks are read from the data buffer of the
+    // layout
+    if (pipeline != bound_batch.pipeline ||
+        batch.texture_offset != bound_batch.texture_offset ||
+        batch.texture_count != bound_batch.texture_count ||
+        batch.skeleton != bound_batch.skeleton) {
+        DescriptorEncoder desc{};
+        desc.set_buffer(0,
+                        0,
+                        view_transform.buffer,
+                        view_transform.offset,
+                        view_transform.size);
+        desc.set_buffer(
+            0, 1, instances.buffer, instances.offset, instances.size);
+        desc.set_buffer(0, 4, object_buffer);
+        // The property block can be null, if that happens the shader should
+        // not declare material and texture bindings
+        if (batch.property_block != nullptr) {
+            auto data_buffer = batch.property_block->layout()->data_buffer();
+            if (data_buffer.get() != nullptr) {
+                desc.set_buffer(0, 2, data_buffer.get());
+            }
+        }
 
-    constexpr uint32_t SAMPLER_2D_COUNT = 8;
-    while (ref_textures.size() < SAMPLER_2D_COUNT) {
-        ref_textures.push_back(ctx->default_texture_vk(DefaultTexture::White));
-    }
-    desc.set_textures(0, 3, ref_textures);
+        // With bindless, textures are read from the bindless set instead
+        if (!ctx->info().support_bindless()) {
+            FrameVector<Handle<Texture>> ref_textures(textures.begin(),
+                                                      textures.end());
+            constexpr uint32_t SAMPLER_2D_COUNT = 8;
+            while (ref_textures.size() < SAMPLER_2D_COUNT) {
+                ref_textures.push_back(
+                    ctx->default_texture_vk(DefaultTexture::White));
+            }
+            desc.set_textures(0, 3, ref_textures);
+        }
 
-    if (req.skeleton != nullptr) {
-        desc.set_buffer(1, 0, req.skeleton->joint_buffer().get());
-    }
+        if (batch.skeleton != nullptr) {
+            desc.set_buffer(1, 0, batch.skeleton->joint_buffer().get());
+        }
 
-    desc.commit(cmd, pipeline);
+        desc.commit(cmd, pipeline);
+        if (pipeline != bound_batch.pipeline) {
+            ctx->bindless_resources()->bind(cmd, pipeline);
+        }
+    }
 
-    if (req.mesh != bound_req.mesh || req.skeleton != bound_req.skeleton) {
-        std::vector<VkBuffer> vertex_buffers = {
-            inst_buffer->buffer(),
+    if (batch.mesh != bound_batch.mesh ||
+        batch.skeleton != bound_batch.skeleton) {
+        constexpr uint32_t MAX_VERTEX_BUFFER_COUNT = 7;
+        VkBuffer vertex_buffers[MAX_VERTEX_BUFFER_COUNT] = {
+            instances.buffer->buffer(),
+        };
+        VkDeviceSize vertex_offsets[MAX_VERTEX_BUFFER_COUNT] = {
+            instances.offset,
         };
-        std::vector<VkDeviceSize> vertex_offsets = {0};
+        uint32_t vertex_buffer_count = 1;
         auto add_vert_buffer = [&](const HeapRange &buf) {
-            vertex_buffers.push_back(buf.buffer());
-            vertex_offsets.push_back(buf.offset);
+            assert(vertex_buffer_count < MAX_VERTEX_BUFFER_COUNT);
+            vertex_buffers[vertex_buffer_count] = buf.buffer();
+            vertex_offsets[vertex_buffer_count] = buf.offset;
+            vertex_buffer_count++;
         };
-        add_vert_buffer(req.mesh->position_buffer());
-        add_vert_buffer(req.mesh->normal_buffer());
-        add_vert_buffer(req.mesh->tangent_buffer());
-        add_vert_buffer(req.mesh->tex_coord_buffer());
-
-        if (req.skeleton != nullptr) {
-            add_vert_buffer(req.mesh->joint_buffer());
-            add_vert_buffer(req.mesh->weight_buffer());
+        add_vert_buffer(batch.mesh->position_buffer());
+        add_vert_buffer(batch.mesh->normal_buffer());
+        add_vert_buffer(batch.mesh->tangent_buffer());
+        add_vert_buffer(batch.mesh->tex_coord_buffer());
+
+        if (batch.skeleton != nullptr) {
+            add_vert_buffer(batch.mesh->joint_buffer());
+            add_vert_buffer(batch.mesh->weight_buffer());
         }
-        cmd->BindVertexBuffers(0,
-                               static_cast<uint32_t>(std::size(vertex_buffers)),
-                               vertex_buffers.data(),
-                               vertex_offsets.data());
-        auto index_buffer = req.mesh->index_buffer();
+        cmd->BindVertexBuffers(
+            0, vertex_buffer_count, vertex_buffers, vertex_offsets);
+        auto index_buffer = batch.mesh->index_buffer();
         cmd->BindIndexBuffer(
             index_buffer.buffer(), index_buffer.offset, VK_INDEX_TYPE_UINT32);
     }
 
-    cmd->DrawIndexed(req.mesh->triangle_count() * 3,
-                     end_index - start_index,
+    cmd->DrawIndexed(batch.mesh->triangle_count() * 3,
+                     batch.instance_count,
                      0,
                      0,
-                     start_index);
+                     batch.instance_offset);
+}
+
+BufferArenaRange create_view_transform(Context *context,
+                                       const glm::mat4 &P,
+                                       const glm::mat4 &V) {
+    auto range = context->buffer_arena()->alloc(sizeof(ViewTransform));
+    range.set_data(ViewTransform::from_V_P(V, P));
+    return range;
+}
+
+// Refer to the whole transform buffer of the view
+BufferArenaRange view_transform_of(View *view) {
+    BufferArenaRange range{};
+    range.buffer = view->transform_buffer().get();
+    range.size = range.buffer->size();
+    return range;
 }
 } // namespace
 
 void Drawer::draw(CommandBuffer *cmd,
                   const glm::mat4 &P,
                   const glm::mat4 &V,
-                  const Handle<Buffer> &view_transform_buffer,
                   ars::Span<const DrawRequest> requests,
                   const DrawCallbacks &callbacks) {
     if (requests.empty()) {
         return;
     }
 
+    auto list = prepare(requests);
+    draw(cmd,
+         ref(list),
+         create_view_transform(cmd->context(), P, V),
+         callbacks);
+}
+
+void Drawer::draw(CommandBuffer *cmd,
+                  View *view,
+                  ars::Span<const DrawRequest> requests) {
+    auto list = prepare(requests);
+    draw(cmd, ref(list), view_transform_of(view), {});
+}
+
+void Drawer::draw(CommandBuffer *cmd, ars::Span<const DrawRequest> requests) {
+    draw(cmd, _view, requests);
+}
+
+void Drawer::draw(const RenderPassExecution &execution,
+                  ars::Span<const DrawRequest> requests) {
+    auto list = prepare(requests);
+    draw(execution, ref(list));
+}
+
+void Drawer::update(RetainedDrawList &list,
+                    RenderPassID pass_id,
+                    const CullingResult &culling_result) const {
+    if (list.up_to_date(pass_id, culling_result)) {
+        return;
+    }
+
+    auto requests = culling_result.gather_draw_requests(pass_id);
+    list._instance_buffer_index =
+        (list._instance_buffer_index + 1) % MAX_FRAMES_IN_FLIGHT;
+    auto draw_list =
+        prepare(requests, &list._instance_buffers[list._instance_buffer_index]);
+    list._instance_size = draw_list.instances.size;
+    list._batches.assign(draw_list.batches.begin(), draw_list.batches.end());
+    list._property_blocks.assign(draw_list.property_blocks.begin(),
+                                 draw_list.property_blocks.end());
+    list._textures.assign(draw_list.textures.begin(),
+                          draw_list.textures.end());
+
+    list._scene = culling_result.scene;
+    list._draw_state_version = culling_result.draw_state_version;
+    list._material_ready_version = culling_result.material_ready_version;
+    list._pass_id = pass_id;
+    list._objects.clear();
+    for (auto id : culling_result.objects) {
+        list._objects.push_back(id.value());
+    }
+    list._texture_versions.clear();
+    for (auto block : list._property_blocks) {
+        list._texture_versions.push_back(
+            block != nullptr ? block->texture_version() : 0);
+    }
+    list._build_count++;
+}
+
+void Drawer::draw(CommandBuffer *cmd,
+                  const glm::mat4 &P,
+                  const glm::mat4 &V,
+                  const RetainedDrawList &list,
+                  const DrawCallbacks &callbacks) {
+    if (list._batches.empty()) {
+        return;
+    }
+
+    draw(cmd,
+         ref(list),
+         create_view_transform(cmd->context(), P, V),
+         callbacks);
+}
+
+void Drawer::draw(const RenderPassExecution &execution,
+                  const RetainedDrawList &list) {
+    draw(execution, ref(list));
+}
+
+Drawer::DrawList
+Drawer::prepare(ars::Span<const DrawRequest> requests,
+                Handle<Buffer> *retained_instance_buffer) const {
     auto count = requests.size();
-    std::vector<const DrawRequest *> sorted_requests{};
+    DrawList list{};
+    FrameVector<const DrawRequest *> sorted_requests{};
 
     {
         ARS_PROFILER_SAMPLE("Sort Request", 0xFF3813B5);
-        sorted_requests.reserve(count);
-        for (int i = 0; i < count; i++) {
+        FrameVector<uint64_t> keys{};
+        FrameVector<uint32_t> indices{};
+        keys.reserve(count);
+        indices.reserve(count);
+        for (uint32_t i = 0; i < count; i++) {
             if (requests[i].material.pipeline == nullptr ||
                 requests[i].mesh == nullptr) {
                 continue;
             }
+            keys.push_back(requests[i].sort_key);
+            indices.push_back(i);
+        }
+
+        radix_sort(keys, indices);
+
+        sorted_requests.reserve(indices.size());
+        for (auto i : indices) {
             sorted_requests.push_back(&requests[i]);
         }
+    }
 
-        std::sort(sorted_requests.begin(),
-                  sorted_requests.end(),
-                  [&](const DrawRequest *lhs, const DrawRequest *rhs) {
-                      if (lhs->material.pipeline != rhs->material.pipeline) {
-                          return lhs->material.pipeline <
-                                 rhs->material.pipeline;
-                      }
-                      if (lhs->material.property_block !=
-                          rhs->material.property_block) {
-                          return lhs->material.property_block <
-                                 rhs->material.property_block;
-                      }
-                      if (lhs->mesh != rhs->mesh) {
-                          return lhs->mesh < rhs->mesh;
-                      }
-                      if (lhs->skeleton != rhs->skeleton) {
-                          return lhs->skeleton < rhs->skeleton;
-                      }
-                      return lhs < rhs;
-                  });
+    if (sorted_requests.empty()) {
+        return list;
+    }
+
+    {
+        ARS_PROFILER_SAMPLE("Batch Request", 0xFF8A2B43);
+        auto &blocks = list.property_blocks;
+        // Blocks reference textures by bindless ids, so any blocks of the
+        // same layout can be batched
+        bool bindless = _view->context()->info().support_bindless();
+        FrameVector<Handle<Texture>> block_textures{};
+        for (uint32_t i = 0; i < sorted_requests.size(); i++) {
+            auto req = sorted_requests[i];
+            auto block = req->material.property_block;
+            bool block_changed =
+                i == 0 ||
+                block != sorted_requests[i - 1]->material.property_block;
+            if (block_changed) {
+                block_textures.clear();
+                if (block != nullptr && !bindless) {
+                    block_textures = block->referenced_textures();
+                }
+            }
+
+            // Textures are bound once for a batch, so blocks of a batch
+            // must reference the same textures for their ids to be valid
+            bool new_batch = list.batches.empty();
+            if (!new_batch) {
+                auto &batch = list.batches.back();
+                auto batch_req = sorted_requests[batch.instance_offset];
+                new_batch =
+                    !can_be_batched(*req, *batch_req) ||
+                    (block_changed &&
+                     !std::equal(block_textures.begin(),
+                                 block_textures.end(),
+                                 list.textures.begin() + batch.texture_offset,
+                                 list.textures.end()));
+            }
+
+            if (new_batch) {
+                DrawBatch batch{};
+                batch.pipeline = req->material.pipeline;
+                batch.property_block = block;
+                batch.mesh = req->mesh;
+                batch.skeleton = req->skeleton;
+                batch.instance_offset = i;
+                batch.texture_count =
+                    static_cast<uint32_t>(block_textures.size());
+                // Share the textures of the last batch if they are the same,
+                // so the batches can share descriptors
+                bool same_textures =
+                    !list.batches.empty() &&
+                    std::equal(block_textures.begin(),
+                               block_textures.end(),
+                               list.textures.begin() +
+                                   list.batches.back().texture_offset,
+                               list.textures.end());
+                if (same_textures) {
+                    batch.texture_offset = list.batches.back().texture_offset;
+                } else {
+                    batch.texture_offset =
+                        static_cast<uint32_t>(list.textures.size());
+                    list.textures.insert(list.textures.end(),
+                                         block_textures.begin(),
+                                         block_textures.end());
+                }
+                list.batches.push_back(batch);
+            }
+
+            if (new_batch || block_changed) {
+                blocks.push_back(block);
+            }
+            list.batches.back().instance_count++;
+        }
     }
 
     auto ctx = _view->context();
 
-    Handle<Buffer> inst_buffer{};
     {
         ARS_PROFILER_SAMPLE("Alloc Instance Buffer", 0xFF384712);
-        inst_buffer = ctx->create_buffer(sizeof(InstanceDrawParam) *
-                                             sorted_requests.size(),
-                                         VK_BUFFER_USAGE_VERTEX_BUFFER_BIT |
-                                             VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
-                                         VMA_MEMORY_USAGE_CPU_TO_GPU);
+        auto size = sizeof(InstanceDrawParam) * sorted_requests.size();
+        if (retained_instance_buffer != nullptr) {
+            auto &buffer = *retained_instance_buffer;
+            if (buffer.get() == nullptr || buffer->size() < size) {
+                // Grow geometrically so lists growing by a few objects don't
+                // reallocate on every rebuild
+                VkDeviceSize capacity = size;
+                if (buffer.get() != nullptr) {
+                    capacity = std::max(capacity, buffer->size() * 2);
+                }
+                buffer = ctx->create_buffer(
+                    capacity,
+                    VK_BUFFER_USAGE_VERTEX_BUFFER_BIT |
+                        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                    VMA_MEMORY_USAGE_CPU_TO_GPU);
+            }
+            list.instances.buffer = buffer.get();
+            list.instances.size = size;
+            list.instances.data = buffer->map();
+        } else {
+            list.instances = ctx->buffer_arena()->alloc(size);
+        }
     }
 
     {
         ARS_PROFILER_SAMPLE("Update Instance Buffer", 0xFF184FA1);
-	inst_buffer->map_once([&](void* ptr) {
-	    auto inst_data = reinterpret_cast<InstanceDrawParam *>(ptr);
-            for (int i = 0; i < sorted_requests.size(); i++) {
-                auto &inst = inst_data[i];
-                auto req = sorted_requests[i];
-		auto MV = V * req->M;
-                inst.MV = MV;
-                inst.I_MV = glm::inverse(MV);
-                inst.material_id = 0;
-                inst.instance_id = i;
-                inst.custom_id = req->custom_id;
-            }
-	});
+        auto inst_data = static_cast<InstanceDrawParam *>(list.instances.data);
+        for (int i = 0; i < sorted_requests.size(); i++) {
+            auto &inst = inst_data[i];
+            auto req = sorted_requests[i];
+            auto block = req->material.property_block;
+            inst.object_id = req->object_id;
+            inst.material_id = block != nullptr ? block->slot() : 0;
+            inst.instance_id = i;
+            inst.custom_id = req->custom_id;
+        }
+        if (retained_instance_buffer != nullptr) {
+            (*retained_instance_buffer)->unmap();
+            list.instances.data = nullptr;
+        }
     }
 
-    DrawRequest bound_req{};
-    size_t last_flushed_index = 0;
+    return list;
+}
 
-    auto flush = [&](size_t end_index) {
-        if (end_index <= last_flushed_index) {
-            return;
-        }
-        auto req = sorted_requests[last_flushed_index];
+void Drawer::record(CommandBuffer *cmd,
+                    const DrawListRef &list,
+                    const BufferArenaRange &view_transform,
+                    uint32_t batch_begin,
+                    uint32_t batch_end,
+                    const DrawCallbacks &callbacks) const {
+    auto object_transform_buffer = _view->scene_vk()->object_transform_buffer();
+    // Command buffers start with nothing bound
+    DrawBatch bound_batch{};
+    for (auto b = batch_begin; b < batch_end; b++) {
+        auto &batch = list.batches[b];
         dispatch_batch(cmd,
-                       *req,
-                       view_transform_buffer.get(),
-                       inst_buffer.get(),
-                       last_flushed_index,
-                       end_index,
-                       bound_req,
+                       batch,
+                       {list.textures.data() + batch.texture_offset,
+                        batch.texture_count},
+                       view_transform,
+                       object_transform_buffer.get(),
+                       list.instances,
+                       bound_batch,
                        callbacks);
-        bound_req = *req;
-        last_flushed_index = end_index;
-    };
+        bound_batch = batch;
+    }
+}
 
-    for (int i = 0; i < sorted_requests.size(); i++) {
-        auto req = sorted_requests[i];
-        if (!can_be_batched(*req, *sorted_requests[last_flushed_index])) {
-            flush(i);
-        }
+void Drawer::draw(CommandBuffer *cmd,
+                  const DrawListRef &list,
+                  const BufferArenaRange &view_transform,
+                  const DrawCallbacks &callbacks) const {
+    record(cmd,
+           list,
+           view_transform,
+           0,
+           static_cast<uint32_t>(list.batches.size()),
+           callbacks);
+}
+
+void Drawer::draw(const RenderPassExecution &execution,
+                  const DrawListRef &list) const {
+    auto batch_count = static_cast<uint32_t>(list.batches.size());
+
+    uint32_t chunk_count = 1;
+    if (execution.contents == VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS) {
+        // Smaller chunks cost more in command buffer overhead than they save
+        constexpr uint32_t MIN_CHUNK_BATCH_COUNT = 16;
+        chunk_count = std::clamp(batch_count / MIN_CHUNK_BATCH_COUNT,
+                                 1u,
+                                 jobs::worker_count() + 1);
     }
-    flush(sorted_requests.size());
+
+    auto view_transform = view_transform_of(_view);
+    execution.render_pass->record(
+        execution, chunk_count, [&](CommandBuffer *cmd, uint32_t chunk) {
+            record(cmd,
+                   list,
+                   view_transform,
+                   batch_count * chunk / chunk_count,
+                   batch_count * (chunk + 1) / chunk_count,
+                   {});
+        });
 }
 
-void Drawer::draw(CommandBuffer *cmd, ars::Span<const DrawRequest> requests) {
-    draw(cmd, _view, requests);
+Drawer::DrawListRef Drawer::ref(const DrawList &list) {
+    return {list.batches, list.textures, list.instances};
+}
+
+Drawer::DrawListRef Drawer::ref(const RetainedDrawList &list) {
+    BufferArenaRange instances{};
+    auto &buffer = list._instance_buffers[list._instance_buffer_index];
+    if (buffer.get() != nullptr) {
+        instances.buffer = buffer.get();
+        instances.size = list._instance_size;
+    }
+    return {list._batches, list._textures, instances};
+}
+
+VkSubpassContents Drawer::subpass_contents() const {
+    if (_parallel_recording && jobs::worker_count() > 0) {
+        return VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS;
+    }
+    return VK_SUBPASS_CONTENTS_INLINE;
+}
+
+bool Drawer::parallel_recording() const {
+    return _parallel_recording;
+}
+
+void Drawer::set_parallel_recording(bool enabled) {
+    _parallel_recording = enabled;
+}
+
+uint64_t RetainedDrawList::build_count() const {
+    return _build_count;
+}
+
+bool RetainedDrawList::up_to_date(RenderPassID pass_id,
+                                  const CullingResult &culling_result) const {
+    if (_build_count == 0 || _scene != culling_result.scene ||
+        _draw_state_version != culling_result.draw_state_version ||
+        _material_ready_version != culling_result.material_ready_version ||
+        _pass_id != pass_id ||
+        _objects.size() != culling_result.objects.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < _objects.size(); i++) {
+        if (_objects[i] != culling_result.objects[i].value()) {
+            return false;
+        }
+    }
+    // Blocks are alive as long as the draw state version is unchanged
+    for (size_t i = 0; i < _property_blocks.size(); i++) {
+        auto block = _property_blocks[i];
+        if (block != nullptr &&
+            block->texture_version() != _texture_versions[i]) {
+            return false;
+        }
+    }
+    return true;
 }
-} // namespace ars::render::vk
+} // namespace ars::render::vk
\ No newline at end of file
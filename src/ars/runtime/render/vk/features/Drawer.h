@@ -8,32 +8,104 @@
 #include "../Vulkan.h"
 #include "Renderer.h"
 #include <ars/runtime/core/misc/Span.h>
+#include <array>
 
 namespace ars::render::vk {
 
 class View;
+class Scene;
+struct CullingResult;
 
 struct DrawRequest {
     glm::mat4 M{};
     uint32_t custom_id = 0;
+    // Index of the transform in the object transform buffer of the scene
+    uint32_t object_id = 0;
     Mesh *mesh = nullptr;
     MaterialPass material{};
     Skin *skeleton = nullptr;
+    // Requests are drawn in ascending order of keys, see make_draw_sort_key()
+    uint64_t sort_key = 0;
 };
 
+// Pack the pipeline id, mesh id, property block id and view depth of the
+// request into a sort key, from the most significant bits. Requests that can
+// be batched are adjacent after sorting, and instances of a batch are ordered
+// front to back. Ids are truncated, collisions only cost extra batches.
+[[nodiscard]] uint64_t make_draw_sort_key(const DrawRequest &req,
+                                          float view_depth);
+
+// The view matrix is applied in shaders, so instance data does not change
+// with the view
 struct InstanceDrawParam {
-    glm::mat4 MV;
-    glm::mat4 I_MV;
+    uint32_t object_id;
     uint32_t material_id;
     uint32_t instance_id;
     uint32_t custom_id;
-    ARS_PADDING_FIELD(uint32_t);
+};
+
+// Requests sharing the same pipeline, mesh and skin, drawn with one instanced
+// draw. Requests with different property blocks of the same layout and
+// textures share a batch, instances index the data buffer of the layout by
+// material_id, which is the slot of their block. With bindless, blocks
+// reference textures by bindless ids, so textures don't split batches.
+struct DrawBatch {
+    GraphicsPipeline *pipeline = nullptr;
+    // Property block of the first request
+    MaterialPropertyBlock *property_block = nullptr;
+    Mesh *mesh = nullptr;
+    Skin *skeleton = nullptr;
+
+    uint32_t instance_offset = 0;
+    uint32_t instance_count = 0;
+    // Range of textures of the draw list, shared by adjacent batches with the
+    // same textures
+    uint32_t texture_offset = 0;
+    uint32_t texture_count = 0;
 };
 
 struct DrawCallbacks {
     std::function<void(CommandBuffer *)> on_pipeline_bound{};
 };
 
+// Draw list kept across frames for a pass drawing culled scene objects. It is
+// rebuilt only when the culled objects change, when render objects are
+// created, destroyed or change meshes, materials, skins or textures, or when
+// pipelines of materials become ready. Moving
+// objects doesn't rebuild lists, transforms are read from the object transform
+// buffer of the scene.
+class RetainedDrawList {
+  public:
+    // Number of times the list is built
+    [[nodiscard]] uint64_t build_count() const;
+
+  private:
+    friend class Drawer;
+
+    [[nodiscard]] bool up_to_date(RenderPassID pass_id,
+                                  const CullingResult &culling_result) const;
+
+    std::vector<DrawBatch> _batches{};
+    std::vector<MaterialPropertyBlock *> _property_blocks{};
+    std::vector<Handle<Texture>> _textures{};
+    // Grow-only instance buffers, a rebuild writes the next one so frames in
+    // flight keep reading the buffer of the previous build
+    std::array<Handle<Buffer>, MAX_FRAMES_IN_FLIGHT> _instance_buffers{};
+    uint32_t _instance_buffer_index = 0;
+    VkDeviceSize _instance_size = 0;
+
+    // What the list is built from
+    Scene *_scene = nullptr;
+    uint64_t _draw_state_version = 0;
+    uint64_t _material_ready_version = 0;
+    RenderPassID _pass_id = RenderPassID_Count;
+    std::vector<uint64_t> _objects{};
+    // Texture versions of the property blocks
+    std::vector<uint32_t> _texture_versions{};
+
+    uint64_t _build_count = 0;
+};
+
 class Drawer {
   public:
     explicit Drawer(View *view);
@@ -58,17 +130,79 @@ class Drawer {
     // Use the view holding the drawer
     void draw(CommandBuffer *cmd, ars::Span<const DrawRequest> requests);
 
-  private:
-    void init_draw_id_billboard_alpha_clip();
+    // Use the view holding the drawer and record into the subpass of the
+    // execution. If the subpass takes secondary command buffers, batches are
+    // split into chunks recorded on job workers.
+    void draw(const RenderPassExecution &execution,
+              ars::Span<const DrawRequest> requests);
+
+    // Rebuild the list if it's out of date with the culling result, requests
+    // are only gathered and sorted then. Different lists can be updated in
+    // parallel.
+    void update(RetainedDrawList &list,
+                RenderPassID pass_id,
+                const CullingResult &culling_result) const;
 
     void draw(CommandBuffer *cmd,
               const glm::mat4 &P,
               const glm::mat4 &V,
-              const Handle<Buffer> &view_transform_buffer,
-              ars::Span<const DrawRequest> requests,
-              const DrawCallbacks &callbacks);
+              const RetainedDrawList &list,
+              const DrawCallbacks &callbacks = {});
+
+    // Same as drawing requests into the execution
+    void draw(const RenderPassExecution &execution,
+              const RetainedDrawList &list);
+
+    // Render passes drawn with the drawer should begin with these contents,
+    // which are secondary command buffers if parallel recording is enabled
+    [[nodiscard]] VkSubpassContents subpass_contents() const;
+    [[nodiscard]] bool parallel_recording() const;
+    void set_parallel_recording(bool enabled);
+
+  private:
+    // Sorted and batched requests with instance data filled, drawn once
+    struct DrawList {
+        FrameVector<DrawBatch> batches{};
+        // Property blocks referenced by the batches
+        FrameVector<MaterialPropertyBlock *> property_blocks{};
+        FrameVector<Handle<Texture>> textures{};
+        BufferArenaRange instances{};
+    };
+
+    // Refers to a DrawList or a RetainedDrawList
+    struct DrawListRef {
+        ars::Span<const DrawBatch> batches{};
+        ars::Span<const Handle<Texture>> textures{};
+        BufferArenaRange instances{};
+    };
+
+    static DrawListRef ref(const DrawList &list);
+    static DrawListRef ref(const RetainedDrawList &list);
+
+    void init_draw_id_billboard_alpha_clip();
+
+    // Instance data is allocated from the buffer arena of the frame, or
+    // written to retained_instance_buffer if it's given, for lists kept across
+    // frames. The buffer is replaced by a bigger one if it's too small.
+    DrawList prepare(ars::Span<const DrawRequest> requests,
+                     Handle<Buffer> *retained_instance_buffer = nullptr) const;
+    // Record batches in [batch_begin, batch_end) of the list
+    void record(CommandBuffer *cmd,
+                const DrawListRef &list,
+                const BufferArenaRange &view_transform,
+                uint32_t batch_begin,
+                uint32_t batch_end,
+                const DrawCallbacks &callbacks) const;
+
+    void draw(CommandBuffer *cmd,
+              const DrawListRef &list,
+              const BufferArenaRange &view_transform,
+              const DrawCallbacks &callbacks) const;
+    void draw(const RenderPassExecution &execution,
+              const DrawListRef &list) const;
 
     View *_view = nullptr;
     std::unique_ptr<GraphicsPipeline> _draw_id_billboard_alpha_clip_pipeline{};
+    bool _parallel_recording = true;
 };
 } // namespace ars::render::vk
\ No newline at end of file
@@ -0,0 +1,261 @@
+#include "LightCulling.h"
+#include "../Context.h"
+#include "../Profiler.h"
+#include "../Scene.h"
+#include <algorithm>
+
+namespace ars::render::vk {
+namespace {
+glm::vec3 unproject(const glm::mat4 &I_P, const glm::vec3 &p_hclip) {
+    auto p = I_P * glm::vec4(p_hclip, 1.0f);
+    return glm::vec3(p) / p.w;
+}
+
+// Intersect the line through the NDC point at two depths with view space plane
+// z == -linear_z. Depths are chosen to be finite for both perspective and
+// orthographic projection with reversed-Z.
+glm::vec3
+point_on_plane_vs(const glm::mat4 &I_P, const glm::vec2 &ndc, float linear_z) {
+    auto p0 = unproject(I_P, glm::vec3(ndc, 1.0f));
+    auto p1 = unproject(I_P, glm::vec3(ndc, 0.5f));
+    auto t = (-linear_z - p0.z) / (p1.z - p0.z);
+    return p0 + t * (p1 - p0);
+}
+
+float slice_linear_z(const LightClusterGrid &grid, uint32_t slice) {
+    if (slice == 0) {
+        return 0.0f;
+    }
+    auto t = static_cast<float>(slice) / static_cast<float>(grid.size.z);
+    return grid.z_near * std::pow(grid.z_far / grid.z_near, t);
+}
+
+bool intersect_sphere_aabb(const glm::vec3 &center,
+                           float radius,
+                           const math::AABB<float> &aabb) {
+    auto closest = glm::clamp(center, aabb.min, aabb.max);
+    auto d = closest - center;
+    return glm::dot(d, d) <= radius * radius;
+}
+} // namespace
+
+uint32_t LightClusterGrid::cluster_count() const {
+    return size.x * size.y * size.z;
+}
+
+uint32_t LightClusterGrid::cluster_index(const glm::uvec3 &cluster) const {
+    return cluster.x + size.x * (cluster.y + size.y * cluster.z);
+}
+
+glm::uvec3 LightClusterGrid::locate(const glm::vec2 &uv,
+                                    float linear_z) const {
+    auto xy = glm::ivec2(glm::floor(uv * glm::vec2(size.x, size.y)));
+    auto z = static_cast<int>(
+        std::floor(std::log(std::max(linear_z, 1e-6f) / z_near) /
+                   std::log(z_far / z_near) * static_cast<float>(size.z)));
+    auto max_index = glm::ivec3(size) - 1;
+    return glm::uvec3(glm::clamp(glm::ivec3(xy, z), glm::ivec3(0), max_index));
+}
+
+math::AABB<float>
+LightClusterGrid::cluster_aabb_vs(const glm::uvec3 &cluster) const {
+    auto grid_xy = glm::vec2(size.x, size.y);
+    auto ndc_min = glm::vec2(cluster.x, cluster.y) / grid_xy * 2.0f - 1.0f;
+    auto ndc_max =
+        glm::vec2(cluster.x + 1, cluster.y + 1) / grid_xy * 2.0f - 1.0f;
+    float slice_z[2] = {slice_linear_z(*this, cluster.z),
+                        slice_linear_z(*this, cluster.z + 1)};
+
+    auto aabb = math::AABB<float>(point_on_plane_vs(I_P, ndc_min, slice_z[0]));
+    for (auto z : slice_z) {
+        for (int i = 0; i < 4; i++) {
+            glm::vec2 ndc((i & 1) ? ndc_max.x : ndc_min.x,
+                          (i & 2) ? ndc_max.y : ndc_min.y);
+            aabb.extend_point(point_on_plane_vs(I_P, ndc, z));
+        }
+    }
+    return aabb;
+}
+
+LightClusterGrid
+LightClusterGrid::from_view(const glm::mat4 &P,
+                            const CameraData &camera,
+                            Span<const PointLightData> lights) {
+    LightClusterGrid grid{};
+    grid.I_P = glm::inverse(P);
+    grid.size = {LIGHT_CLUSTER_X, LIGHT_CLUSTER_Y, LIGHT_CLUSTER_Z};
+    grid.light_count = static_cast<uint32_t>(lights.size());
+    grid.max_light_count_per_cluster = MAX_LIGHT_COUNT_PER_CLUSTER;
+
+    // Lights can not reach points further than the farthest light extent, use
+    // it to tighten the grid when the camera z far is too far or infinite.
+    float light_z_far = 0.0f;
+    for (auto &light : lights) {
+        light_z_far = std::max(light_z_far, -light.position.z + light.range);
+    }
+    auto camera_z_far = camera.z_far();
+    if (camera_z_far > 0.0f) {
+        light_z_far = std::min(light_z_far, camera_z_far);
+    }
+
+    grid.z_near = std::max(camera.z_near(), LIGHT_CLUSTER_MIN_Z_NEAR);
+    grid.z_far = std::max(light_z_far, grid.z_near * 2.0f);
+    return grid;
+}
+
+LightClusterList bin_point_lights(const LightClusterGrid &grid,
+                                  Span<const PointLightData> lights) {
+    LightClusterList list{};
+    list.clusters.resize(grid.cluster_count());
+
+    for (uint32_t z = 0; z < grid.size.z; z++) {
+        for (uint32_t y = 0; y < grid.size.y; y++) {
+            for (uint32_t x = 0; x < grid.size.x; x++) {
+                glm::uvec3 cluster(x, y, z);
+                auto aabb = grid.cluster_aabb_vs(cluster);
+                auto offset = static_cast<uint32_t>(list.light_indices.size());
+                uint32_t count = 0;
+                for (uint32_t i = 0; i < lights.size(); i++) {
+                    if (count >= grid.max_light_count_per_cluster) {
+                        break;
+                    }
+                    auto &light = lights[i];
+                    if (intersect_sphere_aabb(
+                            light.position, light.range, aabb)) {
+                        list.light_indices.push_back(i);
+                        count++;
+                    }
+                }
+                list.clusters[grid.cluster_index(cluster)] = {offset, count};
+            }
+        }
+    }
+
+    return list;
+}
+
+LightCulling::LightCulling(View *view) : _view(view) {
+    init_pipeline();
+    init_buffers();
+}
+
+void LightCulling::init_pipeline() {
+    _cluster_lights_pipeline = ComputePipeline::create(
+        _view->context(), "Shading/ClusterLights.comp");
+}
+
+void LightCulling::init_buffers() {
+    auto ctx = _view->context();
+    _cluster_buffer = ctx->create_buffer(
+        sizeof(glm::uvec2) * LIGHT_CLUSTER_COUNT,
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+        VMA_MEMORY_USAGE_GPU_ONLY);
+    _light_index_buffer = ctx->create_buffer(
+        sizeof(uint32_t) * LIGHT_CLUSTER_COUNT * MAX_LIGHT_COUNT_PER_CLUSTER,
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+        VMA_MEMORY_USAGE_GPU_ONLY);
+}
+
+std::vector<PointLightData> LightCulling::gather_point_lights() const {
+    auto &soa = _view->scene_vk()->point_lights;
+    auto v_matrix = _view->view_matrix();
+    auto count = soa.size();
+    auto xform_arr = soa.get_array<math::XformTRS<float>>();
+    auto light_arr = soa.get_array<Light>();
+    auto range_arr = soa.get_array<LightRange>();
+
+    std::vector<PointLightData> lights{};
+    lights.reserve(count);
+    for (int i = 0; i < count; i++) {
+        PointLightData data{};
+        data.position =
+            math::transform_position(v_matrix, xform_arr[i].translation());
+        data.range =
+            range_arr[i].value.value_or(point_light_range(light_arr[i]));
+        data.color = light_arr[i].color;
+        data.intensity = light_arr[i].intensity;
+
+        // Skip lights that contribute nothing
+        if (data.range <= 0.0f || data.intensity <= 0.0f) {
+            continue;
+        }
+        lights.push_back(data);
+    }
+    return lights;
+}
+
+bool LightCulling::execute(CommandBuffer *cmd) {
+    ARS_PROFILER_SAMPLE_VK(cmd, "Cluster Lights", 0xFF348A21);
+
+    auto lights = gather_point_lights();
+    if (lights.empty()) {
+        return false;
+    }
+
+    auto ctx = _view->context();
+    _grid = LightClusterGrid::from_view(
+        _view->projection_matrix(), _view->camera(), lights);
+
+    _grid_range = ctx->buffer_arena()->alloc(sizeof(LightClusterGrid));
+    _grid_range.set_data(_grid);
+    _point_light_range =
+        ctx->buffer_arena()->alloc(sizeof(PointLightData) * lights.size());
+    _point_light_range.set_data(lights);
+
+    // Cluster buffers are reused across frames, wait for shading of the last
+    // frame before overwriting them.
+    cmd->PipelineBarrier(VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                         VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                         0,
+                         0,
+                         nullptr,
+                         0,
+                         nullptr,
+                         0,
+                         nullptr);
+
+    _cluster_lights_pipeline->bind(cmd);
+
+    DescriptorEncoder desc{};
+    desc.set_buffer(
+        0, 0, _grid_range.buffer, _grid_range.offset, _grid_range.size);
+    desc.set_buffer(0,
+                    1,
+                    _point_light_range.buffer,
+                    _point_light_range.offset,
+                    _point_light_range.size);
+    desc.set_buffer(0, 2, _cluster_buffer.get());
+    desc.set_buffer(0, 3, _light_index_buffer.get());
+    desc.commit(cmd, _cluster_lights_pipeline.get());
+
+    _cluster_lights_pipeline->local_size().dispatch(
+        cmd, _grid.cluster_count(), 1, 1);
+
+    VkMemoryBarrier barrier{VK_STRUCTURE_TYPE_MEMORY_BARRIER};
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    cmd->PipelineBarrier(VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                         VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                         0,
+                         1,
+                         &barrier,
+                         0,
+                         nullptr,
+                         0,
+                         nullptr);
+
+    return true;
+}
+
+void LightCulling::set_up_shade(DescriptorEncoder &desc, uint32_t set) const {
+    desc.set_buffer(
+        set, 0, _grid_range.buffer, _grid_range.offset, _grid_range.size);
+    desc.set_buffer(set,
+                    1,
+                    _point_light_range.buffer,
+                    _point_light_range.offset,
+                    _point_light_range.size);
+    desc.set_buffer(set, 2, _cluster_buffer.get());
+    desc.set_buffer(set, 3, _light_index_buffer.get());
+}
+} // namespace ars::render::vk
@@ -0,0 +1,93 @@
+#pragma once
+
+#include "../Pipeline.h"
+#include "../View.h"
+#include <ars/runtime/core/math/AABB.h>
+#include <ars/runtime/core/misc/Span.h>
+
+namespace ars::render::vk {
+// Point lights are binned into a froxel grid. The grid is uniform in screen
+// space and exponential in view space depth.
+constexpr uint32_t LIGHT_CLUSTER_X = 16;
+constexpr uint32_t LIGHT_CLUSTER_Y = 9;
+constexpr uint32_t LIGHT_CLUSTER_Z = 24;
+constexpr uint32_t LIGHT_CLUSTER_COUNT =
+    LIGHT_CLUSTER_X * LIGHT_CLUSTER_Y * LIGHT_CLUSTER_Z;
+// Lights exceeding this count are ignored by the cluster
+constexpr uint32_t MAX_LIGHT_COUNT_PER_CLUSTER = 64;
+// Slice 0 always starts from the view point, this only limits the depth
+// resolution of the exponential slicing.
+constexpr float LIGHT_CLUSTER_MIN_Z_NEAR = 0.1f;
+
+// Position is in view space. Matches PointLight in Light.glsl.
+struct alignas(16) PointLightData {
+    glm::vec3 position;
+    float range;
+    glm::vec3 color;
+    float intensity;
+};
+
+// Matches LightClusterGrid in LightCluster.glsl.
+struct alignas(16) LightClusterGrid {
+    glm::mat4 I_P;
+    glm::uvec3 size;
+    uint32_t light_count;
+    uint32_t max_light_count_per_cluster;
+    // Positive linear z range for exponential slicing
+    float z_near;
+    float z_far;
+    ARS_PADDING_FIELD(float);
+
+    [[nodiscard]] uint32_t cluster_count() const;
+    [[nodiscard]] uint32_t cluster_index(const glm::uvec3 &cluster) const;
+    // uv is the screen space uv, linear_z is the POSITIVE view space depth.
+    // Points out of the grid are clamped to the nearest cluster.
+    [[nodiscard]] glm::uvec3 locate(const glm::vec2 &uv, float linear_z) const;
+    [[nodiscard]] math::AABB<float>
+    cluster_aabb_vs(const glm::uvec3 &cluster) const;
+
+    static LightClusterGrid from_view(const glm::mat4 &P,
+                                      const CameraData &camera,
+                                      Span<const PointLightData> lights);
+};
+
+struct LightClusterList {
+    // (offset, count) of each cluster in light_indices
+    std::vector<glm::uvec2> clusters{};
+    std::vector<uint32_t> light_indices{};
+};
+
+// CPU reference of the binning done in Shading/ClusterLights.comp. Lights of
+// each cluster are compactly stored, while the GPU version stores light indices
+// of each cluster in fixed size slots. Both can be consumed by the same
+// shading code.
+LightClusterList bin_point_lights(const LightClusterGrid &grid,
+                                  Span<const PointLightData> lights);
+
+class LightCulling {
+  public:
+    explicit LightCulling(View *view);
+
+    // Gather point lights of the scene and bin them into clusters on GPU.
+    // Should be called outside render pass. Returns false if there is no point
+    // light to shade.
+    bool execute(CommandBuffer *cmd);
+
+    // Bind cluster data for point light shading
+    void set_up_shade(DescriptorEncoder &desc, uint32_t set) const;
+
+  private:
+    void init_pipeline();
+    void init_buffers();
+    std::vector<PointLightData> gather_point_lights() const;
+
+    View *_view = nullptr;
+    std::unique_ptr<ComputePipeline> _cluster_lights_pipeline{};
+    LightClusterGrid _grid{};
+    // Allocated from the buffer arena by execute(), valid in the frame only
+    BufferArenaRange _grid_range{};
+    BufferArenaRange _point_light_range{};
+    Handle<Buffer> _cluster_buffer{};
+    Handle<Buffer> _light_index_buffer{};
+};
+} // namespace ars::render::vk
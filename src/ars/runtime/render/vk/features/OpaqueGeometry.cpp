@@ -31,11 +31,12 @@ void OpaqueGeometry::execute(CommandBuffer *cmd,
 
     // clear all rts to zero
     VkClearValue clear_values[5]{};
-    auto rp_exec = rp->begin(cmd, fb, clear_values, VK_SUBPASS_CONTENTS_INLINE);
+    auto drawer = _view->drawer();
+    auto rp_exec =
+        rp->begin(cmd, fb, clear_values, drawer->subpass_contents());
 
-    auto draw_requests =
-        culling_result.gather_draw_requests(RenderPassID_Geometry);
-    _view->drawer()->draw(cmd, draw_requests);
+    drawer->update(_draw_list, RenderPassID_Geometry, culling_result);
+    drawer->draw(rp_exec, _draw_list);
 
     rp->end(rp_exec);
 }
@@ -5,6 +5,7 @@
 #include "../RenderPass.h"
 #include "../View.h"
 #include "../Vulkan.h"
+#include "Drawer.h"
 #include <array>
 
 namespace ars::render::vk {
@@ -22,5 +23,6 @@ class OpaqueGeometry {
     [[nodiscard]] static std::array<NamedRT, 5> geometry_pass_rt_names();
 
     View *_view = nullptr;
+    RetainedDrawList _draw_list{};
 };
 } // namespace ars::render::vk
\ No newline at end of file
@@ -323,24 +323,14 @@ void OverlayRenderer::render_line(CommandBuffer *cmd) {
     auto vert_count = _line_vert_pos.size();
     assert(vert_count == _line_vert_color.size());
     auto ctx = _view->context();
-    auto position_buffer = ctx->create_buffer(sizeof(glm::vec3) * vert_count,
-                                              VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
-                                              VMA_MEMORY_USAGE_CPU_TO_GPU);
-    auto color_buffer = ctx->create_buffer(sizeof(glm::vec4) * vert_count,
-                                           VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
-                                           VMA_MEMORY_USAGE_CPU_TO_GPU);
-
-    position_buffer->map_once([&](void *ptr) {
-        std::memcpy(ptr, _line_vert_pos.data(), sizeof(glm::vec3) * vert_count);
-    });
-    color_buffer->map_once([&](void *ptr) {
-        std::memcpy(
-            ptr, _line_vert_color.data(), sizeof(glm::vec4) * vert_count);
-    });
-
-    VkBuffer vert_buffers[2] = {position_buffer->buffer(),
-                                color_buffer->buffer()};
-    VkDeviceSize offset[2] = {};
+    auto positions = ctx->buffer_arena()->alloc(sizeof(glm::vec3) * vert_count);
+    auto colors = ctx->buffer_arena()->alloc(sizeof(glm::vec4) * vert_count);
+    positions.set_data(_line_vert_pos);
+    colors.set_data(_line_vert_color);
+
+    VkBuffer vert_buffers[2] = {positions.buffer->buffer(),
+                                colors.buffer->buffer()};
+    VkDeviceSize offset[2] = {positions.offset, colors.offset};
 
     cmd->BindVertexBuffers(0, 2, vert_buffers, offset);
 
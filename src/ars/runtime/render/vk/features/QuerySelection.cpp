@@ -55,6 +55,9 @@ std::vector<uint64_t> QuerySelection::query_selection(uint32_t x,
                                  VMA_MEMORY_USAGE_GPU_TO_CPU);
 
     auto scene = _view->scene_vk();
+    // Objects are drawn with transforms uploaded to the scene, which may be
+    // out of date if objects moved since the last render
+    scene->update_dirty_render_object_bounds();
     auto &rd_objs = scene->render_objects;
     auto rd_obj_count = rd_objs.size();
     auto &point_lights = scene->point_lights;
@@ -6,6 +6,30 @@
 #include "../Sky.h"
 
 namespace ars::render::vk {
+namespace {
+TextureCreateInfo hit_buffer_info() {
+    auto info =
+        TextureCreateInfo::sampled_2d(VK_FORMAT_R16G16B16A16_SFLOAT,
+                                      1,
+                                      1,
+                                      1,
+                                      VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE);
+    info.name = "SSR Hit Buffer";
+    info.usage |= VK_IMAGE_USAGE_STORAGE_BIT;
+    info.min_filter = VK_FILTER_NEAREST;
+    info.mag_filter = VK_FILTER_NEAREST;
+    return info;
+}
+
+TextureCreateInfo resolve_buffer_info() {
+    auto info =
+        TextureCreateInfo::sampled_2d(VK_FORMAT_R16G16B16A16_SFLOAT, 1, 1, 1);
+    info.name = "SSR Resolve Buffer";
+    info.usage |= VK_IMAGE_USAGE_STORAGE_BIT;
+    return info;
+}
+} // namespace
+
 void GenerateHierarchyZ::execute(CommandBuffer *cmd) {
     ARS_PROFILER_SAMPLE_VK(cmd, "Generate HiZ", 0xFF116622);
     init_hiz(cmd);
@@ -83,6 +107,7 @@ void GenerateHierarchyZ::render(RenderGraph &rg) {
         [&](RenderGraphPassBuilder &builder) {
             builder.compute_shader_read(NamedRT_Depth);
             builder.compute_shader_write(NamedRT_HiZBuffer);
+            builder.async_compute(true);
         },
         [this](CommandBuffer *cmd) { execute(cmd); });
 }
@@ -102,25 +127,23 @@ ScreenSpaceReflection::ScreenSpaceReflection(View *view) : _view(view) {
         ComputePipeline::create(ctx, "SSR/TemporalFilter.comp");
     _bilateral_filter_pipeline =
         ComputePipeline::create(ctx, "SSR/BilateralFilter.comp");
-
-    alloc_hit_buffer();
-    alloc_resolve_single_sample_buffer();
 }
 
 void ScreenSpaceReflection::trace_rays(RenderGraph &rg,
                                        IScreenSpaceReflectionEffect *settings,
-                                       bool diffuse) {
+                                       bool diffuse,
+                                       TransientTextureId hit_buffer_id) {
     auto pipeline = _hiz_trace_pipeline[diffuse].get();
     rg.add_pass(
         [&](RenderGraphPassBuilder &builder) {
             builder.compute_shader_read(NamedRT_HiZBuffer);
             builder.compute_shader_read(NamedRT_GBuffer1);
             builder.compute_shader_read(NamedRT_GBuffer2);
-            builder.compute_shader_write(_hit_buffer_id);
+            builder.compute_shader_write(hit_buffer_id);
         },
-        [=](CommandBuffer *cmd) {
+        [=, &rg](CommandBuffer *cmd) {
             ARS_PROFILER_SAMPLE_VK(cmd, "SSR Trace", 0xFF432134);
-            auto hit_buffer = _view->rt_manager()->get(_hit_buffer_id);
+            auto hit_buffer = rg.texture(hit_buffer_id);
             auto hiz_buffer = _view->render_target(NamedRT_HiZBuffer);
 
             auto dst_extent = hit_buffer->info().extent;
@@ -157,23 +180,12 @@ void ScreenSpaceReflection::trace_rays(RenderGraph &rg,
         });
 }
 
-void ScreenSpaceReflection::alloc_hit_buffer() {
-    auto info =
-        TextureCreateInfo::sampled_2d(VK_FORMAT_R16G16B16A16_SFLOAT,
-                                      1,
-                                      1,
-                                      1,
-                                      VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE);
-    info.usage |= VK_IMAGE_USAGE_STORAGE_BIT;
-    info.min_filter = VK_FILTER_NEAREST;
-    info.mag_filter = VK_FILTER_NEAREST;
-
-    // Trace at half resolution
-    _hit_buffer_id = _view->rt_manager()->alloc(info, 0.5f);
-}
-
 void ScreenSpaceReflection::resolve_reflection(
-    RenderGraph &rg, IScreenSpaceReflectionEffect *settings, bool diffuse) {
+    RenderGraph &rg,
+    IScreenSpaceReflectionEffect *settings,
+    bool diffuse,
+    TransientTextureId hit_buffer_id,
+    TransientTextureId resolve_buffer_id) {
     auto pipeline = _resolve_reflection_pipeline[diffuse].get();
     rg.add_pass(
         [&](RenderGraphPassBuilder &builder) {
@@ -181,13 +193,12 @@ void ScreenSpaceReflection::resolve_reflection(
             builder.compute_shader_read(NamedRT_GBuffer2);
             builder.compute_shader_read(NamedRT_Depth);
             builder.compute_shader_read(NamedRT_LinearColorHistory);
-            builder.compute_shader_read(_hit_buffer_id);
-            builder.compute_shader_write(_resolve_buffer_single_sample);
+            builder.compute_shader_read(hit_buffer_id);
+            builder.compute_shader_write(resolve_buffer_id);
         },
-        [=](CommandBuffer *cmd) {
+        [=, &rg](CommandBuffer *cmd) {
             pipeline->bind(cmd);
-            auto reflect_color_image =
-                _view->rt_manager()->get(_resolve_buffer_single_sample);
+            auto reflect_color_image = rg.texture(resolve_buffer_id);
             auto dst_extent = reflect_color_image->info().extent;
 
             DescriptorEncoder desc{};
@@ -197,8 +208,7 @@ void ScreenSpaceReflection::resolve_reflection(
             desc.set_texture(
                 0, 2, _view->render_target(NamedRT_GBuffer2).get());
             desc.set_texture(0, 3, _view->render_target(NamedRT_Depth).get());
-            desc.set_texture(
-                0, 4, _view->rt_manager()->get(_hit_buffer_id).get());
+            desc.set_texture(0, 4, rg.texture(hit_buffer_id).get());
             desc.set_texture(
                 0, 5, _view->render_target(NamedRT_LinearColorHistory).get());
 
@@ -222,33 +232,25 @@ void ScreenSpaceReflection::resolve_reflection(
         });
 }
 
-void ScreenSpaceReflection::alloc_resolve_single_sample_buffer() {
-    auto info =
-        TextureCreateInfo::sampled_2d(VK_FORMAT_R16G16B16A16_SFLOAT, 1, 1, 1);
-    info.usage |= VK_IMAGE_USAGE_STORAGE_BIT;
-
-    // Resolve at full resolution
-    _resolve_buffer_single_sample = _view->rt_manager()->alloc(info);
-    _bilateral_filter_back_buffer = _view->rt_manager()->alloc(info);
-}
-
 void ScreenSpaceReflection::render(RenderGraph &rg) {
     render(rg, false);
     render(rg, true);
 }
 
-void ScreenSpaceReflection::temporal_filtering(RenderGraph &rg,
-                                               NamedRT history_rt,
-                                               NamedRT result_rt,
-                                               bool history_valid) {
+void ScreenSpaceReflection::temporal_filtering(
+    RenderGraph &rg,
+    NamedRT history_rt,
+    NamedRT result_rt,
+    TransientTextureId resolve_buffer_id,
+    bool history_valid) {
     rg.add_pass(
         [&](RenderGraphPassBuilder &builder) {
             builder.compute_shader_read(NamedRT_Depth);
             builder.compute_shader_read(history_rt);
-            builder.compute_shader_read(_resolve_buffer_single_sample);
+            builder.compute_shader_read(resolve_buffer_id);
             builder.compute_shader_write(result_rt);
         },
-        [=](CommandBuffer *cmd) {
+        [=, &rg](CommandBuffer *cmd) {
             _temporal_filter_pipeline->bind(cmd);
             auto result_tex = _view->render_target(result_rt);
             auto dst_extent = result_tex->info().extent;
@@ -257,10 +259,7 @@ void ScreenSpaceReflection::temporal_filtering(RenderGraph &rg,
             desc.set_texture(0, 0, result_tex.get());
             desc.set_texture(0, 1, _view->render_target(NamedRT_Depth).get());
             desc.set_texture(0, 2, _view->render_target(history_rt).get());
-            desc.set_texture(
-                0,
-                3,
-                _view->rt_manager()->get(_resolve_buffer_single_sample).get());
+            desc.set_texture(0, 3, rg.texture(resolve_buffer_id).get());
 
             struct Param {
                 float blend_factor;
@@ -297,29 +296,29 @@ void ScreenSpaceReflection::render(RenderGraph &rg, bool diffuse) {
     }
 
     if (settings->enabled()) {
-        trace_rays(rg, settings, diffuse);
-        resolve_reflection(rg, settings, diffuse);
+        // Trace at half resolution and resolve at full resolution
+        auto hit_buffer = rg.create_transient(hit_buffer_info(), 0.5f);
+        auto resolve_buffer = rg.create_transient(resolve_buffer_info());
+
+        trace_rays(rg, settings, diffuse, hit_buffer);
+        resolve_reflection(rg, settings, diffuse, hit_buffer, resolve_buffer);
         if (diffuse) {
-            bilateral_filter(rg, 5.0f);
+            bilateral_filter(rg, resolve_buffer, 5.0f);
         }
-        temporal_filtering(rg, history_rt, result_rt, history_valid);
+        temporal_filtering(
+            rg, history_rt, result_rt, resolve_buffer, history_valid);
         history_valid = true;
     } else {
         history_valid = false;
     }
 }
 
-void ScreenSpaceReflection::bilateral_filter(RenderGraph &rg, float radius) {
-    bilateral_filter(rg,
-                     _resolve_buffer_single_sample,
-                     _bilateral_filter_back_buffer,
-                     radius,
-                     {0.0f, 1.0f});
-    bilateral_filter(rg,
-                     _bilateral_filter_back_buffer,
-                     _resolve_buffer_single_sample,
-                     radius,
-                     {1.0f, 0.0f});
+void ScreenSpaceReflection::bilateral_filter(RenderGraph &rg,
+                                             TransientTextureId rt,
+                                             float radius) {
+    auto back_buffer = rg.create_transient(resolve_buffer_info());
+    bilateral_filter(rg, rt, back_buffer, radius, {0.0f, 1.0f});
+    bilateral_filter(rg, back_buffer, rt, radius, {1.0f, 0.0f});
 }
 
 namespace {
@@ -331,8 +330,8 @@ struct BilateralFilterParam {
 } // namespace
 
 void ScreenSpaceReflection::bilateral_filter(RenderGraph &rg,
-                                             RenderTargetId src_rt,
-                                             RenderTargetId dst_rt,
+                                             TransientTextureId src_rt,
+                                             TransientTextureId dst_rt,
                                              float radius,
                                              const glm::vec2 &direction) {
     rg.add_pass(
@@ -340,11 +339,11 @@ void ScreenSpaceReflection::bilateral_filter(RenderGraph &rg,
             builder.compute_shader_read(src_rt);
             builder.compute_shader_write(dst_rt);
         },
-        [=](CommandBuffer *cmd) {
+        [=, &rg](CommandBuffer *cmd) {
             ARS_PROFILER_SAMPLE_VK(cmd, "Bilateral Filter", 0xFF716481);
             _bilateral_filter_pipeline->bind(cmd);
-            auto dst_tex = _view->rt_manager()->get(dst_rt);
-            auto src_tex = _view->rt_manager()->get(src_rt);
+            auto dst_tex = rg.texture(dst_rt);
+            auto src_tex = rg.texture(src_rt);
             auto dst_extent = dst_tex->info().extent;
 
             DescriptorEncoder desc{};
@@ -32,24 +32,26 @@ class ScreenSpaceReflection {
     void render(RenderGraph &rg, bool diffuse);
     void trace_rays(RenderGraph &rg,
                     IScreenSpaceReflectionEffect *settings,
-                    bool diffuse);
+                    bool diffuse,
+                    TransientTextureId hit_buffer_id);
     void resolve_reflection(RenderGraph &rg,
                             IScreenSpaceReflectionEffect *settings,
-                            bool diffuse);
+                            bool diffuse,
+                            TransientTextureId hit_buffer_id,
+                            TransientTextureId resolve_buffer_id);
     void temporal_filtering(RenderGraph &rg,
                             NamedRT history_rt,
                             NamedRT result_rt,
+                            TransientTextureId resolve_buffer_id,
                             bool history_valid);
-    void bilateral_filter(RenderGraph &rg, float radius);
+    void
+    bilateral_filter(RenderGraph &rg, TransientTextureId rt, float radius);
     void bilateral_filter(RenderGraph &rg,
-                          RenderTargetId src_rt,
-                          RenderTargetId dst_rt,
+                          TransientTextureId src_rt,
+                          TransientTextureId dst_rt,
                           float radius,
                           const glm::vec2 &direction);
 
-    void alloc_hit_buffer();
-    void alloc_resolve_single_sample_buffer();
-
     View *_view = nullptr;
     bool _reflection_history_valid[2]{};
     int32_t _frame_index = 0;
@@ -57,8 +59,5 @@ class ScreenSpaceReflection {
     std::unique_ptr<ComputePipeline> _resolve_reflection_pipeline[2];
     std::unique_ptr<ComputePipeline> _temporal_filter_pipeline;
     std::unique_ptr<ComputePipeline> _bilateral_filter_pipeline;
-    RenderTargetId _hit_buffer_id;
-    RenderTargetId _resolve_buffer_single_sample;
-    RenderTargetId _bilateral_filter_back_buffer;
 };
 } // namespace ars::render::vk
\ No newline at end of file
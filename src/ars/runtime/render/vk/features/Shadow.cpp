@@ -2,7 +2,7 @@
 #include "../Context.h"
 #include "../Profiler.h"
 #include "Drawer.h"
-#include <future>
+#include <ars/runtime/core/Jobs.h>
 
 namespace ars::render::vk {
 Shadow::Shadow(View *view) : _view(view) {}
@@ -23,6 +23,37 @@ void Shadow::render(RenderGraph &rg, const CullingResult &culling_result) {
 }
 
 void Shadow::read_back_hiz(RenderGraph &rg) {
+    auto &read_back = _hiz_read_backs[_view->context()->frame_index()];
+    auto hiz_info = _view->render_target(NamedRT_HiZBuffer)->info();
+
+    // Calculate level size
+    read_back.width =
+        std::max(1u, hiz_info.extent.width >> _hiz_buffer_capture_level);
+    read_back.height =
+        std::max(1u, hiz_info.extent.height >> _hiz_buffer_capture_level);
+    auto block_extent = 1u << _hiz_buffer_capture_level;
+    read_back.block_uv_size.x = static_cast<float>(block_extent) /
+                                static_cast<float>(hiz_info.extent.width);
+    read_back.block_uv_size.y = static_cast<float>(block_extent) /
+                                static_cast<float>(hiz_info.extent.height);
+    read_back.view = _view->data();
+
+    auto level = std::min(hiz_info.mip_levels - 1, _hiz_buffer_capture_level);
+
+    // Reserve buffer space
+    auto buffer_size_in_bytes =
+        read_back.width * read_back.height * 2 * sizeof(float);
+    if (read_back.buffer == nullptr ||
+        read_back.buffer->size() < buffer_size_in_bytes) {
+        read_back.buffer =
+            _view->context()->create_buffer(buffer_size_in_bytes,
+                                            VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                            VMA_MEMORY_USAGE_GPU_TO_CPU);
+    }
+
+    auto buffer = read_back.buffer;
+    auto width = read_back.width;
+    auto height = read_back.height;
     rg.add_pass(
         [&](RenderGraphPassBuilder &builder) {
             builder.access(NamedRT_HiZBuffer,
@@ -30,53 +61,26 @@ void Shadow::read_back_hiz(RenderGraph &rg) {
                            VK_PIPELINE_STAGE_TRANSFER_BIT,
                            false,
                            VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
-            builder.has_side_effect(true);
+            builder.transfer_write(buffer);
         },
         [=](CommandBuffer *cmd) {
             ARS_PROFILER_SAMPLE_VK(cmd, "Read Back HiZ", 0xFF17B13A);
             auto hiz = _view->render_target(NamedRT_HiZBuffer);
-            auto hiz_info = hiz->info();
-            // Calculate level size
-            _hiz_buffer_width = std::max(
-                1u, hiz_info.extent.width >> _hiz_buffer_capture_level);
-            _hiz_buffer_height = std::max(
-                1u, hiz_info.extent.height >> _hiz_buffer_capture_level);
-            auto block_extent = 1u << _hiz_buffer_capture_level;
-            _hiz_block_uv_size.x = static_cast<float>(block_extent) /
-                                   static_cast<float>(hiz_info.extent.width);
-            _hiz_block_uv_size.y = static_cast<float>(block_extent) /
-                                   static_cast<float>(hiz_info.extent.height);
-
-            auto level =
-                std::min(hiz_info.mip_levels - 1, _hiz_buffer_capture_level);
-
-            // Reserve buffer space
-            auto buffer_size_in_bytes =
-                _hiz_buffer_width * _hiz_buffer_height * 2 * sizeof(float);
-            if (_last_frame_hiz_data == nullptr ||
-                _last_frame_hiz_data->size() < buffer_size_in_bytes) {
-                _last_frame_hiz_data = _view->context()->create_buffer(
-                    buffer_size_in_bytes,
-                    VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-                    VMA_MEMORY_USAGE_GPU_TO_CPU);
-            }
 
             // Do copy
             VkBufferImageCopy region{};
-            region.imageExtent.width = _hiz_buffer_width;
-            region.imageExtent.height = _hiz_buffer_height;
+            region.imageExtent.width = width;
+            region.imageExtent.height = height;
             region.imageExtent.depth = 1;
             region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
             region.imageSubresource.baseArrayLayer = 0;
             region.imageSubresource.layerCount = 1;
             region.imageSubresource.mipLevel = level;
 
-            cmd->CopyImageToBuffer(hiz->image(),
-                                   hiz->layout(),
-                                   _last_frame_hiz_data->buffer(),
-                                   1,
-                                   &region);
+            cmd->CopyImageToBuffer(
+                hiz->image(), hiz->layout(), buffer->buffer(), 1, &region);
         });
+    rg.read_back(buffer);
 }
 
 namespace {
@@ -154,24 +158,24 @@ glm::vec4 calculate_valid_viewport(glm::vec2 *hiz_pixels,
 
 SampleDistribution Shadow::calculate_sample_distribution() {
     ARS_PROFILER_SAMPLE("Calculate Depth Sample Dist", 0xFF999411);
-    if (_last_frame_hiz_data == nullptr) {
+    auto &read_back = _hiz_read_backs[_view->context()->frame_index()];
+    if (read_back.buffer == nullptr) {
         return {};
     }
 
-    auto hiz_pixels =
-        reinterpret_cast<glm::vec2 *>(_last_frame_hiz_data->map());
-    ARS_DEFER([&]() { _last_frame_hiz_data->unmap(); });
+    auto hiz_pixels = reinterpret_cast<glm::vec2 *>(read_back.buffer->map());
+    ARS_DEFER([&]() { read_back.buffer->unmap(); });
 
     float min_depth01, max_depth01;
     calculate_hiz_depth01_range(hiz_pixels,
-                                _hiz_buffer_width,
-                                _hiz_buffer_height,
+                                read_back.width,
+                                read_back.height,
                                 min_depth01,
                                 max_depth01);
 
     SampleDistribution dist{};
 
-    auto last_frame_view = _view->last_frame_data();
+    auto last_frame_view = read_back.view;
     auto last_frame_P = last_frame_view.projection_matrix();
     auto last_frame_I_P = glm::inverse(last_frame_P);
     auto last_frame_frustum_ws = last_frame_view.frustum_ws();
@@ -209,13 +213,13 @@ SampleDistribution Shadow::calculate_sample_distribution() {
 
         auto viewport = calculate_valid_viewport(
             hiz_pixels,
-            _hiz_buffer_width,
-            _hiz_buffer_height,
-            _hiz_block_uv_size,
+            read_back.width,
+            read_back.height,
+            read_back.block_uv_size,
             linear_z_to_depth01(last_frame_P, partition_z_far),
             linear_z_to_depth01(last_frame_P, partition_z_near));
 
-        auto viewport_padding = 0.5f * _hiz_block_uv_size;
+        auto viewport_padding = 0.5f * read_back.block_uv_size;
 
         auto effective_frustum_ws = last_frame_frustum_ws.crop({
             {viewport.x - viewport_padding.x,
@@ -281,54 +285,56 @@ void ShadowMap::render(const math::XformTRS<float> &xform,
             Framebuffer *fb = ctx->create_tmp_framebuffer(rp, {_texture});
             // clear all rts to zero
             VkClearValue clear_values[1]{};
+            auto drawer = view->drawer();
             auto rp_exec =
-                rp->begin(cmd, fb, clear_values, VK_SUBPASS_CONTENTS_INLINE);
-
-            std::future<std::vector<DrawRequest>>
-                shadow_draw_requests[SHADOW_CASCADE_COUNT]{};
+                rp->begin(cmd, fb, clear_values, drawer->subpass_contents());
 
             {
                 ARS_PROFILER_SAMPLE("Shadow Culling", 0xFF771128);
+                jobs::Counter culling_counter{};
                 for (int i = 0; i < SHADOW_CASCADE_COUNT; i++) {
-                    shadow_draw_requests[i] =
-                        std::async(std::launch::async, [i, this, scene]() {
+                    jobs::run(
+                        [i, this, scene, drawer]() {
                             auto &cam = _cascade_cameras[i];
                             float w_div_h = cam.viewport.w / cam.viewport.h;
                             auto shadow_cull_obj = scene->cull(
                                 cam.xform, cam.camera.frustum(w_div_h));
 
-                            return shadow_cull_obj.gather_draw_requests(
-                                RenderPassID_Shadow);
-                        });
-                }
-
-                for (auto &fut : shadow_draw_requests) {
-                    fut.wait();
+                            drawer->update(_cascade_draw_lists[i],
+                                           RenderPassID_Shadow,
+                                           shadow_cull_obj);
+                        },
+                        &culling_counter);
                 }
+                jobs::wait(&culling_counter);
             }
 
-            // Render each cascades
-            for (int i = 0; i < SHADOW_CASCADE_COUNT; i++) {
-                auto &cam = _cascade_cameras[i];
-                fb->set_viewport_scissor(cmd,
-                                         cam.viewport.x,
-                                         cam.viewport.y,
-                                         cam.viewport.w,
-                                         cam.viewport.h);
-
-                DrawCallbacks callbacks{};
-                callbacks.on_pipeline_bound = [&](CommandBuffer *cmd) {
-                    // Negative sign to bias because we use inverse z
-                    cmd->SetDepthBias(-_constant_bias, 0.0f, -_slope_bias);
-                };
-
-                float w_div_h = cam.viewport.w / cam.viewport.h;
-                view->drawer()->draw(cmd,
-                                     cam.camera.projection_matrix(w_div_h),
-                                     glm::inverse(cam.xform.matrix_no_scale()),
-                                     shadow_draw_requests[i].get(),
-                                     callbacks);
-            }
+            // Render each cascades, in parallel if the drawer records
+            // secondary command buffers
+            DrawCallbacks callbacks{};
+            callbacks.on_pipeline_bound = [&](CommandBuffer *cmd) {
+                // Negative sign to bias because we use inverse z
+                cmd->SetDepthBias(-_constant_bias, 0.0f, -_slope_bias);
+            };
+
+            rp->record(
+                rp_exec,
+                SHADOW_CASCADE_COUNT,
+                [&](CommandBuffer *cascade_cmd, uint32_t i) {
+                    auto &cam = _cascade_cameras[i];
+                    fb->set_viewport_scissor(cascade_cmd,
+                                             cam.viewport.x,
+                                             cam.viewport.y,
+                                             cam.viewport.w,
+                                             cam.viewport.h);
+
+                    float w_div_h = cam.viewport.w / cam.viewport.h;
+                    drawer->draw(cascade_cmd,
+                                 cam.camera.projection_matrix(w_div_h),
+                                 glm::inverse(cam.xform.matrix_no_scale()),
+                                 _cascade_draw_lists[i],
+                                 callbacks);
+                });
 
             rp->end(rp_exec);
         });
@@ -2,6 +2,8 @@
 
 #include "../RenderGraph.h"
 #include "../View.h"
+#include "Drawer.h"
+#include <array>
 
 namespace ars::render::vk {
 struct CullingResult;
@@ -66,6 +68,7 @@ class ShadowMap {
     float _slope_bias = 3.0f;
     float _constant_bias = 100.0f;
     CascadeCamera _cascade_cameras[SHADOW_CASCADE_COUNT]{};
+    std::array<RetainedDrawList, SHADOW_CASCADE_COUNT> _cascade_draw_lists{};
 };
 
 class Shadow {
@@ -77,12 +80,20 @@ class Shadow {
   private:
     SampleDistribution calculate_sample_distribution();
 
+    struct HiZReadBack {
+        Handle<Buffer> buffer{};
+        // Width and height in pixels
+        uint32_t width = 0;
+        uint32_t height = 0;
+        glm::vec2 block_uv_size = {};
+        // The view when HiZ is captured
+        ViewData view{};
+    };
+
     View *_view = nullptr;
-    Handle<Buffer> _last_frame_hiz_data{};
-    // Width and height in pixels
-    uint32_t _hiz_buffer_width = 0;
-    uint32_t _hiz_buffer_height = 0;
+    // Indexed by Context::frame_index(). The frame slot is recycled before
+    // rendering, so the read back of the same slot is complete.
+    std::array<HiZReadBack, MAX_FRAMES_IN_FLIGHT> _hiz_read_backs{};
     uint32_t _hiz_buffer_capture_level = 6; // Split screen into 64x64 block
-    glm::vec2 _hiz_block_uv_size = {};
 };
 } // namespace ars::render::vk
\ No newline at end of file
@@ -19,9 +19,10 @@ create_material_property_layout(Context *context,
     }
     return {};
 }
+} // namespace
 
 std::shared_ptr<GraphicsPipeline>
-create_material_pass_template(Context *context,
+create_material_pass_pipeline(Context *context,
                               const MaterialInfo &mat_info,
                               const MaterialPassInfo &pass_info) {
     switch (mat_info.shading_model) {
@@ -33,26 +34,12 @@ create_material_pass_template(Context *context,
     }
     return {};
 }
-} // namespace
 
 std::unique_ptr<MaterialPrototype>
 create_material_prototype(Context *context, const MaterialInfo &mat_info) {
     auto proto = std::make_unique<MaterialPrototype>();
     proto->info = mat_info;
     proto->property_layout = create_material_property_layout(context, mat_info);
-    for (int id = 0; id < RenderPassID_Count; id++) {
-        MaterialPassInfo pass_info{};
-        pass_info.pass_id = static_cast<RenderPassID>(id);
-
-        pass_info.skinned = false;
-        proto->passes[pass_info.encode()] =
-            create_material_pass_template(context, mat_info, pass_info);
-
-        pass_info.skinned = true;
-        proto->passes[pass_info.encode()] =
-            create_material_pass_template(context, mat_info, pass_info);
-    }
-
     return proto;
 }
 
@@ -21,6 +21,12 @@ create_draw_pipeline(Context *context,
                      const VkPipelineRasterizationStateCreateInfo *raster,
                      std::vector<const char *> common_flags);
 
+// Pipelines of the passes are not created, see MaterialFactory
 std::unique_ptr<MaterialPrototype>
 create_material_prototype(Context *context, const MaterialInfo &mat_info);
+
+std::shared_ptr<GraphicsPipeline>
+create_material_pass_pipeline(Context *context,
+                              const MaterialInfo &mat_info,
+                              const MaterialPassInfo &pass_info);
 } // namespace ars::render::vk
\ No newline at end of file
@@ -35,13 +35,17 @@ layout(location = 6) in vec4 in_weights;
 #endif
 
 struct Instance {
-    mat4 MV;
-    mat4 I_MV;
+    uint object_id;
     uint material_id;
     uint instance_id;
     uint custom_id;
 };
 
+struct ObjectTransform {
+    mat4 M;
+    mat4 I_M;
+};
+
 layout(set = 0, binding = 0) uniform View {
     ViewTransform ars_view;
 };
@@ -58,8 +62,19 @@ Instance get_instance() {
     return ars_instances[ars_in_instance_id];
 }
 
+// World transforms of render objects, indexed by object_id of instances
+layout(set = 0, binding = 4, std430) buffer ObjectTransforms {
+    ObjectTransform ars_object_transforms[];
+};
+
+ObjectTransform get_object_transform() {
+    return ars_object_transforms[get_instance().object_id];
+}
+
 #ifndef ARS_EMPTY_MATERIAL
 
+// Property blocks of all materials of the layout, indexed by material_id of
+// instances
 layout(set = 0, binding = 2, std430) buffer Materials {
     Material ars_materials[];
 };
@@ -97,11 +112,11 @@ layout(location = 4) out vec3 out_bitangent_vs;
 layout(location = 5) out vec2 out_uv;
 
 void main() {
-    Instance inst = get_instance();
+    ObjectTransform xform = get_object_transform();
     vec3 bitangent_os = calculate_bitangent(in_normal_os, in_tangent_os);
 
-    mat4 MV = inst.MV;
-    mat4 I_MV = inst.I_MV;
+    mat4 MV = get_view().V * xform.M;
+    mat4 I_MV = xform.I_M * get_view().I_V;
 
 #ifdef ARS_SKINNED
     // Skinned mesh should ignore model transform, otherwise the parent xform
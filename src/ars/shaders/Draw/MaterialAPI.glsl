@@ -1,12 +1,18 @@
 #extension GL_EXT_nonuniform_qualifier : require
 
-// #ifdef ARS_SUPPORT_BINDLESS
-// #define ARS_BINDLESS_SAMPLER_2D_COUNT
-// #else
+#ifdef ARS_SUPPORT_BINDLESS
+// All sampled 2D textures, indexed by their bindless ids, see BindlessResources
+// and BINDLESS_SET
+layout(set = 3, binding = 0) uniform sampler2D ars_samplers_2d[];
+
+vec4 sample_tex_2d(uint index, vec2 uv) {
+    // Instances of a batch may use different materials
+    return texture(ars_samplers_2d[nonuniformEXT(index)], uv);
+}
+#else
 // If the platform does not have proper bindless support, use simple descriptor
 // indexing, and give bindless resources count an upper bound
 #define ARS_BINDLESS_SAMPLER_2D_COUNT 8
-// #endif
 
 layout(set = 0, binding = 3) uniform sampler2D
     ars_samplers_2d[ARS_BINDLESS_SAMPLER_2D_COUNT];
@@ -14,6 +20,7 @@ layout(set = 0, binding = 3) uniform sampler2D
 vec4 sample_tex_2d(uint index, vec2 uv) {
     return texture(ars_samplers_2d[index], uv);
 }
+#endif
 
 struct SurfaceAttribute {
     vec3 position;
@@ -0,0 +1,14 @@
+# Write a hash of the SPIR-V embedded by frill to a header. The header is only
+# rewritten when the hash changes, so unchanged shaders don't trigger rebuilds.
+file(SHA256 ${SPIRV_SOURCE} spirv_hash)
+string(SUBSTRING ${spirv_hash} 0 16 spirv_hash)
+set(content
+    "#pragma once\n\n#define ARS_EMBEDDED_SPIRV_HASH 0x${spirv_hash}ull\n")
+
+set(old_content "")
+if (EXISTS ${HASH_HEADER})
+    file(READ ${HASH_HEADER} old_content)
+endif ()
+if (NOT "${old_content}" STREQUAL "${content}")
+    file(WRITE ${HASH_HEADER} "${content}")
+endif ()
@@ -2,6 +2,7 @@
 
 #include <GBuffer.glsl>
 #include <Light.glsl>
+#include <LightCluster.glsl>
 #include <MetallicRoughnessPBR.glsl>
 #include <Misc.glsl>
 #include <Sampling.glsl>
@@ -65,7 +66,20 @@ vec3 get_glossy_irradiance(ShadingPoint sp,
 // Light position and direction are in view space
 #if defined(LIT_POINT_LIGHT)
 layout(set = 1, binding = 0) uniform Param {
-    PointLight light;
+    LightClusterGrid grid;
+};
+
+layout(std430, set = 1, binding = 1) readonly buffer PointLights {
+    PointLight point_lights[];
+};
+
+// (offset, count) of each cluster in light_indices
+layout(std430, set = 1, binding = 2) readonly buffer Clusters {
+    uvec2 clusters[];
+};
+
+layout(std430, set = 1, binding = 3) readonly buffer LightIndices {
+    uint light_indices[];
 };
 #endif
 
@@ -165,6 +179,17 @@ vec3 get_transmittance(ShadingPoint sp, vec3 l_vs) {
     return t;
 }
 
+vec3 shade_direct_light(MetallicRoughnessPBR brdf,
+                        vec3 fd,
+                        vec3 n_vs,
+                        vec3 v_vs,
+                        vec3 lr,
+                        vec3 l_vs) {
+    float NoL = clamp01(dot(n_vs, l_vs));
+    vec3 fr = specular_BRDF(brdf, n_vs, v_vs, l_vs);
+    return (fd + fr) * NoL * lr;
+}
+
 vec3 shade_metallic_roughness_pbr(GBuffer gbuffer, ShadingPoint sp) {
     MetallicRoughnessPBR brdf = get_metallic_roughness_pbr(gbuffer);
 
@@ -196,16 +221,24 @@ vec3 shade_metallic_roughness_pbr(GBuffer gbuffer, ShadingPoint sp) {
     radiance += gbuffer.emission;
 #endif
 
-#if defined(LIT_DIRECTIONAL_LIGHT) || defined(LIT_POINT_LIGHT) ||              \
-    defined(LIT_SUN)
+#if defined(LIT_DIRECTIONAL_LIGHT) || defined(LIT_SUN)
     vec3 lr, l_vs;
     radiance_to_point(light, pos_vs, lr, l_vs);
 
     lr *= get_transmittance(sp, l_vs);
 
-    float NoL = clamp01(dot(n_vs, l_vs));
-    vec3 fr = specular_BRDF(brdf, n_vs, v_vs, l_vs);
-    radiance += (fd + fr) * NoL * lr;
+    radiance += shade_direct_light(brdf, fd, n_vs, v_vs, lr, l_vs);
+#endif
+
+#if defined(LIT_POINT_LIGHT)
+    uvec3 cluster = locate_light_cluster(grid, sp.screen_uv, -pos_vs.z);
+    uvec2 light_list = clusters[get_light_cluster_index(grid, cluster)];
+    for (uint i = 0; i < light_list.y; i++) {
+        PointLight light = point_lights[light_indices[light_list.x + i]];
+        vec3 lr, l_vs;
+        radiance_to_point(light, pos_vs, lr, l_vs);
+        radiance += shade_direct_light(brdf, fd, n_vs, v_vs, lr, l_vs);
+    }
 #endif
 
     return radiance;
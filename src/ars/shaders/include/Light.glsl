@@ -5,6 +5,8 @@
 
 struct PointLight {
     vec3 position;
+    // Radiance smoothly falls off to zero at range
+    float range;
     vec3 color;
     float intensity;
 };
@@ -15,7 +17,10 @@ void radiance_to_point(PointLight light,
                        out vec3 radiance,
                        out vec3 direction) {
     vec3 point_to_light = light.position - point;
-    float attenuation = 1.0 / max(dot(point_to_light, point_to_light), 1e-5);
+    float dist_sqr = dot(point_to_light, point_to_light);
+    float attenuation = 1.0 / max(dist_sqr, 1e-5);
+    float window = clamp01(1.0 - square(dist_sqr / square(light.range)));
+    attenuation *= square(window);
     radiance = attenuation * light.color * light.intensity / (4.0 * PI);
     direction = normalize(point_to_light);
 }
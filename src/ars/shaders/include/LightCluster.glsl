@@ -0,0 +1,82 @@
+#ifndef ARS_LIGHT_CLUSTER_GLSL
+#define ARS_LIGHT_CLUSTER_GLSL
+
+// Point lights are binned into a froxel grid, which is uniform in screen space
+// and exponential in view space depth. See LightCulling.h for details.
+struct LightClusterGrid {
+    mat4 I_P;
+    uvec3 size;
+    uint light_count;
+    uint max_light_count_per_cluster;
+    // Positive linear z range for exponential slicing
+    float z_near;
+    float z_far;
+};
+
+uint get_light_cluster_index(LightClusterGrid grid, uvec3 cluster) {
+    return cluster.x + grid.size.x * (cluster.y + grid.size.y * cluster.z);
+}
+
+// linear_z is the POSITIVE view space depth.
+// Points out of the grid are clamped to the nearest cluster.
+uvec3 locate_light_cluster(LightClusterGrid grid, vec2 uv, float linear_z) {
+    ivec2 xy = ivec2(floor(uv * vec2(grid.size.xy)));
+    int z = int(floor(log(max(linear_z, 1e-6) / grid.z_near) /
+                      log(grid.z_far / grid.z_near) * float(grid.size.z)));
+    return uvec3(clamp(ivec3(xy, z), ivec3(0), ivec3(grid.size) - 1));
+}
+
+float get_light_cluster_slice_linear_z(LightClusterGrid grid, uint slice) {
+    if (slice == 0) {
+        return 0.0;
+    }
+    float t = float(slice) / float(grid.size.z);
+    return grid.z_near * pow(grid.z_far / grid.z_near, t);
+}
+
+vec3 unproject_hclip(mat4 I_P, vec3 p_hclip) {
+    vec4 p = I_P * vec4(p_hclip, 1.0);
+    return p.xyz / p.w;
+}
+
+// Intersect the line through the NDC point at two depths with view space plane
+// z == -linear_z. Depths are chosen to be finite for both perspective and
+// orthographic projection with reversed-Z.
+vec3 get_point_on_plane_vs(mat4 I_P, vec2 ndc, float linear_z) {
+    vec3 p0 = unproject_hclip(I_P, vec3(ndc, 1.0));
+    vec3 p1 = unproject_hclip(I_P, vec3(ndc, 0.5));
+    float t = (-linear_z - p0.z) / (p1.z - p0.z);
+    return p0 + t * (p1 - p0);
+}
+
+void get_light_cluster_aabb_vs(LightClusterGrid grid,
+                               uvec3 cluster,
+                               out vec3 aabb_min,
+                               out vec3 aabb_max) {
+    vec2 ndc_min = vec2(cluster.xy) / vec2(grid.size.xy) * 2.0 - 1.0;
+    vec2 ndc_max = vec2(cluster.xy + 1) / vec2(grid.size.xy) * 2.0 - 1.0;
+    float slice_z[2] = {get_light_cluster_slice_linear_z(grid, cluster.z),
+                        get_light_cluster_slice_linear_z(grid, cluster.z + 1)};
+
+    aabb_min = get_point_on_plane_vs(grid.I_P, ndc_min, slice_z[0]);
+    aabb_max = aabb_min;
+    for (int s = 0; s < 2; s++) {
+        for (int i = 0; i < 4; i++) {
+            vec2 ndc = vec2((i & 1) != 0 ? ndc_max.x : ndc_min.x,
+                            (i & 2) != 0 ? ndc_max.y : ndc_min.y);
+            vec3 p = get_point_on_plane_vs(grid.I_P, ndc, slice_z[s]);
+            aabb_min = min(aabb_min, p);
+            aabb_max = max(aabb_max, p);
+        }
+    }
+}
+
+bool intersect_sphere_aabb(vec3 center,
+                           float radius,
+                           vec3 aabb_min,
+                           vec3 aabb_max) {
+    vec3 d = clamp(center, aabb_min, aabb_max) - center;
+    return dot(d, d) <= radius * radius;
+}
+
+#endif